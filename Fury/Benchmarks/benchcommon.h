@@ -0,0 +1,227 @@
+#pragma once
+/*
+Shared plumbing for the standalone benchmarks: timing, working set sizes, machine-readable results and
+comparison against a stored baseline. Header-only and free of DirectX, so every benchmark builds on its own.
+
+Results are CSV lines of the form
+	kernel,working set,ns per op
+and a baseline file has the same columns plus an optional fourth, the allowed slowdown for that row as a
+fraction (0.25 means 25% slower than the baseline fails). Rows without one use the --threshold option.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	/**A working set size, chosen to sit in one level of the memory hierarchy.*/
+	struct WorkingSet
+	{
+		const char* name;
+		size_t bytes;
+	};
+
+	/**Sizes that fit in L1, in L2, and spill out to DRAM on any current desktop CPU.*/
+	const WorkingSet kWorkingSets[] = {
+		{ "L1", 16 * 1024 },
+		{ "L2", 192 * 1024 },
+		{ "DRAM", 64 * 1024 * 1024 },
+	};
+
+	/**Prevents the optimiser from discarding a result.*/
+	inline void consume(float value)
+	{
+		static volatile float sink;
+		sink = value;
+		(void)sink;
+	}
+
+	/**One measured kernel.*/
+	struct Result
+	{
+		std::string kernel;
+		std::string workingSet;
+		double nsPerOp;
+	};
+
+	/**Runs func, which performs opsPerCall operations, until at least minSeconds have passed, and returns the
+	fastest call in nanoseconds per operation. Taking the minimum filters out scheduling noise.*/
+	template<class Func>
+	double measure(Func func, size_t opsPerCall, double minSeconds = 0.1)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		func(); //Warm up caches and page in the data.
+
+		double best = 1e300;
+		const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(minSeconds));
+		int calls = 0;
+		do
+		{
+			Clock::time_point start = Clock::now();
+			func();
+			Clock::time_point end = Clock::now();
+			best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / double(opsPerCall));
+		} while (++calls < 3 || Clock::now() < deadline);
+
+		return best;
+	}
+
+	/**A float in [-1, 1]. Deterministic across runs, so the baseline always sees the same data.*/
+	inline float randomFloat()
+	{
+		static unsigned state = 12345;
+		state = state * 1664525u + 1013904223u;
+		return float(state >> 8) / float(1 << 24) * 2.f - 1.f;
+	}
+
+	/**Collects results, prints them, and checks them against a baseline.*/
+	class Suite
+	{
+	public:
+		/**Parses the command line:
+		--baseline <file>        compare against the file and fail on regressions
+		--threshold <fraction>   default allowed slowdown, 0.25 if not given
+		--write-baseline <file>  store the results as a new baseline
+		--filter <text>          only run kernels whose name contains the text
+		--quick                  skip the DRAM working set*/
+		Suite(int argc, char** argv) : mThreshold(0.25), mQuick(false)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				std::string arg = argv[i];
+				bool hasValue = i + 1 < argc;
+				if (arg == "--baseline" && hasValue)
+					mBaselinePath = argv[++i];
+				else if (arg == "--threshold" && hasValue)
+					mThreshold = std::atof(argv[++i]);
+				else if (arg == "--write-baseline" && hasValue)
+					mWritePath = argv[++i];
+				else if (arg == "--filter" && hasValue)
+					mFilter = argv[++i];
+				else if (arg == "--quick")
+					mQuick = true;
+				else
+					std::fprintf(stderr, "Ignoring unknown argument %s\n", arg.c_str());
+			}
+			std::printf("kernel,working set,ns per op\n");
+		}
+
+		/**Whether the kernel should run given the filter.*/
+		bool wants(const char* kernel) const
+		{
+			return mFilter.empty() || std::strstr(kernel, mFilter.c_str()) != nullptr;
+		}
+
+		/**Whether the working set should run given --quick.*/
+		bool wants(const WorkingSet& set) const
+		{
+			return !mQuick || set.bytes < 1024 * 1024;
+		}
+
+		void add(const char* kernel, const WorkingSet& set, double nsPerOp)
+		{
+			Result r = { kernel, set.name, nsPerOp };
+			mResults.push_back(r);
+			std::printf("%s,%s,%.3f\n", kernel, set.name, nsPerOp);
+			std::fflush(stdout);
+		}
+
+		/**Writes the baseline if asked and compares against one if given.
+		Returns the process exit code: 0 on success, 1 if anything regressed past its threshold, 2 on I/O errors.*/
+		int finish() const
+		{
+			if (!mWritePath.empty())
+			{
+				std::ofstream out(mWritePath.c_str());
+				if (!out)
+				{
+					std::fprintf(stderr, "Could not write baseline %s\n", mWritePath.c_str());
+					return 2;
+				}
+				out << "kernel,working set,ns per op,threshold\n";
+				for (size_t i = 0; i < mResults.size(); ++i)
+					out << mResults[i].kernel << ',' << mResults[i].workingSet << ',' << mResults[i].nsPerOp << ",\n";
+			}
+
+			if (mBaselinePath.empty())
+				return 0;
+
+			std::map<std::string, std::pair<double, double> > baseline;
+			if (!readBaseline(baseline))
+				return 2;
+
+			int regressions = 0;
+			std::fprintf(stderr, "\n%-36s %6s %10s %10s %8s\n", "kernel", "set", "baseline", "now", "change");
+			for (size_t i = 0; i < mResults.size(); ++i)
+			{
+				const Result& r = mResults[i];
+				auto it = baseline.find(r.kernel + ',' + r.workingSet);
+				if (it == baseline.end())
+				{
+					std::fprintf(stderr, "%-36s %6s %10s %10.3f %8s\n", r.kernel.c_str(), r.workingSet.c_str(), "-",
+						r.nsPerOp, "new");
+					continue;
+				}
+
+				const double base = it->second.first;
+				const double threshold = it->second.second >= 0 ? it->second.second : mThreshold;
+				const double change = r.nsPerOp / base - 1;
+				const bool regressed = change > threshold;
+				regressions += regressed ? 1 : 0;
+				std::fprintf(stderr, "%-36s %6s %10.3f %10.3f %+7.1f%%%s\n", r.kernel.c_str(), r.workingSet.c_str(),
+					base, r.nsPerOp, change * 100, regressed ? "  REGRESSED" : "");
+			}
+
+			if (regressions)
+				std::fprintf(stderr, "\n%d kernel(s) regressed past their threshold.\n", regressions);
+			else
+				std::fprintf(stderr, "\nNo regressions.\n");
+			return regressions ? 1 : 0;
+		}
+
+	private:
+		bool readBaseline(std::map<std::string, std::pair<double, double> >& baseline) const
+		{
+			std::ifstream in(mBaselinePath.c_str());
+			if (!in)
+			{
+				std::fprintf(stderr, "Could not read baseline %s\n", mBaselinePath.c_str());
+				return false;
+			}
+
+			std::string line;
+			std::getline(in, line); //Header
+			while (std::getline(in, line))
+			{
+				std::vector<std::string> fields;
+				std::stringstream ss(line);
+				std::string field;
+				while (std::getline(ss, field, ','))
+					fields.push_back(field);
+				if (fields.size() < 3)
+					continue;
+
+				const double threshold = fields.size() > 3 && !fields[3].empty() ? std::atof(fields[3].c_str()) : -1;
+				baseline[fields[0] + ',' + fields[1]] = std::make_pair(std::atof(fields[2].c_str()), threshold);
+			}
+			return true;
+		}
+
+		std::vector<Result> mResults;
+		std::string mBaselinePath;
+		std::string mWritePath;
+		std::string mFilter;
+		double mThreshold;
+		bool mQuick;
+	};
+}
@@ -0,0 +1,244 @@
+/*
+BVH benchmark: building, refitting and querying the tree over 10k to 1M spheres of radius 1, scattered evenly
+through a cube sized so that the spacing stays the same, about 4 units, whatever the count. The tree is built by
+inserting the spheres one at a time and by rebuild(), and refit with 1% of the spheres moving each frame. Queries
+are a camera frustum reaching 100 units into the cube, a sphere and a box of radius 10, and a ray looking for the
+nearest sphere; the frustum and ray queries are also done by testing every sphere, to compare. Every query is
+checked against the linear search it replaces. Does not depend on DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -I. Benchmarks/bvhbench.cpp bvh.cpp frustum.cpp matrixd.cpp -o bvhbench
+	cl /O2 /EHsc /I. Benchmarks\bvhbench.cpp bvh.cpp frustum.cpp matrixd.cpp
+
+Results are in the CSV format of benchcommon.h: nanoseconds per sphere for building and refitting, per moving
+sphere for the refit, and per query for the queries. --quick keeps only the 10k sphere scene. The number of
+spheres each query found goes to stderr. The exit code is 1 if a query disagreed with the linear search.
+*/
+
+#include "benchcommon.h"
+#include "bvh.h"
+#include <cmath>
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	const float kRadius = 1.f;
+	const float kQueryRadius = 10.f;
+	const size_t kQueries = 256;
+
+	struct Spheres
+	{
+		std::vector<math::vec3> centres;
+		float halfSize;
+
+		explicit Spheres(size_t count) : centres(count), halfSize(2.f * std::cbrt(float(count)))
+		{
+			for (size_t i = 0; i < count; ++i)
+				centres[i] = math::vec3(randomFloat(), randomFloat(), randomFloat()) * halfSize;
+		}
+	};
+
+	/**Where the ray origin + t * direction first meets the sphere, or a negative number if it misses.*/
+	float raySphere(const math::vec3& origin, const math::vec3& direction, const math::vec3& centre, float radius)
+	{
+		const math::vec3 offset = origin - centre;
+		const float b = math::dot(offset, direction);
+		const float c = math::dot(offset, offset) - radius * radius;
+		const float discriminant = b * b - c;
+		if (discriminant < 0)
+			return -1;
+		return -b - std::sqrt(discriminant);
+	}
+
+	size_t indexOf(void* userData)
+	{
+		return size_t(userData);
+	}
+
+	bool benchBVH(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / 64;
+		Spheres scene(count);
+		bool agrees = true;
+
+		BVH bvh;
+		std::vector<BVH::Proxy> proxies(count);
+		if (suite.wants("BVH insert"))
+			suite.add("BVH insert", set, bench::measure([&]() {
+				BVH fresh;
+				for (size_t i = 0; i < count; ++i)
+					fresh.insert(AABB::fromSphere(scene.centres[i], kRadius), (void*)i);
+				bench::consume(float(fresh.height()));
+			}, count));
+
+		for (size_t i = 0; i < count; ++i)
+			proxies[i] = bvh.insert(AABB::fromSphere(scene.centres[i], kRadius), (void*)i);
+		std::fprintf(stderr, "BVH,%s: height %d after inserting\n", set.name, bvh.height());
+
+		if (suite.wants("BVH rebuild"))
+			suite.add("BVH rebuild", set, bench::measure([&]() {
+				bvh.rebuild();
+				bench::consume(float(bvh.height()));
+			}, count));
+		bvh.rebuild();
+		std::fprintf(stderr, "BVH,%s: height %d after rebuilding\n", set.name, bvh.height());
+
+		//The same spheres step back and forth by up to a radius, which takes some out of their leaves each time.
+		std::vector<size_t> moving;
+		for (size_t i = 0; i < count; i += 100)
+			moving.push_back(i);
+		if (suite.wants("BVH refit, 1% moving"))
+		{
+			float direction = 1;
+			suite.add("BVH refit, 1% moving", set, bench::measure([&]() {
+				for (size_t m = 0; m < moving.size(); ++m)
+				{
+					math::vec3& centre = scene.centres[moving[m]];
+					centre.x += direction * kRadius * 0.5f;
+					bvh.move(proxies[moving[m]], AABB::fromSphere(centre, kRadius));
+				}
+				bvh.refit();
+				direction = -direction;
+				bench::consume(float(bvh.height()));
+			}, moving.size()));
+		}
+
+		//Queries from random points inside the cube; the frustum looks down a random axis.
+		std::vector<math::vec3> origins(kQueries), directions(kQueries);
+		std::vector<Frustum> frustums(kQueries);
+		const math::mat4 projection = math::mat4().initProjection(0.7f, 1280, 720, 0.1f, 100.f);
+		for (size_t q = 0; q < kQueries; ++q)
+		{
+			origins[q] = math::vec3(randomFloat(), randomFloat(), randomFloat()) * scene.halfSize;
+			directions[q] = math::vec3(randomFloat(), randomFloat(), randomFloat()).normalize();
+			const math::mat4 view = math::mat4().initRotation(randomFloat() * 3.1416f, 0, 1, 0) *
+				math::mat4().initTranslation(origins[q] * -1);
+			frustums[q] = Frustum(projection * view);
+		}
+
+		size_t found = 0, foundLinear = 0;
+		if (suite.wants("BVH frustum query"))
+		{
+			suite.add("BVH frustum query", set, bench::measure([&]() {
+				found = 0;
+				for (size_t q = 0; q < kQueries; ++q)
+					bvh.queryFrustum(frustums[q], [&](void* userData) {
+						found += frustums[q].intersectsSphere(scene.centres[indexOf(userData)], kRadius);
+					});
+				bench::consume(float(found));
+			}, kQueries));
+
+			suite.add("linear frustum query", set, bench::measure([&]() {
+				foundLinear = 0;
+				for (size_t q = 0; q < kQueries; ++q)
+					for (size_t i = 0; i < count; ++i)
+						foundLinear += frustums[q].intersectsSphere(scene.centres[i], kRadius);
+				bench::consume(float(foundLinear));
+			}, kQueries));
+
+			std::fprintf(stderr, "BVH,%s: %.1f spheres per frustum\n", set.name, double(found) / kQueries);
+			if (found != foundLinear)
+			{
+				std::fprintf(stderr, "BVH,%s: frustum query found %u, linear %u\n", set.name, unsigned(found),
+					unsigned(foundLinear));
+				agrees = false;
+			}
+		}
+
+		if (suite.wants("BVH sphere query"))
+		{
+			suite.add("BVH sphere query", set, bench::measure([&]() {
+				found = 0;
+				for (size_t q = 0; q < kQueries; ++q)
+					bvh.querySphere(origins[q], kQueryRadius, [&](void* userData) {
+						const math::vec3 offset = scene.centres[indexOf(userData)] - origins[q];
+						found += math::dot(offset, offset) <= (kQueryRadius + kRadius) * (kQueryRadius + kRadius);
+					});
+				bench::consume(float(found));
+			}, kQueries));
+			std::fprintf(stderr, "BVH,%s: %.1f spheres per sphere\n", set.name, double(found) / kQueries);
+		}
+
+		if (suite.wants("BVH box query"))
+		{
+			suite.add("BVH box query", set, bench::measure([&]() {
+				found = 0;
+				for (size_t q = 0; q < kQueries; ++q)
+				{
+					const AABB box = AABB::fromSphere(origins[q], kQueryRadius);
+					bvh.queryBox(box, [&](void* userData) {
+						found += box.overlaps(AABB::fromSphere(scene.centres[indexOf(userData)], kRadius));
+					});
+				}
+				bench::consume(float(found));
+			}, kQueries));
+			std::fprintf(stderr, "BVH,%s: %.1f spheres per box\n", set.name, double(found) / kQueries);
+		}
+
+		if (suite.wants("BVH ray query"))
+		{
+			std::vector<float> nearest(kQueries), nearestLinear(kQueries);
+			suite.add("BVH ray query", set, bench::measure([&]() {
+				for (size_t q = 0; q < kQueries; ++q)
+				{
+					float best = 1e30f;
+					bvh.queryRay(origins[q], directions[q], best, [&](void* userData, math::matReal /*maxDistance*/) {
+						const float t = raySphere(origins[q], directions[q], scene.centres[indexOf(userData)], kRadius);
+						if (t >= 0 && t < best)
+							best = t;
+						return best;
+					});
+					nearest[q] = best;
+				}
+				bench::consume(nearest[0]);
+			}, kQueries));
+
+			suite.add("linear ray query", set, bench::measure([&]() {
+				for (size_t q = 0; q < kQueries; ++q)
+				{
+					float best = 1e30f;
+					for (size_t i = 0; i < count; ++i)
+					{
+						const float t = raySphere(origins[q], directions[q], scene.centres[i], kRadius);
+						if (t >= 0 && t < best)
+							best = t;
+					}
+					nearestLinear[q] = best;
+				}
+				bench::consume(nearestLinear[0]);
+			}, kQueries));
+
+			for (size_t q = 0; q < kQueries; ++q)
+				if (nearest[q] != nearestLinear[q])
+				{
+					std::fprintf(stderr, "BVH,%s: ray %u hit at %f, linear at %f\n", set.name, unsigned(q),
+						nearest[q], nearestLinear[q]);
+					agrees = false;
+					break;
+				}
+		}
+
+		return agrees;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	//The sizes are the sphere counts; the byte counts only serve --quick.
+	const bench::WorkingSet scenes[] = {
+		{ "10k", 10000 * 64 },
+		{ "100k", 100000 * 64 },
+		{ "1M", 1000000 * 64 },
+	};
+
+	bool agrees = true;
+	for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s)
+		if (suite.wants(scenes[s]))
+			agrees &= benchBVH(suite, scenes[s]);
+
+	const int result = suite.finish();
+	return agrees ? result : 1;
+}
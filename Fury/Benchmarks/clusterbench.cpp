@@ -0,0 +1,198 @@
+/*
+Clustered light benchmark: LightClusters::assign binning 1k to 16k lights, half point and half spot lights of radius
+1 to 5 scattered through the view, into a 1920x1080 grid of 64 pixel tiles and 24 slices, on 1, 2 and 4 threads.
+After each thread count the lists of every cluster are checked against a brute force reference that tests every
+light against every cluster. Counts beyond the number of cores only measure the overhead. Does not depend on
+DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/clusterbench.cpp lightclusters.cpp matrixd.cpp workerpool.cpp -o clusterbench
+	cl /O2 /EHsc /I. Benchmarks\clusterbench.cpp lightclusters.cpp matrixd.cpp workerpool.cpp
+
+Results are in nanoseconds per light, in the CSV format of benchcommon.h. The milliseconds per assign and the
+number of light indices written go to stderr. --quick leaves out the 16k light set. The exit code is 1 if a cluster's
+lights differed from the reference.
+*/
+
+#include "benchcommon.h"
+#include "lightclusters.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	const unsigned kWidth = 1920, kHeight = 1080;
+	const float kNear = 0.1f, kFar = 100.f;
+
+	/**A point of the view volume, in view space, spread evenly in depth up to the far plane.*/
+	math::vec3 randomInView(const math::mat4& projection)
+	{
+		const float z = 1.f + (randomFloat() * 0.5f + 0.5f) * (kFar - 1.f);
+		const float x = randomFloat() * 1.1f * z / projection.m[0][0];
+		return math::vec3(x, randomFloat() * 1.1f * z / projection.m[1][1], z);
+	}
+
+	/**Point lights first, then spot lights, as Scene::getLights() keeps them. The view only translates, so the
+	directions are the same in world and view space.*/
+	std::vector<LightBufferEntry> makeLights(size_t count, const math::mat4& projection, const math::vec3& eye)
+	{
+		std::vector<LightBufferEntry> lights(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const math::vec3 position = randomInView(projection) + eye;
+			const float radius = 3.f + 2.f * randomFloat();
+			lights[i].positionRadius = math::vec4(position.x, position.y, position.z, radius);
+			lights[i].directionCosAngle = math::vec4(0, 0, 1, 1);
+			if (i >= count / 2)
+			{
+				math::vec3 direction(randomFloat(), randomFloat(), randomFloat());
+				direction = direction.length() > 1e-3f ? direction / direction.length() : math::vec3(0, 0, 1);
+				const float halfAngle = 0.7f + 0.5f * randomFloat();
+				lights[i].directionCosAngle = math::vec4(direction.x, direction.y, direction.z, std::cos(halfAngle));
+			}
+		}
+		return lights;
+	}
+
+	/**Whether a light reaches the cluster box, tested directly: the light's bounding sphere, the same one
+	LightClusters uses, against the box, and for spot lights the cone against the sphere around the box.*/
+	bool reaches(const LightBufferEntry& entry, bool spot, const math::mat4& view, const math::vec3& min,
+		const math::vec3& max)
+	{
+		const math::vec4& p = entry.positionRadius;
+		const math::vec4& d = entry.directionCosAngle;
+		const math::vec4 apex4 = view * math::vec4(p.x, p.y, p.z, 1);
+		const math::vec3 apex(apex4.x, apex4.y, apex4.z);
+		const math::vec3 direction(d.x, d.y, d.z);
+		const float range = p.w, cosAngle = std::min(std::max(d.w, -1.f), 1.f);
+		const float sinAngle = std::sqrt(1 - cosAngle * cosAngle);
+
+		math::vec3 centre = apex;
+		float radius = range;
+		if (spot && cosAngle > 0.70710678f)
+		{
+			radius = range / (2 * cosAngle);
+			centre = apex + direction * radius;
+		}
+		else if (spot && cosAngle > 0)
+		{
+			radius = range * sinAngle;
+			centre = apex + direction * (range * cosAngle);
+		}
+
+		const float dx = std::max(0.f, std::max(min.x - centre.x, centre.x - max.x));
+		const float dy = std::max(0.f, std::max(min.y - centre.y, centre.y - max.y));
+		const float dz = std::max(0.f, std::max(min.z - centre.z, centre.z - max.z));
+		if (dx * dx + dy * dy + dz * dz > radius * radius)
+			return false;
+		if (!spot)
+			return true;
+
+		const math::vec3 boxCentre = (min + max) * 0.5f;
+		const float boxRadius = (max - min).length() * 0.5f;
+		const math::vec3 offset = boxCentre - apex;
+		const float along = math::dot(offset, direction);
+		const float across = std::sqrt(std::max(math::dot(offset, offset) - along * along, 0.f));
+		return !(cosAngle * across - sinAngle * along > boxRadius || along > range + boxRadius ||
+			along < -boxRadius);
+	}
+
+	/**Compares every cluster's list with the lights that reach it, in order, and returns the number of clusters
+	that differ.*/
+	size_t countMismatches(const LightClusters& clusters, const std::vector<LightBufferEntry>& lights,
+		const math::mat4& view)
+	{
+		size_t mismatches = 0;
+		std::vector<unsigned> expected;
+		for (unsigned s = 0; s < clusters.slices(); ++s)
+			for (unsigned y = 0; y < clusters.tilesY(); ++y)
+				for (unsigned x = 0; x < clusters.tilesX(); ++x)
+				{
+					math::vec3 min, max;
+					clusters.clusterBounds(x, y, s, min, max);
+					expected.clear();
+					for (size_t i = 0; i < lights.size(); ++i)
+						if (reaches(lights[i], i >= lights.size() / 2, view, min, max))
+							expected.push_back(unsigned(i));
+
+					const LightClusters::Range& range = clusters.ranges()[clusters.clusterIndex(x, y, s)];
+					if (range.count != expected.size() || !std::equal(expected.begin(), expected.end(),
+						clusters.indices().begin() + range.offset))
+					{
+						if (mismatches == 0)
+							std::fprintf(stderr, "Cluster (%u, %u, %u) has %u lights, the reference %u\n", x, y, s,
+								range.count, unsigned(expected.size()));
+						++mismatches;
+					}
+				}
+		return mismatches;
+	}
+
+	bool benchClusters(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / 64;
+		math::mat4 projection, view;
+		projection.initProjection(1.0f, float(kWidth), float(kHeight), kNear, kFar);
+		const math::vec3 eye(3, -2, 5);
+		view.initTranslation(-eye.x, -eye.y, -eye.z);
+		const std::vector<LightBufferEntry> lights = makeLights(count, projection, eye);
+
+		LightClusters clusters(64, 24);
+		clusters.setProjection(projection, kWidth, kHeight);
+
+		const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		const size_t threadCounts[] = { 1, 2, 4 };
+		bool agrees = true;
+		for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "LightClusters::assign, %u threads", unsigned(threadCounts[t]));
+			if (!suite.wants(name))
+				continue;
+
+			WorkerPool::instance().setWorkerCount(threadCounts[t] - 1);
+			const double ns = bench::measure([&]() {
+				clusters.assign(view, &lights[0], 0, count / 2, count);
+				bench::consume(float(clusters.indices().size()));
+			}, count);
+			suite.add(name, set, ns);
+			std::fprintf(stderr, "%s,%s: %.3f ms per assign, %u indices in %u clusters\n", name, set.name,
+				ns * count / 1e6, unsigned(clusters.indices().size()), unsigned(clusters.clusterCount()));
+
+			const size_t mismatches = countMismatches(clusters, lights, view);
+			if (mismatches > 0)
+			{
+				std::fprintf(stderr, "%s,%s: %u clusters differ from the reference\n", name, set.name,
+					unsigned(mismatches));
+				agrees = false;
+			}
+		}
+
+		WorkerPool::instance().setWorkerCount(hardwareThreads - 1);
+		return agrees;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	//The sizes are the light counts; the byte counts only serve --quick.
+	const bench::WorkingSet sets[] = {
+		{ "1k", 1024 * 64 },
+		{ "4k", 4096 * 64 },
+		{ "16k", 16384 * 64 },
+	};
+
+	bool agrees = true;
+	for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s)
+		if (suite.wants(sets[s]))
+			agrees &= benchClusters(suite, sets[s]);
+
+	const int result = suite.finish();
+	return agrees ? result : 1;
+}
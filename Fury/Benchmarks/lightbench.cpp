@@ -0,0 +1,150 @@
+/*
+Light benchmark: keeping the world space data of 1k to 100k lights up to date, each light hanging at a random place
+in a random hierarchy with as many transform nodes as lights. The old LightNode::computePosition, which walked up
+to the root multiplying full matrices for every light every frame, is measured against Scene::prepare, which reads
+the cached world matrices and recomputes only the lights that moved, with 1% of the lights moving each frame and
+with the scene standing still. Every light's position is checked against the walk. Does not depend on DirectX.
+From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/lightbench.cpp scene.cpp pool.cpp bvh.cpp frustum.cpp renderqueue.cpp commandlist.cpp statecache.cpp camera.cpp movable.cpp matrixd.cpp transformstore.cpp workerpool.cpp -o lightbench
+	cl /O2 /EHsc /I. Benchmarks\lightbench.cpp scene.cpp pool.cpp bvh.cpp frustum.cpp renderqueue.cpp commandlist.cpp statecache.cpp camera.cpp movable.cpp matrixd.cpp transformstore.cpp workerpool.cpp
+
+Results are in nanoseconds per light, in the CSV format of benchcommon.h. --quick keeps only the 1k light scene.
+The exit code is 1 if a light's position differed from the walk's.
+*/
+
+#include "benchcommon.h"
+#include "scene.h"
+#include <cmath>
+#include <vector>
+
+using bench::randomFloat;
+
+//ImmediateIO shows message boxes, which need Windows; the scene only calls these on misuse.
+void Error(std::string err)
+{
+	std::fprintf(stderr, "Error: %s\n", err.c_str());
+}
+
+void Warning(std::string err)
+{
+	std::fprintf(stderr, "Warning: %s\n", err.c_str());
+}
+
+namespace
+{
+	/**The old LightNode::computePosition, reading the local matrices from the store as the nodes no longer keep
+	them, and multiplying in the order the store does. The old one never stepped past an ancestor that was not
+	transformable; every ancestor here is.*/
+	math::mat4 computePosition(Scene& scene, SceneNode* light)
+	{
+		math::mat4 matrix;
+		for (SceneNode* node = light; node != NULL; node = node->getParent())
+			if (node->transformable())
+				matrix = matrix *
+					scene.getTransforms().localMatrix(static_cast<TransformNode*>(node)->transformHandle()).toMat4();
+		return matrix;
+	}
+
+	bool benchLights(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / 64;
+		Scene scene(NULL);
+
+		std::vector<SceneNode*> nodes(1, scene.getRootNode());
+		std::vector<LightNode*> lights;
+		for (size_t i = 0; i < 2 * count; ++i)
+		{
+			SceneNode* parent = nodes[size_t((randomFloat() * 0.5f + 0.5f) * (nodes.size() - 1))];
+			TransformNode* node;
+			if (i % 2 == 0)
+				node = scene.createTransformNode(parent);
+			else if (i % 4 == 1)
+			{
+				PointLightNode* light = scene.createPointLightNode(parent);
+				light->setRadius(5);
+				lights.push_back(light);
+				node = light;
+			}
+			else
+			{
+				SpotLightNode* light = scene.createSpotLightNode(parent);
+				light->setRadius(5);
+				light->setHalfAngle(0.5f);
+				lights.push_back(light);
+				node = light;
+			}
+			node->setPos(randomFloat(), randomFloat(), randomFloat());
+			node->setRot(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), randomFloat()));
+			nodes.push_back(node);
+		}
+		scene.prepare();
+
+		if (suite.wants("computePosition walk"))
+			suite.add("computePosition walk", set, bench::measure([&]() {
+				float sum = 0;
+				for (size_t i = 0; i < lights.size(); ++i)
+					sum += computePosition(scene, lights[i]).m[3][0];
+				bench::consume(sum);
+			}, count));
+
+		std::vector<LightNode*> moving;
+		for (size_t i = 0; i < lights.size(); i += 100)
+			moving.push_back(lights[i]);
+		if (suite.wants("Scene::prepare, 1% moving"))
+		{
+			float direction = 1;
+			suite.add("Scene::prepare, 1% moving", set, bench::measure([&]() {
+				for (size_t i = 0; i < moving.size(); ++i)
+					moving[i]->move(direction * 0.01f, 0, 0);
+				scene.prepare();
+				direction = -direction;
+				bench::consume(scene.getLights()[0].positionRadius.x);
+			}, count));
+		}
+
+		if (suite.wants("Scene::prepare, standing still"))
+			suite.add("Scene::prepare, standing still", set, bench::measure([&]() {
+				scene.prepare();
+				bench::consume(scene.getLights()[0].positionRadius.x);
+			}, count));
+
+		//The walk multiplies in another order, so the two only agree to rounding.
+		scene.prepare();
+		for (size_t i = 0; i < scene.getLights().size(); ++i)
+		{
+			const math::mat4 walked = computePosition(scene, scene.getLightNode(i));
+			const math::vec4& cached = scene.getLights()[i].positionRadius;
+			const float error = std::fabs(walked.m[3][0] - cached.x) + std::fabs(walked.m[3][1] - cached.y) +
+				std::fabs(walked.m[3][2] - cached.z);
+			if (error > 1e-3f)
+			{
+				std::fprintf(stderr, "Lights,%s: light %u is at (%f, %f, %f), the walk puts it at (%f, %f, %f)\n",
+					set.name, unsigned(i), cached.x, cached.y, cached.z, walked.m[3][0], walked.m[3][1],
+					walked.m[3][2]);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	//The sizes are the light counts; the byte counts only serve --quick.
+	const bench::WorkingSet scenes[] = {
+		{ "1k", 1000 * 64 },
+		{ "10k", 10000 * 64 },
+		{ "100k", 100000 * 64 },
+	};
+
+	bool agrees = true;
+	for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s)
+		if (suite.wants(scenes[s]))
+			agrees &= benchLights(suite, scenes[s]);
+
+	const int result = suite.finish();
+	return agrees ? result : 1;
+}
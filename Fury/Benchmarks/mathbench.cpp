@@ -0,0 +1,299 @@
+/*
+Micro-benchmark for the math library kernels, comparing the compiled SIMD path against the scalar reference.
+Does not depend on DirectX, so it builds on any platform. From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/mathbench.cpp matrixd.cpp matrixbatch.cpp workerpool.cpp -o mathbench
+	g++ -std=c++11 -O2 -pthread -mavx -I. Benchmarks/mathbench.cpp matrixd.cpp matrixbatch.cpp workerpool.cpp -o mathbench_avx
+	cl /O2 /EHsc /I. Benchmarks\mathbench.cpp matrixd.cpp matrixbatch.cpp workerpool.cpp
+
+Prints one line per operation: time per call for both paths, the speedup and the largest absolute
+difference between the two results.
+*/
+
+#include "matrixd.h"
+#include "matrixsimd.h"
+#include "matrixbatch.h"
+#include "workerpool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const size_t kCount = 4096; //Fits comfortably in L1/L2, so the kernels are measured rather than memory.
+	const int kRepeats = 200;
+
+	float randomFloat()
+	{
+		return float(std::rand()) / float(RAND_MAX) * 2.f - 1.f;
+	}
+
+	void fill(std::vector<float>& v)
+	{
+		for (size_t i = 0; i < v.size(); ++i)
+			v[i] = randomFloat();
+	}
+
+	float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		float diff = 0;
+		for (size_t i = 0; i < a.size(); ++i)
+			diff = std::max(diff, std::fabs(a[i] - b[i]));
+		return diff;
+	}
+
+	//Prevents the optimiser from discarding results.
+	volatile float gSink;
+
+	template<class Func>
+	double nanosecondsPerCall(Func func)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < kRepeats; ++r)
+			func();
+		auto end = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count() / double(kRepeats * kCount);
+	}
+
+	void report(const char* name, double simdNs, double scalarNs, float diff)
+	{
+		std::printf("%-14s %10.2f ns %10.2f ns %8.2fx %12g\n", name, simdNs, scalarNs, scalarNs / simdNs, diff);
+	}
+}
+
+int main()
+{
+	std::vector<float> a(kCount * 16), b(kCount * 16), outSimd(kCount * 16), outScalar(kCount * 16);
+	fill(a);
+	fill(b);
+
+	std::printf("SIMD path: %s\n", math::simd::pathName());
+	std::printf("%-14s %13s %13s %9s %12s\n", "operation", "simd", "scalar", "speedup", "max diff");
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::mul4x4(&a[i * 16], &b[i * 16], &outSimd[i * 16]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::mul4x4(&a[i * 16], &b[i * 16], &outScalar[i * 16]);
+			gSink = outScalar[0];
+		});
+		report("mat4*mat4", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::mul4x4Vec(&a[i * 16], &b[i * 4], &outSimd[i * 4]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::mul4x4Vec(&a[i * 16], &b[i * 4], &outScalar[i * 4]);
+			gSink = outScalar[0];
+		});
+		report("mat4*vec4", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::transpose4x4(&a[i * 16], &outSimd[i * 16]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::transpose4x4(&a[i * 16], &outScalar[i * 16]);
+			gSink = outScalar[0];
+		});
+		report("transpose", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	{
+		//Diagonally dominant, so the matrices are well conditioned and both paths should agree closely.
+		std::vector<float> invertible(a);
+		for (size_t i = 0; i < kCount; ++i)
+			for (int d = 0; d < 16; d += 5)
+				invertible[i * 16 + d] += 4.f;
+
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::inverse4x4(&invertible[i * 16], &outSimd[i * 16]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::inverse4x4(&invertible[i * 16], &outScalar[i * 16]);
+			gSink = outScalar[0];
+		});
+		report("inverse", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+		outSimd.assign(outSimd.size(), 0.f);
+		outScalar.assign(outScalar.size(), 0.f);
+	}
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::add4(&a[i * 4], &b[i * 4], &outSimd[i * 4]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::add4(&a[i * 4], &b[i * 4], &outScalar[i * 4]);
+			gSink = outScalar[0];
+		});
+		report("vec4+vec4", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::simd::mul4(&a[i * 4], &b[i * 4], &outSimd[i * 4]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				math::scalar::mul4(&a[i * 4], &b[i * 4], &outScalar[i * 4]);
+			gSink = outScalar[0];
+		});
+		report("vec4*vec4", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	{
+		double simdNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				outSimd[i] = math::simd::dot4(&a[i * 4], &b[i * 4]);
+			gSink = outSimd[0];
+		});
+		double scalarNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				outScalar[i] = math::scalar::dot4(&a[i * 4], &b[i * 4]);
+			gSink = outScalar[0];
+		});
+		report("dot(vec4)", simdNs, scalarNs, maxDifference(outSimd, outScalar));
+	}
+
+	//The public API, which now routes through the SIMD kernels:
+	{
+		std::vector<math::mat4> ma(kCount), mb(kCount), mo(kCount);
+		for (size_t i = 0; i < kCount; ++i)
+		{
+			ma[i] = math::mat4().initRotation(randomFloat(), math::vec3(0, 1, 0));
+			mb[i] = math::mat4().initTranslation(randomFloat(), randomFloat(), randomFloat());
+		}
+		double apiNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				mo[i] = ma[i] * mb[i];
+			gSink = mo[0].m[0][0];
+		});
+		std::printf("%-14s %10.2f ns\n", "mat4 API", apiNs);
+
+		//The affine type used by the scene graph, composing the same transforms:
+		std::vector<math::mat3x4> aa(kCount), ab(kCount), ao(kCount);
+		for (size_t i = 0; i < kCount; ++i)
+		{
+			aa[i] = math::mat3x4(ma[i]);
+			ab[i] = math::mat3x4(mb[i]);
+		}
+		double affineNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				ao[i] = aa[i] * ab[i];
+			gSink = ao[0].m[0][0];
+		});
+		std::printf("%-14s %10.2f ns\n", "mat3x4 API", affineNs);
+	}
+
+	//Quaternion interpolation, one call per element against the batch kernels:
+	{
+		std::vector<math::Quaternion> qa(kCount), qb(kCount), qo(kCount);
+		std::vector<float> t(kCount);
+		std::vector<math::mat4> mo(kCount);
+		for (size_t i = 0; i < kCount; ++i)
+		{
+			qa[i] = math::Quaternion(randomFloat(), randomFloat(), randomFloat(), randomFloat()).normalize();
+			qb[i] = math::Quaternion(randomFloat(), randomFloat(), randomFloat(), randomFloat()).normalize();
+			t[i] = randomFloat() * 0.5f + 0.5f;
+		}
+
+		double batchNs = nanosecondsPerCall([&]() {
+			math::slerpMany(&qa[0], &qb[0], &t[0], &qo[0], kCount, false);
+			gSink = qo[0].w;
+		});
+		double loopNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				qo[i] = math::Quaternion::slerp(qa[i], qb[i], t[i]);
+			gSink = qo[0].w;
+		});
+		std::printf("\n%-22s %10.2f ns, %10.2f ns per call (%.0f M/s)\n", "slerpMany / slerp", batchNs, loopNs, 1e3 / batchNs);
+
+		batchNs = nanosecondsPerCall([&]() {
+			math::nlerpMany(&qa[0], &qb[0], &t[0], &qo[0], kCount, false);
+			gSink = qo[0].w;
+		});
+		loopNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				qo[i] = math::Quaternion::nlerp(qa[i], qb[i], t[i]);
+			gSink = qo[0].w;
+		});
+		std::printf("%-22s %10.2f ns, %10.2f ns per call (%.0f M/s)\n", "nlerpMany / nlerp", batchNs, loopNs, 1e3 / batchNs);
+
+		batchNs = nanosecondsPerCall([&]() {
+			math::toMatrixMany(&qa[0], &mo[0], kCount, false);
+			gSink = mo[0].m[0][0];
+		});
+		loopNs = nanosecondsPerCall([&]() {
+			for (size_t i = 0; i < kCount; ++i)
+				mo[i] = qa[i].toMatrix();
+			gSink = mo[0].m[0][0];
+		});
+		std::printf("%-22s %10.2f ns, %10.2f ns per call\n", "toMatrixMany / loop", batchNs, loopNs);
+	}
+
+	//Batch transforms of a large point cloud, against the per-element loop they replace:
+	{
+		const size_t points = 1 << 20;
+		const math::mat4 m = math::mat4().initRotation(0.5f, math::vec3(0, 1, 0)) * math::mat4().initTranslation(1, 2, 3);
+		std::vector<math::vec3> in(points), out(points);
+		std::vector<float> xs(points), ys(points), zs(points), ox(points), oy(points), oz(points);
+		for (size_t i = 0; i < points; ++i)
+		{
+			in[i] = math::vec3(randomFloat(), randomFloat(), randomFloat());
+			xs[i] = in[i].x; ys[i] = in[i].y; zs[i] = in[i].z;
+		}
+
+		auto perPoint = [&](std::function<void()> func) {
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int r = 0; r < 10; ++r)
+				func();
+			auto end = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration<double, std::nano>(end - start).count() / double(10 * points);
+		};
+
+		std::printf("\nBatch transforms of %u points, %u threads:\n", unsigned(points), unsigned(WorkerPool::instance().threadCount()));
+		std::printf("%-22s %10.2f ns\n", "loop of mat4*vec4", perPoint([&]() {
+			for (size_t i = 0; i < points; ++i)
+				out[i] = (m * math::vec4(in[i], 1)).xyz();
+			gSink = out[0].x;
+		}));
+		std::printf("%-22s %10.2f ns\n", "transformPoints AoS", perPoint([&]() {
+			math::transformPoints(m, &in[0], &out[0], points, false);
+			gSink = out[0].x;
+		}));
+		std::printf("%-22s %10.2f ns\n", "transformPoints SoA", perPoint([&]() {
+			math::transformPoints(m, &xs[0], &ys[0], &zs[0], &ox[0], &oy[0], &oz[0], points, false);
+			gSink = ox[0];
+		}));
+		std::printf("%-22s %10.2f ns\n", "SoA, threaded", perPoint([&]() {
+			math::transformPoints(m, &xs[0], &ys[0], &zs[0], &ox[0], &oy[0], &oz[0], points);
+			gSink = ox[0];
+		}));
+	}
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+Regression suite for the math library, ray casting and frustum culling. Times each kernel over working sets that fit in L1, L2
+and DRAM, prints the results as CSV and, given a baseline, fails when a kernel has slowed down past its threshold.
+Does not depend on DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -I. Benchmarks/mathsuite.cpp matrixd.cpp raycasting.cpp frustum.cpp -o mathsuite
+	cl /O2 /EHsc /I. Benchmarks\mathsuite.cpp matrixd.cpp raycasting.cpp frustum.cpp
+
+	./mathsuite --baseline Benchmarks/mathsuite_baseline.csv
+	./mathsuite --write-baseline Benchmarks/mathsuite_baseline.csv
+
+See benchcommon.h for the remaining options and the file format. Timings only compare on the same machine and
+compiler, so regenerate the baseline when either changes.
+*/
+
+#include "benchcommon.h"
+#include "matrixd.h"
+#include "raycasting.h"
+#include "frustum.h"
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	math::vec3 randomVec3()
+	{
+		return math::vec3(randomFloat(), randomFloat(), randomFloat());
+	}
+
+	math::mat4 randomMat4()
+	{
+		math::mat4 m;
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r)
+				m.m[c][r] = randomFloat();
+		return m;
+	}
+
+	void benchMatMul(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / (sizeof(math::mat4) * 3);
+		std::vector<math::mat4> a(count), b(count), out(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			a[i] = randomMat4();
+			b[i] = randomMat4();
+		}
+
+		suite.add("mat4*mat4", set, bench::measure([&]() {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = a[i] * b[i];
+			bench::consume(out[count / 2].m[1][1]);
+		}, count));
+	}
+
+	void benchMatVec(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / (sizeof(math::mat4) + sizeof(math::vec4) * 2);
+		std::vector<math::mat4> m(count);
+		std::vector<math::vec4> v(count), out(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			m[i] = randomMat4();
+			v[i] = math::vec4(randomVec3(), 1);
+		}
+
+		suite.add("mat4*vec4", set, bench::measure([&]() {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = m[i] * v[i];
+			bench::consume(out[count / 2].x);
+		}, count));
+	}
+
+	void benchQuatToMatrix(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / (sizeof(math::Quaternion) + sizeof(math::mat4));
+		std::vector<math::Quaternion> q(count);
+		std::vector<math::mat4> out(count);
+		for (size_t i = 0; i < count; ++i)
+			q[i] = math::Quaternion(randomFloat(), randomFloat(), randomFloat(), randomFloat()).normalize();
+
+		suite.add("Quaternion::toMatrix", set, bench::measure([&]() {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = q[i].toMatrix();
+			bench::consume(out[count / 2].m[0][0]);
+		}, count));
+	}
+
+	void benchVec3(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / (sizeof(math::vec3) * 3);
+		std::vector<math::vec3> a(count), b(count), out(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			a[i] = randomVec3() + math::vec3(2, 0, 0); //Keeps lengths away from zero.
+			b[i] = randomVec3();
+		}
+
+		if (suite.wants("vec3::normalize"))
+			suite.add("vec3::normalize", set, bench::measure([&]() {
+				for (size_t i = 0; i < count; ++i)
+				{
+					out[i] = a[i];
+					out[i].normalize();
+				}
+				bench::consume(out[count / 2].x);
+			}, count));
+
+		if (suite.wants("cross(vec3)"))
+			suite.add("cross(vec3)", set, bench::measure([&]() {
+				for (size_t i = 0; i < count; ++i)
+					out[i] = math::cross(a[i], b[i]);
+				bench::consume(out[count / 2].x);
+			}, count));
+
+		if (suite.wants("dot(vec3)"))
+			suite.add("dot(vec3)", set, bench::measure([&]() {
+				float sum = 0;
+				for (size_t i = 0; i < count; ++i)
+					sum += math::dot(a[i], b[i]);
+				bench::consume(sum);
+			}, count));
+	}
+
+	void benchRayTriangle(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		//Triangles scattered around the ray, so roughly half are hit and the branches stay unpredictable.
+		const size_t count = set.bytes / (sizeof(math::vec3) * 3);
+		std::vector<math::vec3> v(count * 3);
+		for (size_t i = 0; i < count * 3; ++i)
+			v[i] = math::vec3(randomFloat(), randomFloat(), 2 + randomFloat());
+
+		const math::vec3 origin(0, 0, 0), direction(0, 0, 1);
+		suite.add("determineRayTriangleIntersection", set, bench::measure([&]() {
+			int hits = 0;
+			for (size_t i = 0; i < count; ++i)
+				hits += determineRayTriangleIntersection(origin, direction, v[i * 3], v[i * 3 + 1], v[i * 3 + 2]).intersects;
+			bench::consume(float(hits));
+		}, count));
+	}
+
+	void benchBarycentric(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		const size_t count = set.bytes / (sizeof(math::vec2) * 4 + sizeof(math::vec3));
+		std::vector<math::vec2> v(count * 4);
+		std::vector<math::vec3> out(count);
+		for (size_t i = 0; i < count * 4; ++i)
+			v[i] = math::vec2(randomFloat(), randomFloat());
+
+		suite.add("toBarycentric", set, bench::measure([&]() {
+			for (size_t i = 0; i < count; ++i)
+				out[i] = toBarycentric(v[i * 4], v[i * 4 + 1], v[i * 4 + 2], v[i * 4 + 3]);
+			bench::consume(out[count / 2].x);
+		}, count));
+	}
+
+	void benchFrustum(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		//Spheres around a camera at the origin looking down -z, so some are in view and some are not.
+		const size_t count = set.bytes / sizeof(math::vec4);
+		std::vector<math::vec4> spheres(count);
+		for (size_t i = 0; i < count; ++i)
+			spheres[i] = math::vec4(randomFloat() * 20 - 10, randomFloat() * 20 - 10, randomFloat() * 20 - 10,
+				randomFloat());
+
+		const Frustum frustum(math::mat4().initProjection(0.7f, 1280, 720, 0.1f, 100.f));
+		suite.add("Frustum::intersectsSphere", set, bench::measure([&]() {
+			int visible = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const math::vec4& s = spheres[i];
+				visible += frustum.intersectsSphere(math::vec3(s.x, s.y, s.z), s.w);
+			}
+			bench::consume(float(visible));
+		}, count));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	for (size_t s = 0; s < sizeof(bench::kWorkingSets) / sizeof(bench::kWorkingSets[0]); ++s)
+	{
+		const bench::WorkingSet& set = bench::kWorkingSets[s];
+		if (!suite.wants(set))
+			continue;
+
+		if (suite.wants("mat4*mat4"))
+			benchMatMul(suite, set);
+		if (suite.wants("mat4*vec4"))
+			benchMatVec(suite, set);
+		if (suite.wants("Quaternion::toMatrix"))
+			benchQuatToMatrix(suite, set);
+		benchVec3(suite, set);
+		if (suite.wants("determineRayTriangleIntersection"))
+			benchRayTriangle(suite, set);
+		if (suite.wants("toBarycentric"))
+			benchBarycentric(suite, set);
+		if (suite.wants("Frustum::intersectsSphere"))
+			benchFrustum(suite, set);
+	}
+
+	return suite.finish();
+}
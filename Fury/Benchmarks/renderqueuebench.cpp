@@ -0,0 +1,275 @@
+/*
+Render queue benchmark: the cost per packet of recording a frame, of recording and sorting it, and of recording,
+sorting and submitting it, batched, one packet at a time and in command lists on 2 and 4 threads, to drawables that
+record their instanced draws in a CommandList, so the queue itself is measured rather than the GPU. The packets
+spread over 8 shaders, 32 textures and 64 meshes at random depths. A chess board, 32 pieces of 6 meshes and the board, is submitted as well.
+Does not depend on DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/renderqueuebench.cpp renderqueue.cpp commandlist.cpp statecache.cpp workerpool.cpp camera.cpp movable.cpp matrixd.cpp -o renderqueuebench
+	cl /O2 /EHsc /I. Benchmarks\renderqueuebench.cpp renderqueue.cpp commandlist.cpp statecache.cpp workerpool.cpp camera.cpp movable.cpp matrixd.cpp
+
+Results are in nanoseconds per packet, in the CSV format of benchcommon.h. The draw calls of each frame, batched
+and not, go to stderr with the state changes the state cache issued and elided and the buffer maps. The exit code
+is 1 if the recorded instances are not the sorted packets, each once, in order.
+*/
+
+#include "benchcommon.h"
+#include "renderqueue.h"
+#include "commandlist.h"
+#include "drawable.h"
+#include "shaderbuffertypes.h"
+#include "workerpool.h"
+#include <cstring>
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	/**Stand-ins for the shaders, textures and meshes of the packets. The recorder only compares their addresses.*/
+	char shaderTokens[8], textureTokens[32], meshTokens[64];
+
+	ShaderProgram* shaderToken(unsigned i) { return reinterpret_cast<ShaderProgram*>(&shaderTokens[i]); }
+	TextureGPU* textureToken(unsigned i) { return reinterpret_cast<TextureGPU*>(&textureTokens[i]); }
+	RenderMesh* meshToken(unsigned i) { return reinterpret_cast<RenderMesh*>(&meshTokens[i]); }
+
+	/**Draws a batch as StaticMeshInstance does, as one instanced draw of the packets' world matrices.*/
+	class InstancedDrawable : public Drawable
+	{
+	public:
+		InstancedDrawable() : Drawable(TYPE_STATICMESH) {}
+
+		virtual void enqueue(RenderQueue& /*queue*/, RenderWindow* /*renderWindow*/,
+			const math::mat3x4& /*worldMatrix*/) {}
+
+		virtual void draw(RenderBackend& backend, const DrawPacket* const* packets, size_t count,
+			const Camera& /*camera*/)
+		{
+			backend.setShader(packets[0]->shader);
+			backend.setMesh(packets[0]->mesh);
+			if (packets[0]->texture)
+				backend.setTexture(packets[0]->texture);
+			math::mat3x4* instances = static_cast<math::mat3x4*>(backend.allocateInstances(sizeof(math::mat3x4),
+				count));
+			for (size_t i = 0; i < count; ++i)
+				instances[i] = packets[i]->world;
+			backend.drawIndexedInstanced(36, unsigned(count));
+		}
+	};
+
+	/**Whether the recorder drew the queue's packets, each once, in sorted order, in as many draw calls as the queue
+	counted.*/
+	bool checkRecording(const RenderQueue& queue, const CommandList& recorder, const char* name)
+	{
+		size_t packet = 0;
+		bool matches = recorder.drawCalls() == queue.drawCalls();
+		for (size_t c = 0; c < recorder.commands().size() && matches; ++c)
+		{
+			const CommandList::Command& command = recorder.commands()[c];
+			if (command.type != CommandList::DRAW_INDEXED_INSTANCED)
+				continue;
+			const math::mat3x4* instances = static_cast<const math::mat3x4*>(recorder.data(command));
+			for (unsigned i = 0; i < command.instanceCount && matches; ++i, ++packet)
+				matches = packet < queue.size() &&
+					std::memcmp(&instances[i], &queue[packet].world, sizeof(math::mat3x4)) == 0;
+		}
+		matches = matches && packet == queue.size();
+		if (!matches)
+			std::fprintf(stderr, "%s: the recorded instances differ from the sorted packets\n", name);
+		return matches;
+	}
+
+	/**Submits the recorded frame batched, unbatched and batched in command lists on 4 threads, as a frame of the
+	scene, reporting the draw calls, state changes and maps of each.*/
+	bool countDrawCalls(RenderQueue& queue, const Camera& camera, const char* name)
+	{
+		const struct
+		{
+			bool batching;
+			size_t lists;
+			const char* label;
+		} modes[] = {
+			{ true, 1, "batched" },
+			{ false, 1, "unbatched" },
+			{ true, 4, "batched on up to 4 threads" },
+		};
+
+		CommandList recorder;
+		bool matches = true;
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m)
+		{
+			WorkerPool::instance().setWorkerCount(modes[m].lists - 1);
+			queue.setMaxLists(modes[m].lists);
+			recorder.clear();
+			recorder.invalidateState();
+			recorder.beginFrame();
+			FrameConstants frame;
+			frame.view = camera.matrix();
+			frame.projection = camera.projection();
+			recorder.setFrameConstants(&frame, sizeof(frame));
+			queue.setBatching(modes[m].batching);
+			queue.submit(recorder, camera);
+			recorder.endFrame();
+			matches &= checkRecording(queue, recorder, name);
+			const StateCache::Counts& states = recorder.stateCounts();
+			std::fprintf(stderr, "%s: %u packets, %u draw calls %s, %u command lists, %u state changes issued, %u elided, "
+				"%u maps\n", name, unsigned(queue.size()), unsigned(recorder.drawCalls()), modes[m].label,
+				unsigned(queue.listCount()), unsigned(states.totalIssued()), unsigned(states.totalElided()),
+				unsigned(recorder.mapCounts().maps));
+		}
+		queue.setBatching(true);
+		queue.setMaxLists(1);
+		WorkerPool::instance().setWorkerCount(0);
+		return matches;
+	}
+
+	/**The chess scene: 16 pawns, 4 each of rooks, knights and bishops, 2 kings, 2 queens and the board, each piece
+	kind a mesh, all of one shader. The board has a texture; the colours of the sides are per instance, so they do not
+	split batches.*/
+	bool checkChess(const Camera& camera)
+	{
+		const unsigned counts[] = { 16, 4, 4, 4, 2, 2, 1 };
+		const int meshes = sizeof(counts) / sizeof(counts[0]);
+		InstancedDrawable drawable;
+		RenderQueue queue;
+		queue.begin(camera);
+		for (int m = 0; m < meshes; ++m)
+			for (unsigned i = 0; i < counts[m]; ++i)
+			{
+				DrawPacket p;
+				p.drawable = &drawable;
+				p.shader = shaderToken(0);
+				p.texture = m == meshes - 1 ? textureToken(0) : NULL;
+				p.mesh = meshToken(m);
+				p.batch = p.mesh;
+				p.world.initTranslation(float(i % 8), 0, float(i / 8 + m));
+				p.sortKey = RenderQueue::makeSortKey(0, 1, p.texture ? 1 : 0, m,
+					queue.viewDepth(p.world.getTranslation()));
+				queue.add(p);
+			}
+		queue.sort();
+		return countDrawCalls(queue, camera, "Chess");
+	}
+
+	bool benchQueue(bench::Suite& suite, const bench::WorkingSet& set, const Camera& camera)
+	{
+		const size_t count = set.bytes / sizeof(DrawPacket);
+		InstancedDrawable drawable;
+		CommandList recorder;
+		RenderQueue queue;
+		queue.setMaxLists(1);
+		queue.begin(camera);
+
+		std::vector<DrawPacket> packets(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			DrawPacket& p = packets[i];
+			const unsigned shader = unsigned(randomFloat() * 4 + 4);
+			const unsigned texture = unsigned(randomFloat() * 16 + 16);
+			const unsigned mesh = unsigned(randomFloat() * 32 + 32);
+			p.drawable = &drawable;
+			p.shader = shaderToken(shader);
+			p.texture = textureToken(texture);
+			p.mesh = meshToken(mesh);
+			p.batch = p.mesh;
+			p.world.initTranslation(randomFloat() * 10, randomFloat() * 10, randomFloat() * 10);
+			p.sortKey = RenderQueue::makeSortKey(0, shader, texture, mesh, queue.viewDepth(p.world.getTranslation()));
+		}
+
+		if (suite.wants("RenderQueue record"))
+			suite.add("RenderQueue record", set, bench::measure([&]() {
+				queue.begin(camera);
+				for (size_t i = 0; i < count; ++i)
+					queue.add(packets[i]);
+				bench::consume(float(queue.size()));
+			}, count));
+
+		if (suite.wants("RenderQueue record+sort"))
+			suite.add("RenderQueue record+sort", set, bench::measure([&]() {
+				queue.begin(camera);
+				for (size_t i = 0; i < count; ++i)
+					queue.add(packets[i]);
+				queue.sort();
+				bench::consume(float(queue[0].sortKey));
+			}, count));
+
+		if (suite.wants("RenderQueue record+sort+submit"))
+			suite.add("RenderQueue record+sort+submit", set, bench::measure([&]() {
+				recorder.clear();
+				queue.begin(camera);
+				for (size_t i = 0; i < count; ++i)
+					queue.add(packets[i]);
+				queue.sort();
+				queue.submit(recorder, camera);
+				bench::consume(float(recorder.drawCalls()));
+			}, count));
+
+		if (suite.wants("RenderQueue record+sort+submit, unbatched"))
+		{
+			queue.setBatching(false);
+			suite.add("RenderQueue record+sort+submit, unbatched", set, bench::measure([&]() {
+				recorder.clear();
+				queue.begin(camera);
+				for (size_t i = 0; i < count; ++i)
+					queue.add(packets[i]);
+				queue.sort();
+				queue.submit(recorder, camera);
+				bench::consume(float(recorder.drawCalls()));
+			}, count));
+			queue.setBatching(true);
+		}
+
+		//Each list is recorded, and translated by the backend, on a thread of its own.
+		const size_t threadCounts[] = { 2, 4 };
+		for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t)
+		{
+			char kernel[64];
+			std::snprintf(kernel, sizeof(kernel), "RenderQueue record+sort+submit, %u threads",
+				unsigned(threadCounts[t]));
+			if (!suite.wants(kernel))
+				continue;
+
+			WorkerPool::instance().setWorkerCount(threadCounts[t] - 1);
+			queue.setMaxLists(threadCounts[t]);
+			suite.add(kernel, set, bench::measure([&]() {
+				recorder.clear();
+				queue.begin(camera);
+				for (size_t i = 0; i < count; ++i)
+					queue.add(packets[i]);
+				queue.sort();
+				queue.submit(recorder, camera);
+				bench::consume(float(recorder.drawCalls()));
+			}, count));
+			queue.setMaxLists(1);
+			WorkerPool::instance().setWorkerCount(0);
+		}
+
+		queue.begin(camera);
+		for (size_t i = 0; i < count; ++i)
+			queue.add(packets[i]);
+		queue.sort();
+		char name[64];
+		std::snprintf(name, sizeof(name), "RenderQueue,%s", set.name);
+		return countDrawCalls(queue, camera, name);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+	Camera camera(0.7f, 1280, 720, 0.01f, 100.f);
+
+	const bench::WorkingSet frames[] = {
+		{ "1k", 1000 * sizeof(DrawPacket) },
+		{ "10k", 10000 * sizeof(DrawPacket) },
+		{ "100k", 100000 * sizeof(DrawPacket) },
+	};
+
+	bool matches = checkChess(camera);
+	for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); ++f)
+		if (suite.wants(frames[f]))
+			matches &= benchQueue(suite, frames[f], camera);
+
+	const int result = suite.finish();
+	return matches ? result : 1;
+}
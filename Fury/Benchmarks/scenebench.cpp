@@ -0,0 +1,243 @@
+/*
+Transform hierarchy benchmark: the flat TransformStore update against the recursive, pointer based traversal that
+TransformNode::perform used to do, over random hierarchies of 10k to 1M nodes. The store is measured with every
+node dirty, with 1% of the nodes moving each frame, and standing still. Last, the thread count of a full update
+of a 500k node scene is swept, checking every threaded result bit for bit against the serial one. Counts beyond
+the number of cores only measure the overhead. Does not depend on DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/scenebench.cpp transformstore.cpp transformable.cpp movable.cpp matrixd.cpp workerpool.cpp -o scenebench
+	cl /O2 /EHsc /I. Benchmarks\scenebench.cpp transformstore.cpp transformable.cpp movable.cpp matrixd.cpp workerpool.cpp
+
+Results are in nanoseconds per node, in the CSV format of benchcommon.h, so the same options apply. --quick keeps
+only the 10k node scene. The number of matrices each store update recomputed goes to stderr. The exit code is 1
+if a threaded update differed from the serial one.
+*/
+
+#include "benchcommon.h"
+#include "transformstore.h"
+#include "transformable.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	/**A copy of the old TransformNode: children held by pointer, and the accumulated matrix passed down by
+	virtual recursion. The world matrix is kept only so the work can not be optimised away, standing in for
+	DrawableNode handing it to the draw call.*/
+	class RecursiveNode : public Transformable
+	{
+	public:
+		std::vector<RecursiveNode*> mChildren;
+		math::mat3x4 mWorld;
+
+		virtual ~RecursiveNode() {}
+
+		virtual void perform(const math::mat3x4& accumulatedMatrix)
+		{
+			math::mat3x4 transformMatrix = m_matrix * accumulatedMatrix;
+			mWorld = transformMatrix;
+
+			for (size_t i = 0; i < mChildren.size(); ++i)
+				mChildren[i]->perform(transformMatrix);
+		}
+	};
+
+	/**A random hierarchy: each node's parent is picked among the nodes created before it, which gives a tree about
+	as deep as the logarithm of its size, with a few wide nodes near the top.*/
+	struct Hierarchy
+	{
+		std::vector<unsigned> parent; //Index of the parent, or ~0u for the root.
+		std::vector<math::vec3> pos;
+		std::vector<math::Quaternion> rot;
+
+		explicit Hierarchy(size_t count) : parent(count), pos(count), rot(count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				parent[i] = i == 0 ? ~0u : unsigned(std::min(size_t((randomFloat() * 0.5f + 0.5f) * i), i - 1));
+				pos[i] = math::vec3(randomFloat(), randomFloat(), randomFloat());
+				rot[i] = math::Quaternion(randomFloat(), randomFloat(), randomFloat(), randomFloat()).normalize();
+			}
+		}
+	};
+
+	/**Builds the hierarchy out of RecursiveNodes. With shuffle the nodes are allocated in random order, as in a
+	heap that has seen the scene built and torn down a few times; otherwise in creation order.*/
+	RecursiveNode* buildRecursive(const Hierarchy& h, bool shuffle, std::vector<RecursiveNode*>& nodes)
+	{
+		const size_t count = h.parent.size();
+		std::vector<size_t> allocationOrder(count);
+		for (size_t i = 0; i < count; ++i)
+			allocationOrder[i] = i;
+		if (shuffle)
+			for (size_t i = count - 1; i > 0; --i)
+				std::swap(allocationOrder[i], allocationOrder[size_t((randomFloat() * 0.5f + 0.5f) * i)]);
+
+		nodes.assign(count, nullptr);
+		for (size_t i = 0; i < count; ++i)
+			nodes[allocationOrder[i]] = new RecursiveNode;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			nodes[i]->setPos(h.pos[i]);
+			nodes[i]->setRot(h.rot[i]);
+			nodes[i]->forceMatrixUpdate();
+			if (h.parent[i] != ~0u)
+				nodes[h.parent[i]]->mChildren.push_back(nodes[i]);
+		}
+		return nodes[0];
+	}
+
+	void benchRecursive(bench::Suite& suite, const bench::WorkingSet& set, const Hierarchy& h, bool shuffle)
+	{
+		const char* name = shuffle ? "recursive perform, shuffled heap" : "recursive perform";
+		if (!suite.wants(name))
+			return;
+
+		std::vector<RecursiveNode*> nodes;
+		RecursiveNode* root = buildRecursive(h, shuffle, nodes);
+
+		suite.add(name, set, bench::measure([&]() {
+			root->perform(math::mat3x4());
+			bench::consume(nodes.back()->mWorld.m[3][0]);
+		}, nodes.size()));
+
+		for (size_t i = 0; i < nodes.size(); ++i)
+			delete nodes[i];
+	}
+
+	void reportStats(const char* name, const bench::WorkingSet& set, const TransformStore& store)
+	{
+		const TransformStore::UpdateStats& stats = store.lastUpdateStats();
+		std::fprintf(stderr, "%s,%s: %u local and %u world matrices recomputed\n", name, set.name,
+			unsigned(stats.localMatrices), unsigned(stats.worldMatrices));
+	}
+
+	/**Measures the store with the given fraction of the nodes set each frame, or every world matrix rebuilt
+	when moving is negative.*/
+	void benchStore(bench::Suite& suite, const bench::WorkingSet& set, const Hierarchy& h, const char* name,
+		float moving)
+	{
+		if (!suite.wants(name))
+			return;
+
+		const size_t count = h.parent.size();
+		TransformStore store;
+		std::vector<TransformStore::Handle> handles(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			handles[i] = store.create(h.parent[i] == ~0u ? TransformStore::kInvalidHandle : handles[h.parent[i]]);
+			store.setLocal(handles[i], h.pos[i], h.rot[i], 1.f);
+		}
+		store.update(); //Builds the local matrices, which the recursive version also has ready beforehand.
+
+		//The nodes that move, picked once so the frames are alike.
+		std::vector<size_t> moved;
+		for (size_t i = 0; i < count && moving > 0; ++i)
+			if (randomFloat() * 0.5f + 0.5f < moving)
+				moved.push_back(i);
+
+		suite.add(name, set, bench::measure([&]() {
+			if (moving < 0)
+				store.setLocal(handles[0], math::vec3(), math::Quaternion(), 1.f); //Moving the root moves everything.
+			for (size_t i = 0; i < moved.size(); ++i)
+				store.setLocal(handles[moved[i]], h.pos[moved[i]], h.rot[moved[i]], 1.f);
+			store.update();
+			bench::consume(store.worldMatrix(handles.back()).m[3][0]);
+		}, count));
+
+		reportStats(name, set, store);
+	}
+
+	/**Runs the thread sweep. Returns false if any threaded result differs from the serial one.*/
+	bool benchThreads(bench::Suite& suite)
+	{
+		const bench::WorkingSet set = { "500k", 500000 * 64 };
+		if (!suite.wants(set))
+			return true;
+
+		const Hierarchy h(500000);
+		const size_t count = h.parent.size();
+		TransformStore store;
+		std::vector<TransformStore::Handle> handles(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			handles[i] = store.create(h.parent[i] == ~0u ? TransformStore::kInvalidHandle : handles[h.parent[i]]);
+			store.setLocal(handles[i], h.pos[i], h.rot[i], 1.f);
+		}
+		store.update(false);
+
+		std::vector<math::mat3x4> serial(count);
+		for (size_t i = 0; i < count; ++i)
+			serial[i] = store.worldMatrix(handles[i]);
+
+		const size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<size_t> threadCounts;
+		for (size_t threads = 1; threads <= std::max<size_t>(8, hardwareThreads); threads *= 2)
+			threadCounts.push_back(threads);
+		if (threadCounts.back() != hardwareThreads && hardwareThreads > 8)
+			threadCounts.push_back(hardwareThreads);
+
+		bool identical = true;
+		for (size_t t = 0; t < threadCounts.size(); ++t)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "TransformStore::update, %u threads", unsigned(threadCounts[t]));
+			if (!suite.wants(name))
+				continue;
+
+			WorkerPool::instance().setWorkerCount(threadCounts[t] - 1);
+			suite.add(name, set, bench::measure([&]() {
+				store.setLocal(handles[0], h.pos[0], h.rot[0], 1.f); //Unchanged, but dirties the whole tree.
+				store.update();
+				bench::consume(store.worldMatrix(handles.back()).m[3][0]);
+			}, count));
+
+			for (size_t i = 0; i < count; ++i)
+				if (std::memcmp(&serial[i], &store.worldMatrix(handles[i]), sizeof(math::mat3x4)) != 0)
+				{
+					std::fprintf(stderr, "%s: node %u differs from the serial update\n", name, unsigned(i));
+					identical = false;
+					break;
+				}
+		}
+
+		WorkerPool::instance().setWorkerCount(hardwareThreads - 1);
+		return identical;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	//The sizes are the node counts; the byte counts only serve --quick.
+	const bench::WorkingSet scenes[] = {
+		{ "10k", 10000 * 64 },
+		{ "100k", 100000 * 64 },
+		{ "1M", 1000000 * 64 },
+	};
+
+	for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s)
+	{
+		const bench::WorkingSet& set = scenes[s];
+		if (!suite.wants(set))
+			continue;
+
+		const Hierarchy h(set.bytes / 64);
+		benchRecursive(suite, set, h, false);
+		benchRecursive(suite, set, h, true);
+		benchStore(suite, set, h, "TransformStore::update, all dirty", -1);
+		benchStore(suite, set, h, "TransformStore::update, 1% moving", 0.01f);
+		benchStore(suite, set, h, "TransformStore::update, static", 0);
+	}
+
+	const bool identical = benchThreads(suite);
+	const int result = suite.finish();
+	return identical ? result : 1;
+}
@@ -0,0 +1,245 @@
+/*
+Scene traversal benchmark: a full walk of random scene trees of 10k to 1M nodes with the iterator Scene used to
+have, which kept its path in a std::stack, against Scene::iterator, which finds its way through the parent links,
+Scene::breadth_first_iterator, and Scene::forEach. The iterators are stepped both with ++it and with it++, since
+the old one copied its stack on every it++. Scene::iterator and Scene::forEach go again after Scene::compact()
+has laid the nodes out in the order they are visited. Heap allocations are counted by replacing operator new, and
+each walk's count goes to stderr. Does not depend on DirectX. From the Fury directory:
+
+	g++ -std=c++11 -O2 -pthread -I. Benchmarks/traversalbench.cpp scene.cpp pool.cpp bvh.cpp frustum.cpp renderqueue.cpp commandlist.cpp statecache.cpp camera.cpp movable.cpp matrixd.cpp transformstore.cpp workerpool.cpp -o traversalbench
+	cl /O2 /EHsc /I. Benchmarks\traversalbench.cpp scene.cpp pool.cpp bvh.cpp frustum.cpp renderqueue.cpp commandlist.cpp statecache.cpp camera.cpp movable.cpp matrixd.cpp transformstore.cpp workerpool.cpp
+
+Results are in nanoseconds per node, in the CSV format of benchcommon.h. --quick keeps only the 10k node scene.
+The exit code is 1 if a walk missed or repeated a node.
+*/
+
+#include "benchcommon.h"
+#include "scene.h"
+#include <cstdlib>
+#include <new>
+#include <stack>
+#include <vector>
+
+using bench::randomFloat;
+
+namespace
+{
+	size_t gAllocations = 0;
+}
+
+void* operator new(size_t size)
+{
+	++gAllocations;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+//ImmediateIO shows message boxes, which need Windows; the iterators only call these on misuse.
+void Error(std::string err)
+{
+	std::fprintf(stderr, "Error: %s\n", err.c_str());
+}
+
+void Warning(std::string err)
+{
+	std::fprintf(stderr, "Warning: %s\n", err.c_str());
+}
+
+namespace
+{
+	/**A copy of the old Scene::iterator, reading the children through getChildren() instead of as a friend.*/
+	class StackIterator
+	{
+		SceneNode* mRootNode;
+		SceneNode* mNode;
+		std::stack<size_t> stack;
+		bool reachedEnd;
+
+	public:
+		StackIterator(SceneNode* node) : mRootNode(node), mNode(node), reachedEnd(false)
+		{
+			stack.push(0);
+		}
+
+		StackIterator& operator++()
+		{
+			while (stack.top() >= mNode->getChildren().size())
+			{
+				if (mNode == mRootNode)
+				{
+					reachedEnd = true;
+					break;
+				}
+				else
+				{
+					mNode = mNode->getParent();
+					stack.pop();
+				}
+			}
+			if (!reachedEnd)
+			{
+				size_t index = stack.top()++;
+				stack.push(0);
+				mNode = mNode->getChildren()[index];
+			}
+
+			return *this;
+		}
+
+		StackIterator operator++(int)
+		{
+			StackIterator current = *this;
+			++(*this);
+			return current;
+		}
+
+		bool operator != (const StackIterator& it) const
+		{
+			return mNode != it.mNode || reachedEnd != it.reachedEnd;
+		}
+
+		SceneNode* operator*() const
+		{
+			return mNode;
+		}
+
+		static StackIterator end(SceneNode* root)
+		{
+			StackIterator e(root);
+			e.reachedEnd = true;
+			return e;
+		}
+	};
+
+	/**Adds up the visits so the walk can not be optimised away, and checks that each node came exactly once.*/
+	struct Visits
+	{
+		size_t count;
+		size_t addressSum;
+
+		Visits() : count(0), addressSum(0) {}
+
+		void add(SceneNode* node)
+		{
+			++count;
+			addressSum += size_t(node);
+		}
+	};
+
+	template<class Walk>
+	void benchWalk(bench::Suite& suite, const bench::WorkingSet& set, const char* name, size_t count,
+		const Visits& expected, bool& complete, Walk walk)
+	{
+		if (!suite.wants(name))
+			return;
+
+		Visits visits;
+		suite.add(name, set, bench::measure([&]() {
+			visits = Visits();
+			walk(visits);
+			bench::consume(float(visits.count));
+		}, count));
+
+		const size_t before = gAllocations;
+		walk(visits);
+		std::fprintf(stderr, "%s,%s: %u allocations per walk\n", name, set.name, unsigned(gAllocations - before));
+
+		visits = Visits();
+		walk(visits);
+		if (visits.count != expected.count || visits.addressSum != expected.addressSum)
+		{
+			std::fprintf(stderr, "%s,%s: visited %u nodes of %u\n", name, set.name, unsigned(visits.count),
+				unsigned(expected.count));
+			complete = false;
+		}
+	}
+
+	bool benchScene(bench::Suite& suite, const bench::WorkingSet& set)
+	{
+		//Each node's parent is picked among the nodes created before it, as in scenebench.
+		const size_t count = set.bytes / 64;
+		Scene scene(NULL);
+		std::vector<SceneNode*> nodes(1, scene.getRootNode());
+		for (size_t i = 1; i < count; ++i)
+		{
+			SceneNode* parent = nodes[size_t((randomFloat() * 0.5f + 0.5f) * (nodes.size() - 1))];
+			nodes.push_back(scene.createTransformNode(parent));
+		}
+
+		Visits expected;
+		for (size_t i = 0; i < nodes.size(); ++i)
+			expected.add(nodes[i]);
+
+		bool complete = true;
+		SceneNode* root = scene.getRootNode();
+		benchWalk(suite, set, "std::stack iterator, ++it", count, expected, complete, [&](Visits& v) {
+			for (StackIterator it(root), end = StackIterator::end(root); it != end; ++it)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "std::stack iterator, it++", count, expected, complete, [&](Visits& v) {
+			for (StackIterator it(root), end = StackIterator::end(root); it != end; it++)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "Scene::iterator, ++it", count, expected, complete, [&](Visits& v) {
+			for (Scene::iterator it = scene.begin(), end = scene.end(); it != end; ++it)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "Scene::iterator, it++", count, expected, complete, [&](Visits& v) {
+			for (Scene::iterator it = scene.begin(), end = scene.end(); it != end; it++)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "Scene::breadth_first_iterator", count, expected, complete, [&](Visits& v) {
+			for (Scene::breadth_first_iterator it = scene.beginBreadthFirst(), end = scene.endBreadthFirst();
+				it != end; ++it)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "Scene::forEach", count, expected, complete, [&](Visits& v) {
+			scene.forEach([&](SceneNode* node) { v.add(node); });
+		});
+
+		//Once compacted, the walk reads the nodes in the order they sit in memory.
+		std::vector<SceneNode::Handle> handles(nodes.size());
+		for (size_t i = 0; i < nodes.size(); ++i)
+			handles[i] = nodes[i]->handle();
+		scene.compact();
+		root = scene.getRootNode();
+		expected = Visits();
+		for (size_t i = 0; i < handles.size(); ++i)
+			expected.add(scene.getNode(handles[i]));
+
+		benchWalk(suite, set, "Scene::iterator, ++it, compacted", count, expected, complete, [&](Visits& v) {
+			for (Scene::iterator it = scene.begin(), end = scene.end(); it != end; ++it)
+				v.add(*it);
+		});
+		benchWalk(suite, set, "Scene::forEach, compacted", count, expected, complete, [&](Visits& v) {
+			scene.forEach([&](SceneNode* node) { v.add(node); });
+		});
+		return complete;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+
+	//The sizes are the node counts; the byte counts only serve --quick.
+	const bench::WorkingSet scenes[] = {
+		{ "10k", 10000 * 64 },
+		{ "100k", 100000 * 64 },
+		{ "1M", 1000000 * 64 },
+	};
+
+	bool complete = true;
+	for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s)
+		if (suite.wants(scenes[s]))
+			complete &= benchScene(suite, scenes[s]);
+
+	const int result = suite.finish();
+	return complete ? result : 1;
+}
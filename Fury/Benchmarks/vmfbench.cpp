@@ -0,0 +1,457 @@
+/*
+VMF benchmark: loading .vmf models and copying them to a stand-in for a GPU buffer, through the old stream path,
+which reads each file into vectors with an ifstream, and through VMFFile, which maps the file and copies from the
+mapping, keeping the files mapped and unmapping each one after its copy. The models are the game's, the .vmf files
+in Game/Models, and a synthetic corpus of 64 meshes of 16 MB, 1 GB, written to the working directory and removed
+afterwards; the game's models are also loaded, mapped, with their vertices quantized. The files are in the
+operating system's cache after the first load, so this measures warm loads. Does not depend on DirectX. From the
+Fury directory:
+
+	g++ -std=c++11 -O2 -I. Benchmarks/vmfbench.cpp vmffile.cpp mappedfile.cpp vertex.cpp vertexquantizer.cpp -o vmfbench
+	cl /O2 /EHsc /I. Benchmarks\vmfbench.cpp vmffile.cpp mappedfile.cpp vertex.cpp vertexquantizer.cpp
+
+Results are in nanoseconds per file, in the CSV format of benchcommon.h. The throughput and the peak resident memory
+each kernel added go to stderr; on Windows the peak cannot be reset, so it is the peak of the whole run, and each
+kernel should be run on its own with --filter to read it. --quick skips the corpus. The exit code is 1 if a mapped
+model differs from the streamed one, VMFFile accepts a truncated file, a model written as version 2 does not read
+back as it was or its corruption goes unnoticed, or a quantized vertex decodes further from the original than its
+format allows. The quantization error of each model goes to stderr.
+*/
+
+#include "benchcommon.h"
+#include "vmffile.h"
+#include "vertexquantizer.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+using bench::randomFloat;
+
+namespace
+{
+	/**A model as Mesh kept it before VMFFile, read into vectors.*/
+	struct StreamedModel
+	{
+		VMFHeader header;
+		std::vector<Vertex3D> vertices;
+		std::vector<ElementIndexType> indices;
+	};
+
+	/**The old Mesh::load.*/
+	bool streamLoad(const char* path, StreamedModel& model)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (file.fail())
+			return false;
+		file.read(reinterpret_cast<char*>(&model.header), sizeof(VMFHeader));
+		model.vertices.resize(model.header.vertCount);
+		model.indices.resize(model.header.indexCount);
+		file.read(reinterpret_cast<char*>(model.vertices.data()), model.vertices.size() * sizeof(Vertex3D));
+		file.read(reinterpret_cast<char*>(model.indices.data()), model.indices.size() * sizeof(ElementIndexType));
+		return !file.fail();
+	}
+
+	/**Stands in for the vertex and index buffers the driver copies a model into.*/
+	void upload(std::vector<unsigned char>& gpu, const void* vertices, size_t vertexBytes, const void* indices,
+		size_t indexBytes)
+	{
+		if (gpu.size() < vertexBytes + indexBytes)
+			gpu.resize(vertexBytes + indexBytes);
+		std::memcpy(gpu.data(), vertices, vertexBytes);
+		std::memcpy(gpu.data() + vertexBytes, indices, indexBytes);
+		bench::consume(float(gpu[vertexBytes / 2]));
+	}
+
+	/**The resident memory of the process, or its peak since the last resetPeak(), in bytes; 0 where unknown.*/
+	size_t residentBytes(bool peak)
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return peak ? counters.PeakWorkingSetSize : counters.WorkingSetSize;
+#else
+		std::ifstream status("/proc/self/status");
+		const std::string field = peak ? "VmHWM:" : "VmRSS:";
+		std::string line;
+		while (std::getline(status, line))
+			if (line.compare(0, field.size(), field) == 0)
+				return size_t(std::strtoull(line.c_str() + field.size(), NULL, 10)) * 1024;
+		return 0;
+#endif
+	}
+
+	/**Restarts the peak residentBytes() reports from the current size, where the system allows it.*/
+	void resetPeak()
+	{
+#if !defined(_WIN32)
+		std::ofstream clearRefs("/proc/self/clear_refs");
+		clearRefs << "5";
+#endif
+	}
+
+	/**Runs a kernel once more for its peak memory and reports it with the throughput of the measured time.*/
+	template<class Func>
+	void report(const char* kernel, const bench::WorkingSet& set, double nsPerFile, size_t files, Func func)
+	{
+		resetPeak();
+		const size_t before = residentBytes(false);
+		func();
+		const size_t peak = residentBytes(true);
+		const double mb = 1024.0 * 1024.0;
+		std::fprintf(stderr, "%s,%s: %.0f MB/s, peak resident memory %+.1f MB\n", kernel, set.name,
+			double(set.bytes) / mb / (nsPerFile * double(files) * 1e-9), (double(peak) - double(before)) / mb);
+	}
+
+	/**Whether VMFFile reads every model as the stream path does.*/
+	bool checkModels(const std::vector<std::string>& paths)
+	{
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			StreamedModel streamed;
+			VMFFile mapped;
+			const VMFFile::Status status = mapped.open(paths[i].c_str());
+			const bool matches = streamLoad(paths[i].c_str(), streamed) && status == VMFFile::OK &&
+				mapped.vertexCount() == streamed.header.vertCount &&
+				mapped.indexCount() == streamed.header.indexCount &&
+				mapped.bounds().radius == streamed.header.objectRadius &&
+				std::memcmp(mapped.vertices(), streamed.vertices.data(), mapped.vertexBytes()) == 0 &&
+				std::memcmp(mapped.indices(), streamed.indices.data(), mapped.indexBytes()) == 0;
+			if (!matches)
+			{
+				std::fprintf(stderr, "%s: the mapped model differs from the streamed one (%s)\n", paths[i].c_str(),
+					VMFFile::describe(status));
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**Whether VMFFile refuses a copy of a model cut short inside its indices and one cut inside its header.*/
+	bool checkTruncated(const std::string& path)
+	{
+		std::ifstream source(path.c_str(), std::ios::binary);
+		const std::string contents((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+		const char* truncatedPath = "vmfbench_truncated.vmf";
+		const struct
+		{
+			size_t size;
+			VMFFile::Status expected;
+		} cuts[] = {
+			{ contents.size() - sizeof(ElementIndexType), VMFFile::SIZE_MISMATCH },
+			{ sizeof(VMFHeader) / 2, VMFFile::TOO_SHORT },
+		};
+
+		bool refused = true;
+		for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); ++c)
+		{
+			{
+				std::ofstream truncated(truncatedPath, std::ios::binary);
+				truncated.write(contents.data(), cuts[c].size);
+			}
+			VMFFile file;
+			const VMFFile::Status status = file.open(truncatedPath);
+			if (status != cuts[c].expected)
+			{
+				std::fprintf(stderr, "%s cut to %u bytes: expected \"%s\", got \"%s\"\n", path.c_str(),
+					unsigned(cuts[c].size), VMFFile::describe(cuts[c].expected), VMFFile::describe(status));
+				refused = false;
+			}
+		}
+		std::remove(truncatedPath);
+		return refused;
+	}
+
+	size_t fileBytes(const std::vector<std::string>& paths)
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			std::ifstream file(paths[i].c_str(), std::ios::binary | std::ios::ate);
+			bytes += size_t(file.tellg());
+		}
+		return bytes;
+	}
+
+	/**Flips a byte of a file.*/
+	void corrupt(const char* path, size_t offset)
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekg(std::streamoff(offset));
+		const char byte = char(file.get() ^ 0x40);
+		file.seekp(std::streamoff(offset));
+		file.put(byte);
+	}
+
+	/**Whether a model written in version 2, in two parts, reads back as it was, with every vertex in its bounds,
+	and whether a corrupt header is refused and a corrupt vertex found by verifyChecksums().*/
+	bool checkVersion2(const std::string& path)
+	{
+		const char* convertedPath = "vmfbench_v2.vmf";
+		VMFFile original;
+		if (original.open(path.c_str()) != VMFFile::OK)
+			return false;
+		const unsigned half = original.indexCount() / 6 * 3;
+		const VMFSubMesh parts[] = {
+			{ 0, half, 0, 1, {}, {} },
+			{ half, original.indexCount() - half, 0, 2, {}, {} },
+		};
+		bool matches = VMFFile::write(convertedPath, original.vertices(), original.vertexCount(), original.indices(),
+			original.indexCount(), parts, 2);
+
+		VMFFile converted;
+		const VMFFile::Status status = converted.open(convertedPath);
+		matches = matches && status == VMFFile::OK && converted.version() == 2 && converted.verifyChecksums() &&
+			converted.vertexCount() == original.vertexCount() && converted.indexCount() == original.indexCount() &&
+			std::memcmp(converted.vertices(), original.vertices(), original.vertexBytes()) == 0 &&
+			std::memcmp(converted.indices(), original.indices(), original.indexBytes()) == 0 &&
+			converted.subMeshCount() == 2 && converted.subMeshes()[1].firstIndex == half &&
+			converted.subMeshes()[1].material == 2;
+		for (unsigned v = 0; v < converted.vertexCount() && matches; ++v)
+		{
+			const float position[3] = { converted.vertices()[v].x, converted.vertices()[v].y,
+				converted.vertices()[v].z };
+			const VMFFile::Bounds& bounds = converted.bounds();
+			float distanceSquared = 0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				matches &= position[axis] >= bounds.min[axis] && position[axis] <= bounds.max[axis];
+				const float d = position[axis] - bounds.centre[axis];
+				distanceSquared += d * d;
+			}
+			matches &= distanceSquared <= bounds.radius * bounds.radius * 1.0001f;
+		}
+		if (!matches)
+			std::fprintf(stderr, "%s: the version 2 copy differs (%s)\n", path.c_str(), VMFFile::describe(status));
+
+		converted.close();
+
+		//The last byte of the file is one of the indices, the last section.
+		const size_t indexByte = size_t(fileBytes(std::vector<std::string>(1, convertedPath))) - 1;
+		corrupt(convertedPath, indexByte);
+		const VMFFile::Status corruptIndex = converted.open(convertedPath);
+		const bool indexFound = corruptIndex == VMFFile::OK && !converted.verifyChecksums();
+		converted.close();
+		corrupt(convertedPath, indexByte);
+
+		corrupt(convertedPath, offsetof(VMF2Header, boundsMin));
+		const VMFFile::Status corruptHeader = converted.open(convertedPath);
+		if (!indexFound || corruptHeader != VMFFile::BAD_CHECKSUM)
+		{
+			std::fprintf(stderr, "%s: corruption of the version 2 copy went unnoticed (\"%s\", \"%s\")\n",
+				path.c_str(), VMFFile::describe(corruptIndex), VMFFile::describe(corruptHeader));
+			matches = false;
+		}
+		std::remove(convertedPath);
+		return matches;
+	}
+
+	/**Quantizes a model into a version 2 file, reporting the error, and returns whether every vertex decodes to
+	within the error the format allows: half a step of the box on each axis, 0.05 degrees of the normal with 16 bits
+	and 1 with 8, and the rounding of a half float.*/
+	bool checkQuantized(const std::string& path, const std::string& quantizedPath, VertexFormat format)
+	{
+		VMFFile original;
+		if (original.open(path.c_str()) != VMFFile::OK)
+			return false;
+		QuantizationError error;
+		bool matches = VMFFile::write(quantizedPath.c_str(), original.vertices(), original.vertexCount(),
+			original.indices(), original.indexCount(), NULL, 0, format, &error);
+
+		VMFFile quantized;
+		const VMFFile::Status status = quantized.open(quantizedPath.c_str());
+		matches = matches && status == VMFFile::OK && quantized.vertexFormat() == format && !quantized.vertices() &&
+			quantized.vertexBytes() == size_t(original.vertexCount()) * vertexStride(format) &&
+			std::memcmp(quantized.indices(), original.indices(), original.indexBytes()) == 0;
+
+		const VMFFile::Bounds& bounds = quantized.bounds();
+		float halfStep = 0;
+		for (int axis = 0; axis < 3; ++axis)
+			halfStep += std::pow((bounds.max[axis] - bounds.min[axis]) / 65535.f * 0.5f, 2.f);
+		halfStep = std::sqrt(halfStep) * 1.01f + 1e-6f;
+		const float maxCosine = std::cos((format == VERTEX_QUANTIZED ? 0.05f : 1.f) / 57.2957795f);
+		for (unsigned v = 0; v < original.vertexCount() && matches; ++v)
+		{
+			const Vertex3D& vertex = original.vertices()[v];
+			const Vertex3D decoded = dequantizeVertex(static_cast<const unsigned char*>(quantized.vertexData()) +
+				size_t(v) * vertexStride(format), format, bounds.min, bounds.max);
+			const float dx = decoded.x - vertex.x, dy = decoded.y - vertex.y, dz = decoded.z - vertex.z;
+			const float length = std::sqrt(vertex.normx * vertex.normx + vertex.normy * vertex.normy +
+				vertex.normz * vertex.normz);
+			const float cosine = length > 0 ? (decoded.normx * vertex.normx + decoded.normy * vertex.normy +
+				decoded.normz * vertex.normz) / length : 1;
+			matches = std::sqrt(dx * dx + dy * dy + dz * dz) <= halfStep && cosine >= maxCosine &&
+				std::fabs(decoded.u - vertex.u) <= std::max(std::fabs(vertex.u), 1.f) / 2048 &&
+				std::fabs(decoded.v - vertex.v) <= std::max(std::fabs(vertex.v), 1.f) / 2048;
+		}
+
+		std::fprintf(stderr, "%s, %u byte vertices: position error max %g, normal error max %.3f degrees, "
+			"UV error max %g%s\n", path.c_str(), vertexStride(format), error.maxPosition, error.maxNormalDegrees,
+			error.maxUV, matches ? "" : "; a vertex decodes outside the allowed error");
+		return matches;
+	}
+
+	/**Measures loading a set of models and copying them to the GPU stand-in. Only version 1 files can be streamed.*/
+	void benchLoad(bench::Suite& suite, const bench::WorkingSet& set, const std::vector<std::string>& paths,
+		bool streamable = true)
+	{
+		const size_t files = paths.size();
+		std::vector<unsigned char> gpu;
+
+		//Every model stays loaded until the whole set is, as the game keeps its meshes.
+		const char* streamKernel = "VMF stream load+upload";
+		auto streamed = [&]() {
+			std::vector<StreamedModel> models(files);
+			for (size_t i = 0; i < files; ++i)
+			{
+				streamLoad(paths[i].c_str(), models[i]);
+				upload(gpu, models[i].vertices.data(), models[i].vertices.size() * sizeof(Vertex3D),
+					models[i].indices.data(), models[i].indices.size() * sizeof(ElementIndexType));
+			}
+		};
+		if (streamable && suite.wants(streamKernel))
+		{
+			const double ns = bench::measure(streamed, files);
+			suite.add(streamKernel, set, ns);
+			report(streamKernel, set, ns, files, streamed);
+		}
+
+		const char* mappedKernel = "VMF mapped load+upload";
+		auto mapped = [&]() {
+			std::vector<VMFFile> models(files);
+			for (size_t i = 0; i < files; ++i)
+			{
+				models[i].open(paths[i].c_str());
+				upload(gpu, models[i].vertexData(), models[i].vertexBytes(), models[i].indices(),
+					models[i].indexBytes());
+			}
+		};
+		if (suite.wants(mappedKernel))
+		{
+			const double ns = bench::measure(mapped, files);
+			suite.add(mappedKernel, set, ns);
+			report(mappedKernel, set, ns, files, mapped);
+		}
+
+		//As the game does, keeping nothing of a model on the CPU once it is on the GPU.
+		const char* unmappedKernel = "VMF mapped load+upload, unmapped";
+		auto unmapped = [&]() {
+			std::vector<VMFFile> models(files);
+			for (size_t i = 0; i < files; ++i)
+			{
+				models[i].open(paths[i].c_str());
+				upload(gpu, models[i].vertexData(), models[i].vertexBytes(), models[i].indices(),
+					models[i].indexBytes());
+				models[i].close();
+			}
+		};
+		if (suite.wants(unmappedKernel))
+		{
+			const double ns = bench::measure(unmapped, files);
+			suite.add(unmappedKernel, set, ns);
+			report(unmappedKernel, set, ns, files, unmapped);
+		}
+	}
+
+	/**Writes the synthetic corpus, returning its paths, or none if it could not be written.*/
+	std::vector<std::string> writeCorpus(unsigned files, unsigned vertCount, unsigned indexCount)
+	{
+		std::vector<unsigned char> contents(sizeof(VMFHeader) + vertCount * sizeof(Vertex3D) +
+			indexCount * sizeof(ElementIndexType));
+		VMFHeader* header = reinterpret_cast<VMFHeader*>(contents.data());
+		header->vertCount = vertCount;
+		header->indexCount = indexCount;
+		header->objectRadius = 1.f;
+		header->centrePointX = header->centrePointY = header->centrePointZ = 0;
+		Vertex3D* vertices = reinterpret_cast<Vertex3D*>(header + 1);
+		for (unsigned v = 0; v < vertCount; ++v)
+			vertices[v] = Vertex3D(randomFloat(), randomFloat(), randomFloat(), 0, 1, 0, randomFloat(), randomFloat());
+		ElementIndexType* indices = reinterpret_cast<ElementIndexType*>(vertices + vertCount);
+		for (unsigned i = 0; i < indexCount; ++i)
+			indices[i] = ElementIndexType(i % vertCount);
+
+		std::vector<std::string> paths;
+		for (unsigned f = 0; f < files; ++f)
+		{
+			char path[64];
+			std::snprintf(path, sizeof(path), "vmfbench_corpus_%02u.vmf", f);
+			paths.push_back(path);
+			std::ofstream file(path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+			if (file.fail())
+			{
+				std::fprintf(stderr, "Could not write the corpus to %s\n", path);
+				for (size_t p = 0; p < paths.size(); ++p)
+					std::remove(paths[p].c_str());
+				return std::vector<std::string>();
+			}
+		}
+		return paths;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Suite suite(argc, argv);
+	bool matches = true;
+
+	const char* models[] = { "Bishop", "Board", "King", "Knight", "Pawn", "Queen", "Rook", "monster" };
+	std::vector<std::string> gamePaths;
+	for (size_t m = 0; m < sizeof(models) / sizeof(models[0]); ++m)
+		gamePaths.push_back(std::string("Game/Models/") + models[m] + ".vmf");
+	const bench::WorkingSet game = { "Game", fileBytes(gamePaths) };
+	matches &= checkModels(gamePaths) && checkTruncated(gamePaths[0]);
+	for (size_t m = 0; m < gamePaths.size(); ++m)
+		matches &= checkVersion2(gamePaths[m]);
+	if (matches)
+		benchLoad(suite, game, gamePaths);
+
+	//The game's models with quantized vertices: the same meshes in less memory.
+	const struct
+	{
+		VertexFormat format;
+		const char* name;
+	} formats[] = {
+		{ VERTEX_QUANTIZED, "Game quantized" },
+		{ VERTEX_QUANTIZED_COMPACT, "Game compact" },
+	};
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]) && matches; ++f)
+	{
+		std::vector<std::string> quantizedPaths;
+		for (size_t m = 0; m < gamePaths.size(); ++m)
+		{
+			quantizedPaths.push_back(std::string("vmfbench_") + models[m] + ".vmf");
+			matches &= checkQuantized(gamePaths[m], quantizedPaths[m], formats[f].format);
+		}
+		const bench::WorkingSet quantized = { formats[f].name, fileBytes(quantizedPaths) };
+		if (matches)
+			benchLoad(suite, quantized, quantizedPaths, false);
+		for (size_t p = 0; p < quantizedPaths.size(); ++p)
+			std::remove(quantizedPaths[p].c_str());
+	}
+
+	//Each mesh is 12 MB of vertices and 4 MB of indices.
+	const unsigned corpusFiles = 64, corpusVertices = 393216, corpusIndices = 1048576;
+	const bench::WorkingSet corpus = { "1GB", corpusFiles * (sizeof(VMFHeader) + corpusVertices * sizeof(Vertex3D) +
+		corpusIndices * sizeof(ElementIndexType)) };
+	if (matches && suite.wants(corpus))
+	{
+		std::vector<std::string> corpusPaths = writeCorpus(corpusFiles, corpusVertices, corpusIndices);
+		matches &= !corpusPaths.empty() && checkModels(corpusPaths);
+		if (matches)
+			benchLoad(suite, corpus, corpusPaths);
+		for (size_t p = 0; p < corpusPaths.size(); ++p)
+			std::remove(corpusPaths[p].c_str());
+	}
+
+	const int result = suite.finish();
+	return matches ? result : 1;
+}
@@ -1,8 +1,3 @@
-cbuffer Uniforms
-{
-	float4 ObjectColour;
-}
-
 struct PixelInputType
 {
 	float4 positionProjectionspace : SV_POSITION;
@@ -10,6 +5,7 @@ struct PixelInputType
 	float3 normalCameraspace : NORMAL;
 	float3 lightDirection : POSITION1;
 	float2 uv : TEXCOORD0;
+	nointerpolation float4 colour : COLOR0;
 };
 
 Texture2D diffuseTexture;
@@ -115,6 +111,6 @@ float4 main(PixelInputType input) : SV_TARGET
 	float3 ambient = 0.0;
 	float3 specular = specularCoefficient*specularMultiplier;
 	
-	float3 colour = diffuseTexture.Sample(samplerState, input.uv).xyz*(diffuse*ObjectColour.xyz + specular + ambient);
+	float3 colour = diffuseTexture.Sample(samplerState, input.uv).xyz*(diffuse*input.colour.xyz + specular + ambient);
 	return float4(colour,1);
 }
\ No newline at end of file
@@ -1,15 +1,25 @@
-cbuffer MatrixBuffer
+//FrameConstants, at RenderBackend::kFrameConstantSlot.
+cbuffer FrameBuffer : register(b0)
 {
-	matrix worldMatrix;
 	matrix viewMatrix;
 	matrix projectionMatrix;
 }
 
+//The top three rows of the world and normal matrices, and the colour, of one instance (InstanceStaticmesh).
+//Quantized positions come in as fractions of the mesh's box, which the world matrix holds, so they need no decoding.
+//normal0.w is 1 if the normals are octahedral encoded, in which case only their x and y are read.
 struct VertexInputType
 {
 	float3 position : POSITION;
 	float3 normal : NORMAL;
 	float2 uv : TEXCOORD0;
+	float4 world0 : INSTANCE0;
+	float4 world1 : INSTANCE1;
+	float4 world2 : INSTANCE2;
+	float4 normal0 : INSTANCE3;
+	float4 normal1 : INSTANCE4;
+	float4 normal2 : INSTANCE5;
+	float4 colour : INSTANCE6;
 };
 
 struct PixelInputType
@@ -19,28 +29,43 @@ struct PixelInputType
 	float3 normalCameraspace : NORMAL;
 	float3 lightDirection : POSITION1;
 	float2 uv : TEXCOORD0;
+	nointerpolation float4 colour : COLOR0;
 };
 
 static const float3 LightVector = float3(0,1,1);
 
+//The inverse of the octahedral encoding of vertexquantizer.cpp: the square [-1, 1]^2 folded back onto the octahedron.
+float3 octahedralDecode(float2 encoded)
+{
+	float3 normal = float3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-normal.z);
+	normal.xy += normal.xy >= 0 ? -fold : fold;
+	return normalize(normal);
+}
+
 PixelInputType main(VertexInputType input)
 {
 	PixelInputType output;
 	
+	matrix worldMatrix = matrix(input.world0, input.world1, input.world2, float4(0, 0, 0, 1));
+	matrix normalMatrix = matrix(input.normal0, input.normal1, input.normal2, float4(0, 0, 0, 1));
+	
 	output.positionCameraspace = float4(input.position,1.f);
 	output.positionCameraspace = mul(worldMatrix,output.positionCameraspace);
 	output.positionCameraspace = mul(viewMatrix,output.positionCameraspace);
 	
 	output.positionProjectionspace = mul(projectionMatrix,output.positionCameraspace);
 	
-	float4 normalOut = float4(input.normal, 0.f);
-	normalOut = mul(worldMatrix, normalOut);
+	float3 normal = input.normal0.w != 0 ? octahedralDecode(input.normal.xy) : input.normal;
+	float4 normalOut = float4(normal, 0.f);
+	normalOut = mul(normalMatrix, normalOut);
 	normalOut = mul(viewMatrix, normalOut);
 	output.normalCameraspace = normalOut.xyz;
 	
 	output.lightDirection = mul(viewMatrix, LightVector);
 	
 	output.uv = float2(input.uv.x, -input.uv.y);
+	output.colour = input.colour;
 	
 	return output;
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+VMF quantizer: rewrites .vmf models, of either version, as version 2 files with quantized vertices, and reports for
+each how far its vertices moved and how much smaller its vertices and file became. It belongs to the asset pipeline
+and runs offline; the game loads what it writes as it does any other model. From the Fury directory:
+
+	g++ -std=c++11 -O2 -I. Tools/vmfquantize.cpp vmffile.cpp mappedfile.cpp vertex.cpp vertexquantizer.cpp -o vmfquantize
+	cl /O2 /EHsc /I. Tools\vmfquantize.cpp vmffile.cpp mappedfile.cpp vertex.cpp vertexquantizer.cpp
+
+Usage:
+	vmfquantize [--compact] input.vmf output.vmf [input.vmf output.vmf ...]
+
+Vertices take 16 bytes, or 12 with --compact, which keeps 8 bits rather than 16 of each value of the normal. The
+sub-meshes are kept. The exit code is 1 if a model could not be read or written.
+*/
+
+#include "vmffile.h"
+#include "vertexquantizer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	unsigned fileBytes(const char* path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		return unsigned(file.tellg());
+	}
+
+	bool quantize(const char* inputPath, const char* outputPath, VertexFormat format)
+	{
+		VMFFile input;
+		const VMFFile::Status status = input.open(inputPath);
+		if (status != VMFFile::OK)
+		{
+			std::fprintf(stderr, "%s: %s\n", inputPath, VMFFile::describe(status));
+			return false;
+		}
+		if (!input.vertices())
+		{
+			std::fprintf(stderr, "%s: the vertices are quantized already\n", inputPath);
+			return false;
+		}
+
+		QuantizationError error;
+		if (!VMFFile::write(outputPath, input.vertices(), input.vertexCount(), input.indices(), input.indexCount(),
+			input.subMeshes(), input.subMeshCount(), format, &error))
+		{
+			std::fprintf(stderr, "%s: could not write %s\n", inputPath, outputPath);
+			return false;
+		}
+
+		VMFFile output;
+		if (output.open(outputPath) != VMFFile::OK)
+		{
+			std::fprintf(stderr, "%s: could not read %s back\n", inputPath, outputPath);
+			return false;
+		}
+
+		const VMFFile::Bounds& bounds = output.bounds();
+		float diagonal = 0;
+		for (int axis = 0; axis < 3; ++axis)
+			diagonal += (bounds.max[axis] - bounds.min[axis]) * (bounds.max[axis] - bounds.min[axis]);
+		diagonal = std::sqrt(diagonal);
+
+		std::printf("%s: %u vertices of %u bytes, now %u; vertices %u bytes, now %u; file %u bytes, now %u\n"
+			"\tposition error max %g, mean %g (%.5f%% of the box's diagonal)\n"
+			"\tnormal error max %.3f degrees, mean %.3f\n"
+			"\tUV error max %g, mean %g\n",
+			inputPath, input.vertexCount(), vertexStride(input.vertexFormat()), vertexStride(format),
+			unsigned(input.vertexBytes()), unsigned(output.vertexBytes()), fileBytes(inputPath), fileBytes(outputPath),
+			error.maxPosition, error.meanPosition,
+			diagonal > 0 ? error.maxPosition / diagonal * 100 : 0.f, error.maxNormalDegrees, error.meanNormalDegrees,
+			error.maxUV, error.meanUV);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	VertexFormat format = VERTEX_QUANTIZED;
+	int first = 1;
+	if (argc > 1 && std::strcmp(argv[1], "--compact") == 0)
+	{
+		format = VERTEX_QUANTIZED_COMPACT;
+		++first;
+	}
+	if (argc - first < 2 || (argc - first) % 2 != 0)
+	{
+		std::fprintf(stderr, "Usage: %s [--compact] input.vmf output.vmf [input.vmf output.vmf ...]\n", argv[0]);
+		return 1;
+	}
+
+	bool written = true;
+	for (int i = first; i < argc; i += 2)
+		written &= quantize(argv[i], argv[i + 1], format);
+	return written ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+#include "bvh.h"
+
+const BVH::Proxy BVH::kInvalidProxy;
+const math::matReal BVH::kMargin = 0.1f;
+
+BVH::BVH() : mRoot(kNull), mFreeList(kNull), mLeafCount(0), mRefitsSinceBuild(0) {}
+
+unsigned BVH::allocateNode()
+{
+	unsigned node = mFreeList;
+	if (node == kNull)
+	{
+		node = unsigned(mNodes.size());
+		mNodes.push_back(Node());
+	}
+	else
+		mFreeList = mNodes[node].parent;
+
+	Node& n = mNodes[node];
+	n.parent = kNull;
+	n.child[0] = n.child[1] = kNull;
+	n.userData = NULL;
+	n.height = 0;
+	n.moved = false;
+	return node;
+}
+
+void BVH::freeNode(unsigned node)
+{
+	Node& n = mNodes[node];
+	n.parent = mFreeList;
+	n.height = -1;
+	n.moved = false;
+	mFreeList = node;
+}
+
+BVH::Proxy BVH::insert(const AABB& bounds, void* userData)
+{
+	const unsigned leaf = allocateNode();
+	const math::vec3 margin = (bounds.max - bounds.min) * kMargin;
+	mNodes[leaf].box = AABB(bounds.min - margin, bounds.max + margin);
+	mNodes[leaf].userData = userData;
+	insertLeaf(leaf);
+	++mLeafCount;
+	return leaf;
+}
+
+void BVH::remove(Proxy proxy)
+{
+	assert(proxy < mNodes.size() && mNodes[proxy].height == 0);
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--mLeafCount;
+}
+
+void BVH::clear()
+{
+	mNodes.clear();
+	mRoot = kNull;
+	mFreeList = kNull;
+	mLeafCount = 0;
+	mMoved.clear();
+	mRefitsSinceBuild = 0;
+}
+
+bool BVH::move(Proxy proxy, const AABB& bounds)
+{
+	assert(proxy < mNodes.size() && mNodes[proxy].height == 0);
+	Node& leaf = mNodes[proxy];
+	if (leaf.box.contains(bounds))
+		return false;
+
+	const math::vec3 margin = (bounds.max - bounds.min) * kMargin;
+	leaf.box = AABB(bounds.min - margin, bounds.max + margin);
+	if (!leaf.moved)
+	{
+		leaf.moved = true;
+		mMoved.push_back(proxy);
+	}
+	return true;
+}
+
+void BVH::refit()
+{
+	if (mMoved.empty())
+		return;
+
+	mRefitsSinceBuild += mMoved.size();
+	if (mRefitsSinceBuild >= mLeafCount)
+	{
+		rebuild();
+		return;
+	}
+
+	for (size_t i = 0; i < mMoved.size(); ++i)
+	{
+		//Removed since it moved, and perhaps reused for something else.
+		Node& leaf = mNodes[mMoved[i]];
+		if (!leaf.moved)
+			continue;
+		leaf.moved = false;
+
+		//Once a box comes out the same, the boxes above it are as well, unless another moved leaf below them
+		//changes them, which that leaf's own walk will take care of.
+		for (unsigned node = leaf.parent; node != kNull; node = mNodes[node].parent)
+		{
+			Node& n = mNodes[node];
+			const AABB box = AABB::merge(mNodes[n.child[0]].box, mNodes[n.child[1]].box);
+			if (box == n.box)
+				break;
+			n.box = box;
+		}
+	}
+	mMoved.clear();
+}
+
+void BVH::rebuild()
+{
+	for (size_t i = 0; i < mMoved.size(); ++i)
+		mNodes[mMoved[i]].moved = false;
+	mMoved.clear();
+	mRefitsSinceBuild = 0;
+
+	//The leaves keep their indices, since those are the proxies; only the nodes above them are replaced.
+	mBuildScratch.clear();
+	for (size_t i = 0; i < mNodes.size(); ++i)
+	{
+		if (mNodes[i].height == 0)
+			mBuildScratch.push_back(unsigned(i));
+		else if (mNodes[i].height > 0)
+			freeNode(unsigned(i));
+	}
+
+	mRoot = kNull;
+	if (!mBuildScratch.empty())
+	{
+		mRoot = build(&mBuildScratch[0], mBuildScratch.size());
+		mNodes[mRoot].parent = kNull;
+	}
+}
+
+unsigned BVH::build(unsigned* leaves, size_t count)
+{
+	if (count == 1)
+		return leaves[0];
+
+	//Split at the median centre along the axis where the centres spread the most. Centres are compared doubled,
+	//as min + max, which orders them the same.
+	math::vec3 low = mNodes[leaves[0]].box.min + mNodes[leaves[0]].box.max, high = low;
+	for (size_t i = 1; i < count; ++i)
+	{
+		const AABB& box = mNodes[leaves[i]].box;
+		const math::vec3 centre = box.min + box.max;
+		low = math::vec3(std::min(low.x, centre.x), std::min(low.y, centre.y), std::min(low.z, centre.z));
+		high = math::vec3(std::max(high.x, centre.x), std::max(high.y, centre.y), std::max(high.z, centre.z));
+	}
+	const math::vec3 spread = high - low;
+	const int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+	const size_t half = count / 2;
+	const std::vector<Node>& nodes = mNodes;
+	std::nth_element(leaves, leaves + half, leaves + count, [&](unsigned a, unsigned b) {
+		return (&nodes[a].box.min.x)[axis] + (&nodes[a].box.max.x)[axis] <
+			(&nodes[b].box.min.x)[axis] + (&nodes[b].box.max.x)[axis];
+	});
+
+	const unsigned left = build(leaves, half);
+	const unsigned right = build(leaves + half, count - half);
+
+	const unsigned node = allocateNode();
+	Node& n = mNodes[node];
+	n.child[0] = left;
+	n.child[1] = right;
+	n.box = AABB::merge(mNodes[left].box, mNodes[right].box);
+	n.height = 1 + std::max(mNodes[left].height, mNodes[right].height);
+	mNodes[left].parent = node;
+	mNodes[right].parent = node;
+	return node;
+}
+
+void BVH::insertLeaf(unsigned leaf)
+{
+	if (mRoot == kNull)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = kNull;
+		return;
+	}
+
+	//Walk down to the sibling that adds the least area. Making a new parent here costs the area of the merged box,
+	//and every ancestor grows by the same amount whichever child the leaf goes into.
+	const AABB leafBox = mNodes[leaf].box;
+	unsigned index = mRoot;
+	while (!mNodes[index].isLeaf())
+	{
+		const Node& n = mNodes[index];
+		const math::matReal area = n.box.halfArea();
+		const math::matReal combinedArea = AABB::merge(n.box, leafBox).halfArea();
+		const math::matReal cost = 2 * combinedArea;
+		const math::matReal inheritanceCost = 2 * (combinedArea - area);
+
+		math::matReal childCost[2];
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = mNodes[n.child[c]];
+			const math::matReal grown = AABB::merge(child.box, leafBox).halfArea();
+			childCost[c] = (child.isLeaf() ? grown : grown - child.box.halfArea()) + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		index = n.child[childCost[0] <= childCost[1] ? 0 : 1];
+	}
+
+	const unsigned sibling = index;
+	const unsigned oldParent = mNodes[sibling].parent;
+	const unsigned newParent = allocateNode();
+	Node& p = mNodes[newParent];
+	p.parent = oldParent;
+	p.box = AABB::merge(leafBox, mNodes[sibling].box);
+	p.height = mNodes[sibling].height + 1;
+	p.child[0] = sibling;
+	p.child[1] = leaf;
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+
+	if (oldParent == kNull)
+		mRoot = newParent;
+	else
+	{
+		Node& old = mNodes[oldParent];
+		old.child[old.child[0] == sibling ? 0 : 1] = newParent;
+	}
+
+	fixUpwards(oldParent);
+}
+
+void BVH::removeLeaf(unsigned leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = kNull;
+		return;
+	}
+
+	const unsigned parent = mNodes[leaf].parent;
+	const unsigned grandParent = mNodes[parent].parent;
+	const unsigned sibling = mNodes[parent].child[mNodes[parent].child[0] == leaf ? 1 : 0];
+
+	mNodes[sibling].parent = grandParent;
+	if (grandParent == kNull)
+		mRoot = sibling;
+	else
+	{
+		Node& g = mNodes[grandParent];
+		g.child[g.child[0] == parent ? 0 : 1] = sibling;
+	}
+	freeNode(parent);
+
+	fixUpwards(grandParent);
+}
+
+void BVH::fixUpwards(unsigned node)
+{
+	while (node != kNull)
+	{
+		node = balance(node);
+
+		Node& n = mNodes[node];
+		const Node& a = mNodes[n.child[0]];
+		const Node& b = mNodes[n.child[1]];
+		n.height = 1 + std::max(a.height, b.height);
+		n.box = AABB::merge(a.box, b.box);
+		node = n.parent;
+	}
+}
+
+unsigned BVH::balance(unsigned iA)
+{
+	Node& A = mNodes[iA];
+	if (A.isLeaf() || A.height < 2)
+		return iA;
+
+	//Whichever child is taller by two or more takes A's place, and A takes the shorter of that child's children.
+	const int taller = mNodes[A.child[1]].height - mNodes[A.child[0]].height > 1 ? 1 :
+		(mNodes[A.child[0]].height - mNodes[A.child[1]].height > 1 ? 0 : -1);
+	if (taller < 0)
+		return iA;
+
+	const unsigned iB = A.child[1 - taller]; //Stays under A.
+	const unsigned iC = A.child[taller]; //Rotates up.
+	Node& B = mNodes[iB];
+	Node& C = mNodes[iC];
+	const unsigned iF = C.child[0];
+	const unsigned iG = C.child[1];
+	Node& F = mNodes[iF];
+	Node& G = mNodes[iG];
+
+	C.child[0] = iA;
+	C.parent = A.parent;
+	A.parent = iC;
+	if (C.parent == kNull)
+		mRoot = iC;
+	else
+	{
+		Node& parent = mNodes[C.parent];
+		parent.child[parent.child[0] == iA ? 0 : 1] = iC;
+	}
+
+	//The taller of F and G stays under C, the other replaces C under A.
+	const unsigned iKeep = F.height > G.height ? iF : iG;
+	const unsigned iGive = iKeep == iF ? iG : iF;
+	Node& keep = mNodes[iKeep];
+	Node& give = mNodes[iGive];
+
+	C.child[1] = iKeep;
+	A.child[taller] = iGive;
+	give.parent = iA;
+
+	A.box = AABB::merge(B.box, give.box);
+	A.height = 1 + std::max(B.height, give.height);
+	C.box = AABB::merge(A.box, keep.box);
+	C.height = 1 + std::max(A.height, keep.height);
+	return iC;
+}
+
+void BVH::validate() const
+{
+	assert(mMoved.empty());
+	if (mRoot == kNull)
+	{
+		assert(mLeafCount == 0);
+		return;
+	}
+	assert(mNodes[mRoot].parent == kNull);
+
+	size_t leaves = 0;
+	std::vector<unsigned> stack(1, mRoot);
+	while (!stack.empty())
+	{
+		const unsigned index = stack.back();
+		stack.pop_back();
+		const Node& n = mNodes[index];
+		if (n.isLeaf())
+		{
+			assert(n.height == 0);
+			++leaves;
+			continue;
+		}
+
+		const Node& a = mNodes[n.child[0]];
+		const Node& b = mNodes[n.child[1]];
+		assert(a.parent == index && b.parent == index);
+		assert(n.height == 1 + std::max(a.height, b.height));
+		assert(n.box == AABB::merge(a.box, b.box));
+		(void)a;
+		(void)b;
+		stack.push_back(n.child[0]);
+		stack.push_back(n.child[1]);
+	}
+	assert(leaves == mLeafCount);
+	(void)leaves;
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include "matrixd.h"
+#include "frustum.h"
+#include <algorithm>
+#include <assert.h>
+#include <vector>
+
+/*
+A dynamic bounding volume hierarchy: a binary tree of axis aligned boxes with one object in every leaf, where each
+box encloses the boxes below it. A query only descends into boxes that meet what it looks for, so it visits about
+log(n) nodes plus the ones it reports rather than every object in the scene.
+
+Objects are inserted and removed one at a time. An insertion goes where it adds the least surface area to the tree,
+and nodes are rotated on the way back up to keep the tree balanced. A leaf holds its object's bounds grown by a
+margin, so an object that moves a little stays inside its leaf and costs nothing. One that leaves it gets a new box
+in its leaf, and refit() then corrects the boxes above all such leaves in one pass. Refitting keeps the shape of the
+tree, which gets worse as objects travel, so once as many leaves have been refit as the tree holds it is rebuilt
+from scratch instead.
+*/
+
+/**An axis aligned box.*/
+struct AABB
+{
+	math::vec3 min;
+	math::vec3 max;
+
+	AABB() {}
+	AABB(const math::vec3& min_, const math::vec3& max_) : min(min_), max(max_) {}
+
+	/**The box around a sphere.*/
+	static AABB fromSphere(const math::vec3& centre, math::matReal radius)
+	{
+		return AABB(centre - math::vec3(radius, radius, radius), centre + math::vec3(radius, radius, radius));
+	}
+
+	/**The smallest box holding both.*/
+	static AABB merge(const AABB& a, const AABB& b)
+	{
+		return AABB(
+			math::vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+			math::vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+	}
+
+	bool contains(const AABB& other) const
+	{
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+			max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+	}
+
+	bool overlaps(const AABB& other) const
+	{
+		return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z &&
+			max.x >= other.min.x && max.y >= other.min.y && max.z >= other.min.z;
+	}
+
+	bool operator==(const AABB& other) const
+	{
+		return min.x == other.min.x && min.y == other.min.y && min.z == other.min.z &&
+			max.x == other.max.x && max.y == other.max.y && max.z == other.max.z;
+	}
+
+	/**Half the surface area, which is what the surface area heuristic compares.*/
+	math::matReal halfArea() const
+	{
+		const math::vec3 size = max - min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	/**Returns the squared distance from a point to the box, 0 if it is inside.*/
+	math::matReal distanceSquared(const math::vec3& point) const
+	{
+		const math::matReal dx = std::max(std::max(min.x - point.x, point.x - max.x), math::matReal(0));
+		const math::matReal dy = std::max(std::max(min.y - point.y, point.y - max.y), math::matReal(0));
+		const math::matReal dz = std::max(std::max(min.z - point.z, point.z - max.z), math::matReal(0));
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	/**Finds where the ray origin + t * direction enters the box, for t between 0 and maxDistance. Takes the
+	reciprocal of the direction, which may hold infinities. Returns false if the ray misses.*/
+	bool intersectsRay(const math::vec3& origin, const math::vec3& inverseDirection, math::matReal maxDistance,
+		math::matReal& entry) const
+	{
+		const math::matReal x0 = (min.x - origin.x) * inverseDirection.x, x1 = (max.x - origin.x) * inverseDirection.x;
+		const math::matReal y0 = (min.y - origin.y) * inverseDirection.y, y1 = (max.y - origin.y) * inverseDirection.y;
+		const math::matReal z0 = (min.z - origin.z) * inverseDirection.z, z1 = (max.z - origin.z) * inverseDirection.z;
+		const math::matReal enter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)),
+			std::max(std::min(z0, z1), math::matReal(0)));
+		const math::matReal exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)),
+			std::min(std::max(z0, z1), maxDistance));
+		entry = enter;
+		return enter <= exit;
+	}
+};
+
+/**Indexes objects by their bounds. Objects are given as a box and a pointer that queries hand back.*/
+class BVH
+{
+public:
+	/**Identifies an object in the tree. Stays the same until the object is removed, rebuilds included.*/
+	typedef unsigned Proxy;
+
+	/**No object.*/
+	static const Proxy kInvalidProxy = ~0u;
+
+	BVH();
+
+	/**Adds an object with the given bounds.*/
+	Proxy insert(const AABB& bounds, void* userData);
+
+	/**Removes an object. The proxy may be reused.*/
+	void remove(Proxy proxy);
+
+	/**Removes every object. The nodes keep their memory.*/
+	void clear();
+
+	/**Gives an object new bounds. Returns true if they left the leaf's box, in which case queries may miss the
+	object until the next refit().*/
+	bool move(Proxy proxy, const AABB& bounds);
+
+	/**Brings the boxes above every moved object up to date.*/
+	void refit();
+
+	/**Builds the tree again from the boxes of the leaves, splitting them in half along the longest axis at
+	every level. Slower than refitting, but gives back a tree as good as a fresh one.*/
+	void rebuild();
+
+	/**Returns the pointer the object was inserted with.*/
+	void* userData(Proxy proxy) const { return mNodes[proxy].userData; }
+
+	/**Replaces the pointer, for when the object moved in memory.*/
+	void setUserData(Proxy proxy, void* userData) { mNodes[proxy].userData = userData; }
+
+	/**Returns the box in the object's leaf, which holds its bounds with a margin around them.*/
+	const AABB& leafBounds(Proxy proxy) const { return mNodes[proxy].box; }
+
+	/**Returns the number of objects.*/
+	size_t size() const { return mLeafCount; }
+
+	/**Returns the number of levels below the root, 0 for a tree of one object.*/
+	int height() const { return mRoot == kNull ? 0 : mNodes[mRoot].height; }
+
+	/**Checks the links, heights and boxes of every node, asserting on the first one that is wrong. For
+	debugging, and only meaningful after refit().*/
+	void validate() const;
+
+	/**Calls callback(userData) for every object whose leaf box is at least partly inside the frustum.*/
+	template<class Callback>
+	void queryFrustum(const Frustum& frustum, Callback callback) const;
+
+	/**Calls callback(userData) for every object whose leaf box meets the sphere.*/
+	template<class Callback>
+	void querySphere(const math::vec3& centre, math::matReal radius, Callback callback) const;
+
+	/**Calls callback(userData) for every object whose leaf box overlaps the box.*/
+	template<class Callback>
+	void queryBox(const AABB& box, Callback callback) const;
+
+	/**Calls callback(userData, maxDistance) for the objects whose leaf box the ray origin + t * direction enters
+	before t reaches maxDistance, nearer boxes first. The callback returns the distance to keep searching up to:
+	maxDistance to find every object, the distance of a hit to find only nearer ones, or 0 to stop.*/
+	template<class Callback>
+	void queryRay(const math::vec3& origin, const math::vec3& direction, math::matReal maxDistance,
+		Callback callback) const;
+
+private:
+	static const unsigned kNull = ~0u;
+
+	//Deep enough for any balanced tree that fits in memory; insertions keep the tree balanced and rebuilds
+	//split in half, so the height stays near log2 of the object count.
+	static const int kStackSize = 64;
+
+	//The leaf boxes are grown on every side by this fraction of their size.
+	static const math::matReal kMargin;
+
+	struct Node
+	{
+		AABB box;
+		unsigned parent; //The next free node for nodes on the free list.
+		unsigned child[2]; //kNull for leaves.
+		void* userData;
+		int height; //0 for leaves, -1 for free nodes.
+		bool moved; //Waiting for refit().
+
+		bool isLeaf() const { return child[0] == kNull; }
+	};
+
+	unsigned allocateNode();
+	void freeNode(unsigned node);
+
+	void insertLeaf(unsigned leaf);
+	void removeLeaf(unsigned leaf);
+
+	/**Recomputes the boxes and heights from the node up to the root, rotating unbalanced nodes on the way.*/
+	void fixUpwards(unsigned node);
+
+	/**Rotates a child up if its subtree is more than one level taller than its sibling's. Returns the node now in
+	the place of the given one.*/
+	unsigned balance(unsigned node);
+
+	/**Builds a subtree over the leaves and returns its root.*/
+	unsigned build(unsigned* leaves, size_t count);
+
+	/**Walks the nodes whose box passes the test, calling the callback for the leaves.*/
+	template<class Test, class Callback>
+	void traverse(Test test, Callback callback) const;
+
+	std::vector<Node> mNodes;
+	unsigned mRoot;
+	unsigned mFreeList;
+	size_t mLeafCount;
+
+	std::vector<unsigned> mMoved;
+	size_t mRefitsSinceBuild;
+	std::vector<unsigned> mBuildScratch;
+};
+
+template<class Test, class Callback>
+void BVH::traverse(Test test, Callback callback) const
+{
+	if (mRoot == kNull)
+		return;
+
+	unsigned stack[kStackSize];
+	int top = 0;
+	stack[top++] = mRoot;
+	while (top > 0)
+	{
+		const Node& node = mNodes[stack[--top]];
+		if (!test(node.box))
+			continue;
+
+		if (node.isLeaf())
+			callback(node.userData);
+		else
+		{
+			assert(top + 2 <= kStackSize);
+			stack[top++] = node.child[1];
+			stack[top++] = node.child[0];
+		}
+	}
+}
+
+template<class Callback>
+void BVH::queryFrustum(const Frustum& frustum, Callback callback) const
+{
+	if (mRoot == kNull)
+		return;
+
+	//Below a box that is wholly inside, everything is reported without testing. Such nodes are marked in the
+	//stack by the top bit of their index.
+	const unsigned kInside = 0x80000000u;
+	unsigned stack[kStackSize];
+	int top = 0;
+	stack[top++] = mRoot;
+	while (top > 0)
+	{
+		unsigned entry = stack[--top];
+		const Node& node = mNodes[entry & ~kInside];
+		if (!(entry & kInside))
+		{
+			const Frustum::Containment containment = frustum.classifyBox(node.box.min, node.box.max);
+			if (containment == Frustum::OUTSIDE)
+				continue;
+			if (containment == Frustum::INSIDE)
+				entry |= kInside;
+		}
+
+		if (node.isLeaf())
+			callback(node.userData);
+		else
+		{
+			assert(top + 2 <= kStackSize);
+			stack[top++] = node.child[1] | (entry & kInside);
+			stack[top++] = node.child[0] | (entry & kInside);
+		}
+	}
+}
+
+template<class Callback>
+void BVH::querySphere(const math::vec3& centre, math::matReal radius, Callback callback) const
+{
+	const math::matReal radiusSquared = radius * radius;
+	traverse([&](const AABB& box) { return box.distanceSquared(centre) <= radiusSquared; }, callback);
+}
+
+template<class Callback>
+void BVH::queryBox(const AABB& box, Callback callback) const
+{
+	traverse([&](const AABB& nodeBox) { return nodeBox.overlaps(box); }, callback);
+}
+
+template<class Callback>
+void BVH::queryRay(const math::vec3& origin, const math::vec3& direction, math::matReal maxDistance,
+	Callback callback) const
+{
+	const math::vec3 inverseDirection(1 / direction.x, 1 / direction.y, 1 / direction.z);
+	math::matReal entry;
+	if (mRoot == kNull || !mNodes[mRoot].box.intersectsRay(origin, inverseDirection, maxDistance, entry))
+		return;
+
+	//Each node is pushed with where the ray enters it, so it can be dropped if a hit nearer than that turns up
+	//before it is reached.
+	struct Pending
+	{
+		unsigned node;
+		math::matReal entry;
+	};
+	Pending stack[kStackSize];
+	int top = 0;
+	stack[top].node = mRoot;
+	stack[top++].entry = entry;
+	while (top > 0)
+	{
+		const Pending pending = stack[--top];
+		if (pending.entry > maxDistance)
+			continue;
+
+		const Node& node = mNodes[pending.node];
+		if (node.isLeaf())
+		{
+			maxDistance = callback(node.userData, maxDistance);
+			if (maxDistance <= 0)
+				return;
+			continue;
+		}
+
+		math::matReal entries[2];
+		const bool hits[2] = {
+			mNodes[node.child[0]].box.intersectsRay(origin, inverseDirection, maxDistance, entries[0]),
+			mNodes[node.child[1]].box.intersectsRay(origin, inverseDirection, maxDistance, entries[1]) };
+		const int nearer = hits[1] && (!hits[0] || entries[1] < entries[0]) ? 1 : 0;
+		const int farther = 1 - nearer;
+
+		assert(top + 2 <= kStackSize);
+		if (hits[farther])
+		{
+			stack[top].node = node.child[farther];
+			stack[top++].entry = entries[farther];
+		}
+		if (hits[nearer])
+		{
+			stack[top].node = node.child[nearer];
+			stack[top++].entry = entries[nearer];
+		}
+	}
+}
@@ -0,0 +1,169 @@
+#include "commandlist.h"
+#include <cstring>
+
+namespace
+{
+	const size_t kDataAlignment = 16;
+
+	/**Stands for the instance buffer and the triangle list topology in the state cache.*/
+	const char kInstanceBuffer = 0, kTriangleList = 0;
+}
+
+CommandList::CommandList() : mInstanceOffset(0), mInstanceSize(0), mInstanceStride(0), mDrawCalls(0),
+	mInstances(0), mInstancesPending(false) {}
+
+void CommandList::clear()
+{
+	mCommands.clear();
+	mData.clear();
+	mInstanceOffset = 0;
+	mInstanceSize = 0;
+	mInstanceStride = 0;
+	mDrawCalls = 0;
+	mInstances = 0;
+}
+
+const void* CommandList::data(const Command& command) const
+{
+	return command.dataSize ? &mData[command.dataOffset] : NULL;
+}
+
+void CommandList::record(Type type, const void* resource, unsigned slot, size_t dataOffset, size_t dataSize)
+{
+	Command command = { type, resource, slot, 0, 0, 0, dataOffset, dataSize };
+	mCommands.push_back(command);
+}
+
+void CommandList::recordData(Type type, unsigned slot, const void* data, size_t size)
+{
+	const size_t offset = append(size);
+	std::memcpy(&mData[offset], data, size);
+	record(type, NULL, slot, offset, size);
+	++mMapCounts.maps;
+	++mMapCounts.discards;
+}
+
+size_t CommandList::append(size_t size)
+{
+	const size_t offset = (mData.size() + kDataAlignment - 1) & ~(kDataAlignment - 1);
+	mData.resize(offset + size);
+	return offset;
+}
+
+void CommandList::setFrameConstants(const void* data, size_t size)
+{
+	recordData(SET_FRAME_CONSTANTS, kFrameConstantSlot, data, size);
+}
+
+void CommandList::setShader(ShaderProgram* shader)
+{
+	//Not short-circuited, so that each state is counted.
+	bool changed = mStateCache.change(StateCache::VERTEX_SHADER, shader);
+	changed |= mStateCache.change(StateCache::PIXEL_SHADER, shader);
+	changed |= mStateCache.change(StateCache::INPUT_LAYOUT, shader);
+	changed |= mStateCache.change(StateCache::VERTEX_CONSTANT_BUFFER, shader);
+	changed |= mStateCache.change(StateCache::PIXEL_CONSTANT_BUFFER, shader);
+	if (changed)
+		record(SET_SHADER, shader, 0, 0, 0);
+}
+
+void CommandList::setMesh(RenderMesh* mesh)
+{
+	bool changed = mStateCache.change(StateCache::VERTEX_BUFFER, 0, mesh);
+	changed |= mStateCache.change(StateCache::INDEX_BUFFER, mesh);
+	changed |= mStateCache.change(StateCache::TOPOLOGY, &kTriangleList);
+	if (changed)
+		record(SET_MESH, mesh, 0, 0, 0);
+}
+
+void CommandList::setTexture(TextureGPU* texture)
+{
+	bool changed = mStateCache.change(StateCache::SHADER_RESOURCE, texture);
+	changed |= mStateCache.change(StateCache::SAMPLER, texture);
+	if (changed)
+		record(SET_TEXTURE, texture, 0, 0, 0);
+}
+
+void CommandList::setVertexConstants(unsigned slot, const void* data, size_t size)
+{
+	recordData(SET_VERTEX_CONSTANTS, slot, data, size);
+}
+
+void CommandList::setPixelConstants(unsigned slot, const void* data, size_t size)
+{
+	recordData(SET_PIXEL_CONSTANTS, slot, data, size);
+}
+
+void* CommandList::allocateInstances(size_t stride, size_t count)
+{
+	mInstanceSize = stride * count;
+	mInstanceStride = unsigned(stride);
+	mInstanceOffset = append(mInstanceSize);
+	return mInstanceSize ? &mData[mInstanceOffset] : NULL;
+}
+
+void CommandList::drawIndexedInstanced(unsigned indexCount, unsigned instanceCount)
+{
+	mStateCache.change(StateCache::VERTEX_BUFFER, 1, &kInstanceBuffer);
+	Command command = { DRAW_INDEXED_INSTANCED, NULL, 0, indexCount, instanceCount, mInstanceStride, mInstanceOffset,
+		mInstanceSize };
+	mCommands.push_back(command);
+	++mDrawCalls;
+	mInstances += instanceCount;
+	mInstancesPending |= mInstanceSize != 0;
+}
+
+void CommandList::executeList(size_t /*index*/, const CommandList& list)
+{
+	//Lists start and end with nothing bound, as deferred contexts do, and map their instances on their own.
+	const bool instancesPending = mInstancesPending;
+	invalidateState();
+	for (size_t i = 0; i < list.mCommands.size(); ++i)
+	{
+		const Command& command = list.mCommands[i];
+		switch (command.type)
+		{
+		case SET_FRAME_CONSTANTS:
+			setFrameConstants(list.data(command), command.dataSize);
+			break;
+		case SET_SHADER:
+			setShader(static_cast<ShaderProgram*>(const_cast<void*>(command.resource)));
+			break;
+		case SET_MESH:
+			setMesh(static_cast<RenderMesh*>(const_cast<void*>(command.resource)));
+			break;
+		case SET_TEXTURE:
+			setTexture(static_cast<TextureGPU*>(const_cast<void*>(command.resource)));
+			break;
+		case SET_VERTEX_CONSTANTS:
+			setVertexConstants(command.slot, list.data(command), command.dataSize);
+			break;
+		case SET_PIXEL_CONSTANTS:
+			setPixelConstants(command.slot, list.data(command), command.dataSize);
+			break;
+		case DRAW_INDEXED_INSTANCED:
+		{
+			void* instances = allocateInstances(command.stride, command.instanceCount);
+			if (instances)
+				std::memcpy(instances, list.data(command), command.dataSize);
+			drawIndexedInstanced(command.indexCount, command.instanceCount);
+			break;
+		}
+		}
+	}
+	invalidateState();
+
+	if (list.mDrawCalls != 0)
+	{
+		++mMapCounts.maps;
+		++mMapCounts.discards;
+	}
+	mInstancesPending = instancesPending;
+}
+
+void CommandList::endFrame()
+{
+	if (mInstancesPending)
+		++mMapCounts.maps;
+	mInstancesPending = false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "renderbackend.h"
+#include <vector>
+
+/**A backend that keeps the calls made on it instead of issuing them, with copies of the data they were given. Does
+not depend on DirectX, so draw submission can be checked and measured without a GPU. DirectXBackend records its
+frames in one and issues them at the end, and RenderQueue records parts of a frame in them on worker threads.
+Executing a list on a list appends its calls, so one list can stand for the GPU of a frame recorded in several.
+
+Bindings go through the state cache as they would on DirectXBackend, and only those that change something are kept.
+Shaders cannot be looked into here, so a program stands for its vertex shader, pixel shader and layout, and for
+the constant buffers it binds, and a texture for its view and sampler; counts match DirectXBackend's as long as
+programs and textures do not share them. Maps are counted as DirectXBackend makes them: one for the frame constants,
+one for each set of a shader's constants and one at endFrame() for the frame's instances, which are all discards but
+the last, and one for the instances of each list executed.*/
+class CommandList : public RenderBackend
+{
+public:
+	enum Type
+	{
+		SET_FRAME_CONSTANTS,
+		SET_SHADER,
+		SET_MESH,
+		SET_TEXTURE,
+		SET_VERTEX_CONSTANTS,
+		SET_PIXEL_CONSTANTS,
+		DRAW_INDEXED_INSTANCED
+	};
+
+	/**One call. Fields that do not apply to the type are zero.*/
+	struct Command
+	{
+		Type type;
+		const void* resource; //The shader, mesh or texture set.
+		unsigned slot; //Of a constant buffer.
+		unsigned indexCount;
+		unsigned instanceCount;
+		unsigned stride; //Of the instances drawn.
+		size_t dataOffset; //In data(), of the constants set or the instances drawn.
+		size_t dataSize;
+	};
+
+	CommandList();
+
+	/**Forgets the recorded calls, keeping the memory for the next frame. What is bound carries over, as it does on a
+	context; invalidateState() makes the next bindings be recorded again.*/
+	void clear();
+
+	const std::vector<Command>& commands() const { return mCommands; }
+
+	/**Returns the data a command was given.*/
+	const void* data(const Command& command) const;
+
+	/**Returns the number of draw calls and of instances drawn since the last clear().*/
+	size_t drawCalls() const { return mDrawCalls; }
+	size_t instances() const { return mInstances; }
+
+	virtual void setFrameConstants(const void* data, size_t size);
+	virtual void setShader(ShaderProgram* shader);
+	virtual void setMesh(RenderMesh* mesh);
+	virtual void setTexture(TextureGPU* texture);
+	virtual void setVertexConstants(unsigned slot, const void* data, size_t size);
+	virtual void setPixelConstants(unsigned slot, const void* data, size_t size);
+	virtual void* allocateInstances(size_t stride, size_t count);
+	virtual void drawIndexedInstanced(unsigned indexCount, unsigned instanceCount);
+	virtual void endFrame();
+	virtual void beginLists(size_t /*count*/) {}
+	virtual void translateList(size_t /*index*/, const CommandList& /*list*/) {}
+	virtual void executeList(size_t index, const CommandList& list);
+
+private:
+	void record(Type type, const void* resource, unsigned slot, size_t dataOffset, size_t dataSize);
+
+	/**Records a call that copies size bytes of data.*/
+	void recordData(Type type, unsigned slot, const void* data, size_t size);
+
+	/**Returns the offset of size bytes added to mData, aligned so that any type can be read from them.*/
+	size_t append(size_t size);
+
+	std::vector<Command> mCommands;
+	std::vector<unsigned char> mData;
+	size_t mInstanceOffset, mInstanceSize; //Of the last allocateInstances.
+	unsigned mInstanceStride;
+	size_t mDrawCalls, mInstances;
+	bool mInstancesPending; //Drawn since the last endFrame().
+};
@@ -0,0 +1,461 @@
+#include "directxbackend.h"
+#include "directx.h"
+#include "shader.h"
+#include "mesh.h"
+#include "texture.h"
+#include <cstring>
+
+namespace
+{
+	/**The topology in the state cache.*/
+	const void* const kTriangleList = reinterpret_cast<const void*>(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	/**The smallest instance ring. It grows to twice the largest list, so that a frame seldom wraps it.*/
+	const size_t kMinInstanceBufferSize = 256 * 1024;
+
+	template<class T>
+	T* resourceOf(const CommandList::Command& command)
+	{
+		return static_cast<T*>(const_cast<void*>(command.resource));
+	}
+
+	void addCounts(RenderBackend::MapCounts& to, const RenderBackend::MapCounts& from)
+	{
+		to.maps += from.maps;
+		to.discards += from.discards;
+	}
+
+	/**Returns the bindings a recording elided. Those it kept are counted again, as issued or elided, when replayed,
+	but those it elided never reach the replay's cache.*/
+	StateCache::Counts elidedCounts(const StateCache::Counts& recorded)
+	{
+		StateCache::Counts counts = recorded;
+		for (int i = 0; i < StateCache::STATE_COUNT; ++i)
+			counts.issued[i] = 0;
+		return counts;
+	}
+}
+
+DirectXBackend::Target::Target() : context(NULL), stateCache(&ownStateCache), shader(NULL),
+	vertexFormat(VERTEX_FLOAT), instanceBuffer(NULL), instanceBufferSize(0), instanceHead(0), instanceStride(0),
+	commandList(NULL)
+{
+	mapCounts.maps = 0;
+	mapCounts.discards = 0;
+}
+
+DirectXBackend::OutputState::OutputState() : depthStencilView(NULL), depthStencilState(NULL), stencilRef(0),
+	rasterizerState(NULL), viewportCount(0)
+{
+	for (size_t i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		renderTargets[i] = NULL;
+}
+
+DirectXBackend::DirectXBackend() : mDevice(NULL), mFrameConstants(NULL), mFrameConstantsSize(0)
+{
+	mImmediate.stateCache = &mStateCache;
+}
+
+DirectXBackend::~DirectXBackend()
+{
+	shutdown();
+}
+
+bool DirectXBackend::initialise(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	mDevice = device;
+	mImmediate.context = context;
+	mStateCache.invalidate();
+	return device != NULL && context != NULL;
+}
+
+void DirectXBackend::shutdown()
+{
+	for (size_t i = 0; i < mDeferred.size(); ++i)
+	{
+		releaseTarget(*mDeferred[i]);
+		releaseCom(mDeferred[i]->context);
+		delete mDeferred[i];
+	}
+	mDeferred.clear();
+
+	releaseTarget(mImmediate);
+	releaseOutput();
+	releaseCom(mFrameConstants);
+	mFrameConstantsSize = 0;
+	mFrame.clear();
+	mStateCache.invalidate();
+}
+
+void DirectXBackend::releaseTarget(Target& target)
+{
+	releaseCom(target.commandList);
+	releaseCom(target.instanceBuffer);
+	target.instanceBufferSize = 0;
+	target.instanceHead = 0;
+	target.shader = NULL;
+}
+
+void DirectXBackend::captureOutput()
+{
+	releaseOutput();
+	ID3D11DeviceContext* context = mImmediate.context;
+	context->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, mOutput.renderTargets,
+		&mOutput.depthStencilView);
+	context->OMGetDepthStencilState(&mOutput.depthStencilState, &mOutput.stencilRef);
+	context->RSGetState(&mOutput.rasterizerState);
+	mOutput.viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	context->RSGetViewports(&mOutput.viewportCount, mOutput.viewports);
+}
+
+void DirectXBackend::bindOutput(ID3D11DeviceContext* context) const
+{
+	context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, mOutput.renderTargets,
+		mOutput.depthStencilView);
+	context->OMSetDepthStencilState(mOutput.depthStencilState, mOutput.stencilRef);
+	context->RSSetState(mOutput.rasterizerState);
+	if (mOutput.viewportCount)
+		context->RSSetViewports(mOutput.viewportCount, mOutput.viewports);
+}
+
+void DirectXBackend::releaseOutput()
+{
+	for (size_t i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		releaseCom(mOutput.renderTargets[i]);
+	releaseCom(mOutput.depthStencilView);
+	releaseCom(mOutput.depthStencilState);
+	releaseCom(mOutput.rasterizerState);
+	mOutput.stencilRef = 0;
+	mOutput.viewportCount = 0;
+}
+
+void DirectXBackend::setFrameConstants(const void* data, size_t size)
+{
+	mFrame.setFrameConstants(data, size);
+}
+
+void DirectXBackend::setShader(ShaderProgram* shader)
+{
+	mFrame.setShader(shader);
+}
+
+void DirectXBackend::setMesh(RenderMesh* mesh)
+{
+	assert(mesh->inGPU());
+	mFrame.setMesh(mesh);
+}
+
+void DirectXBackend::setTexture(TextureGPU* texture)
+{
+	mFrame.setTexture(texture);
+}
+
+void DirectXBackend::setVertexConstants(unsigned slot, const void* data, size_t size)
+{
+	mFrame.setVertexConstants(slot, data, size);
+}
+
+void DirectXBackend::setPixelConstants(unsigned slot, const void* data, size_t size)
+{
+	mFrame.setPixelConstants(slot, data, size);
+}
+
+void* DirectXBackend::allocateInstances(size_t stride, size_t count)
+{
+	return mFrame.allocateInstances(stride, count);
+}
+
+void DirectXBackend::drawIndexedInstanced(unsigned indexCount, unsigned instanceCount)
+{
+	mFrame.drawIndexedInstanced(indexCount, instanceCount);
+}
+
+void DirectXBackend::endFrame()
+{
+	flush();
+	releaseOutput();
+}
+
+void DirectXBackend::beginLists(size_t count)
+{
+	//The frame constants recorded so far are uploaded now, so that the lists can bind their buffer.
+	flush();
+	captureOutput();
+
+	while (mDeferred.size() < count)
+	{
+		Target* target = new Target();
+		if (FAILED(mDevice->CreateDeferredContext(0, &target->context)))
+		{
+			Error("Could not create a deferred context.");
+			delete target;
+			return;
+		}
+		mDeferred.push_back(target);
+	}
+}
+
+void DirectXBackend::translateList(size_t index, const CommandList& list)
+{
+	if (index >= mDeferred.size())
+		return;
+
+	Target& target = *mDeferred[index];
+	target.stateCache->beginFrame();
+	target.mapCounts.maps = 0;
+	target.mapCounts.discards = 0;
+	replay(target, list, true);
+	target.stateCache->merge(elidedCounts(list.stateCounts()));
+
+	releaseCom(target.commandList);
+	if (FAILED(target.context->FinishCommandList(FALSE, &target.commandList)))
+		target.commandList = NULL;
+}
+
+void DirectXBackend::executeList(size_t index, const CommandList& list)
+{
+	flush();
+	if (index >= mDeferred.size() || !mDeferred[index]->commandList)
+		return;
+
+	Target& target = *mDeferred[index];
+	mImmediate.context->ExecuteCommandList(target.commandList, FALSE);
+	releaseCom(target.commandList);
+
+	//Executing leaves the immediate context with nothing bound.
+	bindOutput(mImmediate.context);
+	mStateCache.invalidate();
+	mStateCache.merge(target.stateCache->counts());
+	addCounts(mMapCounts, target.mapCounts);
+}
+
+void DirectXBackend::flush()
+{
+	replay(mImmediate, mFrame, false);
+	mStateCache.merge(elidedCounts(mFrame.stateCounts()));
+	addCounts(mMapCounts, mImmediate.mapCounts);
+	mImmediate.mapCounts.maps = 0;
+	mImmediate.mapCounts.discards = 0;
+
+	//What the recorder elided was elided against this frame's bindings; the next calls start from the context's.
+	mFrame.clear();
+	mFrame.invalidateState();
+	mFrame.beginFrame();
+}
+
+void DirectXBackend::replay(Target& target, const CommandList& list, bool deferred)
+{
+	if (list.commands().empty())
+		return;
+
+	ID3D11DeviceContext* context = target.context;
+	StateCache& cache = *target.stateCache;
+	if (deferred)
+	{
+		cache.invalidate();
+		bindOutput(context);
+		bindFrameConstants(target);
+	}
+
+	const std::vector<CommandList::Command>& commands = list.commands();
+	const bool instancesUploaded = uploadInstances(target, list, deferred);
+
+	size_t draw = 0;
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		const CommandList::Command& command = commands[i];
+		switch (command.type)
+		{
+		case CommandList::SET_FRAME_CONSTANTS:
+			uploadFrameConstants(target, list.data(command), command.dataSize);
+			break;
+		case CommandList::SET_SHADER:
+			target.shader = resourceOf<ShaderProgram>(command);
+			target.shader->setForRendering(context, cache);
+			break;
+		case CommandList::SET_MESH:
+		{
+			RenderMesh* mesh = resourceOf<RenderMesh>(command);
+			ID3D11Buffer* vertexBuffer = mesh->vertexBuffer();
+			const unsigned stride = vertexStride(mesh->vertexFormat()), start = 0;
+			target.vertexFormat = mesh->vertexFormat();
+			if (cache.change(StateCache::VERTEX_BUFFER, 0, vertexBuffer))
+				context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &start);
+			if (cache.change(StateCache::INDEX_BUFFER, mesh->indexBuffer()))
+				context->IASetIndexBuffer(mesh->indexBuffer(), ELEMENT_INDEX_TYPE_ENUM, 0);
+			if (cache.change(StateCache::TOPOLOGY, kTriangleList))
+				context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			break;
+		}
+		case CommandList::SET_TEXTURE:
+			resourceOf<TextureGPU>(command)->setForRendering(context, cache);
+			break;
+		case CommandList::SET_VERTEX_CONSTANTS:
+			assert(target.shader);
+			target.shader->setVertexData(context, list.data(command), command.dataSize, command.slot);
+			++target.mapCounts.maps;
+			++target.mapCounts.discards;
+			break;
+		case CommandList::SET_PIXEL_CONSTANTS:
+			assert(target.shader);
+			target.shader->setPixelData(context, list.data(command), command.dataSize, command.slot);
+			++target.mapCounts.maps;
+			++target.mapCounts.discards;
+			break;
+		case CommandList::DRAW_INDEXED_INSTANCED:
+		{
+			const unsigned firstInstance = target.firstInstances[draw++];
+			if (!instancesUploaded || command.dataSize == 0)
+				break;
+
+			//The ring stays bound at offset 0 for every draw of a stride; draws differ in their first instance.
+			if (command.stride != target.instanceStride)
+				cache.forget(StateCache::VERTEX_BUFFER, 1);
+			target.instanceStride = command.stride;
+			const unsigned start = 0;
+			if (cache.change(StateCache::VERTEX_BUFFER, 1, target.instanceBuffer))
+				context->IASetVertexBuffers(1, 1, &target.instanceBuffer, &target.instanceStride, &start);
+
+			//Bound here rather than with the mesh, as binding the shader binds its layout for float vertices.
+			assert(target.shader);
+			ID3D11InputLayout* layout = target.shader->getLayout(target.vertexFormat);
+			if (cache.change(StateCache::INPUT_LAYOUT, layout))
+				context->IASetInputLayout(layout);
+			context->DrawIndexedInstanced(command.indexCount, command.instanceCount, 0, 0, firstInstance);
+			break;
+		}
+		}
+	}
+}
+
+bool DirectXBackend::uploadFrameConstants(Target& target, const void* data, size_t size)
+{
+	assert(size % 16 == 0);
+	assert(&target == &mImmediate || size == mFrameConstantsSize);
+
+	if (size != mFrameConstantsSize)
+	{
+		releaseCom(mFrameConstants);
+		mFrameConstantsSize = 0;
+		target.stateCache->forget(StateCache::VERTEX_CONSTANT_BUFFER, kFrameConstantSlot);
+		target.stateCache->forget(StateCache::PIXEL_CONSTANT_BUFFER, kFrameConstantSlot);
+
+		D3D11_BUFFER_DESC desc = { 0 };
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = size;
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(mDevice->CreateBuffer(&desc, NULL, &mFrameConstants)))
+		{
+			Error("Could not create the frame constant buffer.");
+			return false;
+		}
+		mFrameConstantsSize = size;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(target.context->Map(mFrameConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	std::memcpy(mapped.pData, data, size);
+	target.context->Unmap(mFrameConstants, 0);
+	++target.mapCounts.maps;
+	++target.mapCounts.discards;
+
+	bindFrameConstants(target);
+	return true;
+}
+
+void DirectXBackend::bindFrameConstants(Target& target)
+{
+	if (!mFrameConstants)
+		return;
+	if (target.stateCache->change(StateCache::VERTEX_CONSTANT_BUFFER, kFrameConstantSlot, mFrameConstants))
+		target.context->VSSetConstantBuffers(kFrameConstantSlot, 1, &mFrameConstants);
+	if (target.stateCache->change(StateCache::PIXEL_CONSTANT_BUFFER, kFrameConstantSlot, mFrameConstants))
+		target.context->PSSetConstantBuffers(kFrameConstantSlot, 1, &mFrameConstants);
+}
+
+size_t DirectXBackend::layInstances(Target& target, const CommandList& list, size_t offset)
+{
+	const std::vector<CommandList::Command>& commands = list.commands();
+	target.firstInstances.clear();
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		const CommandList::Command& command = commands[i];
+		if (command.type != CommandList::DRAW_INDEXED_INSTANCED)
+			continue;
+
+		if (command.dataSize == 0)
+		{
+			target.firstInstances.push_back(0);
+			continue;
+		}
+		offset = (offset + command.stride - 1) / command.stride * command.stride;
+		target.firstInstances.push_back(unsigned(offset / command.stride));
+		offset += command.dataSize;
+	}
+	return offset;
+}
+
+bool DirectXBackend::uploadInstances(Target& target, const CommandList& list, bool deferred)
+{
+	size_t end = layInstances(target, list, target.instanceHead);
+	if (end == target.instanceHead)
+		return true;
+
+	//Wrapping discards the ring, so that the GPU may still draw from the old contents while the new are written.
+	//A deferred context must discard before its first map of the list.
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (deferred || end > target.instanceBufferSize)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		target.instanceHead = 0;
+		end = layInstances(target, list, 0);
+	}
+
+	if (end > target.instanceBufferSize)
+	{
+		releaseCom(target.instanceBuffer);
+		target.instanceBufferSize = 0;
+		target.stateCache->forget(StateCache::VERTEX_BUFFER, 1);
+
+		size_t newSize = kMinInstanceBufferSize;
+		while (newSize < end * 2)
+			newSize *= 2;
+
+		D3D11_BUFFER_DESC desc = { 0 };
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = newSize;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(mDevice->CreateBuffer(&desc, NULL, &target.instanceBuffer)))
+		{
+			Error("Could not create the instance buffer.");
+			return false;
+		}
+		target.instanceBufferSize = newSize;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(target.context->Map(target.instanceBuffer, 0, mapType, 0, &mapped)))
+		return false;
+
+	const std::vector<CommandList::Command>& commands = list.commands();
+	unsigned char* ring = static_cast<unsigned char*>(mapped.pData);
+	size_t draw = 0;
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		const CommandList::Command& command = commands[i];
+		if (command.type != CommandList::DRAW_INDEXED_INSTANCED)
+			continue;
+		const size_t offset = size_t(target.firstInstances[draw++]) * command.stride;
+		if (command.dataSize != 0)
+			std::memcpy(ring + offset, list.data(command), command.dataSize);
+	}
+
+	target.context->Unmap(target.instanceBuffer, 0);
+	++target.mapCounts.maps;
+	target.mapCounts.discards += mapType == D3D11_MAP_WRITE_DISCARD;
+	target.instanceHead = end;
+	return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "commandlist.h"
+#include <d3d11.h>
+#include <vector>
+
+/**Issues the calls on a Direct3D 11 device context. A frame is recorded and issued at endFrame(), so that the
+instances of all its draws are copied in one map: they go one after the other in a dynamic vertex buffer used as a
+ring, mapped without overwriting what earlier frames drew from until it wraps, and each draw starts at its own.
+
+Lists recorded on other threads are replayed on deferred contexts, one for each index, on the threads that recorded
+them, and the command lists made are executed on the immediate context. The render targets, viewports and depth
+state bound on the immediate context at beginLists() are bound on the deferred contexts, and bound again on the
+immediate context after each list, as executing one leaves it with nothing bound.*/
+class DirectXBackend : public RenderBackend
+{
+public:
+	DirectXBackend();
+	~DirectXBackend();
+
+	bool initialise(ID3D11Device* device, ID3D11DeviceContext* context);
+
+	/**Releases the buffers and deferred contexts.*/
+	void shutdown();
+
+	virtual void setFrameConstants(const void* data, size_t size);
+	virtual void setShader(ShaderProgram* shader);
+	virtual void setMesh(RenderMesh* mesh);
+	virtual void setTexture(TextureGPU* texture);
+	virtual void setVertexConstants(unsigned slot, const void* data, size_t size);
+	virtual void setPixelConstants(unsigned slot, const void* data, size_t size);
+	virtual void* allocateInstances(size_t stride, size_t count);
+	virtual void drawIndexedInstanced(unsigned indexCount, unsigned instanceCount);
+	virtual void endFrame();
+	virtual void beginLists(size_t count);
+	virtual void translateList(size_t index, const CommandList& list);
+	virtual void executeList(size_t index, const CommandList& list);
+
+private:
+	/**A context that lists are replayed on, with what is bound on it and its instance ring.*/
+	struct Target
+	{
+		Target();
+
+		ID3D11DeviceContext* context;
+		StateCache* stateCache;
+		StateCache ownStateCache; //Of a deferred context; the immediate context's is the backend's.
+		MapCounts mapCounts;
+		ShaderProgram* shader;
+		VertexFormat vertexFormat; //Of the mesh bound; the input layout is the shader's for it.
+
+		ID3D11Buffer* instanceBuffer;
+		size_t instanceBufferSize;
+		size_t instanceHead; //Where the next list's instances go.
+		unsigned instanceStride; //As bound.
+		std::vector<unsigned> firstInstances; //Of each draw of the list being replayed, in the ring.
+
+		ID3D11CommandList* commandList; //Made by a deferred context and not yet executed.
+	};
+
+	/**What the immediate context draws to, as bound at beginLists(). It holds a reference to each view and state
+	until endFrame(), so that the swap chain can be resized between frames.*/
+	struct OutputState
+	{
+		OutputState();
+
+		ID3D11RenderTargetView* renderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+		ID3D11DepthStencilView* depthStencilView;
+		ID3D11DepthStencilState* depthStencilState;
+		UINT stencilRef;
+		ID3D11RasterizerState* rasterizerState;
+		D3D11_VIEWPORT viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+		UINT viewportCount;
+	};
+
+	//I really don't want to copy this by accident...
+	DirectXBackend(const DirectXBackend&);
+	DirectXBackend& operator=(const DirectXBackend&);
+
+	/**Issues the calls recorded on the backend itself.*/
+	void flush();
+
+	/**Issues a list's calls on a target. Deferred targets start with nothing bound and a discarded ring.*/
+	void replay(Target& target, const CommandList& list, bool deferred);
+
+	/**Copies the frame constants to their buffer and binds it. The buffer is made on the immediate context.*/
+	bool uploadFrameConstants(Target& target, const void* data, size_t size);
+	void bindFrameConstants(Target& target);
+
+	/**Copies the instances of a list's draws to the target's ring, filling its firstInstances.*/
+	bool uploadInstances(Target& target, const CommandList& list, bool deferred);
+
+	/**Returns the end of a list's instances laid out from offset in the target's ring, each draw's at a multiple of
+	its stride.*/
+	size_t layInstances(Target& target, const CommandList& list, size_t offset);
+
+	void releaseTarget(Target& target);
+
+	/**Reads mOutput from the immediate context, and binds it on a context.*/
+	void captureOutput();
+	void bindOutput(ID3D11DeviceContext* context) const;
+	void releaseOutput();
+
+	ID3D11Device* mDevice;
+	CommandList mFrame;
+	Target mImmediate;
+	std::vector<Target*> mDeferred;
+	OutputState mOutput;
+
+	ID3D11Buffer* mFrameConstants;
+	size_t mFrameConstantsSize;
+};
@@ -1,7 +1,9 @@
 #pragma once
 #include "matrixd.h"
 #include "camera.h"
+#include "renderqueue.h"
 class RenderWindow;
+class RenderBackend;
 
 class Drawable
 {
@@ -12,5 +14,20 @@ protected:
 	Drawable(Type type) {mType=type;}
 
 public:
-	virtual void draw(RenderWindow* renderWindow, const math::mat4& initialTransformMatrix, const Camera& camera) = 0;
+	virtual ~Drawable() {}
+
+	/**Finds the sphere bounding the object in world space at the given transformation. Returns false if the object
+	has no bounds, in which case it is never culled.*/
+	virtual bool worldBounds(const math::mat3x4& /*worldMatrix*/, math::vec3& /*centre*/, float& /*radius*/) const
+	{
+		return false;
+	}
+
+	/**Records the draw calls of the object into the queue, at the given world transformation.*/
+	virtual void enqueue(RenderQueue& queue, RenderWindow* renderWindow, const math::mat3x4& worldMatrix) = 0;
+
+	/**Issues the draw calls of a batch of packets recorded by enqueue, this drawable's first. The others share its
+	DrawPacket::batch, shader and texture, and belong to drawables that set the same batch.*/
+	virtual void draw(RenderBackend& backend, const DrawPacket* const* packets, size_t count,
+		const Camera& camera) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "frustum.h"
+#include <cmath>
+
+Frustum::Frustum()
+{
+	math::vec4 planes[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; ++p)
+		planes[p] = math::vec4(0, 0, 0, 1);
+	setPlanes(planes);
+}
+
+Frustum::Frustum(const math::mat4& viewProjection)
+{
+	//A clip space point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w. Written with the rows of the
+	//matrix, each bound is a plane in world space, such as (row3 + row0) . p >= 0 for the left one.
+	const math::matReal (&m)[4][4] = viewProjection.m;
+	const math::matReal sign[PLANE_COUNT] = { 1, -1, 1, -1, 1, -1 };
+	const int row[PLANE_COUNT] = { 0, 0, 1, 1, 2, 2 };
+
+	math::vec4 planes[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; ++p)
+	{
+		const int r = row[p];
+		const math::matReal w = p == PLANE_NEAR ? 0 : 1; //The near plane is z >= 0 rather than z >= -w.
+		math::vec4 plane(
+			m[0][3] * w + m[0][r] * sign[p],
+			m[1][3] * w + m[1][r] * sign[p],
+			m[2][3] * w + m[2][r] * sign[p],
+			m[3][3] * w + m[3][r] * sign[p]);
+
+		const math::matReal length = math::vec3(plane.x, plane.y, plane.z).length();
+		planes[p] = length > 0 ? plane / length : plane;
+	}
+	setPlanes(planes);
+}
+
+void Frustum::setPlanes(const math::vec4* planes)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		const math::vec4& plane = planes[i < PLANE_COUNT ? i : PLANE_COUNT - 1];
+		if (i < PLANE_COUNT)
+			mPlanes[i] = plane;
+		mX[i] = plane.x;
+		mY[i] = plane.y;
+		mZ[i] = plane.z;
+		mW[i] = plane.w;
+	}
+}
+
+bool Frustum::intersectsSphere(const math::vec3& centre, math::matReal radius) const
+{
+#if defined(MATRIX_D_SSE)
+	const __m128 cx = _mm_set1_ps(centre.x), cy = _mm_set1_ps(centre.y), cz = _mm_set1_ps(centre.z);
+	const __m128 minDistance = _mm_set1_ps(-radius);
+
+	const __m128 d0 = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mX), cx), _mm_mul_ps(_mm_loadu_ps(mY), cy)),
+		_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mZ), cz), _mm_loadu_ps(mW)));
+	const __m128 d1 = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mX + 4), cx), _mm_mul_ps(_mm_loadu_ps(mY + 4), cy)),
+		_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(mZ + 4), cz), _mm_loadu_ps(mW + 4)));
+
+	const __m128 outside = _mm_or_ps(_mm_cmplt_ps(d0, minDistance), _mm_cmplt_ps(d1, minDistance));
+	return _mm_movemask_ps(outside) == 0;
+#elif defined(MATRIX_D_NEON)
+	const float32x4_t cx = vdupq_n_f32(centre.x), cy = vdupq_n_f32(centre.y), cz = vdupq_n_f32(centre.z);
+	const float32x4_t minDistance = vdupq_n_f32(-radius);
+
+	const float32x4_t d0 = vaddq_f32(
+		vaddq_f32(vmulq_f32(vld1q_f32(mX), cx), vmulq_f32(vld1q_f32(mY), cy)),
+		vaddq_f32(vmulq_f32(vld1q_f32(mZ), cz), vld1q_f32(mW)));
+	const float32x4_t d1 = vaddq_f32(
+		vaddq_f32(vmulq_f32(vld1q_f32(mX + 4), cx), vmulq_f32(vld1q_f32(mY + 4), cy)),
+		vaddq_f32(vmulq_f32(vld1q_f32(mZ + 4), cz), vld1q_f32(mW + 4)));
+
+	const uint32x4_t outside = vorrq_u32(vcltq_f32(d0, minDistance), vcltq_f32(d1, minDistance));
+	const uint32x2_t halves = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+	return vget_lane_u32(vpmax_u32(halves, halves), 0) == 0;
+#else
+	for (int p = 0; p < PLANE_COUNT; ++p)
+		if ((mX[p] * centre.x + mY[p] * centre.y) + (mZ[p] * centre.z + mW[p]) < -radius)
+			return false;
+	return true;
+#endif
+}
+
+Frustum::Containment Frustum::classifyBox(const math::vec3& min, const math::vec3& max) const
+{
+	//Against each plane, the box reaches |normal| . extents either side of the distance of its centre.
+	const math::vec3 centre = (min + max) * 0.5f;
+	const math::vec3 extents = (max - min) * 0.5f;
+
+#if defined(MATRIX_D_SSE)
+	const __m128 cx = _mm_set1_ps(centre.x), cy = _mm_set1_ps(centre.y), cz = _mm_set1_ps(centre.z);
+	const __m128 ex = _mm_set1_ps(extents.x), ey = _mm_set1_ps(extents.y), ez = _mm_set1_ps(extents.z);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	int outside = 0, crossing = 0;
+	for (int i = 0; i < 8; i += 4)
+	{
+		const __m128 x = _mm_loadu_ps(mX + i), y = _mm_loadu_ps(mY + i), z = _mm_loadu_ps(mZ + i);
+		const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, cx), _mm_mul_ps(y, cy)),
+			_mm_add_ps(_mm_mul_ps(z, cz), _mm_loadu_ps(mW + i)));
+		const __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(x, absMask), ex),
+			_mm_mul_ps(_mm_and_ps(y, absMask), ey)), _mm_mul_ps(_mm_and_ps(z, absMask), ez));
+		outside |= _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), reach)));
+		crossing |= _mm_movemask_ps(_mm_cmplt_ps(distance, reach));
+	}
+	if (outside)
+		return OUTSIDE;
+	return crossing ? INTERSECTS : INSIDE;
+#elif defined(MATRIX_D_NEON)
+	const float32x4_t cx = vdupq_n_f32(centre.x), cy = vdupq_n_f32(centre.y), cz = vdupq_n_f32(centre.z);
+	const float32x4_t ex = vdupq_n_f32(extents.x), ey = vdupq_n_f32(extents.y), ez = vdupq_n_f32(extents.z);
+	uint32x4_t outside = vdupq_n_u32(0), crossing = vdupq_n_u32(0);
+	for (int i = 0; i < 8; i += 4)
+	{
+		const float32x4_t x = vld1q_f32(mX + i), y = vld1q_f32(mY + i), z = vld1q_f32(mZ + i);
+		const float32x4_t distance = vaddq_f32(vaddq_f32(vmulq_f32(x, cx), vmulq_f32(y, cy)),
+			vaddq_f32(vmulq_f32(z, cz), vld1q_f32(mW + i)));
+		const float32x4_t reach = vaddq_f32(vaddq_f32(vmulq_f32(vabsq_f32(x), ex), vmulq_f32(vabsq_f32(y), ey)),
+			vmulq_f32(vabsq_f32(z), ez));
+		outside = vorrq_u32(outside, vcltq_f32(distance, vnegq_f32(reach)));
+		crossing = vorrq_u32(crossing, vcltq_f32(distance, reach));
+	}
+	uint32x2_t halves = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+	if (vget_lane_u32(vpmax_u32(halves, halves), 0))
+		return OUTSIDE;
+	halves = vorr_u32(vget_low_u32(crossing), vget_high_u32(crossing));
+	return vget_lane_u32(vpmax_u32(halves, halves), 0) ? INTERSECTS : INSIDE;
+#else
+	bool crossing = false;
+	for (int p = 0; p < PLANE_COUNT; ++p)
+	{
+		const math::matReal distance = (mX[p] * centre.x + mY[p] * centre.y) + (mZ[p] * centre.z + mW[p]);
+		const math::matReal reach = std::abs(mX[p]) * extents.x + std::abs(mY[p]) * extents.y +
+			std::abs(mZ[p]) * extents.z;
+		if (distance < -reach)
+			return OUTSIDE;
+		if (distance < reach)
+			crossing = true;
+	}
+	return crossing ? INTERSECTS : INSIDE;
+#endif
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "matrixd.h"
+
+/**The six planes bounding what a camera sees, for discarding objects that can not appear on screen.
+The planes face inwards and are normalised, so plane . (p, 1) is the distance of p inside the plane.*/
+class Frustum
+{
+public:
+	enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+	/**Where a volume lies relative to the frustum.*/
+	enum Containment { OUTSIDE, INTERSECTS, INSIDE };
+
+	/**A frustum that contains everything.*/
+	Frustum();
+
+	/**Extracts the planes from a projection * view matrix (Gribb and Hartmann), for Direct3D clip space where
+	visible depths run from 0 to w.*/
+	explicit Frustum(const math::mat4& viewProjection);
+
+	/**Returns one of the planes as (normal, distance).*/
+	const math::vec4& plane(Plane p) const { return mPlanes[p]; }
+
+	/**Returns false if the sphere lies entirely outside one of the planes. Spheres near a corner of the frustum
+	may pass while outside it, which only costs a wasted draw.*/
+	bool intersectsSphere(const math::vec3& centre, math::matReal radius) const;
+
+	/**Classifies an axis aligned box. INSIDE means inside every plane, so whatever the box holds can be drawn
+	without testing it further. Like the sphere test, a box near a corner may be called INTERSECTS while outside.*/
+	Containment classifyBox(const math::vec3& min, const math::vec3& max) const;
+
+private:
+	void setPlanes(const math::vec4* planes);
+
+	math::vec4 mPlanes[PLANE_COUNT];
+
+	//The planes a component per array, padded to eight by repeating the far plane, for testing four at a time.
+	math::matReal mX[8], mY[8], mZ[8], mW[8];
+};
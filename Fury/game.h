@@ -30,19 +30,25 @@ public:
 	Team team;
 
 	StaticMeshInstance* inst;
-	DrawableNode* node;
+	SceneNode::Handle node;
+	Scene* scene;
 
 	/**Adds itself to the Scene*/
-	Piece(const Coord& c, const Team t, StaticMesh* mesh, Scene* scene, Physics* physics) : coord(c), team(t)
+	Piece(const Coord& c, const Team t, StaticMesh* mesh, Scene* scene, Physics* physics) : coord(c), team(t),
+		scene(scene)
 	{
 		inst = mesh->createInstance();
-		node = scene->createDrawableNode(scene->getRootNode());
-		
-		node->addDrawable(inst);
+		DrawableNode* drawableNode = scene->createDrawableNode(scene->getRootNode());
+		node = SceneNode::kInvalidHandle;
+		if (!drawableNode)
+			return;
+		node = drawableNode->handle();
+
+		drawableNode->addDrawable(inst);
 		setPos(coord);
-		node->scale(0.015f);
+		drawableNode->scale(0.015f);
 
-		physics->registerObject(node, inst->parent());
+		physics->registerObject(drawableNode, inst->parent());
 
 		switch (t)
 		{
@@ -57,16 +63,33 @@ public:
 		}
 	}
 
+	/**Returns the piece's node, or NULL if it was taken out of the scene.*/
+	DrawableNode* getNode()
+	{
+		return scene->getNode<DrawableNode>(node);
+	}
+
 	void setPos(const Coord& c)
 	{
-		node->setPos((float)c.x, 0.f, (float)c.y);
+		if (DrawableNode* n = getNode())
+			n->setPos((float)c.x, 0.f, (float)c.y);
 	}
 
+	/**Returns where the piece stands, or the coordinate it was last given if it was taken out of the scene.*/
 	Coord getPos()
 	{
-		math::vec3 pos = node->getPos();
+		DrawableNode* n = getNode();
+		if (!n)
+			return coord;
+		math::vec3 pos = n->getPos();
 		return Coord(math::iround(pos.x), math::iround(pos.y));
 	}
+
+	void rotate(const math::Quaternion& rotation)
+	{
+		if (DrawableNode* n = getNode())
+			n->rotate(rotation);
+	}
 };
 
 class Board
@@ -77,20 +100,33 @@ public:
 
 	StaticMesh obj;
 	StaticMeshInstance* inst;
-	DrawableNode* node;
+	SceneNode::Handle node = SceneNode::kInvalidHandle;
+	Scene* scene = nullptr;
 
-	bool initialise(Scene* scene, RenderWindow* window, Physics* physics)
+	/**Returns the board's node, or NULL if it was taken out of the scene.*/
+	DrawableNode* getNode()
 	{
+		return scene->getNode<DrawableNode>(node);
+	}
+
+	/**Creates the board and the pieces, all drawn with the texture.*/
+	bool initialise(Scene* scene, RenderWindow* window, Physics* physics, TextureGPU* texture)
+	{
+		this->scene = scene;
 		if (!obj.load("Game/Models/Board.vmf"))
 			return false;
-		obj.upload(window);
+		obj.upload(window, Enum::USAGE_DEFAULT, false);
 		inst = obj.createInstance();
-		node = scene->createDrawableNode(scene->getRootNode());
-		node->addDrawable(inst);
+		inst->setTexture(texture);
+		DrawableNode* boardNode = scene->createDrawableNode(scene->getRootNode());
+		if (!boardNode)
+			return false;
+		node = boardNode->handle();
+		boardNode->addDrawable(inst);
 
 		//Move board to the centre using chess coordinates, and scale:
-		node->setPos(3.5f, 0.f, 3.5f);
-		node->scale(8);
+		boardNode->setPos(3.5f, 0.f, 3.5f);
+		boardNode->scale(8);
 
 		pieces.reserve(32);
 
@@ -108,13 +144,13 @@ public:
 		pieces.push_back(Piece(Coord(7, 7), BLACK, &chessMeshes[ROOK], scene, physics));
 
 		pieces.push_back(Piece(Coord(1, 0), WHITE, &chessMeshes[KNIGHT], scene, physics));
-		pieces.back().node->rotate(math::Quaternion().fromAxisRotation(math::vec3(0,1,0), -math::PIHalf));
+		pieces.back().rotate(math::Quaternion().fromAxisRotation(math::vec3(0,1,0), -math::PIHalf));
 		pieces.push_back(Piece(Coord(6, 0), WHITE, &chessMeshes[KNIGHT], scene, physics));
-		pieces.back().node->rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), -math::PIHalf));
+		pieces.back().rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), -math::PIHalf));
 		pieces.push_back(Piece(Coord(1, 7), BLACK, &chessMeshes[KNIGHT], scene, physics));
-		pieces.back().node->rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), math::PIHalf));
+		pieces.back().rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), math::PIHalf));
 		pieces.push_back(Piece(Coord(6, 7), BLACK, &chessMeshes[KNIGHT], scene, physics));
-		pieces.back().node->rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), math::PIHalf));
+		pieces.back().rotate(math::Quaternion().fromAxisRotation(math::vec3(0, 1, 0), math::PIHalf));
 
 		pieces.push_back(Piece(Coord(2, 0), WHITE, &chessMeshes[BISHOP], scene, physics));
 		pieces.push_back(Piece(Coord(5, 0), WHITE, &chessMeshes[BISHOP], scene, physics));
@@ -126,7 +162,11 @@ public:
 
 		pieces.push_back(Piece(Coord(3, 0), WHITE, &chessMeshes[QUEEN], scene, physics));
 		pieces.push_back(Piece(Coord(4, 7), BLACK, &chessMeshes[QUEEN], scene, physics));
-		
+
+		//Bound through the backend with each batch, as lists recorded on other threads start with nothing bound.
+		for (size_t i = 0; i < pieces.size(); ++i)
+			pieces[i].inst->setTexture(texture);
+
 		return true;
 	}
 
@@ -160,7 +200,7 @@ private:
 
 
 		for (int i = 0; i < PIECE_COUNT; ++i)
-			board.chessMeshes[i].upload(window);
+			board.chessMeshes[i].upload(window, Enum::USAGE_DEFAULT, false);
 
 		return true;
 	}
@@ -171,7 +211,6 @@ private:
 			return false;
 		if (!chessTexture.upload(window->getDirectX().getDevice(), Texture::TextureType::DIFFUSE))
 			return false;
-		chessTexture.setForRendering(window->getDirectX().getContext());
 		return true;
 	}
 
@@ -189,20 +228,14 @@ public:
 		if (
 		!loadTextures() ||
 		!loadObjects() ||
-		!board.initialise(&scene, window, physics))
+		!board.initialise(&scene, window, physics, &chessTexture))
 			return false;
 
+		//The view and projection come in the frame constants, the world matrices and colours in the instances.
 		ShaderProgramDescriptor shaderDesc("Shaders/test.vs", "Shaders/test.fs",
 		{
-			ShaderProgramDescriptor::T_START_CBUFFER, ShaderProgramDescriptor::T_MATRIX_4,
-			ShaderProgramDescriptor::T_MATRIX_4,
-			ShaderProgramDescriptor::T_MATRIX_4,
-			ShaderProgramDescriptor::T_END_CBUFFER
 		},
 		{
-			ShaderProgramDescriptor::T_START_CBUFFER,
-			ShaderProgramDescriptor::T_FLOAT4,
-			ShaderProgramDescriptor::T_END_CBUFFER
 		});
 
 		if (!shader.load(&shaderDesc, window->getDirectX().getDevice()))
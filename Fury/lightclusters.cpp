@@ -0,0 +1,411 @@
+#include "lightclusters.h"
+#include "scene.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	math::vec3 transformPoint(const math::mat4& m, const math::vec3& p)
+	{
+		return math::vec3(
+			m.m[0][0] * p.x + m.m[1][0] * p.y + m.m[2][0] * p.z + m.m[3][0],
+			m.m[0][1] * p.x + m.m[1][1] * p.y + m.m[2][1] * p.z + m.m[3][1],
+			m.m[0][2] * p.x + m.m[1][2] * p.y + m.m[2][2] * p.z + m.m[3][2]);
+	}
+
+	math::vec3 transformDirection(const math::mat4& m, const math::vec3& d)
+	{
+		return math::vec3(
+			m.m[0][0] * d.x + m.m[1][0] * d.y + m.m[2][0] * d.z,
+			m.m[0][1] * d.x + m.m[1][1] * d.y + m.m[2][1] * d.z,
+			m.m[0][2] * d.x + m.m[1][2] * d.y + m.m[2][2] * d.z);
+	}
+
+	/**Returns the tile a position along the screen falls in, counted in tiles and clamped to [0, tiles).*/
+	unsigned clampTile(math::matReal tile, unsigned tiles)
+	{
+		if (!(tile > 0)) //Also catches NaN.
+			return 0;
+		return tile >= math::matReal(tiles) ? tiles - 1 : unsigned(tile);
+	}
+
+	/**Returns the position of the lowest set bit of a non-zero word.*/
+	unsigned lowestBit(unsigned long long word)
+	{
+		//De Bruijn multiplication: the isolated bit shifts a sequence in which every 6 bit window is unique.
+		static const unsigned char positions[64] = {
+			0, 1, 2, 53, 3, 7, 54, 27, 4, 38, 41, 8, 34, 55, 48, 28, 62, 5, 39, 46, 44, 42, 22, 9, 24, 35, 59, 56, 49,
+			18, 29, 11, 63, 52, 6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10, 51, 25, 36, 32, 60, 20, 57, 16,
+			50, 31, 19, 15, 30, 14, 13, 12 };
+		return positions[((word & (0 - word)) * 0x022FDD63CC95386Dull) >> 58];
+	}
+
+	/**Returns a bit for each of four clusters in a row, set if the distance along x from cx to the cluster, squared,
+	is at most limit. The clusters' x extents are in minX[0..3] and maxX[0..3].*/
+	unsigned rowMask(const math::matReal* minX, const math::matReal* maxX, math::matReal cx, math::matReal limit)
+	{
+#if defined(MATRIX_D_SSE)
+		const __m128 c = _mm_set1_ps(cx);
+		const __m128 dx = _mm_max_ps(_mm_setzero_ps(),
+			_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX), c), _mm_sub_ps(c, _mm_loadu_ps(maxX))));
+		return unsigned(_mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), _mm_set1_ps(limit))));
+#elif defined(MATRIX_D_NEON)
+		const float32x4_t c = vdupq_n_f32(cx);
+		const float32x4_t dx = vmaxq_f32(vdupq_n_f32(0),
+			vmaxq_f32(vsubq_f32(vld1q_f32(minX), c), vsubq_f32(c, vld1q_f32(maxX))));
+		const uint32x4_t reached = vcleq_f32(vmulq_f32(dx, dx), vdupq_n_f32(limit));
+		return (vgetq_lane_u32(reached, 0) & 1) | (vgetq_lane_u32(reached, 1) & 2) |
+			(vgetq_lane_u32(reached, 2) & 4) | (vgetq_lane_u32(reached, 3) & 8);
+#else
+		unsigned mask = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			const math::matReal dx = std::max(math::matReal(0), std::max(minX[i] - cx, cx - maxX[i]));
+			if (dx * dx <= limit)
+				mask |= 1u << i;
+		}
+		return mask;
+#endif
+	}
+}
+
+LightClusters::LightClusters(unsigned tileSize, unsigned slices) : mTileSize(tileSize), mSlices(slices),
+	mTilesX(0), mTilesY(0), mPaddedTilesX(0), mWidth(0), mHeight(0), mProjection(0), mXScale(1), mYScale(1),
+	mNear(1), mFar(2), mSliceScale(0), mSliceBias(0), mSliceLights(slices), mSliceBits(slices),
+	mSliceIndices(slices), mSliceOffset(slices)
+{
+}
+
+void LightClusters::setProjection(const math::mat4& projection, unsigned width, unsigned height)
+{
+	if (width == mWidth && height == mHeight && projection == mProjection)
+		return;
+	mProjection = projection;
+	mWidth = width;
+	mHeight = height;
+
+	//initProjection puts depth * far / (far - near) - far * near / (far - near) in z and the depth in w.
+	mXScale = projection.m[0][0];
+	mYScale = projection.m[1][1];
+	const math::matReal a = projection.m[2][2], b = projection.m[3][2];
+	mNear = -b / a;
+	mFar = b / (1 - a);
+
+	mTilesX = (width + mTileSize - 1) / mTileSize;
+	mTilesY = (height + mTileSize - 1) / mTileSize;
+	mPaddedTilesX = (mTilesX + 3) & ~3u;
+
+	const math::matReal logRatio = std::log(mFar / mNear);
+	mSliceScale = mSlices / logRatio;
+	mSliceBias = -(mSlices * std::log(mNear)) / logRatio;
+	mSliceNear.resize(mSlices + 1);
+	for (unsigned s = 0; s <= mSlices; ++s)
+		mSliceNear[s] = mNear * std::pow(mFar / mNear, math::matReal(s) / mSlices);
+	mSliceNear[mSlices] = mFar;
+
+	//A tile covers a range of x / depth, so over the depths of a slice its x reaches furthest at one of the ends.
+	mMinX.assign(size_t(mSlices) * mPaddedTilesX, 1e30f);
+	mMaxX.assign(size_t(mSlices) * mPaddedTilesX, -1e30f);
+	mMinY.resize(size_t(mSlices) * mTilesY);
+	mMaxY.resize(size_t(mSlices) * mTilesY);
+	for (unsigned s = 0; s < mSlices; ++s)
+	{
+		const math::matReal zn = mSliceNear[s], zf = mSliceNear[s + 1];
+		for (unsigned x = 0; x < mTilesX; ++x)
+		{
+			const math::matReal left = math::matReal(x * mTileSize) / width * 2 - 1;
+			const math::matReal right = math::matReal(std::min((x + 1) * mTileSize, width)) / width * 2 - 1;
+			mMinX[s * mPaddedTilesX + x] = std::min(left * zn, left * zf) / mXScale;
+			mMaxX[s * mPaddedTilesX + x] = std::max(right * zn, right * zf) / mXScale;
+		}
+		for (unsigned y = 0; y < mTilesY; ++y)
+		{
+			const math::matReal top = 1 - math::matReal(y * mTileSize) / height * 2;
+			const math::matReal bottom = 1 - math::matReal(std::min((y + 1) * mTileSize, height)) / height * 2;
+			mMinY[s * mTilesY + y] = std::min(bottom * zn, bottom * zf) / mYScale;
+			mMaxY[s * mTilesY + y] = std::max(top * zn, top * zf) / mYScale;
+		}
+	}
+
+	mClusterRadius.assign(size_t(mSlices) * mTilesY * mPaddedTilesX, 0);
+	for (unsigned s = 0; s < mSlices; ++s)
+		for (unsigned y = 0; y < mTilesY; ++y)
+			for (unsigned x = 0; x < mTilesX; ++x)
+			{
+				math::vec3 min, max;
+				clusterBounds(x, y, s, min, max);
+				mClusterRadius[(size_t(s) * mTilesY + y) * mPaddedTilesX + x] = (max - min).length() * 0.5f;
+			}
+
+	mRanges.resize(size_t(mSlices) * mTilesX * mTilesY);
+}
+
+unsigned LightClusters::sliceOf(math::matReal depth) const
+{
+	if (!(depth > mNear))
+		return 0;
+	const math::matReal slice = std::floor(std::log(depth) * mSliceScale + mSliceBias);
+	return slice >= math::matReal(mSlices) ? mSlices - 1 : unsigned(slice);
+}
+
+math::matReal LightClusters::sliceDepth(unsigned slice) const
+{
+	return mSliceNear[slice];
+}
+
+void LightClusters::clusterBounds(unsigned x, unsigned y, unsigned slice, math::vec3& min, math::vec3& max) const
+{
+	min = math::vec3(mMinX[slice * mPaddedTilesX + x], mMinY[slice * mTilesY + y], mSliceNear[slice]);
+	max = math::vec3(mMaxX[slice * mPaddedTilesX + x], mMaxY[slice * mTilesY + y], mSliceNear[slice + 1]);
+}
+
+void LightClusters::prepareLight(const math::mat4& view, const LightBufferEntry& entry, bool spot,
+	ViewLight& light) const
+{
+	const math::vec4& p = entry.positionRadius;
+	const math::vec4& d = entry.directionCosAngle;
+	light.visible = false;
+	light.spot = spot;
+	light.range = p.w;
+	if (!(light.range > 0))
+		return;
+
+	light.apex = transformPoint(view, math::vec3(p.x, p.y, p.z));
+	light.direction = transformDirection(view, math::vec3(d.x, d.y, d.z));
+	light.cosAngle = std::min(std::max(d.w, math::matReal(-1)), math::matReal(1));
+	light.sinAngle = std::sqrt(1 - light.cosAngle * light.cosAngle);
+
+	//The smallest sphere around a cone capped by the range: through the apex and the rim for narrow cones, around
+	//the rim for wide ones. Cones wider than a half sphere get the sphere around the whole range.
+	light.centre = light.apex;
+	light.radius = light.range;
+	if (spot && light.cosAngle > 0)
+	{
+		if (light.cosAngle > math::matReal(0.70710678))
+		{
+			light.radius = light.range / (2 * light.cosAngle);
+			light.centre = light.apex + light.direction * light.radius;
+		}
+		else
+		{
+			light.radius = light.range * light.sinAngle;
+			light.centre = light.apex + light.direction * (light.range * light.cosAngle);
+		}
+	}
+
+	//The slices the sphere reaches between the near and far planes.
+	const math::vec3& c = light.centre;
+	const math::matReal r = light.radius;
+	const math::matReal zLow = std::max(c.z - r, mNear), zHigh = std::min(c.z + r, mFar);
+	if (zLow > zHigh)
+		return;
+	light.z0 = sliceOf(zLow);
+	if (light.z0 > 0 && zLow <= mSliceNear[light.z0])
+		--light.z0;
+	light.z1 = sliceOf(zHigh);
+	if (light.z1 + 1 < mSlices && zHigh >= mSliceNear[light.z1 + 1])
+		++light.z1;
+
+	//The tiles whose cluster boxes the sphere's box can reach. A cluster box spans the x / depth of its tile's
+	//edges at both ends of its slice, so the sphere's box is projected over the whole depth of those slices, where
+	//x / depth is largest and smallest at the ends.
+	const math::matReal zNear = mSliceNear[light.z0], zFar = mSliceNear[light.z1 + 1];
+	const math::matReal left = std::min((c.x - r) / zNear, (c.x - r) / zFar) * mXScale;
+	const math::matReal right = std::max((c.x + r) / zNear, (c.x + r) / zFar) * mXScale;
+	const math::matReal bottom = std::min((c.y - r) / zNear, (c.y - r) / zFar) * mYScale;
+	const math::matReal top = std::max((c.y + r) / zNear, (c.y + r) / zFar) * mYScale;
+
+	//Widened a little so that rounding never leaves out a cluster the exact tests in binSlice would find.
+	const math::matReal slack = 1e-3f;
+	const math::matReal tilesPerUnitX = math::matReal(mWidth) / mTileSize * 0.5f;
+	const math::matReal tilesPerUnitY = math::matReal(mHeight) / mTileSize * 0.5f;
+	const math::matReal x0 = (left + 1) * tilesPerUnitX - slack, x1 = (right + 1) * tilesPerUnitX + slack;
+	const math::matReal y0 = (1 - top) * tilesPerUnitY - slack, y1 = (1 - bottom) * tilesPerUnitY + slack;
+	if (x1 < 0 || x0 >= mTilesX || y1 < 0 || y0 >= mTilesY)
+		return;
+	light.x0 = clampTile(x0, mTilesX);
+	light.x1 = clampTile(x1, mTilesX);
+	light.y0 = clampTile(y0, mTilesY);
+	light.y1 = clampTile(y1, mTilesY);
+	light.visible = true;
+}
+
+unsigned LightClusters::coneMask(const ViewLight& light, const math::matReal* minX, const math::matReal* maxX,
+	math::matReal centreY, math::matReal centreZ, const math::matReal* radius)
+{
+	//Splits the offset to each sphere into along and across the axis; a sphere is out if it lies past the range,
+	//behind the apex, or further than its radius outside the cone's side.
+	const math::matReal offsetY = centreY - light.apex.y, offsetZ = centreZ - light.apex.z;
+	const math::matReal alongYZ = offsetY * light.direction.y + offsetZ * light.direction.z;
+	const math::matReal lengthYZ = offsetY * offsetY + offsetZ * offsetZ;
+#if defined(MATRIX_D_SSE)
+	const __m128 offsetX = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(minX), _mm_loadu_ps(maxX)),
+		_mm_set1_ps(0.5f)), _mm_set1_ps(light.apex.x));
+	const __m128 along = _mm_add_ps(_mm_mul_ps(offsetX, _mm_set1_ps(light.direction.x)), _mm_set1_ps(alongYZ));
+	const __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_set1_ps(lengthYZ));
+	const __m128 across = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lengthSquared, _mm_mul_ps(along, along)),
+		_mm_setzero_ps()));
+	const __m128 outside = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(light.cosAngle), across),
+		_mm_mul_ps(_mm_set1_ps(light.sinAngle), along));
+	const __m128 r = _mm_loadu_ps(radius);
+	const __m128 out = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(outside, r),
+		_mm_cmpgt_ps(along, _mm_add_ps(_mm_set1_ps(light.range), r))),
+		_mm_cmplt_ps(along, _mm_sub_ps(_mm_setzero_ps(), r)));
+	return unsigned(~_mm_movemask_ps(out)) & 15;
+#elif defined(MATRIX_D_NEON)
+	const float32x4_t offsetX = vsubq_f32(vmulq_f32(vaddq_f32(vld1q_f32(minX), vld1q_f32(maxX)), vdupq_n_f32(0.5f)),
+		vdupq_n_f32(light.apex.x));
+	const float32x4_t along = vaddq_f32(vmulq_f32(offsetX, vdupq_n_f32(light.direction.x)), vdupq_n_f32(alongYZ));
+	const float32x4_t lengthSquared = vaddq_f32(vmulq_f32(offsetX, offsetX), vdupq_n_f32(lengthYZ));
+	const float32x4_t across = vsqrtq_f32(vmaxq_f32(vsubq_f32(lengthSquared, vmulq_f32(along, along)),
+		vdupq_n_f32(0)));
+	const float32x4_t outside = vsubq_f32(vmulq_f32(vdupq_n_f32(light.cosAngle), across),
+		vmulq_f32(vdupq_n_f32(light.sinAngle), along));
+	const float32x4_t r = vld1q_f32(radius);
+	const uint32x4_t out = vorrq_u32(vorrq_u32(vcgtq_f32(outside, r),
+		vcgtq_f32(along, vaddq_f32(vdupq_n_f32(light.range), r))), vcltq_f32(along, vnegq_f32(r)));
+	return (~vgetq_lane_u32(out, 0) & 1) | (~vgetq_lane_u32(out, 1) & 2) | (~vgetq_lane_u32(out, 2) & 4) |
+		(~vgetq_lane_u32(out, 3) & 8);
+#else
+	unsigned mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		const math::matReal offsetX = (minX[i] + maxX[i]) * 0.5f - light.apex.x;
+		const math::matReal along = offsetX * light.direction.x + alongYZ;
+		const math::matReal across = std::sqrt(std::max(offsetX * offsetX + lengthYZ - along * along,
+			math::matReal(0)));
+		const math::matReal outside = light.cosAngle * across - light.sinAngle * along;
+		if (!(outside > radius[i] || along > light.range + radius[i] || along < -radius[i]))
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
+void LightClusters::binSlice(unsigned slice)
+{
+	const math::matReal zn = mSliceNear[slice], zf = mSliceNear[slice + 1], centreZ = (zn + zf) * 0.5f;
+	const math::matReal* minX = &mMinX[slice * mPaddedTilesX];
+	const math::matReal* maxX = &mMaxX[slice * mPaddedTilesX];
+	const math::matReal* minY = &mMinY[slice * mTilesY];
+	const math::matReal* maxY = &mMaxY[slice * mTilesY];
+	const math::matReal* clusterRadius = &mClusterRadius[size_t(slice) * mTilesY * mPaddedTilesX];
+
+	//Each cluster gets a bit per light of the slice, so the lights come out in order without sorting.
+	const std::vector<unsigned>& lights = mSliceLights[slice];
+	const unsigned clusters = mTilesY * mPaddedTilesX;
+	const size_t words = (lights.size() + 63) / 64;
+	std::vector<unsigned long long>& bits = mSliceBits[slice];
+	bits.assign(clusters * words, 0);
+
+	for (size_t i = 0; i < lights.size(); ++i)
+	{
+		const ViewLight& light = mLights[lights[i]];
+		const math::vec3& c = light.centre;
+		const math::matReal dz = std::max(math::matReal(0), std::max(zn - c.z, c.z - zf));
+		const math::matReal reachZ = light.radius * light.radius - dz * dz;
+		if (reachZ < 0)
+			continue;
+
+		const unsigned long long bit = 1ull << (i % 64);
+		unsigned long long* lightBits = &bits[i / 64];
+		for (unsigned y = light.y0; y <= light.y1; ++y)
+		{
+			const math::matReal dy = std::max(math::matReal(0), std::max(minY[y] - c.y, c.y - maxY[y]));
+			const math::matReal reachX = reachZ - dy * dy;
+			if (reachX < 0)
+				continue;
+
+			const math::matReal centreY = (minY[y] + maxY[y]) * 0.5f;
+			for (unsigned x = light.x0 & ~3u; x <= light.x1; x += 4)
+			{
+				unsigned mask = rowMask(minX + x, maxX + x, c.x, reachX);
+				if (x < light.x0)
+					mask &= ~0u << (light.x0 - x);
+				if (x + 3 > light.x1)
+					mask &= (1u << (light.x1 - x + 1)) - 1;
+
+				const unsigned row = y * mPaddedTilesX + x;
+				if (mask && light.spot)
+					mask &= coneMask(light, minX + x, maxX + x, centreY, centreZ, clusterRadius + row);
+				for (unsigned lane = 0; mask; ++lane, mask >>= 1)
+					if (mask & 1)
+						lightBits[(row + lane) * words] |= bit;
+			}
+		}
+	}
+
+	//Each cluster's offset is within the slice until assign() adds the slice's own.
+	std::vector<unsigned>& indices = mSliceIndices[slice];
+	indices.clear();
+	Range* ranges = &mRanges[size_t(slice) * mTilesX * mTilesY];
+	for (unsigned y = 0; y < mTilesY; ++y)
+		for (unsigned x = 0; x < mTilesX; ++x)
+		{
+			Range& range = ranges[y * mTilesX + x];
+			range.offset = unsigned(indices.size());
+			for (size_t w = 0; w < words; ++w)
+				for (unsigned long long word = bits[(y * mPaddedTilesX + x) * words + w]; word; word &= word - 1)
+					indices.push_back(mLights[lights[w * 64 + lowestBit(word)]].index);
+			range.count = unsigned(indices.size()) - range.offset;
+		}
+}
+
+void LightClusters::assign(const math::mat4& view, const LightBufferEntry* lights, size_t begin, size_t spotBegin,
+	size_t end, WorkerPool* pool)
+{
+	assert(mTilesX > 0 && "setProjection must be called first");
+	WorkerPool& workers = pool ? *pool : WorkerPool::instance();
+
+	mLights.resize(end - begin);
+	workers.parallelFor(mLights.size(), 256, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i)
+		{
+			prepareLight(view, lights[begin + i], begin + i >= spotBegin, mLights[i]);
+			mLights[i].index = unsigned(begin + i);
+		}
+	});
+
+	for (unsigned s = 0; s < mSlices; ++s)
+		mSliceLights[s].clear();
+	for (size_t i = 0; i < mLights.size(); ++i)
+		if (mLights[i].visible)
+			for (unsigned s = mLights[i].z0; s <= mLights[i].z1; ++s)
+				mSliceLights[s].push_back(unsigned(i));
+
+	workers.parallelFor(mSlices, 1, [this](size_t first, size_t last) {
+		for (size_t s = first; s < last; ++s)
+			binSlice(unsigned(s));
+	});
+
+	size_t total = 0;
+	for (unsigned s = 0; s < mSlices; ++s)
+	{
+		mSliceOffset[s] = total;
+		total += mSliceIndices[s].size();
+	}
+	mIndices.resize(total);
+
+	const unsigned clusters = mTilesX * mTilesY;
+	workers.parallelFor(mSlices, 1, [&](size_t first, size_t last) {
+		for (size_t s = first; s < last; ++s)
+		{
+			Range* ranges = &mRanges[s * clusters];
+			for (unsigned c = 0; c < clusters; ++c)
+				ranges[c].offset += unsigned(mSliceOffset[s]);
+			if (!mSliceIndices[s].empty())
+				std::memcpy(&mIndices[mSliceOffset[s]], &mSliceIndices[s][0],
+					mSliceIndices[s].size() * sizeof(unsigned));
+		}
+	});
+}
+
+void LightClusters::assign(const math::mat4& view, const Scene& scene, WorkerPool* pool)
+{
+	const std::vector<LightBufferEntry>& lights = scene.getLights();
+	assign(view, lights.empty() ? NULL : &lights[0], scene.lightsBegin(LightNode::TYPE_POINT),
+		scene.lightsBegin(LightNode::TYPE_SPOT), scene.lightsEnd(LightNode::TYPE_SPOT), pool);
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "matrixd.h"
+#include "shaderbuffertypes.h"
+#include <vector>
+
+class Scene;
+class WorkerPool;
+
+/*
+Clustered light assignment on the CPU. The view frustum is cut into a grid of clusters: tiles of the screen a fixed
+number of pixels wide and high, and slices in depth whose thickness grows with distance, so every cluster is about
+as deep as it is wide. Each point and spot light is binned into the clusters its bounds reach, and the result is a
+flat array of light indices sorted by cluster, with an offset and count per cluster, from which a pixel shader reads
+the lights of the cluster it falls in. Directional lights reach everywhere and are not binned.
+
+The lights are found for each depth slice independently, so the slices are spread over a WorkerPool. A light is
+bounded by a sphere, which picks a box of clusters from the grid; the sphere is tested against the clusters of the box
+four at a time, and so is a spot light's cone. A slice marks its clusters' lights in a bitset per cluster, which
+lists them in order without sorting.
+*/
+class LightClusters
+{
+public:
+	/**Where the lights of a cluster are in indices().*/
+	struct Range
+	{
+		unsigned offset;
+		unsigned count;
+	};
+
+	/**@param tileSize The width and height of a cluster on screen, in pixels.
+	@param slices The number of clusters in depth.*/
+	explicit LightClusters(unsigned tileSize = 64, unsigned slices = 24);
+
+	/**Lays the grid out for a perspective projection, as built by mat4::initProjection, and a viewport size in
+	pixels. Does nothing if they did not change.*/
+	void setProjection(const math::mat4& projection, unsigned width, unsigned height);
+
+	/**Bins the lights [begin, end) of the array, of which [spotBegin, end) are spot lights and the rest point
+	lights, seen through the view matrix. The indices refer to positions in the array, so the shader can read the
+	lights from the same buffer. With no pool given, WorkerPool::instance() is used.*/
+	void assign(const math::mat4& view, const LightBufferEntry* lights, size_t begin, size_t spotBegin, size_t end,
+		WorkerPool* pool = NULL);
+
+	/**Bins the point and spot lights of the scene, as of its last prepare(). The indices refer to positions in
+	Scene::getLights().*/
+	void assign(const math::mat4& view, const Scene& scene, WorkerPool* pool = NULL);
+
+	unsigned tilesX() const { return mTilesX; }
+	unsigned tilesY() const { return mTilesY; }
+	unsigned slices() const { return mSlices; }
+	unsigned tileSize() const { return mTileSize; }
+	size_t clusterCount() const { return mRanges.size(); }
+
+	/**Returns the cluster holding the tile, counted in tiles from the top left of the screen, and the slice.*/
+	size_t clusterIndex(unsigned x, unsigned y, unsigned slice) const
+	{ return (size_t(slice) * mTilesY + y) * mTilesX + x; }
+
+	/**Returns the slice a view space depth falls in, which is floor(log(depth) * sliceScale() + sliceBias())
+	clamped to the slices, for the shader to compute the same way.*/
+	unsigned sliceOf(math::matReal depth) const;
+	math::matReal sliceScale() const { return mSliceScale; }
+	math::matReal sliceBias() const { return mSliceBias; }
+
+	/**Returns the view space depth at which the slice begins. sliceDepth(slices()) is the far plane.*/
+	math::matReal sliceDepth(unsigned slice) const;
+
+	/**Returns the view space box bounding a cluster.*/
+	void clusterBounds(unsigned x, unsigned y, unsigned slice, math::vec3& min, math::vec3& max) const;
+
+	/**Returns the lights of each cluster as of the last assign(), by cluster index.*/
+	const std::vector<Range>& ranges() const { return mRanges; }
+
+	/**Returns the light indices of every cluster, one after the other.*/
+	const std::vector<unsigned>& indices() const { return mIndices; }
+
+private:
+	/**A light in view space, with the box of clusters its bounding sphere reaches.*/
+	struct ViewLight
+	{
+		math::vec3 centre; //Of the bounding sphere.
+		math::matReal radius;
+		math::vec3 apex; //Of a spot light's cone, or the centre of a point light.
+		math::vec3 direction;
+		math::matReal range, cosAngle, sinAngle;
+		unsigned index; //In the array given to assign().
+		bool spot;
+		bool visible;
+		unsigned x0, x1, y0, y1, z0, z1; //Inclusive.
+	};
+
+	/**Moves the light to view space, bounds it and finds the box of clusters it reaches, or marks it not visible.*/
+	void prepareLight(const math::mat4& view, const LightBufferEntry& entry, bool spot, ViewLight& light) const;
+
+	/**Finds the lights of each cluster of the slice, writing their counts and offsets within the slice to
+	mRanges and the indices to mSliceIndices.*/
+	void binSlice(unsigned slice);
+
+	/**Returns a bit for each of four clusters in a row, set if the spot light's cone reaches the sphere around the
+	cluster. The clusters' x extents are in minX[0..3] and maxX[0..3], and their spheres' radii in radius[0..3].*/
+	static unsigned coneMask(const ViewLight& light, const math::matReal* minX, const math::matReal* maxX,
+		math::matReal centreY, math::matReal centreZ, const math::matReal* radius);
+
+	unsigned mTileSize, mSlices;
+	unsigned mTilesX, mTilesY, mPaddedTilesX; //Rows of tiles are padded to a multiple of four for testing.
+	unsigned mWidth, mHeight;
+	math::mat4 mProjection;
+	math::matReal mXScale, mYScale, mNear, mFar;
+	math::matReal mSliceScale, mSliceBias;
+
+	//The view space bounds of the clusters. A cluster's x extent depends on its column and slice only, and its y
+	//extent on its row and slice, so they are kept per slice by column (padded) and by row.
+	std::vector<math::matReal> mMinX, mMaxX, mMinY, mMaxY;
+	std::vector<math::matReal> mSliceNear; //mSlices + 1 depths.
+	std::vector<math::matReal> mClusterRadius; //Of the sphere around each cluster box, by slice, row and padded column.
+
+	std::vector<ViewLight> mLights;
+	std::vector<std::vector<unsigned> > mSliceLights; //The lights whose box reaches each slice, by mLights index.
+	std::vector<std::vector<unsigned long long> > mSliceBits; //A bit per light of the slice for each of its clusters.
+	std::vector<std::vector<unsigned> > mSliceIndices;
+	std::vector<size_t> mSliceOffset; //Of each slice's indices in mIndices.
+
+	std::vector<Range> mRanges;
+	std::vector<unsigned> mIndices;
+};
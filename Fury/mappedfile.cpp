@@ -0,0 +1,97 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <cstdint>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : mData(NULL), mSize(0) {}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || uint64_t(size.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	//The view keeps the mapping, and the mapping the file, open once their handles are closed.
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+		return false;
+
+	mData = static_cast<const unsigned char*>(view);
+	mSize = size_t(size.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mData)
+		UnmapViewOfFile(mData);
+	mData = NULL;
+	mSize = 0;
+}
+
+#else
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+	const int file = ::open(path, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size <= 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	//The mapping keeps the file open once the descriptor is closed.
+	void* view = mmap(NULL, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+		return false;
+
+	mData = static_cast<const unsigned char*>(view);
+	mSize = size_t(status.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mData)
+		munmap(const_cast<unsigned char*>(mData), mSize);
+	mData = NULL;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+/**A whole file mapped read-only into memory. Pages are read in from the file as they are first touched and shared
+with the operating system's file cache, so nothing is copied and an unused part of the file costs nothing.*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	/**Maps the file, unmapping the one mapped before. Returns false if it could not be opened or is empty.*/
+	bool open(const char* path);
+
+	/**Unmaps the file. The pointers data() returned are invalid afterwards.*/
+	void close();
+
+	bool isOpen() const { return mData != NULL; }
+	const unsigned char* data() const { return mData; }
+	size_t size() const { return mSize; }
+
+private:
+	//I really don't want to copy this by accident...
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* mData;
+	size_t mSize;
+};
@@ -0,0 +1,428 @@
+#include "matrixbatch.h"
+#include "workerpool.h"
+
+namespace math
+{
+	namespace
+	{
+		//Smallest piece of work handed to a thread, so the scheduling cost stays small next to the kernel.
+		const size_t kMinChunk = 4096;
+
+		/**Runs func over [0, count), on several threads when the span is large enough.
+		cost is the work per element relative to transforming one point.*/
+		template<class Func>
+		void dispatch(size_t count, size_t cost, bool allowThreads, const Func& func)
+		{
+			if (allowThreads && count * cost >= kBatchParallelThreshold)
+				WorkerPool::instance().parallelFor(count, (kMinChunk + cost - 1) / cost, func);
+			else
+				func(0, count);
+		}
+
+		/**The AoS kernel. Point selects between w = 1 (points) and w = 0 (directions).
+		Strides are in bytes, so both packed vec3 arrays and interleaved vertices can be handled.*/
+		template<bool Point>
+		void transformStrided(const mat4& m, const char* in, size_t inStride, char* out, size_t outStride,
+			size_t begin, size_t end)
+		{
+#if defined(MATRIX_D_SSE)
+			const __m128 c0 = _mm_loadu_ps(m.m[0]);
+			const __m128 c1 = _mm_loadu_ps(m.m[1]);
+			const __m128 c2 = _mm_loadu_ps(m.m[2]);
+			const __m128 c3 = _mm_loadu_ps(m.m[3]);
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				const float* v = reinterpret_cast<const float*>(in + i * inStride);
+				float* o = reinterpret_cast<float*>(out + i * outStride);
+
+				__m128 r = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+				r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+				r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+				if (Point)
+					r = _mm_add_ps(r, c3);
+
+				_mm_storel_pi(reinterpret_cast<__m64*>(o), r);
+				_mm_store_ss(o + 2, _mm_movehl_ps(r, r));
+			}
+#elif defined(MATRIX_D_NEON)
+			const float32x4_t c0 = vld1q_f32(m.m[0]);
+			const float32x4_t c1 = vld1q_f32(m.m[1]);
+			const float32x4_t c2 = vld1q_f32(m.m[2]);
+			const float32x4_t c3 = vld1q_f32(m.m[3]);
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				const float* v = reinterpret_cast<const float*>(in + i * inStride);
+				float* o = reinterpret_cast<float*>(out + i * outStride);
+
+				float32x4_t r = vmulq_n_f32(c0, v[0]);
+				r = vaddq_f32(r, vmulq_n_f32(c1, v[1]));
+				r = vaddq_f32(r, vmulq_n_f32(c2, v[2]));
+				if (Point)
+					r = vaddq_f32(r, c3);
+
+				vst1_f32(o, vget_low_f32(r));
+				vst1q_lane_f32(o + 2, r, 2);
+			}
+#else
+			for (size_t i = begin; i < end; ++i)
+			{
+				const float* v = reinterpret_cast<const float*>(in + i * inStride);
+				float* o = reinterpret_cast<float*>(out + i * outStride);
+				const matReal x = v[0], y = v[1], z = v[2];
+
+				for (int row = 0; row < 3; ++row)
+				{
+					matReal r = m.m[0][row] * x + m.m[1][row] * y + m.m[2][row] * z;
+					if (Point)
+						r += m.m[3][row];
+					o[row] = float(r);
+				}
+			}
+#endif
+		}
+
+		/**The SoA kernel, which processes one register width of elements per iteration.*/
+		template<bool Point>
+		void transformSoA(const mat4& m, const matReal* xs, const matReal* ys, const matReal* zs,
+			matReal* outXs, matReal* outYs, matReal* outZs, size_t begin, size_t end)
+		{
+			size_t i = begin;
+
+#if defined(MATRIX_D_AVX)
+			for (; i + 8 <= end; i += 8)
+			{
+				const __m256 x = _mm256_loadu_ps(xs + i);
+				const __m256 y = _mm256_loadu_ps(ys + i);
+				const __m256 z = _mm256_loadu_ps(zs + i);
+				matReal* outs[3] = { outXs, outYs, outZs };
+
+				for (int row = 0; row < 3; ++row)
+				{
+					__m256 r = _mm256_mul_ps(_mm256_set1_ps(m.m[0][row]), x);
+					r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(m.m[1][row]), y));
+					r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_set1_ps(m.m[2][row]), z));
+					if (Point)
+						r = _mm256_add_ps(r, _mm256_set1_ps(m.m[3][row]));
+					_mm256_storeu_ps(outs[row] + i, r);
+				}
+			}
+#endif
+
+#if defined(MATRIX_D_SSE)
+			for (; i + 4 <= end; i += 4)
+			{
+				const __m128 x = _mm_loadu_ps(xs + i);
+				const __m128 y = _mm_loadu_ps(ys + i);
+				const __m128 z = _mm_loadu_ps(zs + i);
+				matReal* outs[3] = { outXs, outYs, outZs };
+
+				for (int row = 0; row < 3; ++row)
+				{
+					__m128 r = _mm_mul_ps(_mm_set1_ps(m.m[0][row]), x);
+					r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m.m[1][row]), y));
+					r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m.m[2][row]), z));
+					if (Point)
+						r = _mm_add_ps(r, _mm_set1_ps(m.m[3][row]));
+					_mm_storeu_ps(outs[row] + i, r);
+				}
+			}
+#elif defined(MATRIX_D_NEON)
+			for (; i + 4 <= end; i += 4)
+			{
+				const float32x4_t x = vld1q_f32(xs + i);
+				const float32x4_t y = vld1q_f32(ys + i);
+				const float32x4_t z = vld1q_f32(zs + i);
+				matReal* outs[3] = { outXs, outYs, outZs };
+
+				for (int row = 0; row < 3; ++row)
+				{
+					float32x4_t r = vmulq_n_f32(x, m.m[0][row]);
+					r = vaddq_f32(r, vmulq_n_f32(y, m.m[1][row]));
+					r = vaddq_f32(r, vmulq_n_f32(z, m.m[2][row]));
+					if (Point)
+						r = vaddq_f32(r, vdupq_n_f32(m.m[3][row]));
+					vst1q_f32(outs[row] + i, r);
+				}
+			}
+#endif
+
+			//The tail, or everything on the scalar path:
+			for (; i < end; ++i)
+			{
+				const matReal x = xs[i], y = ys[i], z = zs[i];
+				matReal* outs[3] = { outXs, outYs, outZs };
+
+				for (int row = 0; row < 3; ++row)
+				{
+					matReal r = m.m[0][row] * x + m.m[1][row] * y + m.m[2][row] * z;
+					if (Point)
+						r += m.m[3][row];
+					outs[row][i] = r;
+				}
+			}
+		}
+
+#if defined(MATRIX_D_SSE)
+		//Eberly's SLERP coefficients: u[i] = 1 / ((i + 1)(2i + 3)), v[i] = (i + 1) / (2i + 3), with the last
+		//pair scaled by mu = 1.85298109240830 to compensate for the truncated series.
+		const float kSlerpU[8] = { 1.f / 3, 1.f / 10, 1.f / 21, 1.f / 36, 1.f / 55, 1.f / 78, 1.f / 105,
+			1.85298109240830f / 136 };
+		const float kSlerpV[8] = { 1.f / 3, 2.f / 5, 3.f / 7, 4.f / 9, 5.f / 11, 6.f / 13, 7.f / 15,
+			1.85298109240830f * 8 / 17 };
+
+		/**The scalar form of the SIMD slerp, for the elements left over after the last full register.*/
+		Quaternion slerpApprox(const Quaternion& a, const Quaternion& b, matReal t)
+		{
+			matReal cosTheta = dot(a, b);
+			const matReal sign = cosTheta < 0 ? matReal(-1) : matReal(1);
+			cosTheta *= sign;
+
+			const matReal xm1 = cosTheta - 1, d = 1 - t;
+			matReal ct = 1, cd = 1;
+			for (int i = 7; i >= 0; --i)
+			{
+				ct = 1 + (kSlerpU[i] * t * t - kSlerpV[i]) * xm1 * ct;
+				cd = 1 + (kSlerpU[i] * d * d - kSlerpV[i]) * xm1 * cd;
+			}
+			ct *= t * sign;
+			cd *= d;
+			return Quaternion(a.w*cd + b.w*ct, a.x*cd + b.x*ct, a.y*cd + b.y*ct, a.z*cd + b.z*ct);
+		}
+#endif
+
+		template<bool Slerp>
+		void interpolate(const Quaternion* a, const Quaternion* b, const matReal* t, Quaternion* out,
+			size_t begin, size_t end)
+		{
+			size_t i = begin;
+
+#if defined(MATRIX_D_SSE)
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 signMask = _mm_set1_ps(-0.f);
+
+			for (; i + 4 <= end; i += 4)
+			{
+				//Four quaternions become one register per component:
+				__m128 aw = _mm_loadu_ps(&a[i].w), ax = _mm_loadu_ps(&a[i + 1].w);
+				__m128 ay = _mm_loadu_ps(&a[i + 2].w), az = _mm_loadu_ps(&a[i + 3].w);
+				_MM_TRANSPOSE4_PS(aw, ax, ay, az);
+				__m128 bw = _mm_loadu_ps(&b[i].w), bx = _mm_loadu_ps(&b[i + 1].w);
+				__m128 by = _mm_loadu_ps(&b[i + 2].w), bz = _mm_loadu_ps(&b[i + 3].w);
+				_MM_TRANSPOSE4_PS(bw, bx, by, bz);
+				const __m128 tb = _mm_loadu_ps(t + i);
+				const __m128 ta = _mm_sub_ps(one, tb);
+
+				__m128 cosTheta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)),
+					_mm_add_ps(_mm_mul_ps(ay, by), _mm_mul_ps(az, bz)));
+				const __m128 sign = _mm_and_ps(cosTheta, signMask);
+				cosTheta = _mm_xor_ps(cosTheta, sign);
+
+				__m128 wa = ta, wb = tb;
+				if (Slerp)
+				{
+					const __m128 xm1 = _mm_sub_ps(cosTheta, one);
+					const __m128 tt = _mm_mul_ps(tb, tb), dd = _mm_mul_ps(ta, ta);
+					__m128 ct = one, cd = one;
+					for (int k = 7; k >= 0; --k)
+					{
+						const __m128 u = _mm_set1_ps(kSlerpU[k]), v = _mm_set1_ps(kSlerpV[k]);
+						ct = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, tt), v), xm1), ct));
+						cd = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, dd), v), xm1), cd));
+					}
+					wa = _mm_mul_ps(cd, ta);
+					wb = _mm_mul_ps(ct, tb);
+				}
+				wb = _mm_xor_ps(wb, sign);
+
+				__m128 rw = _mm_add_ps(_mm_mul_ps(aw, wa), _mm_mul_ps(bw, wb));
+				__m128 rx = _mm_add_ps(_mm_mul_ps(ax, wa), _mm_mul_ps(bx, wb));
+				__m128 ry = _mm_add_ps(_mm_mul_ps(ay, wa), _mm_mul_ps(by, wb));
+				__m128 rz = _mm_add_ps(_mm_mul_ps(az, wa), _mm_mul_ps(bz, wb));
+
+				if (!Slerp)
+				{
+					const __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rw, rw), _mm_mul_ps(rx, rx)),
+						_mm_add_ps(_mm_mul_ps(ry, ry), _mm_mul_ps(rz, rz)));
+					__m128 inv = _mm_rsqrt_ps(lenSq);
+					inv = _mm_mul_ps(inv, _mm_sub_ps(_mm_set1_ps(1.5f),
+						_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), lenSq), _mm_mul_ps(inv, inv))));
+					rw = _mm_mul_ps(rw, inv);
+					rx = _mm_mul_ps(rx, inv);
+					ry = _mm_mul_ps(ry, inv);
+					rz = _mm_mul_ps(rz, inv);
+				}
+
+				_MM_TRANSPOSE4_PS(rw, rx, ry, rz);
+				_mm_storeu_ps(&out[i].w, rw);
+				_mm_storeu_ps(&out[i + 1].w, rx);
+				_mm_storeu_ps(&out[i + 2].w, ry);
+				_mm_storeu_ps(&out[i + 3].w, rz);
+			}
+
+			for (; i < end; ++i)
+				out[i] = Slerp ? slerpApprox(a[i], b[i], t[i]) : Quaternion::nlerp(a[i], b[i], t[i]);
+#else
+			for (; i < end; ++i)
+				out[i] = Slerp ? Quaternion::slerp(a[i], b[i], t[i]) : Quaternion::nlerp(a[i], b[i], t[i]);
+#endif
+		}
+
+		void quaternionsToMatrices(const Quaternion* in, mat4* out, size_t begin, size_t end)
+		{
+			size_t i = begin;
+
+#if defined(MATRIX_D_SSE)
+			const __m128 one = _mm_set1_ps(1.f);
+			const __m128 two = _mm_set1_ps(2.f);
+
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 w = _mm_loadu_ps(&in[i].w), x = _mm_loadu_ps(&in[i + 1].w);
+				__m128 y = _mm_loadu_ps(&in[i + 2].w), z = _mm_loadu_ps(&in[i + 3].w);
+				_MM_TRANSPOSE4_PS(w, x, y, z);
+
+				const __m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+				const __m128 xx = _mm_mul_ps(x2, x), yy = _mm_mul_ps(y2, y), zz = _mm_mul_ps(z2, z);
+				const __m128 xy = _mm_mul_ps(x2, y), xz = _mm_mul_ps(x2, z), yz = _mm_mul_ps(y2, z);
+				const __m128 wx = _mm_mul_ps(x2, w), wy = _mm_mul_ps(y2, w), wz = _mm_mul_ps(z2, w);
+
+				//mCR, column C and row R, matching Quaternion::toMatrix:
+				__m128 m00 = _mm_sub_ps(_mm_sub_ps(one, yy), zz);
+				__m128 m01 = _mm_add_ps(xy, wz);
+				__m128 m02 = _mm_sub_ps(xz, wy);
+				__m128 m10 = _mm_sub_ps(xy, wz);
+				__m128 m11 = _mm_sub_ps(_mm_sub_ps(one, xx), zz);
+				__m128 m12 = _mm_add_ps(yz, wx);
+				__m128 m20 = _mm_add_ps(xz, wy);
+				__m128 m21 = _mm_sub_ps(yz, wx);
+				__m128 m22 = _mm_sub_ps(_mm_sub_ps(one, xx), yy);
+				__m128 zero0 = _mm_setzero_ps(), zero1 = _mm_setzero_ps(), zero2 = _mm_setzero_ps();
+
+				_MM_TRANSPOSE4_PS(m00, m01, m02, zero0);
+				_MM_TRANSPOSE4_PS(m10, m11, m12, zero1);
+				_MM_TRANSPOSE4_PS(m20, m21, m22, zero2);
+
+				const __m128 column3 = _mm_setr_ps(0, 0, 0, 1);
+				const __m128 columns[4][3] = { { m00, m10, m20 }, { m01, m11, m21 }, { m02, m12, m22 },
+					{ zero0, zero1, zero2 } };
+				for (int k = 0; k < 4; ++k)
+				{
+					_mm_storeu_ps(out[i + k].m[0], columns[k][0]);
+					_mm_storeu_ps(out[i + k].m[1], columns[k][1]);
+					_mm_storeu_ps(out[i + k].m[2], columns[k][2]);
+					_mm_storeu_ps(out[i + k].m[3], column3);
+				}
+			}
+#endif
+
+			for (; i < end; ++i)
+				out[i] = in[i].toMatrix();
+		}
+
+		template<bool Point>
+		void transformVec3(const mat4& m, const vec3* in, vec3* out, size_t count, bool allowThreads)
+		{
+#if defined(MATRIX_D_SCALAR)
+			//matReal may be double here, so the float strided kernel cannot be used.
+			dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i)
+					out[i] = (m * vec4(in[i], Point ? matReal(1) : matReal(0))).xyz();
+			});
+#else
+			const char* inBytes = reinterpret_cast<const char*>(in);
+			char* outBytes = reinterpret_cast<char*>(out);
+			dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+				transformStrided<Point>(m, inBytes, sizeof(vec3), outBytes, sizeof(vec3), begin, end);
+			});
+#endif
+		}
+	}
+
+	void transformPoints(const mat4& m, const vec3* in, vec3* out, size_t count, bool allowThreads)
+	{
+		transformVec3<true>(m, in, out, count, allowThreads);
+	}
+
+	void transformPoints(const mat4& m, const float* in, size_t inStride, float* out, size_t outStride,
+		size_t count, bool allowThreads)
+	{
+		const char* inBytes = reinterpret_cast<const char*>(in);
+		char* outBytes = reinterpret_cast<char*>(out);
+		dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+			transformStrided<true>(m, inBytes, inStride, outBytes, outStride, begin, end);
+		});
+	}
+
+	void transformPoints(const mat4& m, const matReal* xs, const matReal* ys, const matReal* zs,
+		matReal* outXs, matReal* outYs, matReal* outZs, size_t count, bool allowThreads)
+	{
+		dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+			transformSoA<true>(m, xs, ys, zs, outXs, outYs, outZs, begin, end);
+		});
+	}
+
+	void transformDirections(const mat4& m, const vec3* in, vec3* out, size_t count, bool allowThreads)
+	{
+		transformVec3<false>(m, in, out, count, allowThreads);
+	}
+
+	void transformDirections(const mat4& m, const float* in, size_t inStride, float* out, size_t outStride,
+		size_t count, bool allowThreads)
+	{
+		const char* inBytes = reinterpret_cast<const char*>(in);
+		char* outBytes = reinterpret_cast<char*>(out);
+		dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+			transformStrided<false>(m, inBytes, inStride, outBytes, outStride, begin, end);
+		});
+	}
+
+	void transformDirections(const mat4& m, const matReal* xs, const matReal* ys, const matReal* zs,
+		matReal* outXs, matReal* outYs, matReal* outZs, size_t count, bool allowThreads)
+	{
+		dispatch(count, 1, allowThreads, [&](size_t begin, size_t end) {
+			transformSoA<false>(m, xs, ys, zs, outXs, outYs, outZs, begin, end);
+		});
+	}
+
+	void multiplyMatrices(const mat4* a, const mat4* b, mat4* out, size_t count, bool allowThreads)
+	{
+		//A matrix product costs about four times a point transform, so threads pay off sooner.
+		dispatch(count, 4, allowThreads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				simd::mul4x4(a[i].m[0], b[i].m[0], out[i].m[0]);
+		});
+	}
+
+	void multiplyMatrices(const mat4& a, const mat4* b, mat4* out, size_t count, bool allowThreads)
+	{
+		dispatch(count, 4, allowThreads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+				simd::mul4x4(a.m[0], b[i].m[0], out[i].m[0]);
+		});
+	}
+
+	void nlerpMany(const Quaternion* a, const Quaternion* b, const matReal* t, Quaternion* out, size_t count,
+		bool allowThreads)
+	{
+		dispatch(count, 2, allowThreads, [&](size_t begin, size_t end) {
+			interpolate<false>(a, b, t, out, begin, end);
+		});
+	}
+
+	void slerpMany(const Quaternion* a, const Quaternion* b, const matReal* t, Quaternion* out, size_t count,
+		bool allowThreads)
+	{
+		dispatch(count, 4, allowThreads, [&](size_t begin, size_t end) {
+			interpolate<true>(a, b, t, out, begin, end);
+		});
+	}
+
+	void toMatrixMany(const Quaternion* in, mat4* out, size_t count, bool allowThreads)
+	{
+		dispatch(count, 2, allowThreads, [&](size_t begin, size_t end) {
+			quaternionsToMatrices(in, out, begin, end);
+		});
+	}
+}
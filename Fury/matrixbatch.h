@@ -0,0 +1,65 @@
+#pragma once
+#include "matrixd.h"
+#include <cstddef>
+
+/*
+Batch versions of the matrix and quaternion operations, for pushing whole arrays through one matrix instead of
+calling mat4::operator* per element, and for interpolating many rotations at once. The vector transforms come
+in an array-of-structures (AoS) form and a structure-of-arrays (SoA) form, which vectorises across elements and
+is the faster of the two.
+
+Spans of at least kBatchParallelThreshold elements are split over WorkerPool::instance() unless allowThreads
+is false. Outputs may alias the matching inputs exactly, but must not partially overlap them.
+
+Points are transformed with an implicit w of 1 and directions with w of 0; the resulting w is dropped, so
+neither performs a perspective divide. Directions are not renormalised, and normals should be transformed
+by the inverse transpose of the matrix when it contains non-uniform scaling.
+*/
+
+namespace math
+{
+	/**The span size from which the batch functions split their work across threads.*/
+	const size_t kBatchParallelThreshold = 16384;
+
+	/**out[i] = m * vec4(in[i], 1).*/
+	void transformPoints(const mat4& m, const vec3* in, vec3* out, size_t count, bool allowThreads = true);
+
+	/**Transforms points stored with a byte stride between them, such as the positions of a Vertex3D array:
+	transformPoints(m, &verts[0].x, sizeof(Vertex3D), &verts[0].x, sizeof(Vertex3D), verts.size());
+	Works on float data regardless of matReal.*/
+	void transformPoints(const mat4& m, const float* in, size_t inStride, float* out, size_t outStride,
+		size_t count, bool allowThreads = true);
+
+	/**The structure-of-arrays form: point i is (xs[i], ys[i], zs[i]).*/
+	void transformPoints(const mat4& m, const matReal* xs, const matReal* ys, const matReal* zs,
+		matReal* outXs, matReal* outYs, matReal* outZs, size_t count, bool allowThreads = true);
+
+	/**out[i] = m * vec4(in[i], 0).*/
+	void transformDirections(const mat4& m, const vec3* in, vec3* out, size_t count, bool allowThreads = true);
+
+	/**Transforms directions stored with a byte stride between them, such as the normals of a Vertex3D array.*/
+	void transformDirections(const mat4& m, const float* in, size_t inStride, float* out, size_t outStride,
+		size_t count, bool allowThreads = true);
+
+	/**The structure-of-arrays form: direction i is (xs[i], ys[i], zs[i]).*/
+	void transformDirections(const mat4& m, const matReal* xs, const matReal* ys, const matReal* zs,
+		matReal* outXs, matReal* outYs, matReal* outZs, size_t count, bool allowThreads = true);
+
+	/**out[i] = a[i] * b[i].*/
+	void multiplyMatrices(const mat4* a, const mat4* b, mat4* out, size_t count, bool allowThreads = true);
+
+	/**out[i] = a * b[i], e.g. applying a parent transform to many children.*/
+	void multiplyMatrices(const mat4& a, const mat4* b, mat4* out, size_t count, bool allowThreads = true);
+
+	/**out[i] = Quaternion::nlerp(a[i], b[i], t[i]).*/
+	void nlerpMany(const Quaternion* a, const Quaternion* b, const matReal* t, Quaternion* out, size_t count,
+		bool allowThreads = true);
+
+	/**out[i] = Quaternion::slerp(a[i], b[i], t[i]). The SIMD paths replace the acos and sines with a polynomial
+	(Eberly, "A Fast and Accurate Algorithm for Computing SLERP"), which is within 2e-5 of the exact result.*/
+	void slerpMany(const Quaternion* a, const Quaternion* b, const matReal* t, Quaternion* out, size_t count,
+		bool allowThreads = true);
+
+	/**out[i] = in[i].toMatrix().*/
+	void toMatrixMany(const Quaternion* in, mat4* out, size_t count, bool allowThreads = true);
+}
@@ -1,1238 +1,21 @@
 #include "matrixd.h"
 #include <cmath>
 
-namespace math
-{
-	matInt iround(matReal n)
-	{
-		const int integer = (int)n;
-		if (integer + matReal(0.5) > n)
-			return integer;
-		else
-			return integer + 1;
-	}
-
-
-
-	template<class T> T dot(const tmp::_vec2<T>& v1, const tmp::_vec2<T>& v2)
-	{
-		return v1.x*v2.x + v1.y*v2.y;
-	}
-
-	template<class T> T dot(const tmp::_vec3<T>& v1, const tmp::_vec3<T>& v2)
-	{
-		return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z;
-	}
-
-	template<class T> T dot(const tmp::_vec4<T>& v1, const tmp::_vec4<T>& v2)
-	{
-		return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z + v1.w*v2.w;
-	}
-
-	template<class T> tmp::_vec3<T> cross(const tmp::_vec3<T>& v1, const tmp::_vec3<T>& v2)
-	{
-		return tmp::_vec3<T>(v1.y*v2.z - v1.z*v2.y,
-			v1.z*v2.x - v1.x*v2.z,
-			v1.x*v2.y - v1.y*v2.x);
-	}
-
-	const matReal PIf(acos(-1.f));
-	const matReal PIHalf(PIf / matReal(2));
-
-	namespace tmp
-	{
-		static const matReal matScalarOne(1);
-		static const matReal matScalarNull(0);
-		static const matReal matScalarTwo(2);
-
-		template<class T> _vec2<T>::_vec2()
-		{
-			reset();
-		}
-
-		template<class T> _vec2<T>::_vec2(const T x_, const T y_)
-		{
-			x = x_;
-			y = y_;
-		}
-
-		template<class T> _vec2<T>::_vec2(const T n)
-		{
-			x = n;
-			y = n;
-		}
-
-		template<class T> matReal _vec2<T>::angle() const
-		{
-			return matReal(std::atan2(y, x));
-		}
-
-		template<class T> T _vec2<T>::lengthSquared() const
-		{
-			return x*x + y*y;
-		}
-
-		template<class T> matReal _vec2<T>::length() const
-		{
-			return matReal(std::sqrt(x*x + y*y));
-		}
-
-		template<class T> matReal _vec2<T>::distance(const _vec2<T>& v) const
-		{
-			return matReal(std::sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y)));
-		}
-
-		template<class T> T _vec2<T>::distanceSquared(const _vec2<T>& v) const
-		{
-			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator * (const T n) const
-		{
-			return _vec2<T>(x*n, y*n);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator / (const T n) const
-		{
-			return _vec2<T>(x / n, y / n);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator + (const T n) const
-		{
-			return _vec2<T>(x + n, y + n);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator - (const T n) const
-		{
-			return _vec2<T>(x - n, y - n);
-		}
-
-		template<class T> void  _vec2<T>::operator *= (const T n)
-		{
-			x *= n;
-			y *= n;
-		}
-
-		template<class T> void _vec2<T>::operator /= (const T n)
-		{
-			x /= n;
-			y /= n;
-		}
-
-		template<class T> void _vec2<T>::operator += (const T n)
-		{
-			x += n;
-			y += n;
-		}
-
-		template<class T> void _vec2<T>::operator -= (const T n)
-		{
-			x -= n;
-			y -= n;
-		}
-
-		template<class T> bool _vec2<T>::operator == (const _vec2<T>& vec) const
-		{
-			return x == vec.x && y == vec.y;
-		}
-
-		template<class T> bool _vec2<T>::operator == (T f) const
-		{
-			return x == f && y == f;
-		}
-
-		template<class T> bool _vec2<T>::operator != (const _vec2<T>& vec) const
-		{
-			return x != vec.x || y != vec.y;
-		}
-
-		template<class T> bool _vec2<T>::operator != (T f) const
-		{
-			return x != f || y != f;
-		}
-
-		template<class T> _vec2<T>& _vec2<T>::normalize()
-		{
-			matReal lenDivisor = matScalarOne / length();
-			x = T(x * lenDivisor);
-			y = T(y * lenDivisor);
-			return *this;
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator + (const _vec2<T>& vec) const
-		{
-			return _vec2<T>(x + vec.x, y + vec.y);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator - (const _vec2<T>& vec) const
-		{
-			return _vec2<T>(x - vec.x, y - vec.y);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator * (const _vec2<T>& vec) const
-		{
-			return _vec2<T>(x*vec.x, y*vec.y);
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator / (const _vec2<T>& vec) const
-		{
-			return _vec2<T>(x / vec.x, y / vec.y);
-		}
-
-		template<class T> void _vec2<T>::operator += (const _vec2<T>& vec)
-		{
-			x += vec.x;
-			y += vec.y;
-		}
-
-		template<class T> void _vec2<T>::operator -= (const _vec2<T>& vec)
-		{
-			x -= vec.x;
-			y -= vec.y;
-		}
-
-		template<class T> void _vec2<T>::operator *= (const _vec2<T>& vec)
-		{
-			x *= vec.x;
-			y *= vec.y;
-		}
-
-		template<class T> void _vec2<T>::operator /= (const _vec2<T>& vec)
-		{
-			x /= vec.x;
-			y /= vec.y;
-		}
-
-		template<class T> _vec2<T> _vec2<T>::xy() const { return _vec2<T>(x, y); }
-		template<class T> _vec2<T> _vec2<T>::yx() const { return _vec2<T>(y, x); }
-
-		template<class T> void _vec2<T>::reset()
-		{
-			x = 0;
-			y = 0;
-		}
-
-		template<class T> bool _vec2<T>::operator < (const _vec2<T>& vec) const
-		{
-			if (x == vec.x)
-				return y<vec.y;
-			else
-				return x < vec.x;
-		}
-
-		template<class T> bool _vec2<T>::operator <= (const _vec2<T>& vec) const
-		{
-			return *this < vec || *this == vec;
-		}
-
-		template<class T> bool _vec2<T>::operator > (const _vec2<T>& vec) const
-		{
-			if (x == vec.x)
-				return y>vec.y;
-			else
-				return x > vec.x;
-		}
-
-		template<class T> bool _vec2<T>::operator >= (const _vec2<T>& vec) const
-		{
-			return *this > vec || *this == vec;
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator % (const T n) const
-		{
-			return _vec2<T>(x%n, y%n);
-		}
-
-		template<class T> void _vec2<T>::operator %= (const T n)
-		{
-			x %= n;
-			y %= n;
-		}
-
-		template<class T> _vec2<T> _vec2<T>::operator % (const _vec2<T>& vec) const
-		{
-			return _vec2<T>(x%vec.x, y%vec.y);
-		}
-
-		template<class T> void _vec2<T>::operator %= (const _vec2<T>& vec)
-		{
-			x %= vec.x;
-			y %= vec.y;
-		}
-
-
-		template<> _vec2<float> _vec2<float>::operator % (const float n) const
-		{
-			return _vec2<float>((float)fmod(x, n), (float)fmod(y, n));
-		}
-
-		template<> void _vec2<float>::operator %= (const float n)
-		{
-			x = (float)fmod(x, n);
-			y = (float)fmod(y, n);
-		}
-
-		template<> _vec2<float> _vec2<float>::operator % (const _vec2<float>& vec) const
-		{
-			return _vec2<float>((float)fmod(x, vec.x), (float)fmod(y, vec.y));
-		}
-
-		template<> void _vec2<float>::operator %= (const _vec2<float>& vec)
-		{
-			x = (float)fmod(x, vec.x);
-			y = (float)fmod(y, vec.y);
-		}
-
-
-		template<> _vec2<double> _vec2<double>::operator % (const double n) const
-		{
-			return _vec2<double>((double)fmod(x, n), (double)fmod(y, n));
-		}
-
-		template<> void _vec2<double>::operator %= (const double n)
-		{
-			x = (double)fmod(x, n);
-			y = (double)fmod(y, n);
-		}
-
-		template<> _vec2<double> _vec2<double>::operator % (const _vec2<double>& vec) const
-		{
-			return _vec2<double>((double)fmod(x, vec.x), (double)fmod(y, vec.y));
-		}
-
-		template<> void _vec2<double>::operator %= (const _vec2<double>& vec)
-		{
-			x = (double)fmod(x, vec.x);
-			y = (double)fmod(y, vec.y);
-		}
-
-
-		template<class T> _vec3<T>::_vec3()
-		{
-			reset();
-		}
-
-		template<class T> _vec3<T>::_vec3(const T x_, const T y_, const T z_)
-		{
-			x = x_;
-			y = y_;
-			z = z_;
-		}
-
-		template<class T> _vec3<T>::_vec3(const _vec2<T>& v, const T f)
-		{
-			x = v.x;
-			y = v.y;
-			z = f;
-		}
-
-		template<class T> _vec3<T>::_vec3(const T f, const _vec2<T>& v)
-		{
-			x = f;
-			y = v.x;
-			z = v.y;
-		}
-
-		template<class T> T _vec3<T>::lengthSquared() const
-		{
-			return x*x + y*y + z*z;
-		}
-
-		template<class T> matReal _vec3<T>::length() const
-		{
-			return matReal(std::sqrt(x*x + y*y + z*z));
-		}
-
-		template<class T> matReal _vec3<T>::distance(const _vec3<T>& v) const
-		{
-			return matReal(std::sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z)));
-		}
-
-		template<class T> T _vec3<T>::distanceSquared(const _vec3<T>& v) const
-		{
-			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator * (const T n) const
-		{
-			return _vec3<T>(x*n, y*n, z*n);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator / (const T n) const
-		{
-			return _vec3<T>(x / n, y / n, z / n);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator + (const T n) const
-		{
-			return _vec3<T>(x + n, y + n, z + n);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator - (const T n) const
-		{
-			return _vec3<T>(x - n, y - n, z - n);
-		}
-
-		template<class T> void _vec3<T>::operator *= (const T n)
-		{
-			x *= n;
-			y *= n;
-			z *= n;
-		}
-
-		template<class T> void _vec3<T>::operator /= (const T n)
-		{
-			x /= n;
-			y /= n;
-			z /= n;
-		}
-
-		template<class T> void _vec3<T>::operator += (const T n)
-		{
-			x += n;
-			y += n;
-			z += n;
-		}
-
-		template<class T> void _vec3<T>::operator -= (const T n)
-		{
-			x -= n;
-			y -= n;
-			z -= n;
-		}
-
-		template<class T>
-		bool _vec3<T>::operator == (const _vec3<T>& vec) const
-		{
-			return x == vec.x && y == vec.y && z == vec.z;
-		}
-
-		template<class T> bool _vec3<T>::operator == (T f) const
-		{
-			return x == f && y == f && z == f;
-		}
-
-		template<class T> bool _vec3<T>::operator != (const _vec3<T>& vec) const
-		{
-			return x != vec.x || y != vec.y || z != vec.z;
-		}
-
-		template<class T> bool _vec3<T>::operator != (T f) const
-		{
-			return x != f || y != f || z != f;
-		}
-
-		template<class T> _vec3<T>& _vec3<T>::normalize()
-		{
-			matReal lenDivisor = matScalarOne / length();
-			x = T(x * lenDivisor);
-			y = T(y * lenDivisor);
-			z = T(z * lenDivisor);
-			return *this;
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator + (const _vec3<T>& vec) const
-		{
-			return _vec3<T>(x + vec.x, y + vec.y, z + vec.z);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator - (const _vec3<T>& vec) const
-		{
-			return _vec3<T>(x - vec.x, y - vec.y, z - vec.z);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator * (const _vec3<T>& vec) const
-		{
-			return _vec3<T>(x*vec.x, y*vec.y, z*vec.z);
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator / (const _vec3<T>& vec) const
-		{
-			return _vec3<T>(x / vec.x, y / vec.y, z / vec.z);
-		}
-
-		template<class T> void _vec3<T>::operator += (const _vec3<T>& vec)
-		{
-			x += vec.x;
-			y += vec.y;
-			z += vec.z;
-		}
-
-		template<class T> void _vec3<T>::operator -= (const _vec3<T>& vec)
-		{
-			x -= vec.x;
-			y -= vec.y;
-			z -= vec.z;
-		}
-
-		template<class T> void _vec3<T>::operator *= (const _vec3<T>& vec)
-		{
-			x *= vec.x;
-			y *= vec.y;
-			z *= vec.z;
-		}
-
-		template<class T> void _vec3<T>::operator /= (const _vec3<T>& vec)
-		{
-			x /= vec.x;
-			y /= vec.y;
-			z /= vec.z;
-		}
-
-		template<class T> _vec3<T>& _vec3<T>::rotate(const matReal angle, const _vec3<matReal>& axis)
-		{
-			mat4 rotationmat;
-			rotationmat.initRotation(angle, axis);
-
-			*this = (rotationmat*_vec4<T>(*this, 1)).xyz();
-			return *this;
-		}
-
-		template<class T> void _vec3<T>::reset()
-		{
-			x = 0;
-			y = 0;
-			z = 0;
-		}
-
-		template<class T> _vec3<T> _vec3<T>::xyz() const { return _vec3<T>(x, y, z); }
-		template<class T> _vec3<T> _vec3<T>::xzy() const { return _vec3<T>(x, z, y); }
-		template<class T> _vec3<T> _vec3<T>::yxz() const { return _vec3<T>(y, x, z); }
-		template<class T> _vec3<T> _vec3<T>::yzx() const { return _vec3<T>(y, z, x); }
-		template<class T> _vec3<T> _vec3<T>::zxy() const { return _vec3<T>(z, x, y); }
-		template<class T> _vec3<T> _vec3<T>::zyx() const { return _vec3<T>(z, y, x); }
-
-		template<class T> _vec2<T> _vec3<T>::xy() const { return _vec2<T>(x, y); }
-		template<class T> _vec2<T> _vec3<T>::yx() const { return _vec2<T>(y, x); }
-		template<class T> _vec2<T> _vec3<T>::xz() const { return _vec2<T>(x, z); }
-		template<class T> _vec2<T> _vec3<T>::zx() const { return _vec2<T>(z, x); }
-		template<class T> _vec2<T> _vec3<T>::yz() const { return _vec2<T>(y, z); }
-		template<class T> _vec2<T> _vec3<T>::zy() const { return _vec2<T>(z, y); }
-
-
-		template<class T> bool _vec3<T>::operator < (const _vec3<T>& vec) const
-		{
-			if (x == vec.x)
-				if (y == vec.y)
-				return z<vec.z;
-				else
-					return y<vec.y;
-			else
-				return x < vec.x;
-		}
-
-		template<class T> bool _vec3<T>::operator <= (const _vec3<T>& vec) const
-		{
-			return *this < vec || *this == vec;
-		}
-
-		template<class T> bool _vec3<T>::operator > (const _vec3<T>& vec) const
-		{
-			if (x == vec.x)
-				if (y == vec.y)
-				return z>vec.z;
-				else
-					return y>vec.y;
-			else
-				return x > vec.x;
-		}
-
-		template<class T> bool _vec3<T>::operator >= (const _vec3<T>& vec) const
-		{
-			return *this > vec || *this == vec;
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator % (const T n) const
-		{
-			return _vec3<T>(x%n, y%n, z%n);
-		}
-
-		template<class T> void _vec3<T>::operator %= (const T n)
-		{
-			x %= n;
-			y %= n;
-			z %= n;
-		}
-
-		template<class T> _vec3<T> _vec3<T>::operator % (const _vec3<T>& vec) const
-		{
-			return _vec3<T>(x%vec.x, y%vec.y, z%vec.z);
-		}
-
-		template<class T> void _vec3<T>::operator %= (const _vec3<T>& vec)
-		{
-			x %= vec.x;
-			y %= vec.y;
-			z %= vec.z;
-		}
-
-
-		template<> _vec3<float> _vec3<float>::operator % (const float n) const
-		{
-			return _vec3<float>((float)fmod(x, n), (float)fmod(y, n), (float)fmod(z, n));
-		}
-
-		template<> void _vec3<float>::operator %= (const float n)
-		{
-			x = (float)fmod(x, n);
-			y = (float)fmod(y, n);
-			z = (float)fmod(z, n);
-		}
-
-		template<> _vec3<float> _vec3<float>::operator % (const _vec3<float>& vec) const
-		{
-			return _vec3<float>((float)fmod(x, vec.x), (float)fmod(y, vec.y), (float)fmod(z, vec.z));
-		}
-
-		template<> void _vec3<float>::operator %= (const _vec3<float>& vec)
-		{
-			x = (float)fmod(x, vec.x);
-			y = (float)fmod(y, vec.y);
-			z = (float)fmod(z, vec.z);
-		}
-
-
-		template<> _vec3<double> _vec3<double>::operator % (const double n) const
-		{
-			return _vec3<double>((double)fmod(x, n), (double)fmod(y, n), (double)fmod(z, n));
-		}
-
-		template<> void _vec3<double>::operator %= (const double n)
-		{
-			x = (double)fmod(x, n);
-			y = (double)fmod(y, n);
-			z = (double)fmod(z, n);
-		}
-
-		template<> _vec3<double> _vec3<double>::operator % (const _vec3<double>& vec) const
-		{
-			return _vec3<double>((double)fmod(x, vec.x), (double)fmod(y, vec.y), (double)fmod(z, vec.z));
-		}
-
-		template<> void _vec3<double>::operator %= (const _vec3<double>& vec)
-		{
-			x = (double)fmod(x, vec.x);
-			y = (double)fmod(y, vec.y);
-			z = (double)fmod(z, vec.z);
-		}
-
-
-
-
-
-		template<class T> _vec4<T>::_vec4()
-		{
-			reset();
-		}
-
-		template<class T> _vec4<T>::_vec4(const T x_, const T y_, const T z_, const T w_)
-		{
-			x = x_;
-			y = y_;
-			z = z_;
-			w = w_;
-		}
-
-		template<class T> _vec4<T>::_vec4(const _vec2<T>& v1, const _vec2<T>& v2)
-		{
-			x = v1.x;
-			y = v1.y;
-			z = v2.x;
-			w = v2.y;
-		}
-
-		template<class T> _vec4<T>::_vec4(const T f1, const T f2, const _vec2<T>& v)
-		{
-			x = f1;
-			y = f2;
-			z = v.x;
-			w = v.y;
-		}
-
-		template<class T> _vec4<T>::_vec4(const _vec2<T>& v, const T f1, const T f2)
-		{
-			x = v.x;
-			y = v.y;
-			z = f1;
-			w = f2;
-		}
-
-		template<class T> _vec4<T>::_vec4(const T f1, const _vec2<T>& v, const T f2)
-		{
-			x = f1;
-			y = v.x;
-			z = v.y;
-			w = f2;
-		}
-
-		template<class T> _vec4<T>::_vec4(const _vec3<T>& v, const T f)
-		{
-			x = v.x;
-			y = v.y;
-			z = v.z;
-			w = f;
-		}
-
-		template<class T> _vec4<T>::_vec4(const T f, const _vec3<T>& v)
-		{
-			x = f;
-			y = v.x;
-			z = v.y;
-			w = v.z;
-		}
-
-		template<class T> T _vec4<T>::lengthSquared() const
-		{
-			return x*x + y*y + z*z + w*w;
-		}
-
-		template<class T> matReal _vec4<T>::length() const
-		{
-			return matReal(std::sqrt(x*x + y*y + z*z + w*w));
-		}
-
-		template<class T>
-		matReal _vec4<T>::distance(const _vec4<T>& v) const
-		{
-			return matReal(sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z) + (w - v.w)*(w - v.w)));
-		}
-
-		template<class T> T _vec4<T>::distanceSquared(const _vec4<T>& v) const
-		{
-			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z) + (w - v.w)*(w - v.w);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator * (const T n) const
-		{
-			return _vec4<T>(x*n, y*n, z*n, w*n);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator / (const T n) const
-		{
-			return _vec4<T>(x / n, y / n, z / n, w / n);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator + (const T n) const
-		{
-			return _vec4<T>(x + n, y + n, z + n, w + n);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator - (const T n) const
-		{
-			return _vec4<T>(x - n, y - n, z - n, w - n);
-		}
-
-		template<class T> void _vec4<T>::operator *= (const T n)
-		{
-			x *= n;
-			y *= n;
-			z *= n;
-			w *= n;
-		}
-
-		template<class T> void  _vec4<T>::operator /= (const T n)
-		{
-			x /= n;
-			y /= n;
-			z /= n;
-			w /= n;
-		}
-
-		template<class T> void  _vec4<T>::operator += (const T n)
-		{
-			x += n;
-			y += n;
-			z += n;
-			w += n;
-		}
-
-		template<class T> void  _vec4<T>::operator -= (const T n)
-		{
-			x -= n;
-			y -= n;
-			z -= n;
-			w -= n;
-		}
-
-		template<class T> bool _vec4<T>::operator == (const _vec4<T>& vec) const
-		{
-			return x == vec.x && y == vec.y && z == vec.z && w == vec.w;
-		}
-
-		template<class T> bool _vec4<T>::operator == (T f) const
-		{
-			return x == f && y == f &&z == f && w == f;
-		}
-
-		template<class T> bool _vec4<T>::operator != (const _vec4<T>& vec) const
-		{
-			return x != vec.x || y != vec.y || z != vec.z || w != vec.w;
-		}
-
-		template<class T> bool _vec4<T>::operator != (T f) const
-		{
-			return x != f || y != f || z != f || w != f;
-		}
-
-		template<class T> _vec4<T>& _vec4<T>::normalize()
-		{
-			matReal lenDivisor = matScalarOne / length();
-			x = T(x * lenDivisor);
-			y = T(y * lenDivisor);
-			z = T(z * lenDivisor);
-			w = T(w * lenDivisor);
-			return *this;
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator + (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(x + vec.x, y + vec.y, z + vec.z, w + vec.w);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator - (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(x - vec.x, y - vec.y, z - vec.z, w - vec.w);
-		}
-
-		template<class T>
-		_vec4<T> _vec4<T>::operator * (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(x*vec.x, y*vec.y, z*vec.z, w*vec.w);
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator / (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(x / vec.x, y / vec.y, z / vec.z, w / vec.w);
-		}
-
-		template<class T> void _vec4<T>::operator += (const _vec4<T>& vec)
-		{
-			x += vec.x;
-			y += vec.y;
-			z += vec.z;
-			w += vec.w;
-		}
-		template<class T> void _vec4<T>::operator -= (const _vec4<T>& vec)
-		{
-			x -= vec.x;
-			y -= vec.y;
-			z -= vec.z;
-			w -= vec.w;
-		}
-
-		template<class T> void _vec4<T>::operator *= (const _vec4<T>& vec)
-		{
-			x *= vec.x;
-			y *= vec.y;
-			z *= vec.z;
-			w *= vec.w;
-		}
-
-		template<class T> void _vec4<T>::operator /= (const _vec4<T>& vec)
-		{
-			x /= vec.x;
-			y /= vec.y;
-			z /= vec.z;
-			w /= vec.w;
-		}
-
-		template<class T> void _vec4<T>::reset()
-		{
-			x = 0;
-			y = 0;
-			z = 0;
-			w = 0;
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator % (const T n) const
-		{
-			return _vec4<T>(x%n, y%n, z%n, w%n);
-		}
-
-		template<class T> void _vec4<T>::operator %= (const T n)
-		{
-			x %= n;
-			y %= n;
-			z %= n;
-			w %= n;
-		}
-
-		template<class T> _vec4<T> _vec4<T>::operator % (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(x%vec.x, y%vec.y, z%vec.z, w%vec.w);
-		}
-
-		template<class T> void _vec4<T>::operator %= (const _vec4<T>& vec)
-		{
-			x %= vec.x;
-			y %= vec.y;
-			z %= vec.z;
-			w %= vec.w;
-		}
-
-
-
-		template<> _vec4<float> _vec4<float>::operator % (const float n) const
-		{
-			return _vec4<float>((float)fmod(x, n), (float)fmod(y, n), (float)fmod(z, n), (float)fmod(w, n));
-		}
-
-		template<> void _vec4<float>::operator %= (const float n)
-		{
-			x = (float)fmod(x, n);
-			y = (float)fmod(y, n);
-			z = (float)fmod(z, n);
-			w = (float)fmod(w, n);
-		}
-
-		template<> _vec4<float> _vec4<float>::operator % (const _vec4<float>& vec) const
-		{
-			return _vec4<float>((float)fmod(x, vec.x), (float)fmod(y, vec.y), (float)fmod(z, vec.z), (float)fmod(w, vec.w));
-		}
-
-		template<> void _vec4<float>::operator %= (const _vec4<float>& vec)
-		{
-			x = (float)fmod(x, vec.x);
-			y = (float)fmod(y, vec.y);
-			z = (float)fmod(z, vec.z);
-			w = (float)fmod(w, vec.w);
-		}
-
-
-		template<> _vec4<double> _vec4<double>::operator % (const double n) const
-		{
-			return _vec4<double>((double)fmod(x, n), (double)fmod(y, n), (double)fmod(z, n), (double)fmod(w, n));
-		}
-
-		template<> void _vec4<double>::operator %= (const double n)
-		{
-			x = (double)fmod(x, n);
-			y = (double)fmod(y, n);
-			z = (double)fmod(z, n);
-			w = (double)fmod(w, n);
-		}
-
-		template<> _vec4<double> _vec4<double>::operator % (const _vec4<double>& vec) const
-		{
-			return _vec4<double>((double)fmod(x, vec.x), (double)fmod(y, vec.y), (double)fmod(z, vec.z), (double)fmod(w, vec.w));
-		}
-
-		template<> void _vec4<double>::operator %= (const _vec4<double>& vec)
-		{
-			x = (double)fmod(x, vec.x);
-			y = (double)fmod(y, vec.y);
-			z = (double)fmod(z, vec.z);
-			w = (double)fmod(w, vec.w);
-		}
-
-
-
-
-
-		template<class T> _vec4<T> _vec4<T>::xyzw() const { return _vec4<T>(x, y, z, w); }
-		template<class T> _vec4<T> _vec4<T>::xywz() const { return _vec4<T>(x, y, w, z); }
-		template<class T> _vec4<T> _vec4<T>::xzwy() const { return _vec4<T>(x, z, w, y); }
-		template<class T> _vec4<T> _vec4<T>::xzyw() const { return _vec4<T>(x, z, y, w); }
-		template<class T> _vec4<T> _vec4<T>::xwzy() const { return _vec4<T>(x, w, z, y); }
-		template<class T> _vec4<T> _vec4<T>::xwyz() const { return _vec4<T>(x, w, y, z); }
-		template<class T> _vec4<T> _vec4<T>::yxzw() const { return _vec4<T>(y, x, z, w); }
-		template<class T> _vec4<T> _vec4<T>::yxwz() const { return _vec4<T>(y, x, w, z); }
-		template<class T> _vec4<T> _vec4<T>::yzwx() const { return _vec4<T>(y, z, w, x); }
-		template<class T> _vec4<T> _vec4<T>::yzxw() const { return _vec4<T>(y, z, x, w); }
-		template<class T> _vec4<T> _vec4<T>::ywzx() const { return _vec4<T>(y, w, z, x); }
-		template<class T> _vec4<T> _vec4<T>::ywxz() const { return _vec4<T>(y, w, x, z); }
-		template<class T> _vec4<T> _vec4<T>::zyxw() const { return _vec4<T>(z, y, x, w); }
-		template<class T> _vec4<T> _vec4<T>::zywx() const { return _vec4<T>(z, y, w, x); }
-		template<class T> _vec4<T> _vec4<T>::zxwy() const { return _vec4<T>(z, x, w, y); }
-		template<class T> _vec4<T> _vec4<T>::zxyw() const { return _vec4<T>(z, x, y, w); }
-		template<class T> _vec4<T> _vec4<T>::zwxy() const { return _vec4<T>(z, w, x, y); }
-		template<class T> _vec4<T> _vec4<T>::zwyx() const { return _vec4<T>(z, w, y, x); }
-		template<class T> _vec4<T> _vec4<T>::wyzx() const { return _vec4<T>(w, y, z, x); }
-		template<class T> _vec4<T> _vec4<T>::wyxz() const { return _vec4<T>(w, y, x, z); }
-		template<class T> _vec4<T> _vec4<T>::wzxy() const { return _vec4<T>(w, z, x, y); }
-		template<class T> _vec4<T> _vec4<T>::wzyx() const { return _vec4<T>(w, z, y, x); }
-		template<class T> _vec4<T> _vec4<T>::wxzy() const { return _vec4<T>(w, x, z, y); }
-		template<class T> _vec4<T> _vec4<T>::wxyz() const { return _vec4<T>(w, x, y, z); }
-
-		template<class T> _vec3<T> _vec4<T>::xyz() const { return _vec3<T>(x, y, z); }
-		template<class T> _vec3<T> _vec4<T>::xzy() const { return _vec3<T>(x, z, y); }
-		template<class T> _vec3<T> _vec4<T>::yxz() const { return _vec3<T>(y, x, z); }
-		template<class T> _vec3<T> _vec4<T>::yzx() const { return _vec3<T>(y, z, x); }
-		template<class T> _vec3<T> _vec4<T>::zxy() const { return _vec3<T>(z, x, y); }
-		template<class T> _vec3<T> _vec4<T>::zyx() const { return _vec3<T>(z, y, x); }
-		template<class T> _vec3<T> _vec4<T>::wyz() const { return _vec3<T>(w, y, z); }
-		template<class T> _vec3<T> _vec4<T>::wzy() const { return _vec3<T>(w, z, y); }
-		template<class T> _vec3<T> _vec4<T>::ywz() const { return _vec3<T>(y, w, z); }
-		template<class T> _vec3<T> _vec4<T>::yzw() const { return _vec3<T>(y, z, w); }
-		template<class T> _vec3<T> _vec4<T>::zwy() const { return _vec3<T>(z, w, y); }
-		template<class T> _vec3<T> _vec4<T>::zyw() const { return _vec3<T>(z, y, w); }
-		template<class T> _vec3<T> _vec4<T>::xyw() const { return _vec3<T>(x, y, w); }
-		template<class T> _vec3<T> _vec4<T>::xwy() const { return _vec3<T>(x, w, y); }
-		template<class T> _vec3<T> _vec4<T>::yxw() const { return _vec3<T>(y, x, w); }
-		template<class T> _vec3<T> _vec4<T>::ywx() const { return _vec3<T>(y, w, x); }
-		template<class T> _vec3<T> _vec4<T>::wxy() const { return _vec3<T>(w, x, y); }
-		template<class T> _vec3<T> _vec4<T>::wyx() const { return _vec3<T>(w, y, x); }
-		template<class T> _vec3<T> _vec4<T>::xwz() const { return _vec3<T>(x, w, z); }
-		template<class T> _vec3<T> _vec4<T>::xzw() const { return _vec3<T>(x, z, w); }
-		template<class T> _vec3<T> _vec4<T>::wxz() const { return _vec3<T>(w, x, z); }
-		template<class T> _vec3<T> _vec4<T>::wzx() const { return _vec3<T>(w, z, x); }
-		template<class T> _vec3<T> _vec4<T>::zxw() const { return _vec3<T>(z, x, w); }
-		template<class T> _vec3<T> _vec4<T>::zwx() const { return _vec3<T>(z, w, x); }
-
-		template<class T> _vec2<T> _vec4<T>::xy() const { return _vec2<T>(x, y); }
-		template<class T> _vec2<T> _vec4<T>::yx() const { return _vec2<T>(y, x); }
-		template<class T> _vec2<T> _vec4<T>::xz() const { return _vec2<T>(x, z); }
-		template<class T> _vec2<T> _vec4<T>::zx() const { return _vec2<T>(z, x); }
-		template<class T> _vec2<T> _vec4<T>::xw() const { return _vec2<T>(x, w); }
-		template<class T> _vec2<T> _vec4<T>::wx() const { return _vec2<T>(w, x); }
-		template<class T> _vec2<T> _vec4<T>::yz() const { return _vec2<T>(y, z); }
-		template<class T> _vec2<T> _vec4<T>::zy() const { return _vec2<T>(z, y); }
-		template<class T> _vec2<T> _vec4<T>::wz() const { return _vec2<T>(w, z); }
-		template<class T> _vec2<T> _vec4<T>::zw() const { return _vec2<T>(z, w); }
-
-
-		template<class T> bool _vec4<T>::operator < (const _vec4<T>& vec) const
-		{
-			if (x == vec.x)
-				if (y == vec.y)
-				if (z == vec.z)
-				return w<vec.w;
-				else
-					return z<vec.z;
-				else
-					return y<vec.y;
-			else
-				return x < vec.x;
-		}
-
-		template<class T> bool _vec4<T>::operator <= (const _vec4<T>& vec) const
-		{
-			return *this < vec || *this == vec;
-		}
-
-		template<class T> bool _vec4<T>::operator > (const _vec4<T>& vec) const
-		{
-			if (x == vec.x)
-				if (y == vec.y)
-				if (z == vec.z)
-				return w<vec.w;
-				else
-					return z<vec.z;
-				else
-					return y<vec.y;
-			else
-				return x < vec.x;
-		}
-
-		template<class T> bool _vec4<T>::operator >= (const _vec4<T>& vec) const
-		{
-			return *this > vec || *this == vec;
-		}
-
-
-		_mat4::_mat4()
-		{
-			reset();
-		}
-
-		_mat4::_mat4(const matReal n)
-		{
-			reset();
-			m[0][0] = n; m[1][1] = n;
-			m[2][2] = n; m[3][3] = n;
-		}
-
-		_mat4::_mat4(const matReal m00, const matReal m10, const matReal m20, const matReal m30,
-			const matReal m01, const matReal m11, const matReal m21, const matReal m31,
-			const matReal m02, const matReal m12, const matReal m22, const matReal m32,
-			const matReal m03, const matReal m13, const matReal m23, const matReal m33)
-		{
-			m[0][0] = m00; m[0][1] = m01; m[0][2] = m02; m[0][3] = m03;
-			m[1][0] = m10; m[1][1] = m11; m[1][2] = m12; m[1][3] = m13;
-			m[2][0] = m20; m[2][1] = m21; m[2][2] = m22; m[2][3] = m23;
-			m[3][0] = m30; m[3][1] = m31; m[3][2] = m32; m[3][3] = m33;
-		}
-
-		void _mat4::reset()
-		{
-			m[0][0] = 1; m[0][1] = 0; m[0][2] = 0; m[0][3] = 0;
-			m[1][0] = 0; m[1][1] = 1; m[1][2] = 0; m[1][3] = 0;
-			m[2][0] = 0; m[2][1] = 0; m[2][2] = 1; m[2][3] = 0;
-			m[3][0] = 0; m[3][1] = 0; m[3][2] = 0; m[3][3] = 1;
-		}
-
-		_mat4 _mat4::operator * (const _mat4& p) const
-		{
-			return _mat4(
-				m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2] + m[3][0] * p.m[0][3],
-				m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2] + m[3][0] * p.m[1][3],
-				m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2] + m[3][0] * p.m[2][3],
-				m[0][0] * p.m[3][0] + m[1][0] * p.m[3][1] + m[2][0] * p.m[3][2] + m[3][0] * p.m[3][3],
-				m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2] + m[3][1] * p.m[0][3],
-				m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2] + m[3][1] * p.m[1][3],
-				m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2] + m[3][1] * p.m[2][3],
-				m[0][1] * p.m[3][0] + m[1][1] * p.m[3][1] + m[2][1] * p.m[3][2] + m[3][1] * p.m[3][3],
-				m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2] + m[3][2] * p.m[0][3],
-				m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2] + m[3][2] * p.m[1][3],
-				m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2] + m[3][2] * p.m[2][3],
-				m[0][2] * p.m[3][0] + m[1][2] * p.m[3][1] + m[2][2] * p.m[3][2] + m[3][2] * p.m[3][3],
-				m[0][3] * p.m[0][0] + m[1][3] * p.m[0][1] + m[2][3] * p.m[0][2] + m[3][3] * p.m[0][3],
-				m[0][3] * p.m[1][0] + m[1][3] * p.m[1][1] + m[2][3] * p.m[1][2] + m[3][3] * p.m[1][3],
-				m[0][3] * p.m[2][0] + m[1][3] * p.m[2][1] + m[2][3] * p.m[2][2] + m[3][3] * p.m[2][3],
-				m[0][3] * p.m[3][0] + m[1][3] * p.m[3][1] + m[2][3] * p.m[3][2] + m[3][3] * p.m[3][3]);
-		}
-
-		template<class T>
-		_vec4<T> _mat4::operator* (const _vec4<T>& vec) const
-		{
-			return _vec4<T>(
-				T(m[0][0] * vec.x + m[1][0] * vec.y + m[2][0] * vec.z + m[3][0] * vec.w),
-				T(m[0][1] * vec.x + m[1][1] * vec.y + m[2][1] * vec.z + m[3][1] * vec.w),
-				T(m[0][2] * vec.x + m[1][2] * vec.y + m[2][2] * vec.z + m[3][2] * vec.w),
-				T(m[0][3] * vec.x + m[1][3] * vec.y + m[2][3] * vec.z + m[3][3] * vec.w));
-		}
-
-		_mat4 _mat4::operator* (const matReal n) const
-		{
-			return _mat4(
-				m[0][0] * n, m[0][1] * n, m[0][2] * n, m[0][3] * n,
-				m[1][0] * n, m[1][1] * n, m[1][2] * n, m[1][3] * n,
-				m[2][0] * n, m[2][1] * n, m[2][2] * n, m[2][3] * n,
-				m[3][0] * n, m[3][1] * n, m[3][2] * n, m[3][3] * n);
-		}
-
-		_mat4 _mat4::operator+ (const mat4& p) const
-		{
-			return _mat4(
-				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1],
-				m[0][2] + p.m[0][2], m[0][3] + p.m[0][3],
-				m[1][0] + p.m[1][0], m[1][1] + p.m[1][1],
-				m[1][2] + p.m[1][2], m[1][3] + p.m[1][3],
-				m[2][0] + p.m[2][0], m[2][1] + p.m[2][1],
-				m[2][2] + p.m[2][2], m[2][3] + p.m[2][3],
-				m[3][0] + p.m[3][0], m[3][1] + p.m[3][1],
-				m[3][2] + p.m[3][2], m[3][3] + p.m[3][3]);
-		}
-
-		_mat4 _mat4::operator- (const mat4& p) const
-		{
-			return _mat4(
-				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1],
-				m[0][2] - p.m[0][2], m[0][3] - p.m[0][3],
-				m[1][0] - p.m[1][0], m[1][1] - p.m[1][1],
-				m[1][2] - p.m[1][2], m[1][3] - p.m[1][3],
-				m[2][0] - p.m[2][0], m[2][1] - p.m[2][1],
-				m[2][2] - p.m[2][2], m[2][3] - p.m[2][3],
-				m[3][0] - p.m[3][0], m[3][1] - p.m[3][1],
-				m[3][2] - p.m[3][2], m[3][3] - p.m[3][3]);
-		}
-
-		_mat4 _mat4::operator / (const matReal n) const
-		{
-			return _mat4(
-				m[0][0] / n, m[0][1] / n, m[0][2] / n, m[0][3] / n,
-				m[1][0] / n, m[1][1] / n, m[1][2] / n, m[1][3] / n,
-				m[2][0] / n, m[2][1] / n, m[2][2] / n, m[2][3] / n,
-				m[3][0] / n, m[3][1] / n, m[3][2] / n, m[3][3] / n);
-		}
-
-		_mat4 _mat4::operator+ (const matReal n) const
-		{
-			return _mat4(
-				m[0][0] + n, m[0][1] + n, m[0][2] + n, m[0][3] + n,
-				m[1][0] + n, m[1][1] + n, m[1][2] + n, m[1][3] + n,
-				m[2][0] + n, m[2][1] + n, m[2][2] + n, m[2][3] + n,
-				m[3][0] + n, m[3][1] + n, m[3][2] + n, m[3][3] + n);
-		}
-
-		_mat4 _mat4::operator- (const matReal n) const
-		{
-			return _mat4(
-				m[0][0] - n, m[0][1] - n, m[0][2] - n, m[0][3] - n,
-				m[1][0] - n, m[1][1] - n, m[1][2] - n, m[1][3] - n,
-				m[2][0] - n, m[2][1] - n, m[2][2] - n, m[2][3] - n,
-				m[3][0] - n, m[3][1] - n, m[3][2] - n, m[3][3] - n);
-		}
-
-		void _mat4::operator *= (const _mat4& p)
-		{
-			matReal t1, t2, t3, t4;
-			t1 = m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2] + m[3][0] * p.m[0][3];
-			t2 = m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2] + m[3][0] * p.m[1][3];
-			t3 = m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2] + m[3][0] * p.m[2][3];
-			t4 = m[0][0] * p.m[3][0] + m[1][0] * p.m[3][1] + m[2][0] * p.m[3][2] + m[3][0] * p.m[3][3];
-			m[0][0] = t1; m[1][0] = t2; m[2][0] = t3; m[3][0] = t4;
-			t1 = m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2] + m[3][1] * p.m[0][3];
-			t2 = m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2] + m[3][1] * p.m[1][3];
-			t3 = m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2] + m[3][1] * p.m[2][3];
-			t4 = m[0][1] * p.m[3][0] + m[1][1] * p.m[3][1] + m[2][1] * p.m[3][2] + m[3][1] * p.m[3][3];
-			m[0][1] = t1; m[1][1] = t2; m[2][1] = t3; m[3][1] = t4;
-			t1 = m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2] + m[3][2] * p.m[0][3];
-			t2 = m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2] + m[3][2] * p.m[1][3];
-			t3 = m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2] + m[3][2] * p.m[2][3];
-			t4 = m[0][2] * p.m[3][0] + m[1][2] * p.m[3][1] + m[2][2] * p.m[3][2] + m[3][2] * p.m[3][3];
-			m[0][2] = t1; m[1][2] = t2; m[2][2] = t3; m[3][2] = t4;
-			t1 = m[0][3] * p.m[0][0] + m[1][3] * p.m[0][1] + m[2][3] * p.m[0][2] + m[3][3] * p.m[0][3];
-			t2 = m[0][3] * p.m[1][0] + m[1][3] * p.m[1][1] + m[2][3] * p.m[1][2] + m[3][3] * p.m[1][3];
-			t3 = m[0][3] * p.m[2][0] + m[1][3] * p.m[2][1] + m[2][3] * p.m[2][2] + m[3][3] * p.m[2][3];
-			t4 = m[0][3] * p.m[3][0] + m[1][3] * p.m[3][1] + m[2][3] * p.m[3][2] + m[3][3] * p.m[3][3];
-			m[0][3] = t1; m[1][3] = t2; m[2][3] = t3; m[3][3] = t4;
-		}
-
-		void _mat4::operator *= (const matReal n)
-		{
-			m[0][0] *= n; m[0][1] *= n; m[0][2] *= n; m[0][3] *= n;
-			m[1][0] *= n; m[1][1] *= n; m[1][2] *= n; m[1][3] *= n;
-			m[2][0] *= n; m[2][1] *= n; m[2][2] *= n; m[2][3] *= n;
-			m[3][0] *= n; m[3][1] *= n; m[3][2] *= n; m[3][3] *= n;
-		}
+/*
+The heavy, rarely called parts of the math library. Everything else is defined inline in matrixd.inl.
+*/
 
-		void _mat4::operator /= (const matReal n)
-		{
-			m[0][0] /= n; m[0][1] /= n; m[0][2] /= n; m[0][3] /= n;
-			m[1][0] /= n; m[1][1] /= n; m[1][2] /= n; m[1][3] /= n;
-			m[2][0] /= n; m[2][1] /= n; m[2][2] /= n; m[2][3] /= n;
-			m[3][0] /= n; m[3][1] /= n; m[3][2] /= n; m[3][3] /= n;
-		}
-
-		void _mat4::operator += (const _mat4& p)
-		{
-			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1];
-			m[0][2] += p.m[0][2]; m[0][3] += p.m[0][3];
-			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1];
-			m[1][2] += p.m[1][2]; m[1][3] += p.m[1][3];
-			m[2][0] += p.m[2][0]; m[2][1] += p.m[2][1];
-			m[2][2] += p.m[2][2]; m[2][3] += p.m[2][3];
-			m[3][0] += p.m[3][0]; m[3][1] += p.m[3][1];
-			m[3][2] += p.m[3][2]; m[3][3] += p.m[3][3];
-		}
-
-		void _mat4::operator += (const matReal n)
-		{
-			m[0][0] += n; m[0][1] += n; m[0][2] += n; m[0][3] += n;
-			m[1][0] += n; m[1][1] += n; m[1][2] += n; m[1][3] += n;
-			m[2][0] += n; m[2][1] += n; m[2][2] += n; m[2][3] += n;
-			m[3][0] += n; m[3][1] += n; m[3][2] += n; m[3][3] += n;
-		}
-
-		void _mat4::operator  -= (const _mat4& p)
+namespace math
+{
+	namespace tmp
+	{
+		template<class T> _vec3<T>& _vec3<T>::rotate(const matReal angle, const _vec3<matReal>& axis)
 		{
-			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1];
-			m[0][2] -= p.m[0][2]; m[0][3] -= p.m[0][3];
-			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1];
-			m[1][2] -= p.m[1][2]; m[1][3] -= p.m[1][3];
-			m[2][0] -= p.m[2][0]; m[2][1] -= p.m[2][1];
-			m[2][2] -= p.m[2][2]; m[2][3] -= p.m[2][3];
-			m[3][0] -= p.m[3][0]; m[3][1] -= p.m[3][1];
-			m[3][2] -= p.m[3][2]; m[3][3] -= p.m[3][3];
-		}
+			mat4 rotationmat;
+			rotationmat.initRotation(angle, axis);
 
-		void _mat4::operator  -= (const matReal n)
-		{
-			m[0][0] -= n; m[0][1] -= n; m[0][2] -= n; m[0][3] -= n;
-			m[1][0] -= n; m[1][1] -= n; m[1][2] -= n; m[1][3] -= n;
-			m[2][0] -= n; m[2][1] -= n; m[2][2] -= n; m[2][3] -= n;
-			m[3][0] -= n; m[3][1] -= n; m[3][2] -= n; m[3][3] -= n;
+			*this = (rotationmat*_vec4<T>(*this, 1)).xyz();
+			return *this;
 		}
 
 		_mat4& _mat4::initRotation(const matReal angle, const matReal x,
@@ -1260,74 +43,6 @@ namespace math
 			return *this;
 		}
 
-		bool _mat4::operator == (const _mat4& p) const
-		{
-			return
-				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] &&
-				m[0][2] == p.m[0][2] && m[0][3] == p.m[0][3] &&
-				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1] &&
-				m[1][2] == p.m[1][2] && m[1][3] == p.m[1][3] &&
-				m[2][0] == p.m[2][0] && m[2][1] == p.m[2][1] &&
-				m[2][2] == p.m[2][2] && m[2][3] == p.m[2][3] &&
-				m[3][0] == p.m[3][0] && m[3][1] == p.m[3][1] &&
-				m[3][2] == p.m[3][2] && m[3][3] == p.m[3][3];
-		}
-
-		bool _mat4::operator != (const _mat4& p) const
-		{
-			return
-				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] ||
-				m[0][2] != p.m[0][2] || m[0][3] != p.m[0][3] ||
-				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1] ||
-				m[1][2] != p.m[1][2] || m[1][3] != p.m[1][3] ||
-				m[2][0] != p.m[2][0] || m[2][1] != p.m[2][1] ||
-				m[2][2] != p.m[2][2] || m[2][3] != p.m[2][3] ||
-				m[3][0] != p.m[3][0] || m[3][1] != p.m[3][1] ||
-				m[3][2] != p.m[3][2] || m[3][3] != p.m[3][3];
-		}
-
-		_mat4& _mat4::initTranslation(const matReal x, const matReal y, const matReal z)
-		{
-			reset();
-			m[3][0] = x;
-			m[3][1] = y;
-			m[3][2] = z;
-			return *this;
-		}
-
-		_mat4& _mat4::initScale(const matReal x, const matReal y, const matReal z)
-		{
-			reset();
-			m[0][0] = x;
-			m[1][1] = y;
-			m[2][2] = z;
-			return *this;
-		}
-
-		_mat4& _mat4::initScale(const matReal s)
-		{
-			reset();
-			m[0][0] = s;
-			m[1][1] = s;
-			m[2][2] = s;
-			return *this;
-		}
-
-		_mat4& mat4::initRotation(matReal angle, const vec3& axis)
-		{
-			return initRotation(angle, axis.x, axis.y, axis.z);
-		}
-
-		_mat4& _mat4::initTranslation(vec3& trans)
-		{
-			return initTranslation(trans.x, trans.y, trans.z);
-		}
-
-		_mat4& _mat4::initScale(vec3& scale)
-		{
-			return initScale(scale.x, scale.y, scale.z);
-		}
-
 		_mat4& _mat4::initProjection(const matReal fov, const matReal width,
 			const matReal height, const matReal znear, const matReal zfar)
 		{
@@ -1359,201 +74,109 @@ namespace math
 			return *this;
 		}
 
-		_mat4 _mat4::getTranspose()
-		{
-			return _mat4(m[0][0], m[0][1], m[0][2], m[0][3],
-				m[1][0], m[1][1], m[1][2], m[1][3],
-				m[2][0], m[2][1], m[2][2], m[2][3],
-				m[3][0], m[3][1], m[3][2], m[3][3]);
-		}
-
-		_mat3::_mat3()
-		{
-			reset();
-		}
-
-		_mat3::_mat3(const matReal n)
-		{
-			reset();
-			m[0][0] = n;
-			m[1][1] = n;
-			m[2][2] = n;
-		}
-
-		_mat3::_mat3(const matReal m00, const matReal m10, const matReal m20,
-			const matReal m01, const matReal m11, const matReal m21,
-			const matReal m02, const matReal m12, const matReal m22)
-		{
-			m[0][0] = m00; m[0][1] = m01; m[0][2] = m02;
-			m[1][0] = m10; m[1][1] = m11; m[1][2] = m12;
-			m[2][0] = m20; m[2][1] = m21; m[2][2] = m22;
-		}
-
-		void _mat3::reset()
+		namespace
 		{
-			m[0][0] = 1; m[0][1] = 0; m[0][2] = 0;
-			m[1][0] = 0; m[1][1] = 1; m[1][2] = 0;
-			m[2][0] = 0; m[2][1] = 0; m[2][2] = 1;
-		}
-
-		_mat3 _mat3::operator * (const _mat3& p) const
-		{
-			return _mat3(
-				m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2],
-				m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2],
-				m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2],
-
-				m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2],
-				m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2],
-				m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2],
-
-				m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2],
-				m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2],
-				m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2]);
-		}
-
-		vec3 _mat3::operator* (const vec3& vec) const
-		{
-			return vec3(
-				m[0][0] * vec.x + m[1][0] * vec.y + m[2][0] * vec.z,
-				m[0][1] * vec.x + m[1][1] * vec.y + m[2][1] * vec.z,
-				m[0][2] * vec.x + m[1][2] * vec.y + m[2][2] * vec.z);
-		}
-
-		_mat3 _mat3::operator* (const matReal n) const
-		{
-			return _mat3(
-				m[0][0] * n, m[0][1] * n, m[0][2] * n,
-				m[1][0] * n, m[1][1] * n, m[1][2] * n,
-				m[2][0] * n, m[2][1] * n, m[2][2] * n);
-		}
+			/**Writes the cofactor matrix of the 3x3 part of an affine matrix (columns of the given stride) to cof,
+			as m[column][row], and returns the determinant.*/
+			matReal cofactors3x3(const matReal* a, int stride, matReal cof[3][3])
+			{
+				//a(column, row):
+				const matReal a00 = a[0], a01 = a[1], a02 = a[2];
+				const matReal a10 = a[stride], a11 = a[stride + 1], a12 = a[stride + 2];
+				const matReal a20 = a[stride * 2], a21 = a[stride * 2 + 1], a22 = a[stride * 2 + 2];
 
-		_mat3 _mat3::operator+ (const _mat3& p) const
-		{
-			return _mat3(
-				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1], m[0][2] + p.m[0][2],
-				m[1][1] + p.m[1][1], m[1][0] + p.m[1][0], m[1][2] + p.m[1][2],
-				m[2][0] + p.m[2][0], m[2][1] + p.m[2][1], m[2][2] + p.m[2][2]);
-		}
+				cof[0][0] = a11 * a22 - a21 * a12;
+				cof[0][1] = a20 * a12 - a10 * a22;
+				cof[0][2] = a10 * a21 - a20 * a11;
+				cof[1][0] = a21 * a02 - a01 * a22;
+				cof[1][1] = a00 * a22 - a20 * a02;
+				cof[1][2] = a20 * a01 - a00 * a21;
+				cof[2][0] = a01 * a12 - a11 * a02;
+				cof[2][1] = a10 * a02 - a00 * a12;
+				cof[2][2] = a00 * a11 - a10 * a01;
 
-		_mat3 _mat3::operator- (const _mat3& p) const
-		{
-			return _mat3(
-				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1], m[0][2] - p.m[0][2],
-				m[1][1] - p.m[1][1], m[1][0] - p.m[1][0], m[1][2] - p.m[1][2],
-				m[2][0] - p.m[2][0], m[2][1] - p.m[2][1], m[2][2] - p.m[2][2]);
+				return a00 * cof[0][0] + a10 * cof[1][0] + a20 * cof[2][0];
+			}
 		}
 
-		_mat3 _mat3::operator / (const matReal n) const
+		_mat4 _mat4::getInverseAffine() const
 		{
-			return _mat3(
-				m[0][0] / n, m[0][1] / n, m[0][2] / n,
-				m[1][0] / n, m[1][1] / n, m[1][2] / n,
-				m[2][0] / n, m[2][1] / n, m[2][2] / n);
-		}
+			matReal cof[3][3];
+			const matReal det = cofactors3x3(&m[0][0], 4, cof);
+			if (det == 0)
+				return _mat4();
 
-		_mat3 _mat3::operator+ (const matReal n) const
-		{
-			return _mat3(
-				m[0][0] + n, m[0][1] + n, m[0][2] + n,
-				m[1][0] + n, m[1][1] + n, m[1][2] + n,
-				m[2][0] + n, m[2][1] + n, m[2][2] + n);
-		}
+			//The inverse of the 3x3 part is the transposed cofactor matrix over the determinant.
+			const matReal invDet = 1 / det;
+			_mat4 r;
+			for (int c = 0; c < 3; ++c)
+				for (int row = 0; row < 3; ++row)
+					r.m[c][row] = cof[row][c] * invDet;
 
-		_mat3 _mat3::operator- (const matReal n) const
-		{
-			return _mat3(
-				m[0][0] - n, m[0][1] - n, m[0][2] - n,
-				m[1][0] - n, m[1][1] - n, m[1][2] - n,
-				m[2][0] - n, m[2][1] - n, m[2][2] - n);
+			for (int row = 0; row < 3; ++row)
+				r.m[3][row] = -(r.m[0][row] * m[3][0] + r.m[1][row] * m[3][1] + r.m[2][row] * m[3][2]);
+			return r;
 		}
 
-		void _mat3::operator *= (const _mat3& p)
+		_mat4 _mat4::getNormalMatrix() const
 		{
-			matReal t1, t2, t3;
-			t1 = m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2];
-			t2 = m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2];
-			t3 = m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2];
-			m[0][0] = t1; m[1][0] = t2; m[2][0] = t3;
-			t1 = m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2];
-			t2 = m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2];
-			t3 = m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2];
-			m[0][1] = t1; m[1][1] = t2; m[2][1] = t3;
-			t1 = m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2];
-			t2 = m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2];
-			t3 = m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2];
-			m[0][2] = t1; m[1][2] = t2; m[2][2] = t3;
-		}
+			//inverse(A)^T = cofactor(A) / det(A), so no transpose is needed.
+			matReal cof[3][3];
+			const matReal det = cofactors3x3(&m[0][0], 4, cof);
+			if (det == 0)
+				return _mat4();
 
-		void _mat3::operator *= (const matReal n)
-		{
-			m[0][0] *= n; m[0][1] *= n; m[0][2] *= n;
-			m[1][0] *= n; m[1][1] *= n; m[1][2] *= n;
-			m[2][0] *= n; m[2][1] *= n; m[2][2] *= n;
+			const matReal invDet = 1 / det;
+			_mat4 r;
+			for (int c = 0; c < 3; ++c)
+				for (int row = 0; row < 3; ++row)
+					r.m[c][row] = cof[c][row] * invDet;
+			return r;
 		}
 
-		void _mat3::operator /= (const matReal n)
+		bool _mat4::decompose(_vec3<matReal>& translation, Quaternion& rotation, _vec3<matReal>& scale) const
 		{
-			m[0][0] /= n; m[0][1] /= n; m[0][2] /= n;
-			m[1][0] /= n; m[1][1] /= n; m[1][2] /= n;
-			m[2][0] /= n; m[2][1] /= n; m[2][2] /= n;
-		}
+			translation = _vec3<matReal>(m[3][0], m[3][1], m[3][2]);
 
-		void _mat3::operator += (const _mat3& p)
-		{
-			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1]; m[0][2] += p.m[0][2];
-			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1]; m[1][2] += p.m[1][2];
-			m[2][0] += p.m[2][0]; m[2][1] += p.m[2][1]; m[2][2] += p.m[2][2];
-		}
+			scale = _vec3<matReal>(
+				_vec3<matReal>(m[0][0], m[0][1], m[0][2]).length(),
+				_vec3<matReal>(m[1][0], m[1][1], m[1][2]).length(),
+				_vec3<matReal>(m[2][0], m[2][1], m[2][2]).length());
 
-		void _mat3::operator += (const matReal n)
-		{
-			m[0][0] += n; m[0][1] += n; m[0][2] += n;
-			m[1][0] += n; m[1][1] += n; m[1][2] += n;
-			m[2][0] += n; m[2][1] += n; m[2][2] += n;
-		}
+			rotation.reset();
+			if (scale.x == 0 || scale.y == 0 || scale.z == 0)
+				return false;
 
-		void _mat3::operator  -= (const _mat3& p)
-		{
-			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1]; m[0][2] -= p.m[0][2];
-			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1]; m[1][2] -= p.m[1][2];
-			m[2][0] -= p.m[2][0]; m[2][1] -= p.m[2][1]; m[2][2] -= p.m[2][2];
-		}
+			matReal cof[3][3];
+			if (cofactors3x3(&m[0][0], 4, cof) < 0)
+				scale.x = -scale.x;
 
-		void _mat3::operator  -= (const matReal n)
-		{
-			m[0][0] -= n; m[0][1] -= n; m[0][2] -= n;
-			m[1][0] -= n; m[1][1] -= n; m[1][2] -= n;
-			m[2][0] -= n; m[2][1] -= n; m[2][2] -= n;
-		}
+			_mat4 rot;
+			const matReal scales[3] = { scale.x, scale.y, scale.z };
+			for (int c = 0; c < 3; ++c)
+				for (int row = 0; row < 3; ++row)
+					rot.m[c][row] = m[c][row] / scales[c];
 
-		bool _mat3::operator == (const _mat3& p) const
-		{
-			return
-				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] && m[0][2] == p.m[0][2] &&
-				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1] && m[1][2] == p.m[1][2] &&
-				m[2][0] == p.m[2][0] && m[2][1] == p.m[2][1] && m[2][2] == p.m[2][2];
+			rotation.fromMatrix(rot);
+			return true;
 		}
 
-		bool _mat3::operator != (const _mat3& p) const
+		_mat3x4 _mat3x4::getInverse() const
 		{
-			return
-				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] || m[0][2] != p.m[0][2] ||
-				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1] || m[1][2] != p.m[1][2] ||
-				m[2][0] != p.m[2][0] || m[2][1] != p.m[2][1] || m[2][2] != p.m[2][2];
-		}
+			matReal cof[3][3];
+			const matReal det = cofactors3x3(&m[0][0], 3, cof);
+			if (det == 0)
+				return _mat3x4();
 
-		_mat3 _mat3::getTranspose() const
-		{
-			return _mat3(m[0][0], m[0][1], m[0][2],
-				m[1][0], m[1][1], m[1][2],
-				m[2][0], m[2][1], m[2][2]);
-		}
+			const matReal invDet = 1 / det;
+			_mat3x4 r;
+			for (int c = 0; c < 3; ++c)
+				for (int row = 0; row < 3; ++row)
+					r.m[c][row] = cof[row][c] * invDet;
 
-		matReal _mat3::det() const
-		{
-			return (m[0][0] * m[1][1] * m[2][2] + m[1][0] * m[2][1] * m[0][2] + m[2][0] * m[0][1] * m[1][2]) -
-				(m[2][0] * m[1][1] * m[0][2] + m[0][0] * m[2][1] * m[1][2] + m[1][0] * m[0][1] * m[2][2]);
+			for (int row = 0; row < 3; ++row)
+				r.m[3][row] = -(r.m[0][row] * m[3][0] + r.m[1][row] * m[3][1] + r.m[2][row] * m[3][2]);
+			return r;
 		}
 
 		_mat3 _mat3::getInverse() const
@@ -1576,180 +199,9 @@ namespace math
 				c*h - b*i, a*i - c*g, b*g - a*h,
 				b*f - c*e, c*d - a*f, a*e - b*d)*(1 / determinent);
 		}
-
-		_mat2::_mat2()
-		{
-			reset();
-		}
-
-		_mat2::_mat2(const matReal n)
-		{
-			reset();
-			m[0][0] = n; m[1][1] = n;
-		}
-
-		_mat2::_mat2(const matReal m00, const matReal m10,
-			const matReal m01, const matReal m11)
-		{
-			m[0][0] = m00; m[0][1] = m01;
-			m[1][0] = m10; m[1][1] = m11;
-		}
-
-		void _mat2::reset()
-		{
-			m[0][0] = 1; m[0][1] = 0;
-			m[1][0] = 0; m[1][1] = 1;
-		}
-
-		_mat2 _mat2::operator * (const _mat2& p) const
-		{
-			return _mat2(
-				m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1],
-				m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1],
-				m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1],
-				m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1]);
-		}
-
-		vec2 _mat2::operator* (const vec2& vec) const
-		{
-			return vec2(
-				m[0][0] * vec.x + m[1][0] * vec.y,
-				m[0][1] * vec.x + m[1][1] * vec.y);
-		}
-
-		_mat2 _mat2::operator* (const matReal n) const
-		{
-			return _mat2(
-				m[0][0] * n, m[0][1] * n,
-				m[1][0] * n, m[1][1] * n);
-		}
-
-		_mat2 _mat2::operator+ (const _mat2& p) const
-		{
-			return _mat2(
-				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1],
-				m[1][0] + p.m[1][0], m[1][1] + p.m[1][1]);
-		}
-
-		_mat2 _mat2::operator- (const _mat2& p) const
-		{
-			return _mat2(
-				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1],
-				m[1][0] - p.m[1][0], m[1][1] - p.m[1][1]);
-		}
-
-		_mat2 _mat2::operator / (const matReal n) const
-		{
-			return _mat2(
-				m[0][0] / n, m[0][1] / n,
-				m[1][0] / n, m[1][1] / n);
-		}
-
-		_mat2 _mat2::operator+ (const matReal n) const
-		{
-			return _mat2(
-				m[0][0] + n, m[0][1] + n,
-				m[1][0] + n, m[1][1] + n);
-		}
-
-		_mat2 _mat2::operator- (const matReal n) const
-		{
-			return _mat2(
-				m[0][0] - n, m[0][1] - n,
-				m[1][0] - n, m[1][1] - n);
-		}
-
-		void _mat2::operator *= (const _mat2& p)
-		{
-			matReal t1, t2;
-			t1 = m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1];
-			t2 = m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1];
-			m[0][0] = t1; m[1][0] = t2;
-			t1 = m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1];
-			t2 = m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1];
-			m[0][1] = t1; m[1][1] = t2;
-		}
-
-		void _mat2::operator *= (const matReal n)
-		{
-			m[0][0] *= n; m[0][1] *= n;
-			m[1][0] *= n; m[1][1] *= n;
-		}
-
-		void _mat2::operator /= (const matReal n)
-		{
-			m[0][0] /= n; m[0][1] /= n;
-			m[1][0] /= n; m[1][1] /= n;
-		}
-
-		void _mat2::operator += (const _mat2& p)
-		{
-			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1];
-			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1];
-		}
-
-		void _mat2::operator += (const matReal n)
-		{
-			m[0][0] += n; m[0][1] += n;
-			m[1][0] += n; m[1][1] += n;
-		}
-
-		void _mat2::operator  -= (const _mat2& p)
-		{
-			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1];
-			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1];
-		}
-
-		void _mat2::operator  -= (const matReal n)
-		{
-			m[0][0] -= n; m[0][1] -= n;
-			m[1][0] -= n; m[1][1] -= n;
-		}
-
-		bool _mat2::operator == (const _mat2& p) const
-		{
-			return
-				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] &&
-				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1];
-		}
-
-		bool _mat2::operator != (const _mat2& p) const
-		{
-			return
-				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] ||
-				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1];
-		}
-
-		_mat2 _mat2::getTranspose()
-		{
-			return _mat2(m[0][0], m[0][1],
-				m[1][0], m[1][1]);
-		}
-
 	}
 
 
-	Quaternion::Quaternion()
-	{
-		reset();
-	}
-
-	Quaternion::Quaternion(matReal w_, matReal x_, matReal y_, matReal z_)
-	{
-		w = w_;
-		x = x_;
-		y = y_;
-		z = z_;
-	}
-
-	Quaternion::Quaternion(matReal t)
-	{
-		w = t;
-		x = t;
-		y = t;
-		z = t;
-	}
-
 	Quaternion& Quaternion::fromAxisRotation(const vec3& axis, const matReal angle)
 	{
 		matReal hanfA = angle / matReal(2);
@@ -1762,8 +214,48 @@ namespace math
 		return *this;
 	}
 
-	//Returns quaternion to rotate start to end.
-	//Dodgy
+	Quaternion& Quaternion::fromMatrix(const mat4& rotation)
+	{
+		//r(row, column), picking the largest diagonal term for numerical stability:
+		const matReal r00 = rotation.m[0][0], r11 = rotation.m[1][1], r22 = rotation.m[2][2];
+		const matReal trace = r00 + r11 + r22;
+
+		if (trace > 0)
+		{
+			matReal s = std::sqrt(trace + 1) * 2;
+			w = s / 4;
+			x = (rotation.m[1][2] - rotation.m[2][1]) / s;
+			y = (rotation.m[2][0] - rotation.m[0][2]) / s;
+			z = (rotation.m[0][1] - rotation.m[1][0]) / s;
+		}
+		else if (r00 > r11 && r00 > r22)
+		{
+			matReal s = std::sqrt(1 + r00 - r11 - r22) * 2;
+			w = (rotation.m[1][2] - rotation.m[2][1]) / s;
+			x = s / 4;
+			y = (rotation.m[1][0] + rotation.m[0][1]) / s;
+			z = (rotation.m[2][0] + rotation.m[0][2]) / s;
+		}
+		else if (r11 > r22)
+		{
+			matReal s = std::sqrt(1 + r11 - r00 - r22) * 2;
+			w = (rotation.m[2][0] - rotation.m[0][2]) / s;
+			x = (rotation.m[1][0] + rotation.m[0][1]) / s;
+			y = s / 4;
+			z = (rotation.m[2][1] + rotation.m[1][2]) / s;
+		}
+		else
+		{
+			matReal s = std::sqrt(1 + r22 - r00 - r11) * 2;
+			w = (rotation.m[0][1] - rotation.m[1][0]) / s;
+			x = (rotation.m[2][0] + rotation.m[0][2]) / s;
+			y = (rotation.m[2][1] + rotation.m[1][2]) / s;
+			z = s / 4;
+		}
+
+		return normalize();
+	}
+
 	Quaternion Quaternion::fromRotationBetweenVectors(vec3 start, vec3 dest)
 	{
 		start.normalize();
@@ -1788,13 +280,11 @@ namespace math
 			rotationAxis.y*invs, rotationAxis.z*invs);
 	}
 
-	//Dodgy
 	Quaternion& Quaternion::lookAt(vec3 target, vec3 up)
 	{
 		target.normalize();
 		up.normalize();
 
-
 		Quaternion rot = fromRotationBetweenVectors(vec3(0, 0, 1), target);
 		vec3 right = cross(target, up);
 		vec3 desiredUp = cross(right, target);
@@ -1818,129 +308,17 @@ namespace math
 			return vec4(tmp.x / sqrtw, tmp.y / sqrtw, tmp.z / sqrtw, angle);
 	}
 
-	matReal Quaternion::lengthSquared() const
-	{
-		return  w*w + x*x + y*y + z*z;
-	}
-
-	matReal Quaternion::length() const
-	{
-		return matReal(std::sqrt(w*w + x*x + y*y + z*z));
-	}
-
-	Quaternion& Quaternion::normalize()
-	{
-		matReal lenDivisor = 1.f / length();
-		w = w * lenDivisor;
-		x = x * lenDivisor;
-		y = y * lenDivisor;
-		z = z * lenDivisor;
-		return *this;
-	}
-
-	Quaternion Quaternion::conjugate() const
-	{
-		return Quaternion(w, -x, -y, -z);
-	}
-
-	Quaternion Quaternion::inverse() const
-	{
-		Quaternion out = conjugate();
-		out /= lengthSquared();
-		return out;
-	}
-
-	Quaternion Quaternion::operator * (const Quaternion& b) const
-	{
-		return Quaternion(
-			w * b.w - x * b.x - y * b.y - z * b.z,
-			w * b.x + x * b.w + y * b.z - z * b.y,
-			w * b.y - x * b.z + y * b.w + z * b.x,
-			w * b.z + x * b.y - y * b.x + z * b.w);
-	}
-
-	Quaternion Quaternion::operator / (matReal f) const
-	{
-		return Quaternion(w / f, x / f, y / f, z / f);
-	}
-
-	Quaternion Quaternion::operator * (matReal f) const
-	{
-		return Quaternion(w * f, x * f, y * f, z * f);
-	}
-
-	Quaternion Quaternion::operator * (const vec3& b) const
-	{
-		return Quaternion(
-			x * b.x - y * b.y - z * b.z,
-			w * b.x + y * b.z - z * b.y,
-			w * b.y - x * b.z + z * b.x,
-			w * b.z + x * b.y - y * b.x);
-	}
-
-	Quaternion& Quaternion::operator /= (matReal f)
-	{
-		w /= f;
-		x /= f;
-		y /= f;
-		z /= f;
-		return *this;
-	}
-
-	Quaternion& Quaternion::operator *= (matReal f)
-	{
-		w *= f;
-		x *= f;
-		y *= f;
-		z *= f;
-		return *this;
-	}
-
-	void Quaternion::rotateVector(vec3& v)
-	{
-		Quaternion out = operator*(v)* conjugate();
-		v = vec3(out.x, out.y, out.z);
-	}
-
-	mat4 Quaternion::toMatrix() const
-	{
-		matReal rotX2 = x * 2, rotY2 = y * 2, rotZ2 = z * 2;
-		return mat4(
-			1 - rotY2*y - rotZ2*z, rotX2*y - rotZ2*w, rotX2*z + rotY2*w, 0,
-			rotX2*y + rotZ2*w, 1 - rotX2*x - rotZ2*z, rotY2*z - rotX2*w, 0,
-			rotX2*z - rotY2*w, rotY2*z + rotX2*w, 1 - rotX2*x - rotY2*y, 0,
-			0, 0, 0, 1
-			);
-	}
-
-	void Quaternion::reset()
-	{
-		x = 0;
-		y = 0;
-		z = 0;
-		w = 1;
-	}
 
-
-
-	//Force vector instantiatios for types:
+	//Explicit instantiations of the out-of-line vector functions:
 
 #define FORCE_VEC_INST(type) \
-    template class tmp::_vec2<type>; \
-    template class tmp::_vec3<type>; \
-    template class tmp::_vec4<type>; \
-    template type dot<type>(const tmp::_vec2<type>&, const tmp::_vec2<type>&); \
-    template type dot<type>(const tmp::_vec3<type>&, const tmp::_vec3<type>&); \
-    template type dot<type>(const tmp::_vec4<type>&, const tmp::_vec4<type>&); \
-    template tmp::_vec3<type> cross<type>(const tmp::_vec3<type>&, const tmp::_vec3<type>&);
+	template tmp::_vec3<type>& tmp::_vec3<type>::rotate(const matReal, const tmp::_vec3<matReal>&);
 
 	FORCE_VEC_INST(float)
-		FORCE_VEC_INST(int)
-		FORCE_VEC_INST(double)
-		FORCE_VEC_INST(long long)
-		FORCE_VEC_INST(short)
-
+	FORCE_VEC_INST(int)
+	FORCE_VEC_INST(double)
+	FORCE_VEC_INST(long long)
+	FORCE_VEC_INST(short)
 
 #undef FORCE_VEC_INST
-
-}
\ No newline at end of file
+}
@@ -1,4 +1,12 @@
 #pragma once
+#include "matrixsimd.h"
+
+/*
+The math library is header-only: every small operation is defined inline in matrixd.inl (included at the end of
+this file), so vector and matrix arithmetic can be inlined into its callers without link-time code generation.
+Only the rare, heavy functions (rotation and projection setup, inversions and decomposition, quaternion
+construction helpers) live in matrixd.cpp.
+*/
 
 namespace math
 {
@@ -16,10 +24,12 @@ namespace math
     typedef int matInt;
 #endif
 
-	matInt iround(matReal n);
+	inline matInt iround(matReal n);
+
+	constexpr matReal PIf = matReal(3.14159265358979323846);
+	constexpr matReal PIHalf = PIf / matReal(2);
 
-	extern const matReal PIf;;
-	extern const matReal PIHalf;;
+	class Quaternion;
 
     namespace tmp
     {
@@ -29,9 +39,9 @@ namespace math
         public:
             T x, y;
 
-            _vec2<T>();
-            _vec2<T>(const T x_, const T y_);
-            explicit _vec2<T>(const T n);
+            constexpr _vec2() : x(0), y(0) {}
+            constexpr _vec2(const T x_, const T y_) : x(x_), y(y_) {}
+            constexpr explicit _vec2(const T n) : x(n), y(n) {}
             matReal angle() const;
             T lengthSquared() const;
             matReal length() const;
@@ -80,10 +90,10 @@ namespace math
         public:
             T x, y, z;
 
-            _vec3();
-            _vec3(const T x_, const T y_, const T z_);
-            _vec3(const _vec2<T>& v, const T f);
-            _vec3(const T f, const _vec2<T>& v);
+            constexpr _vec3() : x(0), y(0), z(0) {}
+            constexpr _vec3(const T x_, const T y_, const T z_) : x(x_), y(y_), z(z_) {}
+            constexpr _vec3(const _vec2<T>& v, const T f) : x(v.x), y(v.y), z(f) {}
+            constexpr _vec3(const T f, const _vec2<T>& v) : x(f), y(v.x), z(v.y) {}
             T lengthSquared() const;
             matReal length() const;
             matReal distance(const _vec3<T>& v) const;
@@ -136,14 +146,14 @@ namespace math
         public:
             T x, y, z, w;
 
-            _vec4();
-            _vec4(const T x_, const T y_, const T z_, const T w_);
-            _vec4(const _vec2<T>& v1, const _vec2<T>& v2);
-            _vec4(const T f1, const T f2, const _vec2<T>& v);
-            _vec4(const _vec2<T>& v, const T f1, const T f2);
-            _vec4(const T f1, const _vec2<T>& v, const T f2);
-            _vec4(const _vec3<T>& v, const T f);
-            _vec4(const T f, const _vec3<T>& v);
+            constexpr _vec4() : x(0), y(0), z(0), w(0) {}
+            constexpr _vec4(const T x_, const T y_, const T z_, const T w_) : x(x_), y(y_), z(z_), w(w_) {}
+            constexpr _vec4(const _vec2<T>& v1, const _vec2<T>& v2) : x(v1.x), y(v1.y), z(v2.x), w(v2.y) {}
+            constexpr _vec4(const T f1, const T f2, const _vec2<T>& v) : x(f1), y(f2), z(v.x), w(v.y) {}
+            constexpr _vec4(const _vec2<T>& v, const T f1, const T f2) : x(v.x), y(v.y), z(f1), w(f2) {}
+            constexpr _vec4(const T f1, const _vec2<T>& v, const T f2) : x(f1), y(v.x), z(v.y), w(f2) {}
+            constexpr _vec4(const _vec3<T>& v, const T f) : x(v.x), y(v.y), z(v.z), w(f) {}
+            constexpr _vec4(const T f, const _vec3<T>& v) : x(f), y(v.x), z(v.y), w(v.z) {}
 
             matReal length() const;
             T lengthSquared() const;
@@ -210,12 +220,22 @@ namespace math
         public:
             matReal m[4][4];
 
-            _mat4();
-            explicit _mat4(const matReal n);
-            _mat4(const matReal m00, const matReal m01, const matReal m02, const matReal m03,
-                const matReal m10, const matReal m11, const matReal m12, const matReal m13,
-                const matReal m20, const matReal m21, const matReal m22, const matReal m23,
-                const matReal m30, const matReal m31, const matReal m32, const matReal m33);
+            constexpr _mat4() : m{ { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } {}
+            constexpr explicit _mat4(const matReal n) : m{ { n, 0, 0, 0 }, { 0, n, 0, 0 }, { 0, 0, n, 0 }, { 0, 0, 0, n } } {}
+
+            //The arguments are given row by row; mXY is stored in m[X][Y] (column X, row Y).
+            constexpr _mat4(const matReal m00, const matReal m10, const matReal m20, const matReal m30,
+                const matReal m01, const matReal m11, const matReal m21, const matReal m31,
+                const matReal m02, const matReal m12, const matReal m22, const matReal m32,
+                const matReal m03, const matReal m13, const matReal m23, const matReal m33)
+                : m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } } {}
+
+            //Compile-time counterparts of reset(), initTranslation(...) and initScale(...):
+            static constexpr _mat4 identity();
+            static constexpr _mat4 translation(const matReal x, const matReal y, const matReal z);
+            static constexpr _mat4 scaling(const matReal x, const matReal y, const matReal z);
+            static constexpr _mat4 scaling(const matReal s);
+
             void reset();
             _mat4 operator * (const _mat4& p) const;
             template<class T>
@@ -237,8 +257,8 @@ namespace math
             bool operator != (const _mat4& p) const;
 
             _mat4& initRotation(matReal angle, const _vec3<matReal>& axis);
-            _mat4& initTranslation(_vec3<matReal>& trans);
-            _mat4& initScale(_vec3<matReal>& scale);
+            _mat4& initTranslation(const _vec3<matReal>& trans);
+            _mat4& initScale(const _vec3<matReal>& scale);
 
             _mat4& initRotation(matReal angle, const matReal x,
                 const matReal y, const matReal z);
@@ -252,7 +272,71 @@ namespace math
                 const matReal bottom_, const matReal top_, const matReal near_,
                 const matReal far_);
 
-            _mat4 getTranspose();
+            _mat4 getTranspose() const;
+
+            /**Returns the inverse, or the identity if the matrix is singular.*/
+            _mat4 getInverse() const;
+            /**Returns the inverse of an affine matrix (bottom row 0, 0, 0, 1), or the identity if it is singular.
+            Cheaper than getInverse as only the 3x3 part needs a full inversion.*/
+            _mat4 getInverseAffine() const;
+            /**Returns the inverse transpose of the upper 3x3 part, for transforming normals. Translation is dropped.
+            Unlike the matrix itself this stays correct under non-uniform scaling.*/
+            _mat4 getNormalMatrix() const;
+
+            /**Splits an affine matrix into translation * rotation * scale. A negative determinant is folded into the
+            x scale. Returns false if a scale is zero, in which case the rotation is left as the identity.*/
+            bool decompose(_vec3<matReal>& translation, Quaternion& rotation, _vec3<matReal>& scale) const;
+        };
+
+        /**An affine transform: a mat4 whose bottom row is implicitly (0, 0, 0, 1). Takes 48 bytes instead of 64 and
+        composes with 36 multiplications instead of 64. Used for the scene graph; convert to mat4 with toMat4() where
+        a full matrix is needed, such as when uploading to the GPU.*/
+        class _mat3x4
+        {
+        public:
+            //Four columns of three rows, m[column][row]. Column 3 holds the translation.
+            matReal m[4][3];
+
+            constexpr _mat3x4() : m{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, 0 } } {}
+
+            /**Takes the top three rows of mat. Only meaningful if the bottom row is (0, 0, 0, 1).*/
+            constexpr explicit _mat3x4(const _mat4& mat)
+                : m{ { mat.m[0][0], mat.m[0][1], mat.m[0][2] }, { mat.m[1][0], mat.m[1][1], mat.m[1][2] },
+                { mat.m[2][0], mat.m[2][1], mat.m[2][2] }, { mat.m[3][0], mat.m[3][1], mat.m[3][2] } } {}
+
+            void reset();
+            _mat3x4 operator * (const _mat3x4& p) const;
+            void operator *= (const _mat3x4& p);
+            bool operator == (const _mat3x4& p) const;
+            bool operator != (const _mat3x4& p) const;
+
+            /**Returns the point transformed by the matrix, including the translation.*/
+            _vec3<matReal> transformPoint(const _vec3<matReal>& point) const;
+            /**Returns the direction transformed by the matrix, ignoring the translation.*/
+            _vec3<matReal> transformDirection(const _vec3<matReal>& direction) const;
+
+            _mat3x4& initTranslation(const _vec3<matReal>& trans);
+            _mat3x4& initTranslation(const matReal x, const matReal y, const matReal z);
+            _mat3x4& initScale(const matReal s);
+
+            /**Sets the matrix to translation * rotation * scale. The rotation must be normalised.*/
+            _mat3x4& initTRS(const _vec3<matReal>& trans, const Quaternion& rot, const matReal scale);
+
+            /**The inverse of a rotation and uniform scale followed by a translation, as built by initTRS. Transposes
+            the rotation part and divides out the scale instead of performing a general inversion.*/
+            _mat3x4 getInverseUniformScale() const;
+
+            /**Returns the inverse of any affine transform, or the identity if it is singular.*/
+            _mat3x4 getInverse() const;
+
+            _vec3<matReal> getTranslation() const;
+
+            /**Returns the most the matrix stretches any length by, the longest of its three axes. Scaling a bounding
+            sphere's radius by this keeps it bounding.*/
+            matReal getMaxScale() const;
+
+            /**Returns the equivalent full matrix.*/
+            _mat4 toMat4() const;
         };
 
         class _mat3
@@ -260,11 +344,14 @@ namespace math
         public:
             matReal m[3][3];
 
-            _mat3();
-            explicit _mat3(const matReal n);
-            _mat3(const matReal m00, const matReal m01, const matReal m02,
-                const matReal m10, const matReal m11, const matReal m12,
-                const matReal m20, const matReal m21, const matReal m22);
+            constexpr _mat3() : m{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } } {}
+            constexpr explicit _mat3(const matReal n) : m{ { n, 0, 0 }, { 0, n, 0 }, { 0, 0, n } } {}
+
+            //The arguments are given row by row; mXY is stored in m[X][Y] (column X, row Y).
+            constexpr _mat3(const matReal m00, const matReal m10, const matReal m20,
+                const matReal m01, const matReal m11, const matReal m21,
+                const matReal m02, const matReal m12, const matReal m22)
+                : m{ { m00, m01, m02 }, { m10, m11, m12 }, { m20, m21, m22 } } {}
             void reset();
             _mat3 operator * (const _mat3& p) const;
             _vec3<matReal> operator* (const _vec3<matReal>& vec) const;
@@ -294,10 +381,13 @@ namespace math
         public:
             matReal m[2][2];
 
-            _mat2();
-            explicit _mat2(const matReal n);
-            _mat2(const matReal m00, const matReal m01,
-                const matReal m10, const matReal m11);
+            constexpr _mat2() : m{ { 1, 0 }, { 0, 1 } } {}
+            constexpr explicit _mat2(const matReal n) : m{ { n, 0 }, { 0, n } } {}
+
+            //The arguments are given row by row; mXY is stored in m[X][Y] (column X, row Y).
+            constexpr _mat2(const matReal m00, const matReal m10,
+                const matReal m01, const matReal m11)
+                : m{ { m00, m01 }, { m10, m11 } } {}
             void reset();
             _mat2 operator * (const _mat2& p) const;
             _vec2<matReal> operator* (const _vec2<matReal>& vec) const;
@@ -317,7 +407,7 @@ namespace math
             bool operator == (const _mat2& p) const;
             bool operator != (const _mat2& p) const;
 
-            _mat2 getTranspose();
+            _mat2 getTranspose() const;
         };
 
     }
@@ -357,6 +447,7 @@ namespace math
     typedef tmp::_mat2 mat2;
     typedef tmp::_mat3 mat3;
     typedef tmp::_mat4 mat4;
+    typedef tmp::_mat3x4 mat3x4;
 
     //Alternative names:
     typedef vec2 Vector2f;
@@ -368,6 +459,7 @@ namespace math
     typedef mat2 Matrix2x2;
     typedef mat3 Matrix3x3;
     typedef mat4 Matrix4x4;
+    typedef mat3x4 Matrix3x4;
 
     template <class T> T dot(const tmp::_vec2<T>& v1, const tmp::_vec2<T>& v2);
     template <class T> T dot(const tmp::_vec3<T>& v1, const tmp::_vec3<T>& v2);
@@ -385,11 +477,14 @@ namespace math
 	public:
 		matReal w, x, y, z;
 
-		Quaternion();
-		Quaternion(matReal w_, matReal x_, matReal y_, matReal z_);
-		Quaternion(matReal t);
+		constexpr Quaternion() : w(1), x(0), y(0), z(0) {}
+		constexpr Quaternion(matReal w_, matReal x_, matReal y_, matReal z_) : w(w_), x(x_), y(y_), z(z_) {}
+		constexpr Quaternion(matReal t) : w(t), x(t), y(t), z(t) {}
 		Quaternion& fromAxisRotation(const vec3& axis, const matReal angle);
 
+		/**Sets the quaternion from the upper 3x3 part of a matrix, which must be a pure rotation.*/
+		Quaternion& fromMatrix(const mat4& rotation);
+
 		//Returns quaternion to rotate start to end.
 		//Dodgy
 		static Quaternion fromRotationBetweenVectors(vec3 start, vec3 dest);
@@ -409,6 +504,9 @@ namespace math
 		matReal lengthSquared() const;
 		matReal length() const;
 		Quaternion& normalize();
+		/**Normalises using an approximate reciprocal square root refined by one Newton step (about 1e-6 relative error).
+		Meant for quaternions that are already close to unit length.*/
+		Quaternion& normalizeFast();
 		Quaternion conjugate() const;
 		Quaternion inverse() const;
 
@@ -423,6 +521,15 @@ namespace math
 
 		mat4 toMatrix() const;
 
+		/**Normalised linear interpolation along the shorter arc. Cheaper than slerp, but the angular speed is not constant.*/
+		static Quaternion nlerp(const Quaternion& a, const Quaternion& b, matReal t);
+		/**Spherical linear interpolation along the shorter arc, at constant angular speed. a and b must be normalised.*/
+		static Quaternion slerp(const Quaternion& a, const Quaternion& b, matReal t);
+
 		void reset();
 	};
-}
\ No newline at end of file
+
+	matReal dot(const Quaternion& a, const Quaternion& b);
+}
+
+#include "matrixd.inl"
@@ -0,0 +1,1704 @@
+#pragma once
+//Inline definitions of the math library. Included at the end of matrixd.h; do not include directly.
+#include <cmath>
+
+namespace math
+{
+	inline matInt iround(matReal n)
+	{
+		const int integer = (int)n;
+		if (integer + matReal(0.5) > n)
+			return integer;
+		else
+			return integer + 1;
+	}
+
+
+	template<class T> T dot(const tmp::_vec2<T>& v1, const tmp::_vec2<T>& v2)
+	{
+		return v1.x*v2.x + v1.y*v2.y;
+	}
+
+	template<class T> T dot(const tmp::_vec3<T>& v1, const tmp::_vec3<T>& v2)
+	{
+		return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z;
+	}
+
+	template<class T> T dot(const tmp::_vec4<T>& v1, const tmp::_vec4<T>& v2)
+	{
+		return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z + v1.w*v2.w;
+	}
+
+	template<class T> tmp::_vec3<T> cross(const tmp::_vec3<T>& v1, const tmp::_vec3<T>& v2)
+	{
+		return tmp::_vec3<T>(v1.y*v2.z - v1.z*v2.y,
+			v1.z*v2.x - v1.x*v2.z,
+			v1.x*v2.y - v1.y*v2.x);
+	}
+
+	namespace tmp
+	{
+		constexpr matReal matScalarOne = 1;
+		constexpr matReal matScalarNull = 0;
+		constexpr matReal matScalarTwo = 2;
+
+		//Component-wise modulo used by the % operators; floating point types go through fmod.
+		template<class T> inline T matMod(const T a, const T b) { return a % b; }
+		inline float matMod(const float a, const float b) { return (float)std::fmod(a, b); }
+		inline double matMod(const double a, const double b) { return std::fmod(a, b); }
+
+
+		template<class T> matReal _vec2<T>::angle() const
+		{
+			return matReal(std::atan2(y, x));
+		}
+
+		template<class T> T _vec2<T>::lengthSquared() const
+		{
+			return x*x + y*y;
+		}
+
+		template<class T> matReal _vec2<T>::length() const
+		{
+			return matReal(std::sqrt(x*x + y*y));
+		}
+
+		template<class T> matReal _vec2<T>::distance(const _vec2<T>& v) const
+		{
+			return matReal(std::sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y)));
+		}
+
+		template<class T> T _vec2<T>::distanceSquared(const _vec2<T>& v) const
+		{
+			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator * (const T n) const
+		{
+			return _vec2<T>(x*n, y*n);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator / (const T n) const
+		{
+			return _vec2<T>(x / n, y / n);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator + (const T n) const
+		{
+			return _vec2<T>(x + n, y + n);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator - (const T n) const
+		{
+			return _vec2<T>(x - n, y - n);
+		}
+
+		template<class T> void  _vec2<T>::operator *= (const T n)
+		{
+			x *= n;
+			y *= n;
+		}
+
+		template<class T> void _vec2<T>::operator /= (const T n)
+		{
+			x /= n;
+			y /= n;
+		}
+
+		template<class T> void _vec2<T>::operator += (const T n)
+		{
+			x += n;
+			y += n;
+		}
+
+		template<class T> void _vec2<T>::operator -= (const T n)
+		{
+			x -= n;
+			y -= n;
+		}
+
+		template<class T> bool _vec2<T>::operator == (const _vec2<T>& vec) const
+		{
+			return x == vec.x && y == vec.y;
+		}
+
+		template<class T> bool _vec2<T>::operator == (T f) const
+		{
+			return x == f && y == f;
+		}
+
+		template<class T> bool _vec2<T>::operator != (const _vec2<T>& vec) const
+		{
+			return x != vec.x || y != vec.y;
+		}
+
+		template<class T> bool _vec2<T>::operator != (T f) const
+		{
+			return x != f || y != f;
+		}
+
+		template<class T> _vec2<T>& _vec2<T>::normalize()
+		{
+			matReal lenDivisor = matScalarOne / length();
+			x = T(x * lenDivisor);
+			y = T(y * lenDivisor);
+			return *this;
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator + (const _vec2<T>& vec) const
+		{
+			return _vec2<T>(x + vec.x, y + vec.y);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator - (const _vec2<T>& vec) const
+		{
+			return _vec2<T>(x - vec.x, y - vec.y);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator * (const _vec2<T>& vec) const
+		{
+			return _vec2<T>(x*vec.x, y*vec.y);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator / (const _vec2<T>& vec) const
+		{
+			return _vec2<T>(x / vec.x, y / vec.y);
+		}
+
+		template<class T> void _vec2<T>::operator += (const _vec2<T>& vec)
+		{
+			x += vec.x;
+			y += vec.y;
+		}
+
+		template<class T> void _vec2<T>::operator -= (const _vec2<T>& vec)
+		{
+			x -= vec.x;
+			y -= vec.y;
+		}
+
+		template<class T> void _vec2<T>::operator *= (const _vec2<T>& vec)
+		{
+			x *= vec.x;
+			y *= vec.y;
+		}
+
+		template<class T> void _vec2<T>::operator /= (const _vec2<T>& vec)
+		{
+			x /= vec.x;
+			y /= vec.y;
+		}
+
+		template<class T> _vec2<T> _vec2<T>::xy() const { return _vec2<T>(x, y); }
+		template<class T> _vec2<T> _vec2<T>::yx() const { return _vec2<T>(y, x); }
+
+		template<class T> void _vec2<T>::reset()
+		{
+			x = 0;
+			y = 0;
+		}
+
+		template<class T> bool _vec2<T>::operator < (const _vec2<T>& vec) const
+		{
+			if (x == vec.x)
+				return y<vec.y;
+			else
+				return x < vec.x;
+		}
+
+		template<class T> bool _vec2<T>::operator <= (const _vec2<T>& vec) const
+		{
+			return *this < vec || *this == vec;
+		}
+
+		template<class T> bool _vec2<T>::operator > (const _vec2<T>& vec) const
+		{
+			if (x == vec.x)
+				return y>vec.y;
+			else
+				return x > vec.x;
+		}
+
+		template<class T> bool _vec2<T>::operator >= (const _vec2<T>& vec) const
+		{
+			return *this > vec || *this == vec;
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator % (const T n) const
+		{
+			return _vec2<T>(matMod(x, n), matMod(y, n));
+		}
+
+		template<class T> void _vec2<T>::operator %= (const T n)
+		{
+			x = matMod(x, n);
+			y = matMod(y, n);
+		}
+
+		template<class T> _vec2<T> _vec2<T>::operator % (const _vec2<T>& vec) const
+		{
+			return _vec2<T>(matMod(x, vec.x), matMod(y, vec.y));
+		}
+
+		template<class T> void _vec2<T>::operator %= (const _vec2<T>& vec)
+		{
+			x = matMod(x, vec.x);
+			y = matMod(y, vec.y);
+		}
+
+
+		template<class T> T _vec3<T>::lengthSquared() const
+		{
+			return x*x + y*y + z*z;
+		}
+
+		template<class T> matReal _vec3<T>::length() const
+		{
+			return matReal(std::sqrt(x*x + y*y + z*z));
+		}
+
+		template<class T> matReal _vec3<T>::distance(const _vec3<T>& v) const
+		{
+			return matReal(std::sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z)));
+		}
+
+		template<class T> T _vec3<T>::distanceSquared(const _vec3<T>& v) const
+		{
+			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator * (const T n) const
+		{
+			return _vec3<T>(x*n, y*n, z*n);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator / (const T n) const
+		{
+			return _vec3<T>(x / n, y / n, z / n);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator + (const T n) const
+		{
+			return _vec3<T>(x + n, y + n, z + n);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator - (const T n) const
+		{
+			return _vec3<T>(x - n, y - n, z - n);
+		}
+
+		template<class T> void _vec3<T>::operator *= (const T n)
+		{
+			x *= n;
+			y *= n;
+			z *= n;
+		}
+
+		template<class T> void _vec3<T>::operator /= (const T n)
+		{
+			x /= n;
+			y /= n;
+			z /= n;
+		}
+
+		template<class T> void _vec3<T>::operator += (const T n)
+		{
+			x += n;
+			y += n;
+			z += n;
+		}
+
+		template<class T> void _vec3<T>::operator -= (const T n)
+		{
+			x -= n;
+			y -= n;
+			z -= n;
+		}
+
+		template<class T>
+		bool _vec3<T>::operator == (const _vec3<T>& vec) const
+		{
+			return x == vec.x && y == vec.y && z == vec.z;
+		}
+
+		template<class T> bool _vec3<T>::operator == (T f) const
+		{
+			return x == f && y == f && z == f;
+		}
+
+		template<class T> bool _vec3<T>::operator != (const _vec3<T>& vec) const
+		{
+			return x != vec.x || y != vec.y || z != vec.z;
+		}
+
+		template<class T> bool _vec3<T>::operator != (T f) const
+		{
+			return x != f || y != f || z != f;
+		}
+
+		template<class T> _vec3<T>& _vec3<T>::normalize()
+		{
+			matReal lenDivisor = matScalarOne / length();
+			x = T(x * lenDivisor);
+			y = T(y * lenDivisor);
+			z = T(z * lenDivisor);
+			return *this;
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator + (const _vec3<T>& vec) const
+		{
+			return _vec3<T>(x + vec.x, y + vec.y, z + vec.z);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator - (const _vec3<T>& vec) const
+		{
+			return _vec3<T>(x - vec.x, y - vec.y, z - vec.z);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator * (const _vec3<T>& vec) const
+		{
+			return _vec3<T>(x*vec.x, y*vec.y, z*vec.z);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator / (const _vec3<T>& vec) const
+		{
+			return _vec3<T>(x / vec.x, y / vec.y, z / vec.z);
+		}
+
+		template<class T> void _vec3<T>::operator += (const _vec3<T>& vec)
+		{
+			x += vec.x;
+			y += vec.y;
+			z += vec.z;
+		}
+
+		template<class T> void _vec3<T>::operator -= (const _vec3<T>& vec)
+		{
+			x -= vec.x;
+			y -= vec.y;
+			z -= vec.z;
+		}
+
+		template<class T> void _vec3<T>::operator *= (const _vec3<T>& vec)
+		{
+			x *= vec.x;
+			y *= vec.y;
+			z *= vec.z;
+		}
+
+		template<class T> void _vec3<T>::operator /= (const _vec3<T>& vec)
+		{
+			x /= vec.x;
+			y /= vec.y;
+			z /= vec.z;
+		}
+
+
+		template<class T> void _vec3<T>::reset()
+		{
+			x = 0;
+			y = 0;
+			z = 0;
+		}
+
+		template<class T> _vec3<T> _vec3<T>::xyz() const { return _vec3<T>(x, y, z); }
+		template<class T> _vec3<T> _vec3<T>::xzy() const { return _vec3<T>(x, z, y); }
+		template<class T> _vec3<T> _vec3<T>::yxz() const { return _vec3<T>(y, x, z); }
+		template<class T> _vec3<T> _vec3<T>::yzx() const { return _vec3<T>(y, z, x); }
+		template<class T> _vec3<T> _vec3<T>::zxy() const { return _vec3<T>(z, x, y); }
+		template<class T> _vec3<T> _vec3<T>::zyx() const { return _vec3<T>(z, y, x); }
+
+		template<class T> _vec2<T> _vec3<T>::xy() const { return _vec2<T>(x, y); }
+		template<class T> _vec2<T> _vec3<T>::yx() const { return _vec2<T>(y, x); }
+		template<class T> _vec2<T> _vec3<T>::xz() const { return _vec2<T>(x, z); }
+		template<class T> _vec2<T> _vec3<T>::zx() const { return _vec2<T>(z, x); }
+		template<class T> _vec2<T> _vec3<T>::yz() const { return _vec2<T>(y, z); }
+		template<class T> _vec2<T> _vec3<T>::zy() const { return _vec2<T>(z, y); }
+
+
+		template<class T> bool _vec3<T>::operator < (const _vec3<T>& vec) const
+		{
+			if (x == vec.x)
+				if (y == vec.y)
+				return z<vec.z;
+				else
+					return y<vec.y;
+			else
+				return x < vec.x;
+		}
+
+		template<class T> bool _vec3<T>::operator <= (const _vec3<T>& vec) const
+		{
+			return *this < vec || *this == vec;
+		}
+
+		template<class T> bool _vec3<T>::operator > (const _vec3<T>& vec) const
+		{
+			if (x == vec.x)
+				if (y == vec.y)
+				return z>vec.z;
+				else
+					return y>vec.y;
+			else
+				return x > vec.x;
+		}
+
+		template<class T> bool _vec3<T>::operator >= (const _vec3<T>& vec) const
+		{
+			return *this > vec || *this == vec;
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator % (const T n) const
+		{
+			return _vec3<T>(matMod(x, n), matMod(y, n), matMod(z, n));
+		}
+
+		template<class T> void _vec3<T>::operator %= (const T n)
+		{
+			x = matMod(x, n);
+			y = matMod(y, n);
+			z = matMod(z, n);
+		}
+
+		template<class T> _vec3<T> _vec3<T>::operator % (const _vec3<T>& vec) const
+		{
+			return _vec3<T>(matMod(x, vec.x), matMod(y, vec.y), matMod(z, vec.z));
+		}
+
+		template<class T> void _vec3<T>::operator %= (const _vec3<T>& vec)
+		{
+			x = matMod(x, vec.x);
+			y = matMod(y, vec.y);
+			z = matMod(z, vec.z);
+		}
+
+
+		template<class T> T _vec4<T>::lengthSquared() const
+		{
+			return x*x + y*y + z*z + w*w;
+		}
+
+		template<class T> matReal _vec4<T>::length() const
+		{
+			return matReal(std::sqrt(x*x + y*y + z*z + w*w));
+		}
+
+		template<class T>
+		matReal _vec4<T>::distance(const _vec4<T>& v) const
+		{
+			return matReal(sqrt((x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z) + (w - v.w)*(w - v.w)));
+		}
+
+		template<class T> T _vec4<T>::distanceSquared(const _vec4<T>& v) const
+		{
+			return (x - v.x)*(x - v.x) + (y - v.y)*(y - v.y) + (z - v.z)*(z - v.z) + (w - v.w)*(w - v.w);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator * (const T n) const
+		{
+			return _vec4<T>(x*n, y*n, z*n, w*n);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator / (const T n) const
+		{
+			return _vec4<T>(x / n, y / n, z / n, w / n);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator + (const T n) const
+		{
+			return _vec4<T>(x + n, y + n, z + n, w + n);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator - (const T n) const
+		{
+			return _vec4<T>(x - n, y - n, z - n, w - n);
+		}
+
+		template<class T> void _vec4<T>::operator *= (const T n)
+		{
+			x *= n;
+			y *= n;
+			z *= n;
+			w *= n;
+		}
+
+		template<class T> void  _vec4<T>::operator /= (const T n)
+		{
+			x /= n;
+			y /= n;
+			z /= n;
+			w /= n;
+		}
+
+		template<class T> void  _vec4<T>::operator += (const T n)
+		{
+			x += n;
+			y += n;
+			z += n;
+			w += n;
+		}
+
+		template<class T> void  _vec4<T>::operator -= (const T n)
+		{
+			x -= n;
+			y -= n;
+			z -= n;
+			w -= n;
+		}
+
+		template<class T> bool _vec4<T>::operator == (const _vec4<T>& vec) const
+		{
+			return x == vec.x && y == vec.y && z == vec.z && w == vec.w;
+		}
+
+		template<class T> bool _vec4<T>::operator == (T f) const
+		{
+			return x == f && y == f &&z == f && w == f;
+		}
+
+		template<class T> bool _vec4<T>::operator != (const _vec4<T>& vec) const
+		{
+			return x != vec.x || y != vec.y || z != vec.z || w != vec.w;
+		}
+
+		template<class T> bool _vec4<T>::operator != (T f) const
+		{
+			return x != f || y != f || z != f || w != f;
+		}
+
+		template<class T> _vec4<T>& _vec4<T>::normalize()
+		{
+			matReal lenDivisor = matScalarOne / length();
+			x = T(x * lenDivisor);
+			y = T(y * lenDivisor);
+			z = T(z * lenDivisor);
+			w = T(w * lenDivisor);
+			return *this;
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator + (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(x + vec.x, y + vec.y, z + vec.z, w + vec.w);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator - (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(x - vec.x, y - vec.y, z - vec.z, w - vec.w);
+		}
+
+		template<class T>
+		_vec4<T> _vec4<T>::operator * (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(x*vec.x, y*vec.y, z*vec.z, w*vec.w);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator / (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(x / vec.x, y / vec.y, z / vec.z, w / vec.w);
+		}
+
+		template<class T> void _vec4<T>::operator += (const _vec4<T>& vec)
+		{
+			x += vec.x;
+			y += vec.y;
+			z += vec.z;
+			w += vec.w;
+		}
+		template<class T> void _vec4<T>::operator -= (const _vec4<T>& vec)
+		{
+			x -= vec.x;
+			y -= vec.y;
+			z -= vec.z;
+			w -= vec.w;
+		}
+
+		template<class T> void _vec4<T>::operator *= (const _vec4<T>& vec)
+		{
+			x *= vec.x;
+			y *= vec.y;
+			z *= vec.z;
+			w *= vec.w;
+		}
+
+		template<class T> void _vec4<T>::operator /= (const _vec4<T>& vec)
+		{
+			x /= vec.x;
+			y /= vec.y;
+			z /= vec.z;
+			w /= vec.w;
+		}
+
+		template<class T> void _vec4<T>::reset()
+		{
+			x = 0;
+			y = 0;
+			z = 0;
+			w = 0;
+		}
+
+
+#ifndef MATRIX_D_SCALAR
+		//The float vec4 arithmetic goes through the SIMD kernels.
+
+		template<> inline _vec4<float> _vec4<float>::operator + (const _vec4<float>& vec) const
+		{
+			_vec4<float> out;
+			simd::add4(&x, &vec.x, &out.x);
+			return out;
+		}
+
+		template<> inline _vec4<float> _vec4<float>::operator - (const _vec4<float>& vec) const
+		{
+			_vec4<float> out;
+			simd::sub4(&x, &vec.x, &out.x);
+			return out;
+		}
+
+		template<> inline _vec4<float> _vec4<float>::operator * (const _vec4<float>& vec) const
+		{
+			_vec4<float> out;
+			simd::mul4(&x, &vec.x, &out.x);
+			return out;
+		}
+
+		template<> inline _vec4<float> _vec4<float>::operator / (const _vec4<float>& vec) const
+		{
+			_vec4<float> out;
+			simd::div4(&x, &vec.x, &out.x);
+			return out;
+		}
+
+		template<> inline _vec4<float> _vec4<float>::operator * (const float n) const
+		{
+			_vec4<float> out;
+			simd::scale4(&x, n, &out.x);
+			return out;
+		}
+
+		template<> inline void _vec4<float>::operator += (const _vec4<float>& vec)
+		{
+			simd::add4(&x, &vec.x, &x);
+		}
+
+		template<> inline void _vec4<float>::operator -= (const _vec4<float>& vec)
+		{
+			simd::sub4(&x, &vec.x, &x);
+		}
+
+		template<> inline void _vec4<float>::operator *= (const _vec4<float>& vec)
+		{
+			simd::mul4(&x, &vec.x, &x);
+		}
+
+		template<> inline void _vec4<float>::operator /= (const _vec4<float>& vec)
+		{
+			simd::div4(&x, &vec.x, &x);
+		}
+
+		template<> inline void _vec4<float>::operator *= (const float n)
+		{
+			simd::scale4(&x, n, &x);
+		}
+#endif
+
+
+		template<class T> _vec4<T> _vec4<T>::xyzw() const { return _vec4<T>(x, y, z, w); }
+		template<class T> _vec4<T> _vec4<T>::xywz() const { return _vec4<T>(x, y, w, z); }
+		template<class T> _vec4<T> _vec4<T>::xzwy() const { return _vec4<T>(x, z, w, y); }
+		template<class T> _vec4<T> _vec4<T>::xzyw() const { return _vec4<T>(x, z, y, w); }
+		template<class T> _vec4<T> _vec4<T>::xwzy() const { return _vec4<T>(x, w, z, y); }
+		template<class T> _vec4<T> _vec4<T>::xwyz() const { return _vec4<T>(x, w, y, z); }
+		template<class T> _vec4<T> _vec4<T>::yxzw() const { return _vec4<T>(y, x, z, w); }
+		template<class T> _vec4<T> _vec4<T>::yxwz() const { return _vec4<T>(y, x, w, z); }
+		template<class T> _vec4<T> _vec4<T>::yzwx() const { return _vec4<T>(y, z, w, x); }
+		template<class T> _vec4<T> _vec4<T>::yzxw() const { return _vec4<T>(y, z, x, w); }
+		template<class T> _vec4<T> _vec4<T>::ywzx() const { return _vec4<T>(y, w, z, x); }
+		template<class T> _vec4<T> _vec4<T>::ywxz() const { return _vec4<T>(y, w, x, z); }
+		template<class T> _vec4<T> _vec4<T>::zyxw() const { return _vec4<T>(z, y, x, w); }
+		template<class T> _vec4<T> _vec4<T>::zywx() const { return _vec4<T>(z, y, w, x); }
+		template<class T> _vec4<T> _vec4<T>::zxwy() const { return _vec4<T>(z, x, w, y); }
+		template<class T> _vec4<T> _vec4<T>::zxyw() const { return _vec4<T>(z, x, y, w); }
+		template<class T> _vec4<T> _vec4<T>::zwxy() const { return _vec4<T>(z, w, x, y); }
+		template<class T> _vec4<T> _vec4<T>::zwyx() const { return _vec4<T>(z, w, y, x); }
+		template<class T> _vec4<T> _vec4<T>::wyzx() const { return _vec4<T>(w, y, z, x); }
+		template<class T> _vec4<T> _vec4<T>::wyxz() const { return _vec4<T>(w, y, x, z); }
+		template<class T> _vec4<T> _vec4<T>::wzxy() const { return _vec4<T>(w, z, x, y); }
+		template<class T> _vec4<T> _vec4<T>::wzyx() const { return _vec4<T>(w, z, y, x); }
+		template<class T> _vec4<T> _vec4<T>::wxzy() const { return _vec4<T>(w, x, z, y); }
+		template<class T> _vec4<T> _vec4<T>::wxyz() const { return _vec4<T>(w, x, y, z); }
+
+		template<class T> _vec3<T> _vec4<T>::xyz() const { return _vec3<T>(x, y, z); }
+		template<class T> _vec3<T> _vec4<T>::xzy() const { return _vec3<T>(x, z, y); }
+		template<class T> _vec3<T> _vec4<T>::yxz() const { return _vec3<T>(y, x, z); }
+		template<class T> _vec3<T> _vec4<T>::yzx() const { return _vec3<T>(y, z, x); }
+		template<class T> _vec3<T> _vec4<T>::zxy() const { return _vec3<T>(z, x, y); }
+		template<class T> _vec3<T> _vec4<T>::zyx() const { return _vec3<T>(z, y, x); }
+		template<class T> _vec3<T> _vec4<T>::wyz() const { return _vec3<T>(w, y, z); }
+		template<class T> _vec3<T> _vec4<T>::wzy() const { return _vec3<T>(w, z, y); }
+		template<class T> _vec3<T> _vec4<T>::ywz() const { return _vec3<T>(y, w, z); }
+		template<class T> _vec3<T> _vec4<T>::yzw() const { return _vec3<T>(y, z, w); }
+		template<class T> _vec3<T> _vec4<T>::zwy() const { return _vec3<T>(z, w, y); }
+		template<class T> _vec3<T> _vec4<T>::zyw() const { return _vec3<T>(z, y, w); }
+		template<class T> _vec3<T> _vec4<T>::xyw() const { return _vec3<T>(x, y, w); }
+		template<class T> _vec3<T> _vec4<T>::xwy() const { return _vec3<T>(x, w, y); }
+		template<class T> _vec3<T> _vec4<T>::yxw() const { return _vec3<T>(y, x, w); }
+		template<class T> _vec3<T> _vec4<T>::ywx() const { return _vec3<T>(y, w, x); }
+		template<class T> _vec3<T> _vec4<T>::wxy() const { return _vec3<T>(w, x, y); }
+		template<class T> _vec3<T> _vec4<T>::wyx() const { return _vec3<T>(w, y, x); }
+		template<class T> _vec3<T> _vec4<T>::xwz() const { return _vec3<T>(x, w, z); }
+		template<class T> _vec3<T> _vec4<T>::xzw() const { return _vec3<T>(x, z, w); }
+		template<class T> _vec3<T> _vec4<T>::wxz() const { return _vec3<T>(w, x, z); }
+		template<class T> _vec3<T> _vec4<T>::wzx() const { return _vec3<T>(w, z, x); }
+		template<class T> _vec3<T> _vec4<T>::zxw() const { return _vec3<T>(z, x, w); }
+		template<class T> _vec3<T> _vec4<T>::zwx() const { return _vec3<T>(z, w, x); }
+
+		template<class T> _vec2<T> _vec4<T>::xy() const { return _vec2<T>(x, y); }
+		template<class T> _vec2<T> _vec4<T>::yx() const { return _vec2<T>(y, x); }
+		template<class T> _vec2<T> _vec4<T>::xz() const { return _vec2<T>(x, z); }
+		template<class T> _vec2<T> _vec4<T>::zx() const { return _vec2<T>(z, x); }
+		template<class T> _vec2<T> _vec4<T>::xw() const { return _vec2<T>(x, w); }
+		template<class T> _vec2<T> _vec4<T>::wx() const { return _vec2<T>(w, x); }
+		template<class T> _vec2<T> _vec4<T>::yz() const { return _vec2<T>(y, z); }
+		template<class T> _vec2<T> _vec4<T>::zy() const { return _vec2<T>(z, y); }
+		template<class T> _vec2<T> _vec4<T>::wz() const { return _vec2<T>(w, z); }
+		template<class T> _vec2<T> _vec4<T>::zw() const { return _vec2<T>(z, w); }
+
+
+		template<class T> bool _vec4<T>::operator < (const _vec4<T>& vec) const
+		{
+			if (x == vec.x)
+				if (y == vec.y)
+				if (z == vec.z)
+				return w<vec.w;
+				else
+					return z<vec.z;
+				else
+					return y<vec.y;
+			else
+				return x < vec.x;
+		}
+
+		template<class T> bool _vec4<T>::operator <= (const _vec4<T>& vec) const
+		{
+			return *this < vec || *this == vec;
+		}
+
+		template<class T> bool _vec4<T>::operator > (const _vec4<T>& vec) const
+		{
+			if (x == vec.x)
+				if (y == vec.y)
+				if (z == vec.z)
+				return w<vec.w;
+				else
+					return z<vec.z;
+				else
+					return y<vec.y;
+			else
+				return x < vec.x;
+		}
+
+		template<class T> bool _vec4<T>::operator >= (const _vec4<T>& vec) const
+		{
+			return *this > vec || *this == vec;
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator % (const T n) const
+		{
+			return _vec4<T>(matMod(x, n), matMod(y, n), matMod(z, n), matMod(w, n));
+		}
+
+		template<class T> void _vec4<T>::operator %= (const T n)
+		{
+			x = matMod(x, n);
+			y = matMod(y, n);
+			z = matMod(z, n);
+			w = matMod(w, n);
+		}
+
+		template<class T> _vec4<T> _vec4<T>::operator % (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(matMod(x, vec.x), matMod(y, vec.y), matMod(z, vec.z), matMod(w, vec.w));
+		}
+
+		template<class T> void _vec4<T>::operator %= (const _vec4<T>& vec)
+		{
+			x = matMod(x, vec.x);
+			y = matMod(y, vec.y);
+			z = matMod(z, vec.z);
+			w = matMod(w, vec.w);
+		}
+
+
+		inline constexpr _mat4 _mat4::identity()
+		{
+			return _mat4();
+		}
+
+		inline constexpr _mat4 _mat4::translation(const matReal x, const matReal y, const matReal z)
+		{
+			return _mat4(1, 0, 0, x,
+				0, 1, 0, y,
+				0, 0, 1, z,
+				0, 0, 0, 1);
+		}
+
+		inline constexpr _mat4 _mat4::scaling(const matReal x, const matReal y, const matReal z)
+		{
+			return _mat4(x, 0, 0, 0,
+				0, y, 0, 0,
+				0, 0, z, 0,
+				0, 0, 0, 1);
+		}
+
+		inline constexpr _mat4 _mat4::scaling(const matReal s)
+		{
+			return scaling(s, s, s);
+		}
+
+		inline void _mat4::reset()
+		{
+			m[0][0] = 1; m[0][1] = 0; m[0][2] = 0; m[0][3] = 0;
+			m[1][0] = 0; m[1][1] = 1; m[1][2] = 0; m[1][3] = 0;
+			m[2][0] = 0; m[2][1] = 0; m[2][2] = 1; m[2][3] = 0;
+			m[3][0] = 0; m[3][1] = 0; m[3][2] = 0; m[3][3] = 1;
+		}
+
+		inline _mat4 _mat4::operator * (const _mat4& p) const
+		{
+			_mat4 out;
+			simd::mul4x4(&m[0][0], &p.m[0][0], &out.m[0][0]);
+			return out;
+		}
+
+		template<class T>
+		_vec4<T> _mat4::operator* (const _vec4<T>& vec) const
+		{
+			return _vec4<T>(
+				T(m[0][0] * vec.x + m[1][0] * vec.y + m[2][0] * vec.z + m[3][0] * vec.w),
+				T(m[0][1] * vec.x + m[1][1] * vec.y + m[2][1] * vec.z + m[3][1] * vec.w),
+				T(m[0][2] * vec.x + m[1][2] * vec.y + m[2][2] * vec.z + m[3][2] * vec.w),
+				T(m[0][3] * vec.x + m[1][3] * vec.y + m[2][3] * vec.z + m[3][3] * vec.w));
+		}
+
+		template<>
+		inline _vec4<matReal> _mat4::operator* (const _vec4<matReal>& vec) const
+		{
+			_vec4<matReal> out;
+			simd::mul4x4Vec(&m[0][0], &vec.x, &out.x);
+			return out;
+		}
+
+		inline _mat4 _mat4::operator* (const matReal n) const
+		{
+			return _mat4(
+				m[0][0] * n, m[0][1] * n, m[0][2] * n, m[0][3] * n,
+				m[1][0] * n, m[1][1] * n, m[1][2] * n, m[1][3] * n,
+				m[2][0] * n, m[2][1] * n, m[2][2] * n, m[2][3] * n,
+				m[3][0] * n, m[3][1] * n, m[3][2] * n, m[3][3] * n);
+		}
+
+		inline _mat4 _mat4::operator+ (const mat4& p) const
+		{
+			return _mat4(
+				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1],
+				m[0][2] + p.m[0][2], m[0][3] + p.m[0][3],
+				m[1][0] + p.m[1][0], m[1][1] + p.m[1][1],
+				m[1][2] + p.m[1][2], m[1][3] + p.m[1][3],
+				m[2][0] + p.m[2][0], m[2][1] + p.m[2][1],
+				m[2][2] + p.m[2][2], m[2][3] + p.m[2][3],
+				m[3][0] + p.m[3][0], m[3][1] + p.m[3][1],
+				m[3][2] + p.m[3][2], m[3][3] + p.m[3][3]);
+		}
+
+		inline _mat4 _mat4::operator- (const mat4& p) const
+		{
+			return _mat4(
+				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1],
+				m[0][2] - p.m[0][2], m[0][3] - p.m[0][3],
+				m[1][0] - p.m[1][0], m[1][1] - p.m[1][1],
+				m[1][2] - p.m[1][2], m[1][3] - p.m[1][3],
+				m[2][0] - p.m[2][0], m[2][1] - p.m[2][1],
+				m[2][2] - p.m[2][2], m[2][3] - p.m[2][3],
+				m[3][0] - p.m[3][0], m[3][1] - p.m[3][1],
+				m[3][2] - p.m[3][2], m[3][3] - p.m[3][3]);
+		}
+
+		inline _mat4 _mat4::operator / (const matReal n) const
+		{
+			return _mat4(
+				m[0][0] / n, m[0][1] / n, m[0][2] / n, m[0][3] / n,
+				m[1][0] / n, m[1][1] / n, m[1][2] / n, m[1][3] / n,
+				m[2][0] / n, m[2][1] / n, m[2][2] / n, m[2][3] / n,
+				m[3][0] / n, m[3][1] / n, m[3][2] / n, m[3][3] / n);
+		}
+
+		inline _mat4 _mat4::operator+ (const matReal n) const
+		{
+			return _mat4(
+				m[0][0] + n, m[0][1] + n, m[0][2] + n, m[0][3] + n,
+				m[1][0] + n, m[1][1] + n, m[1][2] + n, m[1][3] + n,
+				m[2][0] + n, m[2][1] + n, m[2][2] + n, m[2][3] + n,
+				m[3][0] + n, m[3][1] + n, m[3][2] + n, m[3][3] + n);
+		}
+
+		inline _mat4 _mat4::operator- (const matReal n) const
+		{
+			return _mat4(
+				m[0][0] - n, m[0][1] - n, m[0][2] - n, m[0][3] - n,
+				m[1][0] - n, m[1][1] - n, m[1][2] - n, m[1][3] - n,
+				m[2][0] - n, m[2][1] - n, m[2][2] - n, m[2][3] - n,
+				m[3][0] - n, m[3][1] - n, m[3][2] - n, m[3][3] - n);
+		}
+
+		inline void _mat4::operator *= (const _mat4& p)
+		{
+			simd::mul4x4(&m[0][0], &p.m[0][0], &m[0][0]);
+		}
+
+		inline void _mat4::operator *= (const matReal n)
+		{
+			m[0][0] *= n; m[0][1] *= n; m[0][2] *= n; m[0][3] *= n;
+			m[1][0] *= n; m[1][1] *= n; m[1][2] *= n; m[1][3] *= n;
+			m[2][0] *= n; m[2][1] *= n; m[2][2] *= n; m[2][3] *= n;
+			m[3][0] *= n; m[3][1] *= n; m[3][2] *= n; m[3][3] *= n;
+		}
+
+		inline void _mat4::operator /= (const matReal n)
+		{
+			m[0][0] /= n; m[0][1] /= n; m[0][2] /= n; m[0][3] /= n;
+			m[1][0] /= n; m[1][1] /= n; m[1][2] /= n; m[1][3] /= n;
+			m[2][0] /= n; m[2][1] /= n; m[2][2] /= n; m[2][3] /= n;
+			m[3][0] /= n; m[3][1] /= n; m[3][2] /= n; m[3][3] /= n;
+		}
+
+		inline void _mat4::operator += (const _mat4& p)
+		{
+			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1];
+			m[0][2] += p.m[0][2]; m[0][3] += p.m[0][3];
+			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1];
+			m[1][2] += p.m[1][2]; m[1][3] += p.m[1][3];
+			m[2][0] += p.m[2][0]; m[2][1] += p.m[2][1];
+			m[2][2] += p.m[2][2]; m[2][3] += p.m[2][3];
+			m[3][0] += p.m[3][0]; m[3][1] += p.m[3][1];
+			m[3][2] += p.m[3][2]; m[3][3] += p.m[3][3];
+		}
+
+		inline void _mat4::operator += (const matReal n)
+		{
+			m[0][0] += n; m[0][1] += n; m[0][2] += n; m[0][3] += n;
+			m[1][0] += n; m[1][1] += n; m[1][2] += n; m[1][3] += n;
+			m[2][0] += n; m[2][1] += n; m[2][2] += n; m[2][3] += n;
+			m[3][0] += n; m[3][1] += n; m[3][2] += n; m[3][3] += n;
+		}
+
+		inline void _mat4::operator  -= (const _mat4& p)
+		{
+			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1];
+			m[0][2] -= p.m[0][2]; m[0][3] -= p.m[0][3];
+			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1];
+			m[1][2] -= p.m[1][2]; m[1][3] -= p.m[1][3];
+			m[2][0] -= p.m[2][0]; m[2][1] -= p.m[2][1];
+			m[2][2] -= p.m[2][2]; m[2][3] -= p.m[2][3];
+			m[3][0] -= p.m[3][0]; m[3][1] -= p.m[3][1];
+			m[3][2] -= p.m[3][2]; m[3][3] -= p.m[3][3];
+		}
+
+		inline void _mat4::operator  -= (const matReal n)
+		{
+			m[0][0] -= n; m[0][1] -= n; m[0][2] -= n; m[0][3] -= n;
+			m[1][0] -= n; m[1][1] -= n; m[1][2] -= n; m[1][3] -= n;
+			m[2][0] -= n; m[2][1] -= n; m[2][2] -= n; m[2][3] -= n;
+			m[3][0] -= n; m[3][1] -= n; m[3][2] -= n; m[3][3] -= n;
+		}
+
+
+		inline bool _mat4::operator == (const _mat4& p) const
+		{
+			return
+				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] &&
+				m[0][2] == p.m[0][2] && m[0][3] == p.m[0][3] &&
+				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1] &&
+				m[1][2] == p.m[1][2] && m[1][3] == p.m[1][3] &&
+				m[2][0] == p.m[2][0] && m[2][1] == p.m[2][1] &&
+				m[2][2] == p.m[2][2] && m[2][3] == p.m[2][3] &&
+				m[3][0] == p.m[3][0] && m[3][1] == p.m[3][1] &&
+				m[3][2] == p.m[3][2] && m[3][3] == p.m[3][3];
+		}
+
+		inline bool _mat4::operator != (const _mat4& p) const
+		{
+			return
+				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] ||
+				m[0][2] != p.m[0][2] || m[0][3] != p.m[0][3] ||
+				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1] ||
+				m[1][2] != p.m[1][2] || m[1][3] != p.m[1][3] ||
+				m[2][0] != p.m[2][0] || m[2][1] != p.m[2][1] ||
+				m[2][2] != p.m[2][2] || m[2][3] != p.m[2][3] ||
+				m[3][0] != p.m[3][0] || m[3][1] != p.m[3][1] ||
+				m[3][2] != p.m[3][2] || m[3][3] != p.m[3][3];
+		}
+
+		inline _mat4& _mat4::initTranslation(const matReal x, const matReal y, const matReal z)
+		{
+			reset();
+			m[3][0] = x;
+			m[3][1] = y;
+			m[3][2] = z;
+			return *this;
+		}
+
+		inline _mat4& _mat4::initScale(const matReal x, const matReal y, const matReal z)
+		{
+			reset();
+			m[0][0] = x;
+			m[1][1] = y;
+			m[2][2] = z;
+			return *this;
+		}
+
+		inline _mat4& _mat4::initScale(const matReal s)
+		{
+			reset();
+			m[0][0] = s;
+			m[1][1] = s;
+			m[2][2] = s;
+			return *this;
+		}
+
+		inline _mat4& mat4::initRotation(matReal angle, const vec3& axis)
+		{
+			return initRotation(angle, axis.x, axis.y, axis.z);
+		}
+
+		inline _mat4& _mat4::initTranslation(const vec3& trans)
+		{
+			return initTranslation(trans.x, trans.y, trans.z);
+		}
+
+		inline _mat4& _mat4::initScale(const vec3& scale)
+		{
+			return initScale(scale.x, scale.y, scale.z);
+		}
+
+
+		inline _mat4 _mat4::getTranspose() const
+		{
+			_mat4 out;
+			simd::transpose4x4(&m[0][0], &out.m[0][0]);
+			return out;
+		}
+
+
+		inline void _mat3::reset()
+		{
+			m[0][0] = 1; m[0][1] = 0; m[0][2] = 0;
+			m[1][0] = 0; m[1][1] = 1; m[1][2] = 0;
+			m[2][0] = 0; m[2][1] = 0; m[2][2] = 1;
+		}
+
+		inline _mat3 _mat3::operator * (const _mat3& p) const
+		{
+			return _mat3(
+				m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2],
+				m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2],
+				m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2],
+
+				m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2],
+				m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2],
+				m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2],
+
+				m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2],
+				m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2],
+				m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2]);
+		}
+
+		inline vec3 _mat3::operator* (const vec3& vec) const
+		{
+			return vec3(
+				m[0][0] * vec.x + m[1][0] * vec.y + m[2][0] * vec.z,
+				m[0][1] * vec.x + m[1][1] * vec.y + m[2][1] * vec.z,
+				m[0][2] * vec.x + m[1][2] * vec.y + m[2][2] * vec.z);
+		}
+
+		inline _mat3 _mat3::operator* (const matReal n) const
+		{
+			return _mat3(
+				m[0][0] * n, m[0][1] * n, m[0][2] * n,
+				m[1][0] * n, m[1][1] * n, m[1][2] * n,
+				m[2][0] * n, m[2][1] * n, m[2][2] * n);
+		}
+
+		inline _mat3 _mat3::operator+ (const _mat3& p) const
+		{
+			return _mat3(
+				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1], m[0][2] + p.m[0][2],
+				m[1][1] + p.m[1][1], m[1][0] + p.m[1][0], m[1][2] + p.m[1][2],
+				m[2][0] + p.m[2][0], m[2][1] + p.m[2][1], m[2][2] + p.m[2][2]);
+		}
+
+		inline _mat3 _mat3::operator- (const _mat3& p) const
+		{
+			return _mat3(
+				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1], m[0][2] - p.m[0][2],
+				m[1][1] - p.m[1][1], m[1][0] - p.m[1][0], m[1][2] - p.m[1][2],
+				m[2][0] - p.m[2][0], m[2][1] - p.m[2][1], m[2][2] - p.m[2][2]);
+		}
+
+		inline _mat3 _mat3::operator / (const matReal n) const
+		{
+			return _mat3(
+				m[0][0] / n, m[0][1] / n, m[0][2] / n,
+				m[1][0] / n, m[1][1] / n, m[1][2] / n,
+				m[2][0] / n, m[2][1] / n, m[2][2] / n);
+		}
+
+		inline _mat3 _mat3::operator+ (const matReal n) const
+		{
+			return _mat3(
+				m[0][0] + n, m[0][1] + n, m[0][2] + n,
+				m[1][0] + n, m[1][1] + n, m[1][2] + n,
+				m[2][0] + n, m[2][1] + n, m[2][2] + n);
+		}
+
+		inline _mat3 _mat3::operator- (const matReal n) const
+		{
+			return _mat3(
+				m[0][0] - n, m[0][1] - n, m[0][2] - n,
+				m[1][0] - n, m[1][1] - n, m[1][2] - n,
+				m[2][0] - n, m[2][1] - n, m[2][2] - n);
+		}
+
+		inline void _mat3::operator *= (const _mat3& p)
+		{
+			matReal t1, t2, t3;
+			t1 = m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1] + m[2][0] * p.m[0][2];
+			t2 = m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1] + m[2][0] * p.m[1][2];
+			t3 = m[0][0] * p.m[2][0] + m[1][0] * p.m[2][1] + m[2][0] * p.m[2][2];
+			m[0][0] = t1; m[1][0] = t2; m[2][0] = t3;
+			t1 = m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1] + m[2][1] * p.m[0][2];
+			t2 = m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1] + m[2][1] * p.m[1][2];
+			t3 = m[0][1] * p.m[2][0] + m[1][1] * p.m[2][1] + m[2][1] * p.m[2][2];
+			m[0][1] = t1; m[1][1] = t2; m[2][1] = t3;
+			t1 = m[0][2] * p.m[0][0] + m[1][2] * p.m[0][1] + m[2][2] * p.m[0][2];
+			t2 = m[0][2] * p.m[1][0] + m[1][2] * p.m[1][1] + m[2][2] * p.m[1][2];
+			t3 = m[0][2] * p.m[2][0] + m[1][2] * p.m[2][1] + m[2][2] * p.m[2][2];
+			m[0][2] = t1; m[1][2] = t2; m[2][2] = t3;
+		}
+
+		inline void _mat3::operator *= (const matReal n)
+		{
+			m[0][0] *= n; m[0][1] *= n; m[0][2] *= n;
+			m[1][0] *= n; m[1][1] *= n; m[1][2] *= n;
+			m[2][0] *= n; m[2][1] *= n; m[2][2] *= n;
+		}
+
+		inline void _mat3::operator /= (const matReal n)
+		{
+			m[0][0] /= n; m[0][1] /= n; m[0][2] /= n;
+			m[1][0] /= n; m[1][1] /= n; m[1][2] /= n;
+			m[2][0] /= n; m[2][1] /= n; m[2][2] /= n;
+		}
+
+		inline void _mat3::operator += (const _mat3& p)
+		{
+			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1]; m[0][2] += p.m[0][2];
+			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1]; m[1][2] += p.m[1][2];
+			m[2][0] += p.m[2][0]; m[2][1] += p.m[2][1]; m[2][2] += p.m[2][2];
+		}
+
+		inline void _mat3::operator += (const matReal n)
+		{
+			m[0][0] += n; m[0][1] += n; m[0][2] += n;
+			m[1][0] += n; m[1][1] += n; m[1][2] += n;
+			m[2][0] += n; m[2][1] += n; m[2][2] += n;
+		}
+
+		inline void _mat3::operator  -= (const _mat3& p)
+		{
+			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1]; m[0][2] -= p.m[0][2];
+			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1]; m[1][2] -= p.m[1][2];
+			m[2][0] -= p.m[2][0]; m[2][1] -= p.m[2][1]; m[2][2] -= p.m[2][2];
+		}
+
+		inline void _mat3::operator  -= (const matReal n)
+		{
+			m[0][0] -= n; m[0][1] -= n; m[0][2] -= n;
+			m[1][0] -= n; m[1][1] -= n; m[1][2] -= n;
+			m[2][0] -= n; m[2][1] -= n; m[2][2] -= n;
+		}
+
+		inline bool _mat3::operator == (const _mat3& p) const
+		{
+			return
+				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] && m[0][2] == p.m[0][2] &&
+				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1] && m[1][2] == p.m[1][2] &&
+				m[2][0] == p.m[2][0] && m[2][1] == p.m[2][1] && m[2][2] == p.m[2][2];
+		}
+
+		inline bool _mat3::operator != (const _mat3& p) const
+		{
+			return
+				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] || m[0][2] != p.m[0][2] ||
+				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1] || m[1][2] != p.m[1][2] ||
+				m[2][0] != p.m[2][0] || m[2][1] != p.m[2][1] || m[2][2] != p.m[2][2];
+		}
+
+		inline _mat3 _mat3::getTranspose() const
+		{
+			return _mat3(m[0][0], m[0][1], m[0][2],
+				m[1][0], m[1][1], m[1][2],
+				m[2][0], m[2][1], m[2][2]);
+		}
+
+		inline matReal _mat3::det() const
+		{
+			return (m[0][0] * m[1][1] * m[2][2] + m[1][0] * m[2][1] * m[0][2] + m[2][0] * m[0][1] * m[1][2]) -
+				(m[2][0] * m[1][1] * m[0][2] + m[0][0] * m[2][1] * m[1][2] + m[1][0] * m[0][1] * m[2][2]);
+		}
+
+
+		inline void _mat2::reset()
+		{
+			m[0][0] = 1; m[0][1] = 0;
+			m[1][0] = 0; m[1][1] = 1;
+		}
+
+		inline _mat2 _mat2::operator * (const _mat2& p) const
+		{
+			return _mat2(
+				m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1],
+				m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1],
+				m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1],
+				m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1]);
+		}
+
+		inline vec2 _mat2::operator* (const vec2& vec) const
+		{
+			return vec2(
+				m[0][0] * vec.x + m[1][0] * vec.y,
+				m[0][1] * vec.x + m[1][1] * vec.y);
+		}
+
+		inline _mat2 _mat2::operator* (const matReal n) const
+		{
+			return _mat2(
+				m[0][0] * n, m[0][1] * n,
+				m[1][0] * n, m[1][1] * n);
+		}
+
+		inline _mat2 _mat2::operator+ (const _mat2& p) const
+		{
+			return _mat2(
+				m[0][0] + p.m[0][0], m[0][1] + p.m[0][1],
+				m[1][0] + p.m[1][0], m[1][1] + p.m[1][1]);
+		}
+
+		inline _mat2 _mat2::operator- (const _mat2& p) const
+		{
+			return _mat2(
+				m[0][0] - p.m[0][0], m[0][1] - p.m[0][1],
+				m[1][0] - p.m[1][0], m[1][1] - p.m[1][1]);
+		}
+
+		inline _mat2 _mat2::operator / (const matReal n) const
+		{
+			return _mat2(
+				m[0][0] / n, m[0][1] / n,
+				m[1][0] / n, m[1][1] / n);
+		}
+
+		inline _mat2 _mat2::operator+ (const matReal n) const
+		{
+			return _mat2(
+				m[0][0] + n, m[0][1] + n,
+				m[1][0] + n, m[1][1] + n);
+		}
+
+		inline _mat2 _mat2::operator- (const matReal n) const
+		{
+			return _mat2(
+				m[0][0] - n, m[0][1] - n,
+				m[1][0] - n, m[1][1] - n);
+		}
+
+		inline void _mat2::operator *= (const _mat2& p)
+		{
+			matReal t1, t2;
+			t1 = m[0][0] * p.m[0][0] + m[1][0] * p.m[0][1];
+			t2 = m[0][0] * p.m[1][0] + m[1][0] * p.m[1][1];
+			m[0][0] = t1; m[1][0] = t2;
+			t1 = m[0][1] * p.m[0][0] + m[1][1] * p.m[0][1];
+			t2 = m[0][1] * p.m[1][0] + m[1][1] * p.m[1][1];
+			m[0][1] = t1; m[1][1] = t2;
+		}
+
+		inline void _mat2::operator *= (const matReal n)
+		{
+			m[0][0] *= n; m[0][1] *= n;
+			m[1][0] *= n; m[1][1] *= n;
+		}
+
+		inline void _mat2::operator /= (const matReal n)
+		{
+			m[0][0] /= n; m[0][1] /= n;
+			m[1][0] /= n; m[1][1] /= n;
+		}
+
+		inline void _mat2::operator += (const _mat2& p)
+		{
+			m[0][0] += p.m[0][0]; m[0][1] += p.m[0][1];
+			m[1][0] += p.m[1][0]; m[1][1] += p.m[1][1];
+		}
+
+		inline void _mat2::operator += (const matReal n)
+		{
+			m[0][0] += n; m[0][1] += n;
+			m[1][0] += n; m[1][1] += n;
+		}
+
+		inline void _mat2::operator  -= (const _mat2& p)
+		{
+			m[0][0] -= p.m[0][0]; m[0][1] -= p.m[0][1];
+			m[1][0] -= p.m[1][0]; m[1][1] -= p.m[1][1];
+		}
+
+		inline void _mat2::operator  -= (const matReal n)
+		{
+			m[0][0] -= n; m[0][1] -= n;
+			m[1][0] -= n; m[1][1] -= n;
+		}
+
+		inline bool _mat2::operator == (const _mat2& p) const
+		{
+			return
+				m[0][0] == p.m[0][0] && m[0][1] == p.m[0][1] &&
+				m[1][0] == p.m[1][0] && m[1][1] == p.m[1][1];
+		}
+
+		inline bool _mat2::operator != (const _mat2& p) const
+		{
+			return
+				m[0][0] != p.m[0][0] || m[0][1] != p.m[0][1] ||
+				m[1][0] != p.m[1][0] || m[1][1] != p.m[1][1];
+		}
+
+		inline _mat4 _mat4::getInverse() const
+		{
+			_mat4 out;
+			if (!simd::inverse4x4(&m[0][0], &out.m[0][0]))
+				return _mat4();
+			return out;
+		}
+
+		inline _mat2 _mat2::getTranspose() const
+		{
+			return _mat2(m[0][0], m[0][1],
+				m[1][0], m[1][1]);
+		}
+
+		inline void _mat3x4::reset()
+		{
+			*this = _mat3x4();
+		}
+
+		inline _mat3x4 _mat3x4::operator * (const _mat3x4& p) const
+		{
+			//The implicit bottom rows are (0, 0, 0, 1), so each column needs only the 3x3 part of this matrix,
+			//and the translation column adds this translation.
+			_mat3x4 r;
+			simd::mul3x4(&m[0][0], &p.m[0][0], &r.m[0][0]);
+			return r;
+		}
+
+		inline void _mat3x4::operator *= (const _mat3x4& p)
+		{
+			simd::mul3x4(&m[0][0], &p.m[0][0], &m[0][0]);
+		}
+
+		inline bool _mat3x4::operator == (const _mat3x4& p) const
+		{
+			for (int c = 0; c < 4; ++c)
+				for (int row = 0; row < 3; ++row)
+					if (m[c][row] != p.m[c][row])
+						return false;
+			return true;
+		}
+
+		inline bool _mat3x4::operator != (const _mat3x4& p) const
+		{
+			return !(*this == p);
+		}
+
+		inline _vec3<matReal> _mat3x4::transformPoint(const _vec3<matReal>& point) const
+		{
+			return _vec3<matReal>(
+				m[0][0] * point.x + m[1][0] * point.y + m[2][0] * point.z + m[3][0],
+				m[0][1] * point.x + m[1][1] * point.y + m[2][1] * point.z + m[3][1],
+				m[0][2] * point.x + m[1][2] * point.y + m[2][2] * point.z + m[3][2]);
+		}
+
+		inline _vec3<matReal> _mat3x4::transformDirection(const _vec3<matReal>& direction) const
+		{
+			return _vec3<matReal>(
+				m[0][0] * direction.x + m[1][0] * direction.y + m[2][0] * direction.z,
+				m[0][1] * direction.x + m[1][1] * direction.y + m[2][1] * direction.z,
+				m[0][2] * direction.x + m[1][2] * direction.y + m[2][2] * direction.z);
+		}
+
+		inline _mat3x4& _mat3x4::initTranslation(const _vec3<matReal>& trans)
+		{
+			return initTranslation(trans.x, trans.y, trans.z);
+		}
+
+		inline _mat3x4& _mat3x4::initTranslation(const matReal x, const matReal y, const matReal z)
+		{
+			reset();
+			m[3][0] = x;
+			m[3][1] = y;
+			m[3][2] = z;
+			return *this;
+		}
+
+		inline _mat3x4& _mat3x4::initScale(const matReal s)
+		{
+			reset();
+			m[0][0] = s;
+			m[1][1] = s;
+			m[2][2] = s;
+			return *this;
+		}
+
+		inline _mat3x4& _mat3x4::initTRS(const _vec3<matReal>& trans, const Quaternion& rot, const matReal scale)
+		{
+			//The same rotation as Quaternion::toMatrix, with the scale folded into the columns.
+			const matReal x2 = rot.x * 2, y2 = rot.y * 2, z2 = rot.z * 2;
+
+			m[0][0] = (1 - y2*rot.y - z2*rot.z) * scale;
+			m[0][1] = (x2*rot.y + z2*rot.w) * scale;
+			m[0][2] = (x2*rot.z - y2*rot.w) * scale;
+
+			m[1][0] = (x2*rot.y - z2*rot.w) * scale;
+			m[1][1] = (1 - x2*rot.x - z2*rot.z) * scale;
+			m[1][2] = (y2*rot.z + x2*rot.w) * scale;
+
+			m[2][0] = (x2*rot.z + y2*rot.w) * scale;
+			m[2][1] = (y2*rot.z - x2*rot.w) * scale;
+			m[2][2] = (1 - x2*rot.x - y2*rot.y) * scale;
+
+			m[3][0] = trans.x;
+			m[3][1] = trans.y;
+			m[3][2] = trans.z;
+			return *this;
+		}
+
+		inline _mat3x4 _mat3x4::getInverseUniformScale() const
+		{
+			//For M = s*R, the inverse is R^T/s = M^T/s^2, and s^2 is the squared length of any column.
+			const matReal scaleSq = m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2];
+			const matReal invScaleSq = scaleSq == 0 ? 0 : 1 / scaleSq;
+
+			_mat3x4 r;
+			for (int c = 0; c < 3; ++c)
+				for (int row = 0; row < 3; ++row)
+					r.m[c][row] = m[row][c] * invScaleSq;
+
+			for (int row = 0; row < 3; ++row)
+				r.m[3][row] = -(r.m[0][row] * m[3][0] + r.m[1][row] * m[3][1] + r.m[2][row] * m[3][2]);
+			return r;
+		}
+
+		inline _vec3<matReal> _mat3x4::getTranslation() const
+		{
+			return _vec3<matReal>(m[3][0], m[3][1], m[3][2]);
+		}
+
+		inline matReal _mat3x4::getMaxScale() const
+		{
+			matReal longest = 0;
+			for (int c = 0; c < 3; ++c)
+			{
+				const matReal lengthSquared = m[c][0] * m[c][0] + m[c][1] * m[c][1] + m[c][2] * m[c][2];
+				if (lengthSquared > longest)
+					longest = lengthSquared;
+			}
+			return matReal(std::sqrt(longest));
+		}
+
+		inline _mat4 _mat3x4::toMat4() const
+		{
+			return _mat4(
+				m[0][0], m[1][0], m[2][0], m[3][0],
+				m[0][1], m[1][1], m[2][1], m[3][1],
+				m[0][2], m[1][2], m[2][2], m[3][2],
+				0, 0, 0, 1);
+		}
+
+	}
+
+
+	//Returns quaternion to rotate start to end.
+	//Dodgy
+
+	//Dodgy
+
+
+	inline matReal Quaternion::lengthSquared() const
+	{
+		return  w*w + x*x + y*y + z*z;
+	}
+
+	inline matReal Quaternion::length() const
+	{
+		return matReal(std::sqrt(w*w + x*x + y*y + z*z));
+	}
+
+	inline Quaternion& Quaternion::normalize()
+	{
+		matReal lenDivisor = 1.f / length();
+		w = w * lenDivisor;
+		x = x * lenDivisor;
+		y = y * lenDivisor;
+		z = z * lenDivisor;
+		return *this;
+	}
+
+	inline Quaternion& Quaternion::normalizeFast()
+	{
+#if defined(MATRIX_D_SSE)
+		const __m128 lenSq = _mm_set_ss(lengthSquared());
+		__m128 r = _mm_rsqrt_ss(lenSq);
+		//One Newton-Raphson step: r = r * (1.5 - 0.5 * lenSq * r * r)
+		r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), lenSq), _mm_mul_ss(r, r))));
+		const matReal lenDivisor = _mm_cvtss_f32(r);
+#elif defined(MATRIX_D_NEON)
+		const float lenSq = lengthSquared();
+		float32x2_t r = vrsqrte_f32(vdup_n_f32(lenSq));
+		r = vmul_f32(r, vrsqrts_f32(vmul_f32(vdup_n_f32(lenSq), r), r));
+		const matReal lenDivisor = vget_lane_f32(r, 0);
+#else
+		const matReal lenDivisor = 1 / std::sqrt(lengthSquared());
+#endif
+		w *= lenDivisor;
+		x *= lenDivisor;
+		y *= lenDivisor;
+		z *= lenDivisor;
+		return *this;
+	}
+
+	inline matReal dot(const Quaternion& a, const Quaternion& b)
+	{
+		return a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z;
+	}
+
+	inline Quaternion Quaternion::nlerp(const Quaternion& a, const Quaternion& b, matReal t)
+	{
+		//q and -q are the same rotation; flip b onto a's hemisphere to take the shorter arc.
+		const matReal tb = dot(a, b) < 0 ? -t : t;
+		const matReal ta = 1 - t;
+		return Quaternion(a.w*ta + b.w*tb, a.x*ta + b.x*tb, a.y*ta + b.y*tb, a.z*ta + b.z*tb).normalizeFast();
+	}
+
+	inline Quaternion Quaternion::slerp(const Quaternion& a, const Quaternion& b, matReal t)
+	{
+		matReal cosTheta = dot(a, b);
+		matReal sign = 1;
+		if (cosTheta < 0)
+		{
+			cosTheta = -cosTheta;
+			sign = -1;
+		}
+
+		//Nearly parallel: sin(theta) vanishes, but the arc is then short enough to be linear.
+		if (cosTheta > matReal(0.9995))
+			return nlerp(a, b, t);
+
+		const matReal theta = std::acos(cosTheta);
+		const matReal invSin = 1 / std::sin(theta);
+		const matReal ta = std::sin((1 - t) * theta) * invSin;
+		const matReal tb = std::sin(t * theta) * invSin * sign;
+		return Quaternion(a.w*ta + b.w*tb, a.x*ta + b.x*tb, a.y*ta + b.y*tb, a.z*ta + b.z*tb);
+	}
+
+	inline Quaternion Quaternion::conjugate() const
+	{
+		return Quaternion(w, -x, -y, -z);
+	}
+
+	inline Quaternion Quaternion::inverse() const
+	{
+		Quaternion out = conjugate();
+		out /= lengthSquared();
+		return out;
+	}
+
+	inline Quaternion Quaternion::operator * (const Quaternion& b) const
+	{
+		return Quaternion(
+			w * b.w - x * b.x - y * b.y - z * b.z,
+			w * b.x + x * b.w + y * b.z - z * b.y,
+			w * b.y - x * b.z + y * b.w + z * b.x,
+			w * b.z + x * b.y - y * b.x + z * b.w);
+	}
+
+	inline Quaternion Quaternion::operator / (matReal f) const
+	{
+		return Quaternion(w / f, x / f, y / f, z / f);
+	}
+
+	inline Quaternion Quaternion::operator * (matReal f) const
+	{
+		return Quaternion(w * f, x * f, y * f, z * f);
+	}
+
+	inline Quaternion Quaternion::operator * (const vec3& b) const
+	{
+		return Quaternion(
+			x * b.x - y * b.y - z * b.z,
+			w * b.x + y * b.z - z * b.y,
+			w * b.y - x * b.z + z * b.x,
+			w * b.z + x * b.y - y * b.x);
+	}
+
+	inline Quaternion& Quaternion::operator /= (matReal f)
+	{
+		w /= f;
+		x /= f;
+		y /= f;
+		z /= f;
+		return *this;
+	}
+
+	inline Quaternion& Quaternion::operator *= (matReal f)
+	{
+		w *= f;
+		x *= f;
+		y *= f;
+		z *= f;
+		return *this;
+	}
+
+	inline void Quaternion::rotateVector(vec3& v)
+	{
+		Quaternion out = operator*(v)* conjugate();
+		v = vec3(out.x, out.y, out.z);
+	}
+
+	inline mat4 Quaternion::toMatrix() const
+	{
+		matReal rotX2 = x * 2, rotY2 = y * 2, rotZ2 = z * 2;
+		return mat4(
+			1 - rotY2*y - rotZ2*z, rotX2*y - rotZ2*w, rotX2*z + rotY2*w, 0,
+			rotX2*y + rotZ2*w, 1 - rotX2*x - rotZ2*z, rotY2*z - rotX2*w, 0,
+			rotX2*z - rotY2*w, rotY2*z + rotX2*w, 1 - rotX2*x - rotY2*y, 0,
+			0, 0, 0, 1
+			);
+	}
+
+	inline void Quaternion::reset()
+	{
+		x = 0;
+		y = 0;
+		z = 0;
+		w = 1;
+	}
+}
@@ -0,0 +1,518 @@
+#pragma once
+
+/*
+SIMD kernels behind the math library. The path is chosen at compile time:
+ - MATRIX_D_AVX   : AVX on top of SSE (two matrix columns per instruction).
+ - MATRIX_D_SSE   : SSE, used on every x86/x64 target unless disabled.
+ - MATRIX_D_NEON  : ARM NEON.
+ - MATRIX_D_SCALAR: The reference path, forced by defining MATRIX_D_NO_SIMD (or implied by MATRIX_D_DOUBLE).
+
+This header is included by matrixd.h and has no dependencies of its own. All kernels work on the column-major
+layout used by mat4 (m[column][row]), which is also the layout the shaders expect (D3DCOMPILE_PACK_MATRIX_COLUMN_MAJOR).
+The kernels perform the multiplications and additions in the same order as the scalar reference, so results are
+bit-exact unless the compiler contracts them into FMA instructions.
+*/
+
+#if !defined(MATRIX_D_NO_SIMD) && !defined(MATRIX_D_DOUBLE)
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MATRIX_D_SSE
+#if defined(__AVX__)
+#define MATRIX_D_AVX
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+#define MATRIX_D_NEON
+#endif
+#endif
+
+#if !defined(MATRIX_D_SSE) && !defined(MATRIX_D_NEON)
+#define MATRIX_D_SCALAR
+#endif
+
+#if defined(MATRIX_D_AVX)
+#include <immintrin.h>
+#elif defined(MATRIX_D_SSE)
+#include <xmmintrin.h>
+#elif defined(MATRIX_D_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace math
+{
+	/**The scalar reference implementations. Always available, regardless of the selected SIMD path.*/
+	namespace scalar
+	{
+		/**out = a * b, for two column-major 4x4 matrices. out may alias a or b.*/
+		template<class Real>
+		inline void mul4x4(const Real* a, const Real* b, Real* out)
+		{
+			Real r[16];
+			for (int c = 0; c < 4; ++c)
+				for (int row = 0; row < 4; ++row)
+					r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] +
+						a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+			for (int i = 0; i < 16; ++i)
+				out[i] = r[i];
+		}
+
+		/**out = m * v, for a column-major 4x4 matrix and a 4 component vector. out may alias v.*/
+		template<class Real>
+		inline void mul4x4Vec(const Real* m, const Real* v, Real* out)
+		{
+			Real r[4];
+			for (int row = 0; row < 4; ++row)
+				r[row] = m[row] * v[0] + m[4 + row] * v[1] + m[8 + row] * v[2] + m[12 + row] * v[3];
+			out[0] = r[0]; out[1] = r[1]; out[2] = r[2]; out[3] = r[3];
+		}
+
+		/**out = transpose(m). out may alias m.*/
+		template<class Real>
+		inline void transpose4x4(const Real* m, Real* out)
+		{
+			Real r[16];
+			for (int c = 0; c < 4; ++c)
+				for (int row = 0; row < 4; ++row)
+					r[row * 4 + c] = m[c * 4 + row];
+			for (int i = 0; i < 16; ++i)
+				out[i] = r[i];
+		}
+
+		/**out = a * b, for two affine matrices stored as four columns of three (mat3x4). out may alias a or b.*/
+		template<class Real>
+		inline void mul3x4(const Real* a, const Real* b, Real* out)
+		{
+			//a is read into locals up front, so it need not be reloaded after every store through a possibly aliasing out.
+			const Real a00 = a[0], a01 = a[1], a02 = a[2];
+			const Real a10 = a[3], a11 = a[4], a12 = a[5];
+			const Real a20 = a[6], a21 = a[7], a22 = a[8];
+			const Real a30 = a[9], a31 = a[10], a32 = a[11];
+			Real r[12];
+			for (int c = 0; c < 12; c += 3)
+			{
+				const Real b0 = b[c], b1 = b[c + 1], b2 = b[c + 2];
+				r[c] = a00 * b0 + a10 * b1 + a20 * b2;
+				r[c + 1] = a01 * b0 + a11 * b1 + a21 * b2;
+				r[c + 2] = a02 * b0 + a12 * b1 + a22 * b2;
+			}
+			out[0] = r[0]; out[1] = r[1]; out[2] = r[2];
+			out[3] = r[3]; out[4] = r[4]; out[5] = r[5];
+			out[6] = r[6]; out[7] = r[7]; out[8] = r[8];
+			out[9] = r[9] + a30; out[10] = r[10] + a31; out[11] = r[11] + a32;
+		}
+
+		/**out = inverse(m) by cofactor expansion. Returns false and leaves out untouched if m is singular.
+		The same code serves either storage order, since the inverse of a transpose is the transpose of the inverse.
+		out may alias m.*/
+		template<class Real>
+		inline bool inverse4x4(const Real* m, Real* out)
+		{
+			Real inv[16];
+			inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] +
+				m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+			inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] -
+				m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+			inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] +
+				m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+			inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] -
+				m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+			inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] -
+				m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+			inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] +
+				m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+			inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] -
+				m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+			inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] +
+				m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+			inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] +
+				m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+			inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] -
+				m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+			inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] +
+				m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+			inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] -
+				m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+			inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] -
+				m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+			inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] +
+				m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+			inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] -
+				m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+			inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] +
+				m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+			const Real det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+			if (det == 0)
+				return false;
+
+			const Real invDet = Real(1) / det;
+			for (int i = 0; i < 16; ++i)
+				out[i] = inv[i] * invDet;
+			return true;
+		}
+
+		template<class Real>
+		inline void add4(const Real* a, const Real* b, Real* out)
+		{ out[0] = a[0] + b[0]; out[1] = a[1] + b[1]; out[2] = a[2] + b[2]; out[3] = a[3] + b[3]; }
+
+		template<class Real>
+		inline void sub4(const Real* a, const Real* b, Real* out)
+		{ out[0] = a[0] - b[0]; out[1] = a[1] - b[1]; out[2] = a[2] - b[2]; out[3] = a[3] - b[3]; }
+
+		template<class Real>
+		inline void mul4(const Real* a, const Real* b, Real* out)
+		{ out[0] = a[0] * b[0]; out[1] = a[1] * b[1]; out[2] = a[2] * b[2]; out[3] = a[3] * b[3]; }
+
+		template<class Real>
+		inline void div4(const Real* a, const Real* b, Real* out)
+		{ out[0] = a[0] / b[0]; out[1] = a[1] / b[1]; out[2] = a[2] / b[2]; out[3] = a[3] / b[3]; }
+
+		template<class Real>
+		inline void scale4(const Real* a, const Real s, Real* out)
+		{ out[0] = a[0] * s; out[1] = a[1] * s; out[2] = a[2] * s; out[3] = a[3] * s; }
+
+		template<class Real>
+		inline Real dot4(const Real* a, const Real* b)
+		{ return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]; }
+	}
+
+	/**The kernels used by the library. Fall back to the scalar reference when no SIMD path is available.*/
+	namespace simd
+	{
+#if defined(MATRIX_D_SSE)
+
+		inline void mul4x4(const float* a, const float* b, float* out)
+		{
+			const __m128 a0 = _mm_loadu_ps(a);
+			const __m128 a1 = _mm_loadu_ps(a + 4);
+			const __m128 a2 = _mm_loadu_ps(a + 8);
+			const __m128 a3 = _mm_loadu_ps(a + 12);
+
+#if defined(MATRIX_D_AVX)
+			//Two output columns per iteration. Column c only reads column c of b, so aliasing stays safe.
+			const __m256 a00 = _mm256_set_m128(a0, a0);
+			const __m256 a11 = _mm256_set_m128(a1, a1);
+			const __m256 a22 = _mm256_set_m128(a2, a2);
+			const __m256 a33 = _mm256_set_m128(a3, a3);
+
+			for (int c = 0; c < 16; c += 8)
+			{
+				const __m256 bc = _mm256_loadu_ps(b + c);
+				__m256 r = _mm256_mul_ps(a00, _mm256_permute_ps(bc, 0x00));
+				r = _mm256_add_ps(r, _mm256_mul_ps(a11, _mm256_permute_ps(bc, 0x55)));
+				r = _mm256_add_ps(r, _mm256_mul_ps(a22, _mm256_permute_ps(bc, 0xAA)));
+				r = _mm256_add_ps(r, _mm256_mul_ps(a33, _mm256_permute_ps(bc, 0xFF)));
+				_mm256_storeu_ps(out + c, r);
+			}
+#else
+			for (int c = 0; c < 16; c += 4)
+			{
+				const __m128 bc = _mm_loadu_ps(b + c);
+				__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00));
+				r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55)));
+				r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xAA)));
+				r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xFF)));
+				_mm_storeu_ps(out + c, r);
+			}
+#endif
+		}
+
+		inline void mul4x4Vec(const float* m, const float* v, float* out)
+		{
+			__m128 r = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0]));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4), _mm_set1_ps(v[1])));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8), _mm_set1_ps(v[2])));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(v[3])));
+			_mm_storeu_ps(out, r);
+		}
+
+		/**Loads the twelve floats of a mat3x4 as four columns, each with a junk fourth lane. The data is moved as three
+		whole vectors and shuffled, rather than with loads that straddle columns, so chained products still benefit
+		from store forwarding.*/
+		inline void load3x4(const float* m, __m128& c0, __m128& c1, __m128& c2, __m128& c3)
+		{
+			const __m128 l0 = _mm_loadu_ps(m);
+			const __m128 l1 = _mm_loadu_ps(m + 4);
+			const __m128 l2 = _mm_loadu_ps(m + 8);
+			const __m128 t = _mm_shuffle_ps(l0, l1, _MM_SHUFFLE(1, 0, 3, 3));
+			c0 = l0;
+			c1 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 2, 0));
+			c2 = _mm_shuffle_ps(l1, l2, _MM_SHUFFLE(0, 0, 3, 2));
+			c3 = _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(3, 3, 2, 1));
+		}
+
+		/**Returns a0 * x + a1 * y + a2 * z, where x, y and z hold one value in every lane.*/
+		inline __m128 mulColumn3(__m128 a0, __m128 a1, __m128 a2, __m128 x, __m128 y, __m128 z)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, x), _mm_mul_ps(a1, y)), _mm_mul_ps(a2, z));
+		}
+
+		/**Returns a0 * bc.x + a1 * bc.y + a2 * bc.z.*/
+		inline __m128 mulColumn3(__m128 a0, __m128 a1, __m128 a2, __m128 bc)
+		{
+			return mulColumn3(a0, a1, a2, _mm_shuffle_ps(bc, bc, 0x00), _mm_shuffle_ps(bc, bc, 0x55),
+				_mm_shuffle_ps(bc, bc, 0xAA));
+		}
+
+		inline void mul3x4(const float* a, const float* b, float* out)
+		{
+			__m128 a0, a1, a2, a3;
+			load3x4(a, a0, a1, a2, a3);
+
+#if defined(MATRIX_D_AVX)
+			//AVX broadcasts straight from memory in a single load, which is cheaper than shuffling.
+			const __m128 r0 = mulColumn3(a0, a1, a2, _mm_broadcast_ss(b), _mm_broadcast_ss(b + 1), _mm_broadcast_ss(b + 2));
+			const __m128 r1 = mulColumn3(a0, a1, a2, _mm_broadcast_ss(b + 3), _mm_broadcast_ss(b + 4), _mm_broadcast_ss(b + 5));
+			const __m128 r2 = mulColumn3(a0, a1, a2, _mm_broadcast_ss(b + 6), _mm_broadcast_ss(b + 7), _mm_broadcast_ss(b + 8));
+			const __m128 r3 = _mm_add_ps(mulColumn3(a0, a1, a2,
+				_mm_broadcast_ss(b + 9), _mm_broadcast_ss(b + 10), _mm_broadcast_ss(b + 11)), a3);
+#else
+			__m128 b0, b1, b2, b3;
+			load3x4(b, b0, b1, b2, b3);
+
+			const __m128 r0 = mulColumn3(a0, a1, a2, b0);
+			const __m128 r1 = mulColumn3(a0, a1, a2, b1);
+			const __m128 r2 = mulColumn3(a0, a1, a2, b2);
+			const __m128 r3 = _mm_add_ps(mulColumn3(a0, a1, a2, b3), a3);
+#endif
+
+			const __m128 t0 = _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(0, 0, 2, 2));
+			const __m128 t2 = _mm_shuffle_ps(r2, r3, _MM_SHUFFLE(0, 0, 2, 2));
+			_mm_storeu_ps(out, _mm_shuffle_ps(r0, t0, _MM_SHUFFLE(2, 0, 1, 0)));
+			_mm_storeu_ps(out + 4, _mm_shuffle_ps(r1, r2, _MM_SHUFFLE(1, 0, 2, 1)));
+			_mm_storeu_ps(out + 8, _mm_shuffle_ps(t2, r3, _MM_SHUFFLE(2, 1, 2, 0)));
+		}
+
+		inline void transpose4x4(const float* m, float* out)
+		{
+			__m128 c0 = _mm_loadu_ps(m);
+			__m128 c1 = _mm_loadu_ps(m + 4);
+			__m128 c2 = _mm_loadu_ps(m + 8);
+			__m128 c3 = _mm_loadu_ps(m + 12);
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			_mm_storeu_ps(out, c0);
+			_mm_storeu_ps(out + 4, c1);
+			_mm_storeu_ps(out + 8, c2);
+			_mm_storeu_ps(out + 12, c3);
+		}
+
+#define MATRIX_D_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MATRIX_D_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+
+		//Helpers for the inverse, which treats each __m128 as a 2x2 block (x y / z w).
+
+		/**a * b for 2x2 blocks.*/
+		inline __m128 mul2x2(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, MATRIX_D_SWIZZLE(b, 0, 3, 0, 3)),
+				_mm_mul_ps(MATRIX_D_SWIZZLE(a, 1, 0, 3, 2), MATRIX_D_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		/**adjugate(a) * b for 2x2 blocks.*/
+		inline __m128 adjMul2x2(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(MATRIX_D_SWIZZLE(a, 3, 3, 0, 0), b),
+				_mm_mul_ps(MATRIX_D_SWIZZLE(a, 1, 1, 2, 2), MATRIX_D_SWIZZLE(b, 2, 3, 0, 1)));
+		}
+
+		/**a * adjugate(b) for 2x2 blocks.*/
+		inline __m128 mulAdj2x2(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, MATRIX_D_SWIZZLE(b, 3, 0, 3, 0)),
+				_mm_mul_ps(MATRIX_D_SWIZZLE(a, 1, 0, 3, 2), MATRIX_D_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+
+		/**Block-wise inverse of a 4x4 matrix: with M = (A B / C D) in 2x2 blocks, every block of the inverse is
+		built from 2x2 products and adjugates, and |M| = |A||D| + |B||C| - tr((A#B)(D#C)).
+		The columns are treated as rows, which is fine since the inverse of a transpose is the transpose of the inverse.*/
+		inline bool inverse4x4(const float* m, float* out)
+		{
+			const __m128 c0 = _mm_loadu_ps(m);
+			const __m128 c1 = _mm_loadu_ps(m + 4);
+			const __m128 c2 = _mm_loadu_ps(m + 8);
+			const __m128 c3 = _mm_loadu_ps(m + 12);
+
+			const __m128 a = _mm_movelh_ps(c0, c1);
+			const __m128 b = _mm_movehl_ps(c1, c0);
+			const __m128 c = _mm_movelh_ps(c2, c3);
+			const __m128 d = _mm_movehl_ps(c3, c2);
+
+			//(|A|, |B|, |C|, |D|):
+			const __m128 detSub = _mm_sub_ps(
+				_mm_mul_ps(MATRIX_D_SHUFFLE(c0, c2, 0, 2, 0, 2), MATRIX_D_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+				_mm_mul_ps(MATRIX_D_SHUFFLE(c0, c2, 1, 3, 1, 3), MATRIX_D_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+			const __m128 detA = MATRIX_D_SWIZZLE(detSub, 0, 0, 0, 0);
+			const __m128 detB = MATRIX_D_SWIZZLE(detSub, 1, 1, 1, 1);
+			const __m128 detC = MATRIX_D_SWIZZLE(detSub, 2, 2, 2, 2);
+			const __m128 detD = MATRIX_D_SWIZZLE(detSub, 3, 3, 3, 3);
+
+			const __m128 dc = adjMul2x2(d, c);
+			const __m128 ab = adjMul2x2(a, b);
+			__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mul2x2(b, dc));
+			__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mul2x2(c, ab));
+			__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mulAdj2x2(d, ab));
+			__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mulAdj2x2(a, dc));
+
+			__m128 tr = _mm_mul_ps(ab, MATRIX_D_SWIZZLE(dc, 0, 2, 1, 3));
+			tr = _mm_add_ps(tr, MATRIX_D_SWIZZLE(tr, 2, 3, 0, 1));
+			tr = _mm_add_ps(tr, MATRIX_D_SWIZZLE(tr, 1, 0, 3, 2));
+			const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+			if (_mm_cvtss_f32(detM) == 0)
+				return false;
+
+			//The adjugate of each block flips the sign of its off-diagonal:
+			const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+			x = _mm_mul_ps(x, rDetM);
+			y = _mm_mul_ps(y, rDetM);
+			z = _mm_mul_ps(z, rDetM);
+			w = _mm_mul_ps(w, rDetM);
+
+			_mm_storeu_ps(out, MATRIX_D_SHUFFLE(x, y, 3, 1, 3, 1));
+			_mm_storeu_ps(out + 4, MATRIX_D_SHUFFLE(x, y, 2, 0, 2, 0));
+			_mm_storeu_ps(out + 8, MATRIX_D_SHUFFLE(z, w, 3, 1, 3, 1));
+			_mm_storeu_ps(out + 12, MATRIX_D_SHUFFLE(z, w, 2, 0, 2, 0));
+			return true;
+		}
+
+#undef MATRIX_D_SHUFFLE
+#undef MATRIX_D_SWIZZLE
+
+		inline void add4(const float* a, const float* b, float* out)
+		{ _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+		inline void sub4(const float* a, const float* b, float* out)
+		{ _mm_storeu_ps(out, _mm_sub_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+		inline void mul4(const float* a, const float* b, float* out)
+		{ _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+		inline void div4(const float* a, const float* b, float* out)
+		{ _mm_storeu_ps(out, _mm_div_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))); }
+
+		inline void scale4(const float* a, const float s, float* out)
+		{ _mm_storeu_ps(out, _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(s))); }
+
+		inline float dot4(const float* a, const float* b)
+		{
+			//Summed as ((x + y) + z) + w to match the scalar reference.
+			const __m128 p = _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b));
+			__m128 r = _mm_add_ss(p, _mm_shuffle_ps(p, p, 0x55));
+			r = _mm_add_ss(r, _mm_shuffle_ps(p, p, 0xAA));
+			r = _mm_add_ss(r, _mm_shuffle_ps(p, p, 0xFF));
+			return _mm_cvtss_f32(r);
+		}
+
+#elif defined(MATRIX_D_NEON)
+
+		inline void mul4x4(const float* a, const float* b, float* out)
+		{
+			const float32x4_t a0 = vld1q_f32(a);
+			const float32x4_t a1 = vld1q_f32(a + 4);
+			const float32x4_t a2 = vld1q_f32(a + 8);
+			const float32x4_t a3 = vld1q_f32(a + 12);
+
+			for (int c = 0; c < 16; c += 4)
+			{
+				float32x4_t r = vmulq_n_f32(a0, b[c]);
+				r = vaddq_f32(r, vmulq_n_f32(a1, b[c + 1]));
+				r = vaddq_f32(r, vmulq_n_f32(a2, b[c + 2]));
+				r = vaddq_f32(r, vmulq_n_f32(a3, b[c + 3]));
+				vst1q_f32(out + c, r);
+			}
+		}
+
+		inline void mul4x4Vec(const float* m, const float* v, float* out)
+		{
+			float32x4_t r = vmulq_n_f32(vld1q_f32(m), v[0]);
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m + 4), v[1]));
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m + 8), v[2]));
+			r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(m + 12), v[3]));
+			vst1q_f32(out, r);
+		}
+
+		inline void mul3x4(const float* a, const float* b, float* out)
+		{
+			const float32x4_t a0 = vld1q_f32(a);
+			const float32x4_t a1 = vld1q_f32(a + 3);
+			const float32x4_t a2 = vld1q_f32(a + 6);
+			const float32x4_t a3 = vcombine_f32(vld1_f32(a + 9), vld1_lane_f32(a + 11, vdup_n_f32(0), 0));
+
+			float32x4_t r[4];
+			for (int c = 0; c < 4; ++c)
+			{
+				r[c] = vmulq_n_f32(a0, b[c * 3]);
+				r[c] = vaddq_f32(r[c], vmulq_n_f32(a1, b[c * 3 + 1]));
+				r[c] = vaddq_f32(r[c], vmulq_n_f32(a2, b[c * 3 + 2]));
+			}
+			r[3] = vaddq_f32(r[3], a3);
+
+			vst1q_f32(out, r[0]);
+			vst1q_f32(out + 3, r[1]);
+			vst1q_f32(out + 6, r[2]);
+			vst1_f32(out + 9, vget_low_f32(r[3]));
+			vst1q_lane_f32(out + 11, r[3], 2);
+		}
+
+		inline void transpose4x4(const float* m, float* out)
+		{
+			//vld4 de-interleaves, which is exactly a 4x4 transpose.
+			const float32x4x4_t t = vld4q_f32(m);
+			vst1q_f32(out, t.val[0]);
+			vst1q_f32(out + 4, t.val[1]);
+			vst1q_f32(out + 8, t.val[2]);
+			vst1q_f32(out + 12, t.val[3]);
+		}
+
+		//The block-wise SSE inverse relies on shuffles with no cheap NEON equivalent; keep the reference path.
+		inline bool inverse4x4(const float* m, float* out)
+		{ return scalar::inverse4x4(m, out); }
+
+		inline void add4(const float* a, const float* b, float* out)
+		{ vst1q_f32(out, vaddq_f32(vld1q_f32(a), vld1q_f32(b))); }
+
+		inline void sub4(const float* a, const float* b, float* out)
+		{ vst1q_f32(out, vsubq_f32(vld1q_f32(a), vld1q_f32(b))); }
+
+		inline void mul4(const float* a, const float* b, float* out)
+		{ vst1q_f32(out, vmulq_f32(vld1q_f32(a), vld1q_f32(b))); }
+
+		//NEON has no exact vector divide on 32 bit ARM; keep the reference path.
+		inline void div4(const float* a, const float* b, float* out)
+		{ scalar::div4(a, b, out); }
+
+		inline void scale4(const float* a, const float s, float* out)
+		{ vst1q_f32(out, vmulq_n_f32(vld1q_f32(a), s)); }
+
+		inline float dot4(const float* a, const float* b)
+		{ return scalar::dot4(a, b); }
+
+#else
+
+		using scalar::mul4x4;
+		using scalar::mul4x4Vec;
+		using scalar::mul3x4;
+		using scalar::transpose4x4;
+		using scalar::inverse4x4;
+		using scalar::add4;
+		using scalar::sub4;
+		using scalar::mul4;
+		using scalar::div4;
+		using scalar::scale4;
+		using scalar::dot4;
+
+#endif
+
+		/**Returns the name of the compiled SIMD path, for logging and benchmarks.*/
+		inline const char* pathName()
+		{
+#if defined(MATRIX_D_AVX)
+			return "AVX";
+#elif defined(MATRIX_D_SSE)
+			return "SSE";
+#elif defined(MATRIX_D_NEON)
+			return "NEON";
+#else
+			return "Scalar";
+#endif
+		}
+	}
+}
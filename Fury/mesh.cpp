@@ -1,17 +1,19 @@
 #include "mesh.h"
-#include "vmfheader.h"
 #include "immediateio.h"
-#include <fstream>
 #include "directx.h"
 #include "renderwindow.h"
 #include "camera.h"
 #include "shader.h"
 #include "shaderbuffertypes.h"
+#include "renderbackend.h"
 
-Mesh::Mesh() : m_inCPU(0),  m_vertexCount(0), m_indexCount(0){}
+//The scale static meshes are drawn at, applied after their world transformation.
+const float kModelScale = 0.2f;
+
+Mesh::Mesh() : m_inCPU(0),  m_vertexCount(0), m_indexCount(0), m_vertexFormat(VERTEX_FLOAT), m_boundsRadius(0) {}
 
 Mesh::Mesh(const char *path) : m_inCPU(0),
-							   m_vertexCount(0), m_indexCount(0)
+							   m_vertexCount(0), m_indexCount(0), m_vertexFormat(VERTEX_FLOAT), m_boundsRadius(0)
 {
 	load(path);
 }
@@ -27,40 +29,26 @@ bool Mesh::load(const char *path)
 
 	Inform(std::string("Loading object: \"") + fileLocation + "\"");
 
-	std::ifstream modelFile(fileLocation, std::ios::binary);
-	modelFile.seekg(0);
-
-	if (modelFile.fail())
+	m_inCPU = false;
+	m_subMeshes.clear();
+	const VMFFile::Status status = m_file.open(path);
+	if (status != VMFFile::OK)
 	{
-		Warning(std::string("Could not open \"") + fileLocation + "\"!\n" + strerror(errno));
+		Warning(std::string("Could not load \"") + fileLocation + "\"!\n" + VMFFile::describe(status));
 		return false;
 	}
 
 	m_location = path;
 
-	//Read in header
-	VMFHeader header;
-	modelFile.read(reinterpret_cast<char*>(&header), sizeof(header));
-
-	m_vertexCount	= header.vertCount;
-	m_indexCount	= header.indexCount;
-
-	m_vertices.clear();
-	m_indices.clear();
-	m_inCPU = false;
-
-	//Fill vectors from file:
-	if (header.vertCount > 0)
-	{
-		m_vertices.resize(header.vertCount);
-		modelFile.read(reinterpret_cast<char*>(&m_vertices[0]), header.vertCount*sizeof(m_vertices[0]));
-	}
-	if (header.indexCount > 0)
-	{
-		m_indices.resize(header.indexCount);
-		modelFile.read(reinterpret_cast<char*>(&m_indices[0]), header.indexCount*sizeof(ElementIndexType));
-	}
-	//
+	const VMFFile::Bounds& bounds = m_file.bounds();
+	m_vertexCount	= m_file.vertexCount();
+	m_indexCount	= m_file.indexCount();
+	m_vertexFormat	= m_file.vertexFormat();
+	m_boundsCentre	= math::vec3(bounds.centre[0], bounds.centre[1], bounds.centre[2]);
+	m_boundsRadius	= bounds.radius;
+	m_boundsMin		= math::vec3(bounds.min[0], bounds.min[1], bounds.min[2]);
+	m_boundsMax		= math::vec3(bounds.max[0], bounds.max[1], bounds.max[2]);
+	m_subMeshes.assign(m_file.subMeshes(), m_file.subMeshes() + m_file.subMeshCount());
 
 	m_inCPU = true;
 	return true;
@@ -68,12 +56,11 @@ bool Mesh::load(const char *path)
 
 void Mesh::clearCPU()
 {
-	m_vertices.clear();
-	m_indices.clear();
+	m_file.close();
 	m_inCPU = false;
 }
 
-bool RenderMesh::upload(RenderWindow* window, Enum::Usage vertexUsage)
+bool RenderMesh::upload(RenderWindow* window, Enum::Usage vertexUsage, bool keepInCPU)
 {
 	if (!window)
 		return false;
@@ -92,25 +79,28 @@ bool RenderMesh::upload(RenderWindow* window, Enum::Usage vertexUsage)
 
 		//Set up the vertex buffer
 		vertexBufferDesc.Usage = (D3D11_USAGE)vertexUsage;
-		vertexBufferDesc.ByteWidth = sizeof(Vertex3D)*m_vertices.size();
+		vertexBufferDesc.ByteWidth = m_file.vertexBytes();
 		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 
-		vertexData.pSysMem = &m_vertices[0];
-		vertexData.SysMemPitch = sizeof(Vertex3D)*m_vertices.size();
+		//Straight from the mapping: the driver's copy is the only one made.
+		vertexData.pSysMem = m_file.vertexData();
+		vertexData.SysMemPitch = m_file.vertexBytes();
 		
 		if (FAILED(dx.getDevice()->CreateBuffer(&vertexBufferDesc, &vertexData, &gpuInfo.vertexBuffer)))
 			return false;
 
 		//Set up the index buffer
 		indexBufferDesc.Usage = (D3D11_USAGE)vertexUsage;
-		indexBufferDesc.ByteWidth = sizeof(ElementIndexType)*m_indices.size();
+		indexBufferDesc.ByteWidth = m_file.indexBytes();
 		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
-		indexData.pSysMem = &m_indices[0];
+		indexData.pSysMem = m_file.indices();
 
 		if (FAILED(dx.getDevice()->CreateBuffer(&indexBufferDesc, &indexData, &gpuInfo.indexBuffer)))
 			return false;
 
+		if (!keepInCPU)
+			clearCPU();
 
 		return true;
 	}
@@ -139,26 +129,104 @@ void Mesh::clear()
 	clearCPU();
 }
 
-void StaticMeshInstance::draw(RenderWindow* renderWindow, const math::mat4& initialTransformMatrix, const Camera& camera)
+namespace
+{
+	Pool& instancePool()
+	{
+		static Pool pool(sizeof(StaticMeshInstance));
+		return pool;
+	}
+}
+
+void* StaticMeshInstance::operator new(size_t size)
 {
-	assert(mParent->inGPU());
+	//Classes deriving from this one are bigger than the blocks.
+	if (size != sizeof(StaticMeshInstance))
+		return ::operator new(size);
+	return instancePool().allocate();
+}
+
+void StaticMeshInstance::operator delete(void* instance, size_t size)
+{
+	if (!instance)
+		return;
+	if (size != sizeof(StaticMeshInstance))
+		::operator delete(instance);
+	else
+		instancePool().deallocate(instance);
+}
 
-	auto context = renderWindow->getDirectX().getContext();
-	const unsigned stride = sizeof(Vertex3D), start = 0;
+PoolStats StaticMeshInstance::poolStats()
+{
+	return instancePool().stats();
+}
+
+bool StaticMeshInstance::worldBounds(const math::mat3x4& worldMatrix, math::vec3& centre, float& radius) const
+{
+	if (mParent->boundsRadius() <= 0)
+		return false;
 
-	context->IASetVertexBuffers(0, 1, &mParent->gpuInfo.vertexBuffer, &stride, &start);
-	context->IASetIndexBuffer(mParent->gpuInfo.indexBuffer, ELEMENT_INDEX_TYPE_ENUM, 0);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	centre = worldMatrix.transformPoint(mParent->boundsCentre()) * kModelScale;
+	radius = mParent->boundsRadius() * worldMatrix.getMaxScale() * kModelScale;
+	return true;
+}
 
-	VertexBufferStaticmesh vertexUniforms;
-	vertexUniforms.projection = camera.projection();
-	vertexUniforms.view = camera.matrix();
-	vertexUniforms.world = math::mat4().initScale(0.2f)*initialTransformMatrix;
+void StaticMeshInstance::enqueue(RenderQueue& queue, RenderWindow* renderWindow, const math::mat3x4& worldMatrix)
+{
+	DrawPacket packet;
+	packet.drawable = this;
+	packet.shader = renderWindow->getActiveShader();
+	packet.texture = mTexture && mTexture->inGPU() ? mTexture : NULL;
+	packet.mesh = mParent;
+	packet.batch = mParent;
+	packet.world = worldMatrix;
+	packet.sortKey = RenderQueue::makeSortKey(0,
+		packet.shader ? packet.shader->renderId().value() : 0,
+		packet.texture ? packet.texture->renderId().value() : 0,
+		mParent->renderId().value(),
+		queue.viewDepth(worldMatrix.getTranslation() * kModelScale));
+	queue.add(packet);
+}
 
-	PixelBufferStaticmesh pixelUniforms;
-	pixelUniforms.colour = mColour;
+void StaticMeshInstance::draw(RenderBackend& backend, const DrawPacket* const* packets, size_t count,
+	const Camera& camera)
+{
+	const DrawPacket& first = *packets[0];
+	backend.setShader(first.shader);
+	backend.setMesh(mParent);
+	if (first.texture)
+		backend.setTexture(first.texture);
+
+	InstanceStaticmesh* instances =
+		static_cast<InstanceStaticmesh*>(backend.allocateInstances(sizeof(InstanceStaticmesh), count));
+	if (!instances)
+		return;
+
+	const math::mat4 scale = math::mat4().initScale(kModelScale);
+
+	//Quantized positions arrive in the shader as fractions of the mesh's box, so the box goes into the world
+	//matrix, after which they need no decoding; the normals do, and normal[0].w says how.
+	const bool quantized = mParent->vertexFormat() != VERTEX_FLOAT;
+	const math::vec3 boxMin = mParent->boundsMin(), boxSize = mParent->boundsMax() - mParent->boundsMin();
+	const math::mat4 decode = quantized ? math::mat4::translation(boxMin.x, boxMin.y, boxMin.z) *
+		math::mat4::scaling(boxSize.x, boxSize.y, boxSize.z) : math::mat4::identity();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const math::mat4 world = scale * packets[i]->world.toMat4();
+		const math::mat4 normal = world.getNormalMatrix();
+		const math::mat4 position = quantized ? world * decode : world;
+		InstanceStaticmesh& instance = instances[i];
+		for (int row = 0; row < 3; ++row)
+		{
+			instance.world[row] = math::vec4(position.m[0][row], position.m[1][row], position.m[2][row],
+				position.m[3][row]);
+			instance.normal[row] = math::vec4(normal.m[0][row], normal.m[1][row], normal.m[2][row],
+				normal.m[3][row]);
+		}
+		instance.normal[0].w = quantized ? 1.f : 0.f;
+		instance.colour = static_cast<const StaticMeshInstance*>(packets[i]->drawable)->mColour;
+	}
 
-	renderWindow->getActiveShader()->setVertexData(context, &vertexUniforms, 0);
-	renderWindow->getActiveShader()->setPixelData(context, &pixelUniforms, 0);
-	renderWindow->getActiveShader()->render(context, mParent->m_indexCount);
+	backend.drawIndexedInstanced(mParent->indexCount(), unsigned(count));
 }
\ No newline at end of file
@@ -7,15 +7,23 @@
 #include "transformable.h"
 #include "light.h"
 #include "raycasting.h"
+#include "renderqueue.h"
+#include "pool.h"
+#include "vmffile.h"
 
-/**A virtual base class designed to handle basic mesh management, such as loading, uploading to the GPU, etc. Not placable.*/
+/**A virtual base class designed to handle basic mesh management, such as loading, uploading to the GPU, etc. Not placable.
+The vertices and indices in the CPU are those of the mapped file, not a copy.*/
 class Mesh
 {
 protected:
-	std::vector < Vertex3D > m_vertices;
-	std::vector < ElementIndexType > m_indices;
+	VMFFile m_file;
 	std::string m_location;
 	unsigned m_vertexCount, m_indexCount;
+	VertexFormat m_vertexFormat;
+	math::vec3 m_boundsCentre;
+	float m_boundsRadius;
+	math::vec3 m_boundsMin, m_boundsMax;
+	std::vector<VMFSubMesh> m_subMeshes;
 	bool m_inCPU;
 
 public:
@@ -32,18 +40,79 @@ public:
 	virtual ~Mesh();
 
 	/**
-	Loads a model from a file into the CPU. Shouldn't call directly.
+	Loads a model from a file into the CPU, by mapping it. Shouldn't call directly.
 	@param path The path of the original file (.obj, etc.)
 	*/
 	bool load(const char *path);
 
+	/**Returns the vertices in the CPU, vertexCount() of them, or NULL if the mesh is not in the CPU or its vertices
+	are quantized.*/
+	const Vertex3D* vertices() const
+	{
+		return m_file.vertices();
+	}
+
+	/**Returns the indices in the CPU, indexCount() of them, or NULL if the mesh is not in the CPU.*/
+	const ElementIndexType* indices() const
+	{
+		return m_file.indices();
+	}
+
+	unsigned vertexCount() const
+	{
+		return m_vertexCount;
+	}
+
+	/**Returns the layout of the vertices. Quantized positions are fractions of the box of boundsMin() and
+	boundsMax().*/
+	VertexFormat vertexFormat() const
+	{
+		return m_vertexFormat;
+	}
+
 	std::string location()
 	{
 		return m_location;
 	}
 
+	/**Returns the centre of the sphere bounding the model, in model space, as stored in the vmf file.*/
+	const math::vec3& boundsCentre() const
+	{
+		return m_boundsCentre;
+	}
+
+	/**Returns the radius of the sphere bounding the model, or 0 if the file did not give one.*/
+	float boundsRadius() const
+	{
+		return m_boundsRadius;
+	}
+
+	/**Returns the corners of the axis aligned box bounding the model, in model space. Version 1 vmf files have none,
+	so theirs is the cube around the bounding sphere.*/
+	const math::vec3& boundsMin() const
+	{
+		return m_boundsMin;
+	}
+
+	const math::vec3& boundsMax() const
+	{
+		return m_boundsMax;
+	}
+
+	unsigned indexCount() const
+	{
+		return m_indexCount;
+	}
+
+	/**Returns the parts of the model, each a range of the indices; at least one, the whole model, once loaded.*/
+	const std::vector<VMFSubMesh>& subMeshes() const
+	{
+		return m_subMeshes;
+	}
+
 	virtual void clear();
 
+	/**Unmaps the file. The counts, bounds and sub-meshes are kept, so a mesh in the GPU can still be drawn.*/
 	void clearCPU();
 };
 
@@ -52,6 +121,7 @@ class RenderMesh : public Mesh
 {
 protected:
 	bool m_inGPU;
+	RenderId<RenderMesh> m_renderId;
 
 	struct
 	{
@@ -63,7 +133,11 @@ public:
 	RenderMesh() : Mesh(), m_inGPU(0) {}
 	RenderMesh(const char *path) : Mesh(path), m_inGPU(0) {}
 
-	bool upload(RenderWindow* window, Enum::Usage vertexUsage = Enum::USAGE_DEFAULT);
+	/**
+	Copies the mesh from the mapped file into the GPU.
+	@param keepInCPU Whether the file stays mapped afterwards. Nothing in the engine reads it once uploaded.
+	*/
+	bool upload(RenderWindow* window, Enum::Usage vertexUsage = Enum::USAGE_DEFAULT, bool keepInCPU = true);
 	void deupload();
 
 	virtual void clear();
@@ -71,6 +145,22 @@ public:
 	{
 		return m_inGPU;
 	}
+
+	/**Returns the number of the mesh in render queue sort keys.*/
+	const RenderId<RenderMesh>& renderId() const
+	{
+		return m_renderId;
+	}
+
+	ID3D11Buffer* vertexBuffer()
+	{
+		return gpuInfo.vertexBuffer;
+	}
+
+	ID3D11Buffer* indexBuffer()
+	{
+		return gpuInfo.indexBuffer;
+	}
 };
 
 
@@ -83,19 +173,32 @@ class StaticMeshInstance : public Drawable
 protected:
 	friend class StaticMesh;
 
-	TextureGPU mTexture;
+	TextureGPU* mTexture;
 	StaticMesh* mParent;
 	math::vec4 mColour;
 
 	StaticMeshInstance(StaticMesh* parent) : Drawable(Drawable::TYPE_STATICMESH)
 	{
+		mTexture = NULL;
 		mParent = parent;
 		mColour = math::vec4(1, 1, 1, 1);
 	}
 
 public:
 
-	virtual void draw(RenderWindow* renderWindow, const math::mat4& initialTransformMatrix, const Camera& camera);
+	/**Instances are allocated from a pool shared by all static meshes, so that they sit together in memory.*/
+	static void* operator new(size_t size);
+	static void operator delete(void* instance, size_t size);
+
+	/**Returns how many instances the pool holds and how much room it has.*/
+	static PoolStats poolStats();
+
+	virtual bool worldBounds(const math::mat3x4& worldMatrix, math::vec3& centre, float& radius) const;
+
+	virtual void enqueue(RenderQueue& queue, RenderWindow* renderWindow, const math::mat3x4& worldMatrix);
+
+	/**Draws the batch as instances of the mesh, with each instance's world matrix and colour.*/
+	virtual void draw(RenderBackend& backend, const DrawPacket* const* packets, size_t count, const Camera& camera);
 
 	//void setAffectingLight(Light* light)
 	//{
@@ -107,6 +210,13 @@ public:
 		mColour = c;
 	}
 
+	/**Draws the instance with the texture, which must outlive it, bound through the backend; NULL for none.
+	Instances sharing a texture batch together.*/
+	void setTexture(TextureGPU* texture)
+	{
+		mTexture = texture;
+	}
+
 	StaticMesh* parent()
 	{
 		return mParent;
@@ -128,7 +238,7 @@ public:
 		load(path.c_str());
 	}
 
-	/*Returns a new instance. Memory management is up to the user.*/
+	/*Returns a new instance, which the user deletes when done with it.*/
 	StaticMeshInstance* createInstance()
 	{
 		return new StaticMeshInstance(this);
@@ -15,25 +15,25 @@ void Movable::setPos(float x, float y, float z)
 	m_pos.x = x;
 	m_pos.y = y;
 	m_pos.z = z;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::setPos(const math::vec3 & pos)
 {
 	m_pos = pos;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::setRot(const math::Quaternion & quat)
 {
 	m_rot = quat;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::setScale(float scale)
 {
 	m_scale = scale;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::move(float x, float y, float z)
@@ -41,7 +41,7 @@ void Movable::move(float x, float y, float z)
 	m_pos.x += x;
 	m_pos.y += y;
 	m_pos.z += z;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::move(const math::vec3& delta)
@@ -49,26 +49,25 @@ void Movable::move(const math::vec3& delta)
 	m_pos.x+=delta.x;
 	m_pos.y+=delta.y;
 	m_pos.z+=delta.z;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::rotate(float x, float y, float z, float w)
 {
 	// ///
 	setRot(math::Quaternion(x, y, z, w)); //To be extended
-	m_pendingMatrixUpdate = true;
 }
 
 void Movable::rotate(const math::Quaternion & quat)
 {
 	m_rot = quat*m_rot;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 void Movable::scale(float scale)
 {
 	m_scale *= scale;
-	m_pendingMatrixUpdate = true;
+	invalidate();
 }
 
 math::vec3 Movable::getPos()
@@ -126,6 +125,11 @@ void Movable::resetPos()
 	m_pos.reset();
 	m_rot.reset();
 	m_scale = 0;
+	invalidate();
+}
+
+void Movable::invalidate()
+{
 	m_pendingMatrixUpdate = true;
 }
 
@@ -11,6 +11,10 @@ protected:
 protected:
 	bool m_pendingMatrixUpdate;
 
+	/**Called by every setter after the transformation changed. Marks the matrix as pending an update;
+	overrides must call this version too.*/
+	virtual void invalidate();
+
 public:
 
 	/**Initialises the pendingUpdate variable to true.*/
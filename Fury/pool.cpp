@@ -0,0 +1,185 @@
+#include "pool.h"
+#include <assert.h>
+#include <new>
+
+const size_t Pool::kAlignment;
+const size_t Arena::kMaxPooledSize;
+const size_t Arena::kPoolCount;
+const size_t Arena::kHeapHeaderSize;
+
+Pool::Pool(size_t blockSize, size_t blocksPerChunk)
+	: mBlockSize((blockSize + kAlignment - 1) / kAlignment * kAlignment), mBlocksPerChunk(blocksPerChunk),
+	mChunk(0), mNextBlock(0), mFreeList(NULL), mLive(0), mPeak(0), mUsed(0)
+{
+	assert(blockSize > 0 && blocksPerChunk > 0);
+}
+
+Pool::~Pool()
+{
+	release();
+}
+
+void* Pool::allocate()
+{
+	void* block;
+	if (mFreeList)
+	{
+		block = mFreeList;
+		mFreeList = mFreeList->next;
+	}
+	else
+	{
+		if (mNextBlock == mBlocksPerChunk)
+		{
+			++mChunk;
+			mNextBlock = 0;
+		}
+		if (mChunk == mChunks.size())
+			mChunks.push_back(static_cast<char*>(::operator new(mBlockSize * mBlocksPerChunk)));
+		block = mChunks[mChunk] + mNextBlock++ * mBlockSize;
+		++mUsed;
+	}
+
+	if (++mLive > mPeak)
+		mPeak = mLive;
+	return block;
+}
+
+void Pool::deallocate(void* block)
+{
+	assert(mLive > 0);
+	FreeBlock* freed = static_cast<FreeBlock*>(block);
+	freed->next = mFreeList;
+	mFreeList = freed;
+	--mLive;
+}
+
+void Pool::reset()
+{
+	mChunk = 0;
+	mNextBlock = 0;
+	mFreeList = NULL;
+	mLive = 0;
+	mUsed = 0;
+}
+
+void Pool::release()
+{
+	reset();
+	for (size_t i = 0; i < mChunks.size(); ++i)
+		::operator delete(mChunks[i]);
+	mChunks.clear();
+}
+
+PoolStats Pool::stats() const
+{
+	PoolStats stats;
+	stats.live = mLive;
+	stats.peak = mPeak;
+	stats.used = mUsed;
+	stats.capacity = mChunks.size() * mBlocksPerChunk;
+	stats.liveBytes = mLive * mBlockSize;
+	stats.capacityBytes = stats.capacity * mBlockSize;
+	return stats;
+}
+
+Arena::Arena() : mHeapBlocks(NULL), mHeapCount(0), mHeapBytes(0), mLive(0), mPeak(0)
+{
+	//Fewer blocks per chunk for the large sizes, so a chunk stays around 64kB at most.
+	for (size_t i = 0; i < kPoolCount; ++i)
+	{
+		const size_t size = i < 16 ? (i + 1) * 16 : size_t(512) << (i - 16);
+		mPools[i] = new Pool(size, size <= 256 ? 256 : 65536 / size);
+	}
+}
+
+Arena::~Arena()
+{
+	reset();
+	for (size_t i = 0; i < kPoolCount; ++i)
+		delete mPools[i];
+}
+
+size_t Arena::poolIndex(size_t size)
+{
+	if (size <= 256)
+		return size == 0 ? 0 : (size - 1) / 16;
+
+	size_t index = 16;
+	for (size_t classSize = 512; classSize < size; classSize *= 2)
+		++index;
+	return index;
+}
+
+void* Arena::allocate(size_t size)
+{
+	if (++mLive > mPeak)
+		mPeak = mLive;
+
+	if (size <= kMaxPooledSize)
+		return mPools[poolIndex(size)]->allocate();
+
+	HeapBlock* block = static_cast<HeapBlock*>(::operator new(kHeapHeaderSize + size));
+	block->prev = NULL;
+	block->next = mHeapBlocks;
+	if (mHeapBlocks)
+		mHeapBlocks->prev = block;
+	mHeapBlocks = block;
+	++mHeapCount;
+	mHeapBytes += size;
+	return reinterpret_cast<char*>(block) + kHeapHeaderSize;
+}
+
+void Arena::deallocate(void* block, size_t size)
+{
+	assert(mLive > 0);
+	--mLive;
+
+	if (size <= kMaxPooledSize)
+	{
+		mPools[poolIndex(size)]->deallocate(block);
+		return;
+	}
+
+	HeapBlock* heapBlock = reinterpret_cast<HeapBlock*>(static_cast<char*>(block) - kHeapHeaderSize);
+	if (heapBlock->prev)
+		heapBlock->prev->next = heapBlock->next;
+	else
+		mHeapBlocks = heapBlock->next;
+	if (heapBlock->next)
+		heapBlock->next->prev = heapBlock->prev;
+	--mHeapCount;
+	mHeapBytes -= size;
+	::operator delete(heapBlock);
+}
+
+void Arena::reset()
+{
+	for (size_t i = 0; i < kPoolCount; ++i)
+		mPools[i]->reset();
+
+	while (mHeapBlocks)
+	{
+		HeapBlock* next = mHeapBlocks->next;
+		::operator delete(mHeapBlocks);
+		mHeapBlocks = next;
+	}
+	mHeapCount = 0;
+	mHeapBytes = 0;
+	mLive = 0;
+}
+
+PoolStats Arena::stats() const
+{
+	PoolStats total = { mHeapCount, mPeak, mHeapCount, 0, mHeapBytes, 0 };
+	for (size_t i = 0; i < kPoolCount; ++i)
+	{
+		const PoolStats stats = mPools[i]->stats();
+		total.live += stats.live;
+		total.used += stats.used;
+		total.capacity += stats.capacity;
+		total.liveBytes += stats.liveBytes;
+		total.capacityBytes += stats.capacityBytes;
+	}
+	return total;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/*
+Allocators for objects made and destroyed in large numbers, such as scene nodes. A Pool hands out blocks of one
+size, carved from chunks of many blocks at a time, so objects made together sit together in memory and a freed
+block is reused by the next allocation of its size. An Arena is a set of pools, one per size class, for objects
+of differing sizes that are released together.
+
+Neither is thread safe; each is meant to be used by the thread that owns the objects.
+*/
+
+/**What a pool or arena holds, for keeping an eye on memory use.*/
+struct PoolStats
+{
+	size_t live; //Blocks allocated and not yet freed.
+	size_t peak; //The most blocks live at once. Survives reset().
+	size_t used; //Blocks allocated since the last reset, freed or not.
+	size_t capacity; //Blocks in the chunks held.
+	size_t liveBytes;
+	size_t capacityBytes;
+
+	/**The share of the used blocks that were freed and not yet reused, so lie as holes between live objects.*/
+	float fragmentation() const { return used ? float(used - live) / float(used) : 0.f; }
+};
+
+/**Hands out blocks of a fixed size.*/
+class Pool
+{
+public:
+	/**The block size is rounded up to a multiple of kAlignment, which every block is aligned to.*/
+	explicit Pool(size_t blockSize, size_t blocksPerChunk = 256);
+	~Pool();
+
+	static const size_t kAlignment = 16;
+
+	void* allocate();
+
+	/**Returns a block from this pool for reuse.*/
+	void deallocate(void* block);
+
+	/**Forgets every block at once, keeping the chunks for reuse. Objects still in the pool are not destroyed,
+	so anything they own must live in the pool or an arena as well.*/
+	void reset();
+
+	/**Forgets every block and frees the chunks.*/
+	void release();
+
+	size_t blockSize() const { return mBlockSize; }
+
+	PoolStats stats() const;
+
+private:
+	Pool(const Pool&);
+	Pool& operator=(const Pool&);
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	size_t mBlockSize;
+	size_t mBlocksPerChunk;
+	std::vector<char*> mChunks;
+	size_t mChunk; //The chunk new blocks are cut from once the free list is empty.
+	size_t mNextBlock; //The first block of mChunks[mChunk] never handed out since the last reset.
+	FreeBlock* mFreeList;
+	size_t mLive, mPeak, mUsed;
+};
+
+/**Pools for every size up to kMaxPooledSize, from which larger requests go to the heap. Sizes up to 256 bytes get
+a pool per multiple of 16, larger ones a pool per power of two.*/
+class Arena
+{
+public:
+	static const size_t kMaxPooledSize = 4096;
+
+	Arena();
+	~Arena();
+
+	void* allocate(size_t size);
+
+	/**Frees a block, which must be given the size it was allocated with.*/
+	void deallocate(void* block, size_t size);
+
+	/**Forgets every block, keeping the pools' chunks; see Pool::reset(). Blocks too large for the pools are
+	freed, one by one.*/
+	void reset();
+
+	/**Returns the totals over every pool. Blocks from the heap count as live and used but not as capacity, and
+	the peak is of the arena as a whole.*/
+	PoolStats stats() const;
+
+	/**Returns the number of pools, and one of them, for a breakdown of stats() by size.*/
+	size_t poolCount() const { return kPoolCount; }
+	const Pool& pool(size_t index) const { return *mPools[index]; }
+
+private:
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+
+	static const size_t kPoolCount = 16 + 4; //16 to 256 in steps of 16, then 512 to 4096.
+
+	static size_t poolIndex(size_t size);
+
+	//Blocks from the heap are linked together through a header in front of them, for reset() to find.
+	struct HeapBlock
+	{
+		HeapBlock* prev;
+		HeapBlock* next;
+	};
+	static const size_t kHeapHeaderSize = 16;
+
+	Pool* mPools[kPoolCount];
+	HeapBlock* mHeapBlocks;
+	size_t mHeapCount, mHeapBytes;
+	size_t mLive, mPeak;
+};
+
+/**A standard allocator drawing from an arena, so that containers inside pooled objects are pooled too.*/
+template<class T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	explicit ArenaAllocator(Arena* arena) : mArena(arena) {}
+
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.arena()) {}
+
+	T* allocate(size_t n) { return static_cast<T*>(mArena->allocate(n * sizeof(T))); }
+	void deallocate(T* p, size_t n) { mArena->deallocate(p, n * sizeof(T)); }
+
+	Arena* arena() const { return mArena; }
+
+	template<class U>
+	bool operator==(const ArenaAllocator<U>& other) const { return mArena == other.arena(); }
+	template<class U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return mArena != other.arena(); }
+
+private:
+	Arena* mArena;
+};
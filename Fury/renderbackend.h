@@ -0,0 +1,99 @@
+#pragma once
+#include "statecache.h"
+#include <cstddef>
+
+class ShaderProgram;
+class RenderMesh;
+class TextureGPU;
+class CommandList;
+
+/*
+What drawables ask of the GPU, without naming the API. Drawable::draw records its calls through a backend, so the
+same drawing code runs on DirectXBackend, which issues them on a device context, and on CommandList, which only
+keeps a list of them, for recording on other threads and for tests and benchmarks that have no GPU.
+
+Draws are always instanced; per-object data goes in the instances, and a single object is one instance. What is the
+same for the whole frame, such as the camera, goes in the frame constants, shared by every shader. Bindings go
+through the backend's StateCache, so that setting what is already set costs nothing.
+
+A frame is the calls between beginFrame() and endFrame(). Backends may defer the calls to endFrame().
+
+A frame may also be recorded on several threads, each into a CommandList of its own. The backend makes ready for
+the lists with beginLists(), translates each into its own form with translateList() on the thread that recorded it,
+and issues them with executeList() in order on the thread that owns the backend. The calls on the backend itself
+before each executeList() are issued before the list. Every list starts with nothing bound but the frame constants.
+*/
+class RenderBackend
+{
+public:
+	/**The constant buffer slot of the frame constants in both stages. Shaders' own buffers follow it.*/
+	static const unsigned kFrameConstantSlot = 0;
+	static const unsigned kFirstShaderConstantSlot = 1;
+
+	/**Buffer maps since beginFrame(), and how many of them discarded the buffer's contents.*/
+	struct MapCounts
+	{
+		size_t maps;
+		size_t discards;
+	};
+
+	RenderBackend() { beginFrame(); }
+	virtual ~RenderBackend() {}
+
+	/**Fills the frame constants. Set once a frame, before the draws; the size must be a multiple of 16.*/
+	virtual void setFrameConstants(const void* data, size_t size) = 0;
+
+	/**Makes the program current, along with its constant buffers and input layout.*/
+	virtual void setShader(ShaderProgram* shader) = 0;
+
+	/**Binds the mesh's vertex and index buffers as the first vertex stream, drawn as a triangle list.*/
+	virtual void setMesh(RenderMesh* mesh) = 0;
+
+	/**Binds the texture to the pixel shader.*/
+	virtual void setTexture(TextureGPU* texture) = 0;
+
+	/**Fills a constant buffer of the current shader's vertex or pixel stage, each set a map of its own. The size must
+	match the buffer's.*/
+	virtual void setVertexConstants(unsigned slot, const void* data, size_t size) = 0;
+	virtual void setPixelConstants(unsigned slot, const void* data, size_t size) = 0;
+
+	/**Returns room for count instances of stride bytes each, to be filled before the next call on the backend and
+	drawn from the second vertex stream by the next drawIndexedInstanced.*/
+	virtual void* allocateInstances(size_t stride, size_t count) = 0;
+
+	/**Draws the first indexCount indices of the current mesh once for each of the instances last allocated.*/
+	virtual void drawIndexedInstanced(unsigned indexCount, unsigned instanceCount) = 0;
+
+	/**Starts a frame, zeroing the counts of state changes and maps.*/
+	void beginFrame()
+	{
+		mStateCache.beginFrame();
+		mMapCounts.maps = 0;
+		mMapCounts.discards = 0;
+	}
+
+	/**Ends the frame, issuing what was deferred.*/
+	virtual void endFrame() = 0;
+
+	/**Makes ready for count lists recorded on other threads this frame, before they are recorded.*/
+	virtual void beginLists(size_t count) = 0;
+
+	/**Translates a recorded list. Called on the thread that recorded it, at the same time as for other indices.*/
+	virtual void translateList(size_t index, const CommandList& list) = 0;
+
+	/**Issues a translated list after what was issued before it. Called in order of index.*/
+	virtual void executeList(size_t index, const CommandList& list) = 0;
+
+	/**Makes the next binding of each state be issued. Call after binding state behind the backend's back.*/
+	void invalidateState() { mStateCache.invalidate(); }
+
+	/**Returns the state changes issued and elided since beginFrame().*/
+	const StateCache::Counts& stateCounts() const { return mStateCache.counts(); }
+
+	/**Returns the buffer maps since beginFrame().*/
+	const MapCounts& mapCounts() const { return mMapCounts; }
+
+protected:
+	StateCache mStateCache;
+	MapCounts mMapCounts;
+};
@@ -0,0 +1,197 @@
+#include "renderqueue.h"
+#include "drawable.h"
+#include "camera.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	//Below this many packets a comparison sort beats clearing and scanning the radix histograms.
+	const size_t kRadixSortThreshold = 2048;
+
+	//Bounds the instance data of one draw call.
+	const size_t kMaxBatchSize = 1024;
+
+	//Fewer packets than this per list do not make up for recording on another thread.
+	const size_t kMinPacketsPerList = 4096;
+
+	/**Whether the packet can join the batch that began with first. Textures are compared by address, as the
+	batch binds only the first packet's.*/
+	bool batchesWith(const DrawPacket& first, const DrawPacket& packet)
+	{
+		return first.batch != NULL && packet.batch == first.batch && packet.shader == first.shader &&
+			packet.texture == first.texture && (packet.sortKey >> 60) == (first.sortKey >> 60);
+	}
+}
+
+uint64_t RenderQueue::makeSortKey(unsigned layer, unsigned shader, unsigned texture, unsigned mesh, float depth)
+{
+	//The bits of a positive float sort like the float itself, so the top 16 make a coarse but ordered depth.
+	uint32_t depthBits = 0;
+	if (depth > 0)
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return (uint64_t(layer & 0xF) << 60) |
+		(uint64_t(shader & 0xFFF) << 48) |
+		(uint64_t(texture & 0xFFFF) << 32) |
+		(uint64_t(mesh & 0xFFFF) << 16) |
+		uint64_t(depthBits >> 16);
+}
+
+RenderQueue::RenderQueue() : mBatching(true), mDrawCalls(0), mMaxLists(0), mListCount(0) {}
+
+void RenderQueue::begin(const Camera& camera)
+{
+	mPackets.clear();
+	mOrder.clear();
+	mView = camera.matrix();
+}
+
+float RenderQueue::viewDepth(const math::vec3& worldPosition) const
+{
+	return (mView * math::vec4(worldPosition, 1)).z;
+}
+
+void RenderQueue::add(const DrawPacket& packet)
+{
+	SortEntry entry = { packet.sortKey, unsigned(mPackets.size()) };
+	mOrder.push_back(entry);
+	mPackets.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+	const size_t count = mOrder.size();
+	if (count < kRadixSortThreshold)
+	{
+		std::sort(mOrder.begin(), mOrder.end(), [](const SortEntry& a, const SortEntry& b) {
+			return a.key < b.key || (a.key == b.key && a.index < b.index);
+		});
+		return;
+	}
+
+	//Least significant digit first radix sort, a byte at a time. Each pass is stable, so equal keys keep the
+	//order they were added in. Bytes that are the same in every key, such as an unused layer, are skipped.
+	size_t histogram[8][256];
+	std::memset(histogram, 0, sizeof(histogram));
+	for (size_t i = 0; i < count; ++i)
+		for (int digit = 0; digit < 8; ++digit)
+			++histogram[digit][(mOrder[i].key >> (digit * 8)) & 0xFF];
+
+	mSortScratch.resize(count);
+	SortEntry* from = &mOrder[0];
+	SortEntry* to = &mSortScratch[0];
+	for (int digit = 0; digit < 8; ++digit)
+	{
+		size_t* offsets = histogram[digit];
+		const int shift = digit * 8;
+		if (offsets[(from[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		size_t sum = 0;
+		for (int b = 0; b < 256; ++b)
+		{
+			const size_t n = offsets[b];
+			offsets[b] = sum;
+			sum += n;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			to[offsets[(from[i].key >> shift) & 0xFF]++] = from[i];
+		std::swap(from, to);
+	}
+
+	if (from != &mOrder[0])
+		mOrder.swap(mSortScratch);
+}
+
+void RenderQueue::submit(RenderBackend& backend, const Camera& camera)
+{
+	const size_t threads = mMaxLists ? mMaxLists : WorkerPool::instance().threadCount();
+	const size_t lists = std::min(threads, mOrder.size() / kMinPacketsPerList);
+	if (lists > 1)
+		submitLists(backend, camera, lists);
+	else
+	{
+		mListCount = 0;
+		mDrawCalls = submitRange(backend, mBatch, 0, mOrder.size(), camera);
+	}
+}
+
+size_t RenderQueue::submitRange(RenderBackend& backend, std::vector<const DrawPacket*>& batch, size_t begin,
+	size_t end, const Camera& camera) const
+{
+	size_t drawCalls = 0;
+	for (size_t i = begin; i < end;)
+	{
+		const DrawPacket& first = mPackets[mOrder[i++].index];
+		batch.clear();
+		batch.push_back(&first);
+		if (mBatching)
+			for (; i < end && batch.size() < kMaxBatchSize; ++i)
+			{
+				const DrawPacket& packet = mPackets[mOrder[i].index];
+				if (!batchesWith(first, packet))
+					break;
+				batch.push_back(&packet);
+			}
+
+		first.drawable->draw(backend, &batch[0], batch.size(), camera);
+		++drawCalls;
+	}
+	return drawCalls;
+}
+
+void RenderQueue::submitLists(RenderBackend& backend, const Camera& camera, size_t lists)
+{
+	mLists.resize(std::max(mLists.size(), lists));
+	mListCount = lists;
+
+	//Even runs, each end moved on past the batch it splits. Batching is an equivalence, so comparing neighbours
+	//finds where a batch ends.
+	size_t begin = 0;
+	for (size_t l = 0; l < lists; ++l)
+	{
+		size_t end = l + 1 == lists ? mOrder.size() : std::max(begin, mOrder.size() * (l + 1) / lists);
+		for (size_t moved = 0; mBatching && end != begin && end < mOrder.size() && moved < kMaxBatchSize; ++moved)
+		{
+			if (!batchesWith(mPackets[mOrder[end - 1].index], mPackets[mOrder[end].index]))
+				break;
+			++end;
+		}
+		mLists[l].begin = begin;
+		mLists[l].end = end;
+		begin = end;
+	}
+
+	backend.beginLists(lists);
+	WorkerPool::instance().parallelFor(lists, 1, [&](size_t first, size_t last) {
+		for (size_t l = first; l < last; ++l)
+		{
+			ListRecording& recording = mLists[l];
+			recording.list.clear();
+			recording.list.invalidateState();
+			recording.list.beginFrame();
+			recording.drawCalls = submitRange(recording.list, recording.batch, recording.begin, recording.end, camera);
+			backend.translateList(l, recording.list);
+		}
+	});
+
+	mDrawCalls = 0;
+	for (size_t l = 0; l < lists; ++l)
+	{
+		backend.executeList(l, mLists[l].list);
+		mDrawCalls += mLists[l].drawCalls;
+	}
+}
+
+size_t RenderQueue::size() const
+{
+	return mPackets.size();
+}
+
+const DrawPacket& RenderQueue::operator[](size_t index) const
+{
+	return mPackets[mOrder[index].index];
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "matrixd.h"
+#include "commandlist.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+The scene draws in two stages. The traversal asks every drawable to record its draw calls as packets in the
+RenderQueue, and once the whole scene is recorded the queue sorts the packets by key and submits them. Draw order
+is therefore decided by the key rather than by the shape of the tree, and recording, sorting and submission can be
+measured on their own.
+
+Packets that come together after sorting and share a batch, shader and texture are handed to the drawable in one
+call, which draws them as instances of a single draw call.
+
+Large frames are submitted on the worker pool: the sorted packets are split into runs, each recorded into a
+CommandList of its own on a worker and translated there by the backend, and the lists are executed in order on the
+calling thread. Drawable::draw must therefore be safe to call on several threads at once for different packets.
+
+A sort key holds, from the most significant bits down:
+	layer   4 bits, drawn in increasing order
+	shader 12 bits
+	texture 16 bits
+	mesh   16 bits
+	depth  16 bits, front to back
+so packets sharing a shader come together, then those sharing a texture within that, and so on.
+*/
+
+class Drawable;
+class RenderBackend;
+class Camera;
+class ShaderProgram;
+class TextureGPU;
+class RenderMesh;
+
+/**A small number naming a GPU resource in sort keys, handed out in order of creation. Each type of resource counts
+on its own, so that its field of the key stays dense and does not wrap because of the others. Copies of a resource
+share the number, which only means they sort together.*/
+template<class Resource>
+class RenderId
+{
+public:
+	RenderId() : mValue(sNext++) {}
+
+	unsigned value() const { return mValue; }
+
+private:
+	unsigned mValue;
+	static std::atomic<unsigned> sNext;
+};
+
+template<class Resource>
+std::atomic<unsigned> RenderId<Resource>::sNext(0);
+
+/**One recorded draw call. Any of the resources may be NULL if the drawable does not use one.*/
+struct DrawPacket
+{
+	uint64_t sortKey;
+	Drawable* drawable; //Issues the draw call in Drawable::draw.
+	ShaderProgram* shader;
+	TextureGPU* texture;
+	RenderMesh* mesh;
+	//Packets with the same batch, shader and texture can be drawn together, by the drawable of the first; NULL
+	//never batches. Should be a resource in the sort key, such as the mesh, so that such packets sort together.
+	const void* batch;
+	math::mat3x4 world;
+};
+
+/**The draw packets of one frame, in one buffer that keeps its memory from frame to frame.*/
+class RenderQueue
+{
+public:
+	/**Packs a sort key. Fields wider than their bits keep their low bits; depths below zero count as zero.*/
+	static uint64_t makeSortKey(unsigned layer, unsigned shader, unsigned texture, unsigned mesh, float depth);
+
+	RenderQueue();
+
+	/**Empties the queue for a new frame, viewed through the given camera.*/
+	void begin(const Camera& camera);
+
+	/**Returns the distance in front of the camera of a point, for the depth field of the sort key.*/
+	float viewDepth(const math::vec3& worldPosition) const;
+
+	/**Records a packet.*/
+	void add(const DrawPacket& packet);
+
+	/**Orders the packets by key. Packets with equal keys stay in the order they were added.*/
+	void sort();
+
+	/**Calls Drawable::draw for every batch of packets, in sorted order if sort() was called. Frames large enough
+	are recorded into command lists on the worker pool and executed on the backend in order.*/
+	void submit(RenderBackend& backend, const Camera& camera);
+
+	/**Sets the most command lists a submit records. Zero, the default, allows one for each thread of
+	WorkerPool::instance(); one submits on the calling thread only.*/
+	void setMaxLists(size_t maxLists) { mMaxLists = maxLists; }
+
+	/**Returns the number of command lists the last submit recorded, or zero if it drew on the backend directly.*/
+	size_t listCount() const { return mListCount; }
+
+	/**Sets whether packets are batched. When off, every packet is drawn on its own, as a batch of one.*/
+	void setBatching(bool batching) { mBatching = batching; }
+
+	/**Returns the number of Drawable::draw calls the last submit made, which is the number of draw calls when
+	every drawable makes one per batch.*/
+	size_t drawCalls() const { return mDrawCalls; }
+
+	/**Returns the number of packets recorded this frame.*/
+	size_t size() const;
+
+	/**Returns the packet drawn at the given position, in sorted order if sort() was called.*/
+	const DrawPacket& operator[](size_t index) const;
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		unsigned index;
+	};
+
+	/**One worker's part of a frame.*/
+	struct ListRecording
+	{
+		CommandList list;
+		std::vector<const DrawPacket*> batch;
+		size_t begin, end; //In sorted order.
+		size_t drawCalls;
+	};
+
+	/**Draws the sorted packets [begin, end) on the backend, returning the number of Drawable::draw calls.*/
+	size_t submitRange(RenderBackend& backend, std::vector<const DrawPacket*>& batch, size_t begin, size_t end,
+		const Camera& camera) const;
+
+	/**Splits the sorted packets into lists at batch boundaries and records, translates and executes them.*/
+	void submitLists(RenderBackend& backend, const Camera& camera, size_t lists);
+
+	std::vector<DrawPacket> mPackets;
+	std::vector<SortEntry> mOrder;
+	std::vector<SortEntry> mSortScratch;
+	std::vector<const DrawPacket*> mBatch;
+	std::vector<ListRecording> mLists;
+	math::mat4 mView;
+	bool mBatching;
+	size_t mDrawCalls;
+	size_t mMaxLists;
+	size_t mListCount;
+};
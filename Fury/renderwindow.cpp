@@ -3,5 +3,7 @@
 
 void RenderWindow::draw(Scene* scene)
 {
-	scene->draw();
+	backend.beginFrame();
+	scene->draw(backend);
+	backend.endFrame();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "window.h"
 #include "graphicsinfo.h"
 #include "rendertarget.h"
+#include "directxbackend.h"
 
 class Scene;
 
@@ -9,6 +10,7 @@ class RenderWindow : public Window, public RenderTarget
 {
 private:
 	DirectX directx;
+	DirectXBackend backend;
 	RenderState renderState;
 	GraphicsInfo graphicsInfo;
 	ShaderProgram* activeShader;
@@ -19,13 +21,15 @@ public:
 	virtual bool initialise(HINSTANCE hInstance) 
 	{
 		if(!Window::initialise(hInstance) ||
-			!directx.initialise(mWidth, mHeight, mHwnd, &graphicsInfo))
+			!directx.initialise(mWidth, mHeight, mHwnd, &graphicsInfo) ||
+			!backend.initialise(directx.getDevice(), directx.getContext()))
 			return false;
 		return true;
 	}
 
 	virtual void shutdown()
 	{
+		backend.shutdown();
 		directx.shutdown();
 		Window::shutdown();
 	}
@@ -61,4 +65,10 @@ public:
 	{
 		return directx;
 	}
+
+	/**Returns the backend the scene draws through.*/
+	RenderBackend& getBackend()
+	{
+		return backend;
+	}
 };
\ No newline at end of file
@@ -1,12 +1,34 @@
 #pragma once
 #include "scene.h"
+#include "renderbackend.h"
+#include <cmath>
 
 
-SceneNode::SceneNode(SceneNode* parent, Scene* scene) : mType(SCENE)
+namespace
+{
+	//In front of every node, so that deleting a node finds its arena and size without reading the destroyed node.
+	//Padded to the pools' alignment so that the node after it stays aligned.
+	struct NodeHeader
+	{
+		Arena* arena;
+		size_t size;
+	};
+	static_assert(sizeof(NodeHeader) <= Pool::kAlignment, "A node header must fit in the alignment padding");
+}
+
+SceneNode::SceneNode(SceneNode* parent, Scene* scene) : mChildren(ArenaAllocator<SceneNode*>(scene->mArena)),
+	mIndexInParent(0), mType(SCENE)
 {
 	mTransformable = false;
 	setParent(parent);
 	mScene = scene;
+	mHandle = scene->registerNode(this);
+}
+
+SceneNode::SceneNode(const SceneNode& other) : mChildren(ArenaAllocator<SceneNode*>(other.mScene->mArena)),
+	mParent(NULL), mIndexInParent(0), mScene(other.mScene), mHandle(other.mHandle), mType(other.mType),
+	mTransformable(other.mTransformable)
+{
 }
 
 
@@ -18,17 +40,54 @@ SceneNode* mParent;
 
 SceneNode::~SceneNode()
 {
+	//Orphaned first, so that they do not take themselves out of the list being walked.
 	for (size_t i = 0; i < mChildren.size(); ++i)
+	{
+		mChildren[i]->mParent = NULL;
 		delete mChildren[i];
+	}
+
+	if (mParent)
+		mParent->deleteChild(this);
+	mScene->unregisterNode(mHandle);
+}
+
+void* SceneNode::operator new(size_t size, Scene* scene)
+{
+	const size_t total = Pool::kAlignment + size;
+	NodeHeader* header = static_cast<NodeHeader*>(scene->mArena->allocate(total));
+	header->arena = scene->mArena;
+	header->size = total;
+	return reinterpret_cast<char*>(header) + Pool::kAlignment;
+}
+
+void SceneNode::operator delete(void* node, Scene*)
+{
+	operator delete(node);
 }
 
+void SceneNode::operator delete(void* node)
+{
+	if (!node)
+		return;
+	NodeHeader* header = reinterpret_cast<NodeHeader*>(static_cast<char*>(node) - Pool::kAlignment);
+	header->arena->deallocate(header, header->size);
+}
 
 
-Scene::Scene(RenderWindow* window) : mRootNode(new TransformNode(NULL, this)), mActiveCamera(NULL), mWindow(window) {}
+
+Scene::Scene(RenderWindow* window) : mArena(&mArenas[0]), mSlotsInUse(0), mNodeCount(0),
+	mRootNode(new (this) TransformNode(NULL, this)), mActiveCamera(NULL), mWindow(window)
+{
+	for (int type = 0; type < LightNode::TYPE_COUNT; ++type)
+		mLightTypeEnd[type] = 0;
+	mCullStats.visible = 0;
+	mCullStats.culled = 0;
+}
 
 Scene::~Scene()
 {
-	deletePtr(mRootNode);
+	//The arena frees the nodes, as in clear().
 }
 
 TransformNode* Scene::getRootNode()
@@ -38,48 +97,363 @@ TransformNode* Scene::getRootNode()
 
 void Scene::clear()
 {
-	deletePtr(mRootNode);
-	mRootNode = new TransformNode(NULL, this);
+	//Nothing a node holds needs its destructor: the child lists are in the arena, and the transforms, bounds and
+	//list entries are dropped here with the tables they are in.
+	mTransforms.clear();
+	mBounds.clear();
+	mDrawables.clear();
+	mUnboundedDrawables.clear();
+	mLightNodes.clear();
+	mLightEntries.clear();
+	for (int type = 0; type < LightNode::TYPE_COUNT; ++type)
+		mLightTypeEnd[type] = 0;
+	mArena->reset();
+
+	//Slots are reused from the front again, each one's generation going up as it is, so old handles stay invalid.
+	mFreeNodeSlots.clear();
+	mSlotsInUse = 0;
+	mNodeCount = 0;
+
+	mRootNode = new (this) TransformNode(NULL, this);
+}
+
+SceneNode::Handle Scene::registerNode(SceneNode* node)
+{
+	++mNodeCount;
+
+	size_t slot;
+	if (!mFreeNodeSlots.empty())
+	{
+		slot = mFreeNodeSlots.back();
+		mFreeNodeSlots.pop_back();
+		++mNodeSlots[slot].generation;
+	}
+	else
+	{
+		//Past the slots in use, skipping those retired before the last clear().
+		while (mSlotsInUse < mNodeSlots.size() && mNodeSlots[mSlotsInUse].generation == kMaxGeneration)
+			++mSlotsInUse;
+
+		slot = mSlotsInUse;
+		if (slot == kSlotMask)
+		{
+			//This slot is kept out so that no handle equals kInvalidHandle, and the ones past it do not fit in one.
+			--mNodeCount;
+			Error("Too many scene nodes.");
+			return SceneNode::kInvalidHandle;
+		}
+		++mSlotsInUse;
+		if (slot == mNodeSlots.size())
+		{
+			NodeSlot fresh = { NULL, 0 };
+			mNodeSlots.push_back(fresh);
+		}
+		else
+			++mNodeSlots[slot].generation;
+	}
+
+	mNodeSlots[slot].node = node;
+	return SceneNode::Handle(slot) | mNodeSlots[slot].generation << kSlotBits;
+}
+
+void Scene::unregisterNode(SceneNode::Handle handle)
+{
+	if (handle == SceneNode::kInvalidHandle)
+		return;
+	--mNodeCount;
+
+	const size_t slot = handle & kSlotMask;
+	assert(mNodeSlots[slot].node && mNodeSlots[slot].generation == handle >> kSlotBits);
+	mNodeSlots[slot].node = NULL;
+	if (mNodeSlots[slot].generation < kMaxGeneration)
+		mFreeNodeSlots.push_back(unsigned(slot));
+}
+
+bool Scene::destroyNode(SceneNode::Handle handle)
+{
+	SceneNode* node = getNode(handle);
+	if (!node)
+		return false;
+	if (node == mRootNode)
+	{
+		Warning("Can not destroy root node.");
+		return false;
+	}
+	delete node;
+	return true;
+}
+
+void Scene::compact()
+{
+	Arena* from = mArena;
+	mArena = from == &mArenas[0] ? &mArenas[1] : &mArenas[0];
+	mRootNode = static_cast<TransformNode*>(relocateSubtree(mRootNode, NULL));
+
+	//As in clear(), the originals need no destructors.
+	from->reset();
+}
+
+SceneNode* Scene::relocateSubtree(const SceneNode* node, SceneNode* parent)
+{
+	SceneNode* moved = node->relocate();
+	moved->mParent = parent;
+	moved->mIndexInParent = node->mIndexInParent;
+	mNodeSlots[moved->mHandle & kSlotMask].node = moved;
+
+	moved->mChildren.reserve(node->mChildren.size());
+	for (size_t i = 0; i < node->mChildren.size(); ++i)
+		moved->mChildren.push_back(relocateSubtree(node->mChildren[i], moved));
+	return moved;
+}
+
+void Scene::prepare()
+{
+	mTransforms.update();
+
+	for (size_t i = 0; i < mDrawables.size(); ++i)
+	{
+		DrawableNode* node = mDrawables[i];
+		if (node->mBoundsDirty || mTransforms.changedInLastUpdate(node->mTransform))
+			node->updateBounds();
+	}
+	mBounds.refit();
+
+	for (size_t i = 0; i < mLightNodes.size(); ++i)
+	{
+		LightNode* light = mLightNodes[i];
+		if (light->needsRecomputing || mTransforms.changedInLastUpdate(light->mTransform))
+		{
+			light->needsRecomputing = false;
+			mLightEntries[i] = light->computeEntry(light->worldMatrix());
+		}
+	}
+}
+
+void Scene::addLight(LightNode* light)
+{
+	mLightNodes.push_back(NULL);
+	mLightEntries.push_back(LightBufferEntry());
+
+	//Each later type gives its first light to the free place at its end, which moves the free place to its front.
+	size_t free = mLightNodes.size() - 1;
+	for (int type = LightNode::TYPE_COUNT - 1; type > light->mLightType; --type)
+	{
+		const size_t first = mLightTypeEnd[type - 1];
+		if (first != free)
+		{
+			moveLight(first, free);
+			free = first;
+		}
+		++mLightTypeEnd[type];
+	}
+
+	mLightNodes[free] = light;
+	light->mLightIndex = free;
+	++mLightTypeEnd[light->mLightType];
+}
+
+void Scene::removeLight(LightNode* light)
+{
+	//The last light of each type from the light's own on moves into the free place, which moves to where it was.
+	size_t free = light->mLightIndex;
+	for (int type = light->mLightType; type < LightNode::TYPE_COUNT; ++type)
+	{
+		const size_t last = mLightTypeEnd[type] - 1;
+		if (last > free)
+		{
+			moveLight(last, free);
+			free = last;
+		}
+		mLightTypeEnd[type] = free;
+	}
+
+	mLightNodes.pop_back();
+	mLightEntries.pop_back();
 }
 
-void Scene::draw()
+void Scene::moveLight(size_t from, size_t to)
+{
+	mLightNodes[to] = mLightNodes[from];
+	mLightEntries[to] = mLightEntries[from];
+	mLightNodes[to]->mLightIndex = to;
+}
+
+void Scene::enqueue(DrawableNode* node)
+{
+	++mCullStats.visible;
+	node->mDrawable->enqueue(mRenderQueue, mWindow, node->worldMatrix());
+}
+
+void Scene::draw(RenderBackend& backend)
 {
 	prepare();
-	mRootNode->perform(math::mat4());
+
+	mFrustum = Frustum(mActiveCamera->projection() * mActiveCamera->matrix());
+	mCullStats.visible = 0;
+	mCullStats.culled = 0;
+
+	mRenderQueue.begin(*mActiveCamera);
+
+	//The BVH tests boxes around the spheres, so the spheres themselves are tested before drawing.
+	mBounds.queryFrustum(mFrustum, [this](void* userData) {
+		DrawableNode* node = static_cast<DrawableNode*>(userData);
+		if (mFrustum.intersectsSphere(node->mWorldCentre, node->mWorldRadius))
+			enqueue(node);
+	});
+	mCullStats.culled = mBounds.size() - mCullStats.visible;
+
+	for (size_t i = 0; i < mUnboundedDrawables.size(); ++i)
+		enqueue(mUnboundedDrawables[i]);
+
+	mRenderQueue.sort();
+
+	FrameConstants frame;
+	frame.view = mActiveCamera->matrix();
+	frame.projection = mActiveCamera->projection();
+	backend.setFrameConstants(&frame, sizeof(frame));
+	mRenderQueue.submit(backend, *mActiveCamera);
 }
 
-void DrawableNode::perform(const math::mat4& accumulatedMatrix)
- {
-	 updateMatrix();
+TransformNode::TransformNode(SceneNode* parent, Scene* scene) : SceneNode(parent, scene)
+{
+	mType = TRANSFORM;
+	mTransformable = true;
 
-	math::mat4 transformMatrix = m_matrix * accumulatedMatrix;
+	TransformStore::Handle parentTransform = TransformStore::kInvalidHandle;
+	for (SceneNode* node = parent; node != NULL; node = node->getParent())
+		if (node->transformable())
+		{
+			parentTransform = static_cast<TransformNode*>(node)->mTransform;
+			break;
+		}
+	mTransform = scene->getTransforms().create(parentTransform);
+}
 
-	if (mDrawable)
-		mDrawable->draw(mScene->getWindow(), transformMatrix, *mScene->getActiveCamera());
+TransformNode::~TransformNode()
+{
+	mScene->getTransforms().destroy(mTransform);
+}
 
+void TransformNode::invalidate()
+{
+	Movable::invalidate();
+	mScene->getTransforms().setLocal(mTransform, m_pos, m_rot, m_scale);
+}
+
+void TransformNode::perform()
+{
 	for (size_t i = 0; i < mChildren.size(); ++i)
-		mChildren[i]->perform(transformMatrix);
+		mChildren[i]->perform();
 }
 
-void CameraNode::perform(RenderWindow* window, const math::mat4& accumulatedMatrix)
+const math::mat3x4& TransformNode::localMatrix() const
 {
-	math::mat4 transformMatrix = m_matrix * accumulatedMatrix;
+	return mScene->getTransforms().localMatrix(mTransform);
+}
 
-	for (size_t i = 0; i < mChildren.size(); ++i)
-		mChildren[i]->perform(transformMatrix);
+const math::mat3x4& TransformNode::worldMatrix() const
+{
+	return mScene->getTransforms().worldMatrix(mTransform);
 }
 
-LightNode::LightNode(SceneNode* parent, Scene* scene, LightType type) //Type, iterator to light from light list in scene for deletion.
-	: TransformNode(parent, scene), needsRecomputing(true)
+const size_t DrawableNode::kNotListed;
+
+DrawableNode::DrawableNode(SceneNode* parent, Scene* scene) : TransformNode(parent, scene), mDrawable(NULL),
+	mBoundsDirty(false), mWorldRadius(0), mBoundsProxy(BVH::kInvalidProxy), mUnboundedIndex(kNotListed)
+{
+	mType = DRAW;
+	mDrawableIndex = scene->mDrawables.size();
+	scene->mDrawables.push_back(this);
+}
+
+SceneNode* DrawableNode::relocate() const
+{
+	DrawableNode* copy = new (mScene) DrawableNode(*this);
+	mScene->mDrawables[mDrawableIndex] = copy;
+	if (mUnboundedIndex != kNotListed)
+		mScene->mUnboundedDrawables[mUnboundedIndex] = copy;
+	if (mBoundsProxy != BVH::kInvalidProxy)
+		mScene->mBounds.setUserData(mBoundsProxy, copy);
+	return copy;
+}
+
+DrawableNode::~DrawableNode()
+{
+	//Swap the last node into the hole to keep the lists dense.
+	std::vector<DrawableNode*>& drawables = mScene->mDrawables;
+	drawables[mDrawableIndex] = drawables.back();
+	drawables[mDrawableIndex]->mDrawableIndex = mDrawableIndex;
+	drawables.pop_back();
+
+	if (mUnboundedIndex != kNotListed)
+		unlistUnbounded();
+
+	if (mBoundsProxy != BVH::kInvalidProxy)
+		mScene->mBounds.remove(mBoundsProxy);
+}
+
+void DrawableNode::updateBounds()
+{
+	mBoundsDirty = false;
+	const bool bounded = mDrawable && mDrawable->worldBounds(worldMatrix(), mWorldCentre, mWorldRadius);
+
+	BVH& bounds = mScene->mBounds;
+	if (bounded)
+	{
+		const AABB box = AABB::fromSphere(mWorldCentre, mWorldRadius);
+		if (mBoundsProxy == BVH::kInvalidProxy)
+			mBoundsProxy = bounds.insert(box, this);
+		else
+			bounds.move(mBoundsProxy, box);
+	}
+	else if (mBoundsProxy != BVH::kInvalidProxy)
+	{
+		bounds.remove(mBoundsProxy);
+		mBoundsProxy = BVH::kInvalidProxy;
+	}
+
+	std::vector<DrawableNode*>& unbounded = mScene->mUnboundedDrawables;
+	const bool listed = mUnboundedIndex != kNotListed;
+	if (mDrawable && !bounded && !listed)
+	{
+		mUnboundedIndex = unbounded.size();
+		unbounded.push_back(this);
+	}
+	else if ((bounded || !mDrawable) && listed)
+		unlistUnbounded();
+}
+
+void DrawableNode::unlistUnbounded()
+{
+	std::vector<DrawableNode*>& unbounded = mScene->mUnboundedDrawables;
+	unbounded[mUnboundedIndex] = unbounded.back();
+	unbounded[mUnboundedIndex]->mUnboundedIndex = mUnboundedIndex;
+	unbounded.pop_back();
+	mUnboundedIndex = kNotListed;
+}
+
+LightNode::LightNode(SceneNode* parent, Scene* scene, LightType type)
+	: TransformNode(parent, scene), mLightType(type), needsRecomputing(true), mRadius(0), mHalfAngle(0)
 {
 	mType = LIGHT;
-	mLightType = type;
-	scene->mLights.push_back(this);
-	mLightIterator = --scene->mLights.end();
+	scene->addLight(this);
 }
 
 LightNode:: ~LightNode()
 {
-	mParent->deleteChild(this);
-	mScene->mLights.erase(mLightIterator);
+	mScene->removeLight(this);
+}
+
+void LightNode::relist()
+{
+	mScene->mLightNodes[mLightIndex] = this;
+}
+
+LightBufferEntry LightNode::computeEntry(const math::mat3x4& worldMatrix) const
+{
+	LightBufferEntry entry;
+	entry.positionRadius = math::vec4(worldMatrix.getTranslation(), mRadius * worldMatrix.getMaxScale());
+	entry.directionCosAngle = math::vec4(worldMatrix.transformDirection(math::vec3(0, 0, 1)).normalize(),
+		std::cos(mHalfAngle));
+	return entry;
 }
\ No newline at end of file
@@ -4,14 +4,28 @@
 #include "util.h"
 #include "drawable.h"
 #include "transformable.h"
+#include "transformstore.h"
+#include "renderqueue.h"
+#include "bvh.h"
 #include "camera.h"
-#include <list>
+#include "pool.h"
+#include "shaderbuffertypes.h"
 #include <stack>
 #include "immediateio.h"
 #include <assert.h>
 /*
-The lights are not visible from the tree, but are in it nevertheless. Each light points to its branch,
-so that its position is calculated in reverse.
+The lights are not visible from the tree, but are in it nevertheless.
+The transforms of the nodes live in the scene's TransformStore rather than in the tree, so that all world matrices
+are computed in one pass over flat arrays before anything is drawn. The tree only decides what is drawn: drawing
+the scene walks it to record draw packets in the scene's RenderQueue, which then sorts and submits them.
+Drawing does not walk the tree, though. After the transforms are updated, every drawable whose world matrix changed
+has its bounding sphere moved in the scene's BVH, and the frame records only the drawables the BVH finds in the view
+frustum of the active camera, plus those without bounds.
+The nodes, and their lists of children, are allocated from the scene's Arena. Clearing the scene resets the arena
+and the tables the nodes are registered in rather than destroying the nodes one by one.
+Code that keeps nodes for longer than a frame should hold their handles rather than pointers. A handle finds its
+node through the scene's slot table, so it can tell when the node is gone, and still finds it after compact() has
+moved it.
 */
 
 class RenderWindow;
@@ -19,34 +33,63 @@ class Scene;
 
 class SceneNode
 {
+public:
+	/**Identifies a node in its scene; see Scene::getNode(). The low Scene::kSlotBits bits are the node's slot in
+	the scene's slot table, the rest the generation of the slot, which goes up each time the slot is reused.*/
+	typedef unsigned Handle;
+
+	/**No node. Never valid.*/
+	static const Handle kInvalidHandle = ~0u;
+
 protected:
 
 	enum NodeType {SCENE, TRANSFORM, DRAW, CAMERA, LIGHT, OTHER};
 
 	SceneNode(SceneNode* parent, Scene* scene);
 
+	/**Copies everything but the links to other nodes, for relocate(). The copy has no parent and no children.*/
+	SceneNode(const SceneNode& other);
+
+	/**Creates a copy of the node in the scene's current arena and points the scene's tables at it. Scene::compact()
+	links the copy into the tree and drops the original without destroying it.*/
+	virtual SceneNode* relocate() const = 0;
+
 	friend class Scene;
 
-	std::vector<SceneNode*> mChildren;
+	typedef std::vector<SceneNode*, ArenaAllocator<SceneNode*> > ChildList;
+
+	ChildList mChildren;
 	SceneNode* mParent;
+	size_t mIndexInParent; //Position in the parent's mChildren, so iterators can step to the next sibling.
 	Scene* mScene; //The scene where it was created
+	Handle mHandle;
 	NodeType mType;
 	bool mTransformable;
 
 	template<class T>
 	T* addChild(T* child)
 	{
+		child->mIndexInParent = mChildren.size();
 		mChildren.push_back(child);
 		return child;
 	}
 
 	SceneNode* setParent(SceneNode* parent) { return mParent = parent; }
 
-	
+private:
+	SceneNode& operator=(const SceneNode&);
+
 public:
+	/**Deletes the children as well, and takes the node out of its parent's children.*/
 	virtual ~SceneNode();
 
-	virtual void perform(const math::mat4& accumulatedMatrix = math::mat4()) = 0; //Performs some action
+	/**Nodes can only be created in a scene's arena. Deleting one gives its memory back to the arena; a node
+	must not be deleted after the scene was cleared.*/
+	static void* operator new(size_t size, Scene* scene);
+	static void operator delete(void* node, Scene* scene);
+	static void operator delete(void* node);
+
+	virtual void perform() = 0; //Performs some action
 
 	NodeType nodeType() { return mType; }
 
@@ -54,41 +97,53 @@ public:
 
 	SceneNode* getParent() { return mParent; }
 
-	/**Tries to delete the element from its children. Use with care.*/
-	template<class T>
-	void deleteChild(T t)
+	Handle handle() const { return mHandle; }
+
+	const ChildList& getChildren() const { return mChildren; }
+
+	/**Takes the child out of the children, leaving it without a parent, in constant time: the last child moves
+	into its place. The child is not destroyed.*/
+	void deleteChild(SceneNode* child)
 	{
-		for (auto it = mChildren.begin(); it != mChildren.end(); ++it)
-			if (*it == t)
-			{
-				it = mChildren.erase(it); //function returns usable iterator :D
-				--it;
-			}
+		assert(child->mParent == this && mChildren[child->mIndexInParent] == child);
+		SceneNode* last = mChildren.back();
+		mChildren[child->mIndexInParent] = last;
+		last->mIndexInParent = child->mIndexInParent;
+		mChildren.pop_back();
+		child->mParent = NULL;
 	}
 
 };
 
 
-class TransformNode : public SceneNode, public Transformable
+/**A node with a position, rotation and scale relative to its parent. The matrices are kept in the scene's
+TransformStore, which the setters inherited from Movable write through to.*/
+class TransformNode : public SceneNode, public Movable
 {
 protected:
 	friend class Scene;
 
-	TransformNode(SceneNode* parent, Scene* scene) : SceneNode(parent, scene)
-	{
-		mType = TRANSFORM;
-		mTransformable = true;
-	}
+	TransformNode(SceneNode* parent, Scene* scene);
+
+	virtual SceneNode* relocate() const { return new (mScene) TransformNode(*this); }
+
+	virtual void invalidate();
+
+	TransformStore::Handle mTransform;
 
 public:
+	virtual ~TransformNode();
 
-	virtual void perform(const math::mat4& accumulatedMatrix = math::mat4())
-	{
-		math::mat4 transformMatrix = m_matrix * accumulatedMatrix;
+	virtual void perform();
 
-		for (size_t i = 0; i < mChildren.size(); ++i)
-			mChildren[i]->perform(transformMatrix);
-	}
+	/**Returns the handle of the node's transform in the scene's TransformStore.*/
+	TransformStore::Handle transformHandle() const { return mTransform; }
+
+	/**Returns the matrix relative to the parent node, as of the last time the scene was drawn.*/
+	const math::mat3x4& localMatrix() const;
+
+	/**Returns the matrix relative to the world, as of the last time the scene was drawn.*/
+	const math::mat3x4& worldMatrix() const;
 };
 
 
@@ -97,18 +152,37 @@ class DrawableNode : public TransformNode
 protected:
 	friend class Scene;
 
-	DrawableNode(SceneNode* parent, Scene* scene) : TransformNode(parent, scene), mDrawable(NULL)
-	{
-		mType = DRAW;
-	}
+	DrawableNode(SceneNode* parent, Scene* scene);
+
+	virtual SceneNode* relocate() const;
+
+	/**Finds the world space bounds again and moves them in the scene's BVH.*/
+	void updateBounds();
+
+	/**Takes the node out of Scene::mUnboundedDrawables.*/
+	void unlistUnbounded();
+
+	static const size_t kNotListed = ~size_t(0);
 
 	Drawable* mDrawable;
+	bool mBoundsDirty; //The drawable changed, so the bounds must be found again even if the node did not move.
+	math::vec3 mWorldCentre;
+	float mWorldRadius;
+	BVH::Proxy mBoundsProxy; //kInvalidProxy while the node has no bounds.
+	size_t mDrawableIndex; //Position in Scene::mDrawables.
+	size_t mUnboundedIndex; //Position in Scene::mUnboundedDrawables, or kNotListed.
 
 public:
+	virtual ~DrawableNode();
+
+	void addDrawable(Drawable* drawable) { mDrawable = drawable; mBoundsDirty = true; }
 
-	virtual void perform(const math::mat4& accumulatedMatrix = math::mat4());
+	/**Returns the centre of the sphere bounding the drawable in world space, as of the last time the scene was
+	drawn. Only meaningful if the drawable has bounds.*/
+	const math::vec3& worldCentre() const { return mWorldCentre; }
 
-	void addDrawable(Drawable* drawable) { mDrawable = drawable; }
+	/**Returns the radius of the world space bounding sphere.*/
+	float worldRadius() const { return mWorldRadius; }
 };
 
 
@@ -117,46 +191,53 @@ class CameraNode : public TransformNode
 {
 protected:
 	Camera* mCamera;
+
+	virtual SceneNode* relocate() const { return new (mScene) CameraNode(*this); }
 public:
 
 	CameraNode(SceneNode* parent, Camera* camera, Scene* scene) : TransformNode(parent, scene), mCamera(camera)
 	{ 	mType = CAMERA; }
-
-	virtual void perform(RenderWindow* window, const math::mat4& accumulatedMatrix = math::mat4());
 };
 
 
-/*The scene keeps a separate list of lights, and it's maintained so that the destructor of the LightNode
-automatically cleans it up.*/
+/*The scene keeps a separate array of lights, sorted by type, and it's maintained so that the destructor of the
+LightNode automatically cleans it up. Alongside it is the light data the shaders read, which the scene recomputes
+for the lights that moved or changed when it is prepared.*/
 class LightNode : public TransformNode
 {
 public:
-	enum LightType { TYPE_DIRECTIONAL, TYPE_POINT, TYPE_SPOT };
-	LightType mLightType;
-	std::list<LightNode*>::iterator mLightIterator;
-	bool needsRecomputing;
+	enum LightType { TYPE_DIRECTIONAL, TYPE_POINT, TYPE_SPOT, TYPE_COUNT };
+
+protected:
+	friend class Scene;
 
-	LightNode(SceneNode* parent, Scene* scene, LightType type); //Type, iterator to light from light list in scene for deletion.
+	/**Points the light array at the copy.*/
+	template<class T>
+	static SceneNode* relocateLight(const T& light)
+	{
+		T* copy = new (light.mScene) T(light);
+		copy->relist();
+		return copy;
+	}
 
+	virtual SceneNode* relocate() const { return relocateLight(*this); }
 
-	LightType type() { return mLightType; }
+	/**Points the scene's light array at this node.*/
+	void relist();
 
-	void computePosition() //Goes down the tree to compute the position of the light at the current frame
-	{
-		SceneNode* node = mParent;
-		m_matrix.reset();
+	/**Returns the data the shaders read, for the given world matrix.*/
+	LightBufferEntry computeEntry(const math::mat3x4& worldMatrix) const;
 
-		while (node!=NULL)
-		{
-			if (node->transformable())
-			{
-				Transformable* trans = (Transformable*)(node);
-				m_matrix = trans->matrix() * m_matrix;
-				node = node->getParent();
-			}
-		}
-	}
+	LightType mLightType;
+	size_t mLightIndex; //Position in the scene's light array.
+	bool needsRecomputing; //The radius or angle changed, so the entry must be computed again even if it did not move.
+	float mRadius;
+	float mHalfAngle;
 
+public:
+	LightNode(SceneNode* parent, Scene* scene, LightType type);
+
+	LightType type() { return mLightType; }
 
 	//Unregister light from scene:
 	virtual ~LightNode();
@@ -164,6 +245,9 @@ public:
 
 class DirectionalLightNode : public LightNode
 {
+protected:
+	virtual SceneNode* relocate() const { return relocateLight(*this); }
+
 public:
 	DirectionalLightNode(SceneNode* parent, Scene* scene) :
 		LightNode(parent, scene, TYPE_DIRECTIONAL) {}
@@ -171,43 +255,117 @@ public:
 
 class PointLightNode : public LightNode
 {
+protected:
+	virtual SceneNode* relocate() const { return relocateLight(*this); }
+
 public:
 	PointLightNode(SceneNode* parent, Scene* scene) :
-		LightNode(parent, scene, TYPE_POINT), mRadius(0) {}
+		LightNode(parent, scene, TYPE_POINT) {}
 
-	float mRadius;
+	/**Sets how far the light reaches, before the node's scale.*/
+	void setRadius(float radius) { mRadius = radius; needsRecomputing = true; }
+	float getRadius() const { return mRadius; }
 };
 
 class SpotLightNode : public LightNode
 {
+protected:
+	virtual SceneNode* relocate() const { return relocateLight(*this); }
+
 public:
 	SpotLightNode(SceneNode* parent, Scene* scene) :
-		LightNode(parent, scene, TYPE_SPOT), mRadius(0), mHalfAngle(0) {}
+		LightNode(parent, scene, TYPE_SPOT) {}
 
-	float mRadius;
-	float mHalfAngle;
+	/**Sets how far the light reaches, before the node's scale.*/
+	void setRadius(float radius) { mRadius = radius; needsRecomputing = true; }
+	float getRadius() const { return mRadius; }
+
+	/**Sets the angle between the centre and the edge of the cone, in radians. The cone points along the node's z
+	axis.*/
+	void setHalfAngle(float halfAngle) { mHalfAngle = halfAngle; needsRecomputing = true; }
+	float getHalfAngle() const { return mHalfAngle; }
 };
 
 
 class Scene
 {
+public:
+	/**How many drawables the last frame drew and how many it skipped for being out of view.*/
+	struct CullStats
+	{
+		size_t visible;
+		size_t culled;
+	};
+
+	/**Handles have this many bits for the slot, so a scene holds up to 2^kSlotBits - 1 nodes at once. The rest
+	count generations; a slot whose generation runs out is retired rather than reused, so a handle never
+	finds a node created after its own was destroyed.*/
+	static const unsigned kSlotBits = 22;
+
 private:
+	//First, since every node lives in one of them. Nodes are allocated from mArena, the other one only serves
+	//compact(), which moves every node across and swaps them.
+	Arena mArenas[2];
+	Arena* mArena;
+
+	//The slot table handles resolve through.
+	struct NodeSlot
+	{
+		SceneNode* node; //NULL while free.
+		unsigned generation;
+	};
+	std::vector<NodeSlot> mNodeSlots;
+	std::vector<unsigned> mFreeNodeSlots;
+	size_t mSlotsInUse; //Slots from here on were not handed out since the last clear(), and are free too.
+	size_t mNodeCount;
+
+	//Before the root, since the nodes release their transforms and bounds when destroyed.
+	TransformStore mTransforms;
+	BVH mBounds;
+	std::vector<DrawableNode*> mDrawables;
+	std::vector<DrawableNode*> mUnboundedDrawables; //Have a drawable but no bounds, so are always drawn.
+
 	TransformNode* mRootNode;
+	RenderQueue mRenderQueue;
 	Camera* mActiveCamera;
 	RenderWindow* mWindow;
+	Frustum mFrustum;
+	CullStats mCullStats;
 
-	std::list<LightNode*> mLights;
+	//The lights, sorted by type, and the data the shaders read for each. mLightTypeEnd[t] is one past the last light
+	//of type t.
+	std::vector<LightNode*> mLightNodes;
+	std::vector<LightBufferEntry> mLightEntries;
+	size_t mLightTypeEnd[LightNode::TYPE_COUNT];
 
-	void draw();
+	/**Culls, records and submits the scene through the backend.*/
+	void draw(RenderBackend& backend);
 
 	friend class RenderWindow;
 	friend class LightNode;
+	friend class DrawableNode;
+	friend class SceneNode;
 
-	void prepare()
-	{
-		for (auto it = mLights.begin(); it != mLights.end(); ++it)
-			(*it)->computePosition();
-	}
+	/**Records the node's draw calls in the render queue and counts it as visible.*/
+	void enqueue(DrawableNode* node);
+
+	/**Gives the node a slot and returns its handle, or kInvalidHandle if every slot a handle can name is taken.*/
+	SceneNode::Handle registerNode(SceneNode* node);
+
+	/**Frees the node's slot, if it got one.*/
+	void unregisterNode(SceneNode::Handle handle);
+
+	/**Moves the node and its subtree to the current arena, depth first, and returns the moved node.*/
+	SceneNode* relocateSubtree(const SceneNode* node, SceneNode* parent);
+
+	/**Inserts the light at the end of the lights of its type, moving one light of each later type along.*/
+	void addLight(LightNode* light);
+
+	/**Fills the light's place with the last of its type, and that one's with the last of the next type, and so on.*/
+	void removeLight(LightNode* light);
+
+	/**Moves the light at from to to, which must be free.*/
+	void moveLight(size_t from, size_t to);
 
 public:
 
@@ -216,29 +374,99 @@ public:
 
 	TransformNode* getRootNode();
 
+	/**Removes every node but the root, which is replaced by a new one, in time independent of the number of
+	nodes: their memory goes back to the arena all at once and their destructors are not run. Pointers to the old
+	nodes, root included, are invalid afterwards.*/
 	void clear();
 
 	void setWindow(RenderWindow* window) { mWindow = window; }
 
 	RenderWindow* getWindow() { return mWindow; }
 
+	/**Returns the store holding the node transforms. Its lastUpdateStats() tell how many matrices the last
+	frame recomputed.*/
+	TransformStore& getTransforms() { return mTransforms; }
+
+	/**Returns the BVH over the world space bounds of the drawable nodes, for finding them by position. Its user
+	data are DrawableNode pointers, and it is up to date as of the last time the scene was drawn.*/
+	const BVH& getBounds() const { return mBounds; }
+
+	/**Returns the queue the nodes record their draw calls in. It holds the packets of the last frame drawn.*/
+	RenderQueue& getRenderQueue() { return mRenderQueue; }
+
+	/**Updates the world matrices, the bounds of the drawables that moved, and the data of the lights that moved or
+	changed. Drawing does this first; call it to use them without drawing.*/
+	void prepare();
+
+	/**Returns the data of every light, sorted by type, as of the last prepare(). Laid out as the shaders read it,
+	so the array can be copied to a GPU buffer as it is.*/
+	const std::vector<LightBufferEntry>& getLights() const { return mLightEntries; }
+
+	/**Returns the range of getLights() holding the lights of a type.*/
+	size_t lightsBegin(LightNode::LightType type) const { return type == 0 ? 0 : mLightTypeEnd[type - 1]; }
+	size_t lightsEnd(LightNode::LightType type) const { return mLightTypeEnd[type]; }
+
+	/**Returns the node of the light at the index in getLights().*/
+	LightNode* getLightNode(size_t index) const { return mLightNodes[index]; }
+
+	/**Returns how many drawables the last frame drew and culled.*/
+	const CullStats& getCullStats() const { return mCullStats; }
+
+	/**Returns the arena the nodes are allocated from. Its stats() tell how many nodes and child lists are live and
+	how fragmented the arena has become.*/
+	const Arena& getArena() const { return *mArena; }
+
+	/**Returns the node the handle refers to, or NULL if it was destroyed or the handle is from before the last
+	clear(). Takes constant time.*/
+	SceneNode* getNode(SceneNode::Handle handle) const
+	{
+		const size_t slot = handle & kSlotMask;
+		if (slot >= mSlotsInUse)
+			return NULL;
+		const NodeSlot& s = mNodeSlots[slot];
+		return s.generation == handle >> kSlotBits ? s.node : NULL;
+	}
+
+	/**Returns the node as the type it was created as, which the caller must know, or NULL if it is gone.*/
+	template<class T>
+	T* getNode(SceneNode::Handle handle) const
+	{
+		return static_cast<T*>(getNode(handle));
+	}
+
+	/**Returns whether the handle's node still exists.*/
+	bool isValid(SceneNode::Handle handle) const { return getNode(handle) != NULL; }
+
+	/**Deletes the node and its subtree if they still exist, and returns whether they did. The root can not be
+	destroyed.*/
+	bool destroyNode(SceneNode::Handle handle);
+
+	/**Returns the number of nodes, root included.*/
+	size_t nodeCount() const { return mNodeCount; }
+
+	/**Moves every node to fresh memory in the order iterator visits them, each followed by its list of children,
+	so walking the tree reads memory front to back. Pointers to nodes are invalid afterwards; handles are not.*/
+	void compact();
+
+	//The create functions return NULL if the scene already holds as many nodes as handles can name.
+
 	TransformNode* createTransformNode(SceneNode* parent)
-	{ return parent->addChild(new TransformNode(parent, this)); }
+	{ return adopt(parent, new (this) TransformNode(parent, this)); }
 
 	DrawableNode* createDrawableNode(SceneNode* parent)
-	{ return parent->addChild(new DrawableNode(parent, this)); }
+	{ return adopt(parent, new (this) DrawableNode(parent, this)); }
 
 	CameraNode* createCameraNode(SceneNode* parent, Camera* camera) //Kinda useless at the moment...
-	{ return parent->addChild(new CameraNode(parent, camera, this)); }
+	{ return adopt(parent, new (this) CameraNode(parent, camera, this)); }
 
 	DirectionalLightNode* createDirectionalLightNode(SceneNode* parent)
-	{ return parent->addChild(new DirectionalLightNode(parent, this)); }
+	{ return adopt(parent, new (this) DirectionalLightNode(parent, this)); }
 
 	PointLightNode* createPointLightNode(SceneNode* parent)
-	{ return parent->addChild(new PointLightNode(parent, this)); }
+	{ return adopt(parent, new (this) PointLightNode(parent, this)); }
 
 	SpotLightNode* createSpotLightNode(SceneNode* parent)
-	{ return parent->addChild(new SpotLightNode(parent, this)); }
+	{ return adopt(parent, new (this) SpotLightNode(parent, this)); }
 
 	void setActiveCamera(Camera* camera)
 	{ mActiveCamera = camera; }
@@ -247,49 +475,68 @@ public:
 	{ return mActiveCamera; }
 
 
-	//The iterator implementation:
+	//The iterator implementation. Neither iterator allocates: they find the next node through the parent links and
+	//each node's index in its parent, so an iterator is a few words and copies for free.
 
-	class iterator : public std::iterator < std::forward_iterator_tag, int >
+	/**Visits the nodes depth first, each before its children, starting with the root.*/
+	class iterator : public std::iterator < std::forward_iterator_tag, SceneNode* >
 	{
 		SceneNode* mRootNode;
-		SceneNode* mNode;
-		std::stack<size_t> stack; //Keeps track of which paths the iterator took. Index of current child = stack.top()
-		bool reachedEnd; //has the end been reached?
+		SceneNode* mNode; //NULL at the end.
+
+		//The parent of mNode and its index there. Keeping them here rather than reading them from mNode lets the
+		//step to the next sibling start before mNode has been fetched from memory.
+		SceneNode* mParent;
+		size_t mIndex;
 
 		friend class Scene;
 
-	public:
-		iterator(SceneNode* node) : mRootNode(node), mNode(node), reachedEnd(false)
-		{ 
-			stack.push(0); //start index.
+		/**Moves to the child of parent at index or, if there is none, to the next sibling of parent or of the
+		nearest ancestor that has one.*/
+		void moveTo(SceneNode* parent, size_t index)
+		{
+			while (index >= parent->mChildren.size())
+			{
+				if (parent == mRootNode)
+				{
+					mNode = NULL;
+					return;
+				}
+				index = parent->mIndexInParent + 1;
+				parent = parent->mParent;
+			}
+			mParent = parent;
+			mIndex = index;
+			mNode = parent->mChildren[index];
 		}
 
+	public:
+		iterator(SceneNode* root, SceneNode* node) : mRootNode(root), mNode(node), mParent(NULL), mIndex(0) {}
+
 		//++it
 		iterator& operator++()
 		{
-			//If no children left to explore
-			while (stack.top() >= mNode->mChildren.size())
+			//Enter the first child, or else the next sibling of the node or of the nearest ancestor that has one.
+			if (!mNode->mChildren.empty())
 			{
-				//Are we the parent? If so, reached end.
-				if (mNode == mRootNode)
-				{
-					reachedEnd = true;
-					break;
-				}
-				else //go back one node
-				{
-					mNode = mNode->mParent;
-					stack.pop();
-				}
+				mParent = mNode;
+				mIndex = 0;
+				mNode = mNode->mChildren[0];
+				return *this;
 			}
-			if (!reachedEnd) //if still any nodes left
+
+			while (mNode != mRootNode)
 			{
-				//enter child node while incrementic stack.
-				size_t index = stack.top()++; //index to enter, and increment for next time.
-				stack.push(0); //index of entered node.
-				mNode = mNode->mChildren[index];
+				if (mIndex + 1 < mParent->mChildren.size())
+				{
+					mNode = mParent->mChildren[++mIndex];
+					return *this;
+				}
+				mNode = mParent;
+				mIndex = mNode->mIndexInParent;
+				mParent = mNode->mParent;
 			}
-
+			mNode = NULL;
 			return *this;
 		}
 
@@ -308,12 +555,7 @@ public:
 				Error("Scene iterators compared from different sources.");
 				return false;
 			}
-			if (mNode == it.mNode && !(reachedEnd^it.reachedEnd))
-			{
-				return true;
-			}
-			else
-				return false;
+			return mNode == it.mNode;
 		}
 
 		bool operator != (const iterator& it) const
@@ -334,32 +576,178 @@ public:
 
 	};
 
+	/**Visits the nodes level by level, starting with the root. Without a queue, finding the next node means
+	climbing to the nearest ancestor with another subtree and descending it again, so a step costs up to twice the
+	depth, and more in trees where many branches end above the current level.*/
+	class breadth_first_iterator : public std::iterator < std::forward_iterator_tag, SceneNode* >
+	{
+		SceneNode* mRootNode;
+		SceneNode* mNode; //NULL at the end.
+		size_t mDepth; //Of mNode below the root.
+
+		friend class Scene;
+
+		/**Returns the first node depth levels below the node, or NULL if its subtree is not that deep.*/
+		static SceneNode* firstAtDepth(SceneNode* node, size_t depth)
+		{
+			if (depth == 0)
+				return node;
+			for (size_t i = 0; i < node->mChildren.size(); ++i)
+				if (SceneNode* found = firstAtDepth(node->mChildren[i], depth - 1))
+					return found;
+			return NULL;
+		}
+
+	public:
+		breadth_first_iterator(SceneNode* root, SceneNode* node) : mRootNode(root), mNode(node), mDepth(0) {}
+
+		//++it
+		breadth_first_iterator& operator++()
+		{
+			//The next node on the same level lies under a later sibling of the node or of one of its ancestors.
+			size_t climbed = 0;
+			for (SceneNode* node = mNode; node != mRootNode; node = node->mParent, ++climbed)
+			{
+				SceneNode* parent = node->mParent;
+				for (size_t i = node->mIndexInParent + 1; i < parent->mChildren.size(); ++i)
+					if (SceneNode* found = firstAtDepth(parent->mChildren[i], climbed))
+					{
+						mNode = found;
+						return *this;
+					}
+			}
+
+			//The level is done.
+			mNode = firstAtDepth(mRootNode, ++mDepth);
+			return *this;
+		}
+
+		//it++
+		breadth_first_iterator operator++(int)
+		{
+			breadth_first_iterator current = *this;
+			++(*this);
+			return current;
+		}
+
+		bool operator == (const breadth_first_iterator& it) const
+		{
+			if (mRootNode != it.mRootNode)
+			{
+				Error("Scene iterators compared from different sources.");
+				return false;
+			}
+			return mNode == it.mNode;
+		}
+
+		bool operator != (const breadth_first_iterator& it) const
+		{
+			return !(*this == it);
+		}
+
+		SceneNode* operator*() const
+		{
+			return mNode;
+		}
+
+		SceneNode* operator->() const
+		{
+			return mNode;
+		}
+	};
+
 	iterator begin() const
 	{
-		return iterator(mRootNode);
+		return iterator(mRootNode, mRootNode);
 	}
 
 	iterator end() const
 	{
-		iterator e = begin();
-		e.reachedEnd = true;
-		return e;
+		return iterator(mRootNode, NULL);
+	}
+
+	breadth_first_iterator beginBreadthFirst() const
+	{
+		return breadth_first_iterator(mRootNode, mRootNode);
 	}
 
-	//erases and returns the next element. Makes input element point to end to help avoid errors.
+	breadth_first_iterator endBreadthFirst() const
+	{
+		return breadth_first_iterator(mRootNode, NULL);
+	}
+
+	/**Calls visit(node) for every node in the same order as iterator, by plain recursion the compiler can inline
+	the visitor into. The fastest way to walk the whole tree.*/
+	template<class Visitor>
+	void forEach(Visitor visit) const
+	{
+		forEach(mRootNode, visit);
+	}
+
+	/**Deletes the node, handing its children to its parent, and returns the next element. Makes input element point
+	to end to help avoid errors. Nodes after the erased one are still visited once each, in a different order.*/
 	iterator erase(iterator& it)
 	{
-		if (it.mNode == mRootNode)
+		SceneNode* node = it.mNode;
+		if (node == mRootNode)
 		{
 			Warning("Can not erase root node.");
 			return it;
 		}
-		iterator out = it;
-		++out;
-		//link parent to the children of the node being deleted, and vice versa.
-		it->getParent()->mChildren.insert(it->getParent()->mChildren.end(), it->mChildren.begin(), it->mChildren.end());
-		out->setParent(it->getParent());
+
+		//The children's transforms move up to the one the node's own hung from, so their world matrices no longer
+		//include the node's.
+		SceneNode* parent = node->mParent;
+		if (node->transformable())
+		{
+			const TransformStore::Handle parentTransform =
+				mTransforms.getParent(static_cast<TransformNode*>(node)->mTransform);
+			for (size_t i = 0; i < node->mChildren.size(); ++i)
+				if (node->mChildren[i]->transformable())
+					mTransforms.setParent(static_cast<TransformNode*>(node->mChildren[i])->mTransform, parentTransform);
+		}
+
+		for (size_t i = 0; i < node->mChildren.size(); ++i)
+		{
+			node->mChildren[i]->setParent(parent);
+			parent->addChild(node->mChildren[i]);
+		}
+		node->mChildren.clear();
+
+		//Taking the node out moves the parent's last child, not yet visited, into its place.
+		const size_t index = node->mIndexInParent;
+		parent->deleteChild(node);
+		delete node;
+
+		iterator out(mRootNode, NULL);
+		out.moveTo(parent, index);
+		it.mNode = NULL;
 		return out;
 	}
 
+private:
+	static const unsigned kSlotMask = (1u << kSlotBits) - 1;
+	static const unsigned kMaxGeneration = ~0u >> kSlotBits;
+
+	/**Adds a node just created to its parent's children, or deletes it and returns NULL if it got no handle.*/
+	template<class T>
+	T* adopt(SceneNode* parent, T* node)
+	{
+		if (node->mHandle == SceneNode::kInvalidHandle)
+		{
+			node->mParent = NULL; //Not among the parent's children yet.
+			delete node;
+			return NULL;
+		}
+		return parent->addChild(node);
+	}
+
+	template<class Visitor>
+	static void forEach(SceneNode* node, Visitor& visit)
+	{
+		visit(node);
+		for (size_t i = 0; i < node->mChildren.size(); ++i)
+			forEach(node->mChildren[i], visit);
+	}
+
 };
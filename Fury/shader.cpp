@@ -1,4 +1,5 @@
 #include "shader.h"
+#include <cstddef>
 
 namespace ShaderOP
 {
@@ -120,6 +121,17 @@ bool ConstantBuffer::setdata(const void* data)
 }
 
 
+bool ConstantBuffer::setdata(ID3D11DeviceContext* context, const void* data)
+{
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(mBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	memcpy(mapped.pData, data, mSize);
+	context->Unmap(mBuffer, 0);
+	return true;
+}
+
+
 ShaderBase::~ShaderBase()
 {
 	clear();
@@ -157,19 +169,57 @@ bool PixelShader::load(const std::string& path, ID3D11Device*  device)
 }
 
 bool PixelShader::setForRendering(ID3D11DeviceContext* context)
+{
+	StateCache cache;
+	return setForRendering(context, cache);
+}
+
+bool PixelShader::setForRendering(ID3D11DeviceContext* context, StateCache& cache)
 {
 	for (size_t i = 0; i < mConstantBuffers.size(); ++i)
 	{
+		const unsigned slot = RenderBackend::kFirstShaderConstantSlot + i;
 		ID3D11Buffer* buffer = mConstantBuffers[i]->getBuffer();
-		context->PSSetConstantBuffers(i, 1, &buffer);
+		if (cache.change(StateCache::PIXEL_CONSTANT_BUFFER, slot, buffer))
+			context->PSSetConstantBuffers(slot, 1, &buffer);
 	}
 
-	context->PSSetShader(mShader, NULL, 0);
+	if (cache.change(StateCache::PIXEL_SHADER, mShader))
+		context->PSSetShader(mShader, NULL, 0);
 
 	return true;
 }
 
-bool InputLayout::create(const std::vector<Type> layout, ID3D11Device* device, ID3D10Blob*& shaderBlob)
+namespace
+{
+	/**Where the per vertex elements of each VertexFormat are, and how the input assembler converts them to floats,
+	in the order of InputLayout::Type. The compact position is read as four values, the fourth the normal, which
+	the shader ignores; there are no three value 16 bit formats.*/
+	const struct
+	{
+		DXGI_FORMAT format;
+		unsigned offset;
+	} kVertexElements[VERTEX_FORMAT_COUNT][InputLayout::INSTANCE] = {
+		{
+			{ DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex3D, x) },
+			{ DXGI_FORMAT_R32G32B32_FLOAT, offsetof(Vertex3D, normx) },
+			{ DXGI_FORMAT_R32G32_FLOAT, offsetof(Vertex3D, u) },
+		},
+		{
+			{ DXGI_FORMAT_R16G16B16A16_UNORM, offsetof(QuantizedVertex, position) },
+			{ DXGI_FORMAT_R16G16_SNORM, offsetof(QuantizedVertex, normal) },
+			{ DXGI_FORMAT_R16G16_FLOAT, offsetof(QuantizedVertex, uv) },
+		},
+		{
+			{ DXGI_FORMAT_R16G16B16A16_UNORM, offsetof(CompactQuantizedVertex, position) },
+			{ DXGI_FORMAT_R8G8_SNORM, offsetof(CompactQuantizedVertex, normal) },
+			{ DXGI_FORMAT_R16G16_FLOAT, offsetof(CompactQuantizedVertex, uv) },
+		},
+	};
+}
+
+bool InputLayout::create(const std::vector<Type> layout, ID3D11Device* device, ID3D10Blob*& shaderBlob,
+	VertexFormat format)
 {
 	D3D11_INPUT_ELEMENT_DESC* layoutDesc = new D3D11_INPUT_ELEMENT_DESC[layout.size()];
 
@@ -183,8 +233,15 @@ bool InputLayout::create(const std::vector<Type> layout, ID3D11Device* device, I
 		layoutDesc[i] = { 0 };
 		layoutDesc[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 		layoutDesc[i].SemanticIndex = semanticIndex[layout[i]]++;
+		if (layout[i] == INSTANCE)
+		{
+			layoutDesc[i].InputSlot = 1;
+			layoutDesc[i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+			layoutDesc[i].InstanceDataStepRate = 1;
+		}
 		
-		if(i!=0)
+		//Elements follow the one before them in the same stream.
+		if (i != 0 && layoutDesc[i - 1].InputSlot == layoutDesc[i].InputSlot)
 			layoutDesc[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 
 		switch (layout[i])
@@ -201,9 +258,19 @@ bool InputLayout::create(const std::vector<Type> layout, ID3D11Device* device, I
 			layoutDesc[i].SemanticName = "TEXCOORD";
 			layoutDesc[i].Format = DXGI_FORMAT_R32G32_FLOAT;
 			break;
+		case INSTANCE:
+			layoutDesc[i].SemanticName = "INSTANCE";
+			layoutDesc[i].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			break;
 		default:
 			assert(0);
 		}
+
+		if (layout[i] != INSTANCE)
+		{
+			layoutDesc[i].Format = kVertexElements[format][layout[i]].format;
+			layoutDesc[i].AlignedByteOffset = kVertexElements[format][layout[i]].offset;
+		}
 	}
 
 	HRESULT error;
@@ -233,21 +300,35 @@ bool VertexShader::load(const std::string& path, ID3D11Device*  device)
 		return false;
 	}
 
-	//MUST BE IN ORDER >.< :
-	mLayout.create({ InputLayout::POSITION, InputLayout::NORMAL, InputLayout::TEXCOORD}, device, mShaderBlob);
+	//MUST BE IN ORDER >.< : The instances are laid out as InstanceStaticmesh.
+	for (int format = 0; format < VERTEX_FORMAT_COUNT; ++format)
+		mLayouts[format].create({ InputLayout::POSITION, InputLayout::NORMAL, InputLayout::TEXCOORD,
+			InputLayout::INSTANCE, InputLayout::INSTANCE, InputLayout::INSTANCE,
+			InputLayout::INSTANCE, InputLayout::INSTANCE, InputLayout::INSTANCE,
+			InputLayout::INSTANCE }, device, mShaderBlob, VertexFormat(format));
 	return true;
 }
 
 bool VertexShader::setForRendering(ID3D11DeviceContext* context)
+{
+	StateCache cache;
+	return setForRendering(context, cache);
+}
+
+bool VertexShader::setForRendering(ID3D11DeviceContext* context, StateCache& cache)
 {
 	for (size_t i = 0; i < mConstantBuffers.size(); ++i)
 	{
+		const unsigned slot = RenderBackend::kFirstShaderConstantSlot + i;
 		auto buffer = mConstantBuffers[i]->getBuffer();
-		context->VSSetConstantBuffers(i, 1, &buffer);
+		if (cache.change(StateCache::VERTEX_CONSTANT_BUFFER, slot, buffer))
+			context->VSSetConstantBuffers(slot, 1, &buffer);
 	}
 	
-	context->IASetInputLayout(mLayout.getLayout());
-	context->VSSetShader(mShader, NULL, 0);
+	if (cache.change(StateCache::INPUT_LAYOUT, getLayout()))
+		context->IASetInputLayout(getLayout());
+	if (cache.change(StateCache::VERTEX_SHADER, mShader))
+		context->VSSetShader(mShader, NULL, 0);
 
 	return true;
 }
@@ -338,10 +419,21 @@ ShaderProgram::~ShaderProgram()
 	deletePtr(mPixelShader);
 }
 
-void ShaderProgram::render(ID3D11DeviceContext* context, int indexCount)
+void ShaderProgram::setForRendering(ID3D11DeviceContext* context)
 {
 	mVertexShader->setForRendering(context);
 	mPixelShader->setForRendering(context);
+}
+
+void ShaderProgram::setForRendering(ID3D11DeviceContext* context, StateCache& cache)
+{
+	mVertexShader->setForRendering(context, cache);
+	mPixelShader->setForRendering(context, cache);
+}
+
+void ShaderProgram::render(ID3D11DeviceContext* context, int indexCount)
+{
+	setForRendering(context);
 
 	context->DrawIndexed(indexCount, 0, 0);
 }
@@ -13,6 +13,10 @@
 #include "directx.h"
 #include "immediateio.h"
 #include "shaderbuffertypes.h"
+#include "renderqueue.h"
+#include "statecache.h"
+#include "renderbackend.h"
+#include "vertex.h"
 
 namespace ShaderOP
 {
@@ -107,6 +111,7 @@ public:
 
 	/**
 	* Place data into the buffer's GPU memory. sizeof(*data) must be equal to the size specified upon creation.
+	* Unlike lock(), setdata() and unlock(), may be called on several contexts at once.
 	* @param context The current DirectX context.
 	*/
 	bool setdata(ID3D11DeviceContext* context, const void* data);
@@ -123,7 +128,8 @@ class InputLayout
 private:
 	ID3D11InputLayout* mLayout;
 public:
-	enum Type { POSITION, NORMAL, TEXCOORD, TYPE_COUNT };
+	/**INSTANCE is a float4 of per-instance data, read from the second vertex stream.*/
+	enum Type { POSITION, NORMAL, TEXCOORD, INSTANCE, TYPE_COUNT };
 
 	/**
 	* A constructor initialising everything to its default value.
@@ -139,12 +145,14 @@ public:
 
 	/**
 	* Creates the input layout, based on a vector that describes it in detail.
-	* @param layout The layout description.
+	* @param layout The layout description, with at most one each of POSITION, NORMAL and TEXCOORD.
 	* @param device The ID3D11 device.
 	* @param shaderBlob A pointer to the compiled shader bytecode.
+	* @param format The layout of the vertices the per vertex elements are read from.
 	* @return Returns true if the operation was successful.
 	*/
-	bool create(const std::vector<Type> layout, ID3D11Device* device, ID3D10Blob*& shaderBlob);
+	bool create(const std::vector<Type> layout, ID3D11Device* device, ID3D10Blob*& shaderBlob,
+		VertexFormat format = VERTEX_FLOAT);
 
 
 	/**
@@ -220,20 +228,29 @@ public:
 	*/
 	template<class DataType>
 	int setConstantBuffersData(ID3D11DeviceContext* context, DataType* data, size_t bufferNo)
+	{
+		return setConstantBuffersData(context, data, sizeof(DataType), bufferNo);
+	}
+
+
+	/**
+	* Sets the data for a particular constant buffer from untyped memory.
+	* @param size The size of the data, which must be the size of the buffer.
+	* @return The same codes as the typed version.
+	*/
+	int setConstantBuffersData(ID3D11DeviceContext* context, const void* data, size_t size, size_t bufferNo)
 	{
 		//If there is no data in the pointer, or the data struct is empty.
-		if (sizeof(DataType) < 2 || !data) 
+		if (size < 2 || !data)
 			return 1;
 
 		if (bufferNo >= mConstantBuffers.size())
 			return 2;
 
-		assert(mConstantBuffers[bufferNo]->size() == sizeof(DataType)); //Can't just change data type ^^
+		assert(mConstantBuffers[bufferNo]->size() == size); //Can't just change data type ^^
 
-		if (
-			!mConstantBuffers[bufferNo]->lock(context) ||
-			!mConstantBuffers[bufferNo]->setdata(data) ||
-			!mConstantBuffers[bufferNo]->unlock(context))
+		//Maps into memory of its own rather than the buffer's, as deferred contexts may set it on several threads.
+		if (!mConstantBuffers[bufferNo]->setdata(context, data))
 			return 3;
 		
 		return 0;
@@ -260,6 +277,13 @@ public:
 	virtual bool setForRendering(ID3D11DeviceContext* context) = 0;
 
 
+	/**
+	* Sets it for rendering, skipping what the cache says is already bound. Its constant buffers are bound after the
+	* frame constants, the first at RenderBackend::kFirstShaderConstantSlot.
+	*/
+	virtual bool setForRendering(ID3D11DeviceContext* context, StateCache& cache) = 0;
+
+
 	/**
 	* Returns true if the shader is ready to be used.
 	*/
@@ -308,6 +332,7 @@ public:
 	* Sets it as the current pixel shader for rendering.
 	*/
 	virtual bool setForRendering(ID3D11DeviceContext* context);
+	virtual bool setForRendering(ID3D11DeviceContext* context, StateCache& cache);
 
 
 	/**
@@ -327,7 +352,7 @@ class VertexShader : public ShaderBase
 {
 private:
 	ID3D11VertexShader* mShader;
-	InputLayout mLayout;
+	InputLayout mLayouts[VERTEX_FORMAT_COUNT];
 public:
 
 	/**
@@ -343,11 +368,11 @@ public:
 
 
 	/**
-	* Returns the currently set vertex shader layout.
+	* Returns the input layout for vertices of a format. setForRendering() binds the one for VERTEX_FLOAT.
 	*/
-	ID3D11InputLayout* getLayout()
+	ID3D11InputLayout* getLayout(VertexFormat format = VERTEX_FLOAT)
 	{
-		return mLayout.getLayout();
+		return mLayouts[format].getLayout();
 	}
 
 
@@ -372,6 +397,7 @@ public:
 	* Sets it as the current pixel shader for rendering.
 	*/
 	virtual bool setForRendering(ID3D11DeviceContext* context);
+	virtual bool setForRendering(ID3D11DeviceContext* context, StateCache& cache);
 
 
 	/**
@@ -462,6 +488,7 @@ protected:
 	
 	VertexShader* mVertexShader;
 	PixelShader* mPixelShader;
+	RenderId<ShaderProgram> mRenderId;
 
 public:
 	/**
@@ -498,10 +525,52 @@ public:
 	}
 
 
+	/**
+	* Sets a cbuffer for the vertex shader from untyped memory of the buffer's size.
+	*/
+	void setVertexData(ID3D11DeviceContext* context, const void* vertexdata, size_t size, size_t index)
+	{
+		mVertexShader->setConstantBuffersData(context, vertexdata, size, index);
+	}
+
+	/**
+	* Sets a cbuffer for the pixel shader from untyped memory of the buffer's size.
+	*/
+	void setPixelData(ID3D11DeviceContext* context, const void* pixeldata, size_t size, size_t index)
+	{
+		mPixelShader->setConstantBuffersData(context, pixeldata, size, index);
+	}
+
+
+	/**
+	* Sets the program as active, along with its constant buffers and input layout.
+	* @param context The DirectX Context.
+	*/
+	void setForRendering(ID3D11DeviceContext* context);
+
+
+	/**
+	* Sets the program as active, skipping the shaders, buffers and layout the cache says are already bound.
+	*/
+	void setForRendering(ID3D11DeviceContext* context, StateCache& cache);
+
+
 	/**
 	* Sets the program as active and draws the currently set objects.
 	* @param context The DirectX Context.
 	* @param indexCount The number of indices to draw.
 	*/
 	void render(ID3D11DeviceContext* context, int indexCount);
+
+
+	/**
+	* Returns the vertex shader's input layout for vertices of a format.
+	*/
+	ID3D11InputLayout* getLayout(VertexFormat format) { return mVertexShader->getLayout(format); }
+
+
+	/**
+	* Returns the number of the program in render queue sort keys.
+	*/
+	const RenderId<ShaderProgram>& renderId() const { return mRenderId; }
 };
\ No newline at end of file
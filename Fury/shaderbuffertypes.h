@@ -1,14 +1,26 @@
 #pragma once
 
 
-struct VertexBufferStaticmesh
+/**What every shader sees of the frame, in the frame constants.*/
+struct FrameConstants
 {
-	math::mat4 world;
 	math::mat4 view;
 	math::mat4 projection;
 };
 
-struct PixelBufferStaticmesh
+/**One static mesh instance in the second vertex stream. The matrices are stored as their top three rows.*/
+struct InstanceStaticmesh
 {
+	math::vec4 world[3];
+	math::vec4 normal[3]; //Inverse transpose of world, for transforming normals. normal[0].w is 1 if the mesh's
+						  //normals are octahedral encoded, and 0 if they are float3.
 	math::vec4 colour;
+};
+
+/**One light in world space. Directional lights leave the position and radius unused, point lights the direction
+and angle.*/
+struct LightBufferEntry
+{
+	math::vec4 positionRadius; //The radius is how far the light reaches.
+	math::vec4 directionCosAngle; //The direction the light shines in, and the cosine of a spot light's half angle.
 };
\ No newline at end of file
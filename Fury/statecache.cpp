@@ -0,0 +1,75 @@
+#include "statecache.h"
+#include <cassert>
+#include <cstring>
+
+size_t StateCache::Counts::totalIssued() const
+{
+	size_t total = 0;
+	for (int i = 0; i < STATE_COUNT; ++i)
+		total += issued[i];
+	return total;
+}
+
+size_t StateCache::Counts::totalElided() const
+{
+	size_t total = 0;
+	for (int i = 0; i < STATE_COUNT; ++i)
+		total += elided[i];
+	return total;
+}
+
+StateCache::StateCache()
+{
+	std::memset(mBound, 0, sizeof(mBound));
+	invalidate();
+	beginFrame();
+}
+
+bool StateCache::change(State state, unsigned slot, const void* value)
+{
+	assert(state < STATE_COUNT && slot < kSlots);
+
+	if (mKnown[state][slot] && mBound[state][slot] == value)
+	{
+		++mCounts.elided[state];
+		return false;
+	}
+
+	mBound[state][slot] = value;
+	mKnown[state][slot] = true;
+	++mCounts.issued[state];
+	return true;
+}
+
+void StateCache::forget(State state, unsigned slot)
+{
+	assert(state < STATE_COUNT && slot < kSlots);
+	mKnown[state][slot] = false;
+}
+
+void StateCache::invalidate()
+{
+	std::memset(mKnown, 0, sizeof(mKnown));
+}
+
+void StateCache::beginFrame()
+{
+	std::memset(&mCounts, 0, sizeof(mCounts));
+}
+
+void StateCache::merge(const Counts& counts)
+{
+	for (int i = 0; i < STATE_COUNT; ++i)
+	{
+		mCounts.issued[i] += counts.issued[i];
+		mCounts.elided[i] += counts.elided[i];
+	}
+}
+
+const char* StateCache::name(State state)
+{
+	static const char* const names[STATE_COUNT] = { "vertex shader", "pixel shader", "input layout",
+		"vertex constant buffer", "pixel constant buffer", "vertex buffer", "index buffer", "shader resource",
+		"sampler", "topology" };
+	return names[state];
+}
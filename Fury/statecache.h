@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+
+/*
+The pipeline state bound on a context, kept so that binding what is already bound can be skipped. Does not depend
+on DirectX: values are the addresses of the bound objects, or any other number that identifies them, so the same
+cache filters the calls of DirectXBackend and of CommandList.
+
+The context keeps a reference to what is bound, so an object cannot be freed and another made at its address while
+the cache still holds it. Anything that binds state on the context without the cache must call invalidate().
+*/
+class StateCache
+{
+public:
+	enum State
+	{
+		VERTEX_SHADER,
+		PIXEL_SHADER,
+		INPUT_LAYOUT,
+		VERTEX_CONSTANT_BUFFER,
+		PIXEL_CONSTANT_BUFFER,
+		VERTEX_BUFFER,
+		INDEX_BUFFER,
+		SHADER_RESOURCE,
+		SAMPLER,
+		TOPOLOGY,
+		STATE_COUNT
+	};
+
+	/**Slots tracked of each state. Direct3D 11 has more shader resource slots, but nothing here uses them.*/
+	static const unsigned kSlots = 16;
+
+	/**Bindings issued and skipped since beginFrame(), by state.*/
+	struct Counts
+	{
+		size_t issued[STATE_COUNT];
+		size_t elided[STATE_COUNT];
+
+		size_t totalIssued() const;
+		size_t totalElided() const;
+	};
+
+	StateCache();
+
+	/**Returns true if binding value to the slot of a state changes what is bound, remembering the value if so.
+	Counts the binding as issued or elided.*/
+	bool change(State state, unsigned slot, const void* value);
+	bool change(State state, const void* value) { return change(state, 0, value); }
+
+	/**Forgets what is bound to a slot, so that the next binding to it is issued.*/
+	void forget(State state, unsigned slot);
+
+	/**Forgets everything bound. The counts are kept.*/
+	void invalidate();
+
+	/**Zeroes the counts. What is bound carries over from the last frame.*/
+	void beginFrame();
+
+	/**Adds the counts of another cache, such as that of a deferred context, to these.*/
+	void merge(const Counts& counts);
+
+	const Counts& counts() const { return mCounts; }
+
+	/**Returns the name of a state, for statistics.*/
+	static const char* name(State state);
+
+private:
+	const void* mBound[STATE_COUNT][kSlots];
+	bool mKnown[STATE_COUNT][kSlots];
+	Counts mCounts;
+};
@@ -229,6 +229,14 @@ void TextureGPU::setForRendering(ID3D11DeviceContext* context)
 	context->PSSetSamplers(0, 1, &mSamplerState);
 }
 
+void TextureGPU::setForRendering(ID3D11DeviceContext* context, StateCache& cache)
+{
+	if (cache.change(StateCache::SHADER_RESOURCE, mView))
+		context->PSSetShaderResources(0, 1, &mView);
+	if (cache.change(StateCache::SAMPLER, mSamplerState))
+		context->PSSetSamplers(0, 1, &mSamplerState);
+}
+
 ID3D11ShaderResourceView* TextureGPU::getTextureView()
 {
 	return mView;
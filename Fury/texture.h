@@ -1,5 +1,7 @@
 #pragma once
 #include "rendertarget.h"
+#include "renderqueue.h"
+#include "statecache.h"
 
 //Always 4 components
 class Texture
@@ -39,6 +41,7 @@ bool mInGPU;
 ID3D11Texture2D* mTexture;
 ID3D11ShaderResourceView* mView;
 ID3D11SamplerState* mSamplerState;
+RenderId<TextureGPU> mRenderId;
 
 public:
 TextureGPU();
@@ -53,6 +56,12 @@ bool inGPU();
 virtual void clear();
 
 void setForRendering(ID3D11DeviceContext* device);
+
+/**Binds the view and sampler to the first pixel shader slot, unless the cache says they already are.*/
+void setForRendering(ID3D11DeviceContext* context, StateCache& cache);
+
+/**Returns the number of the texture in render queue sort keys.*/
+const RenderId<TextureGPU>& renderId() const { return mRenderId; }
 };
 
 
@@ -8,10 +8,7 @@ void Transformable::updateMatrix()
 
 void Transformable::forceMatrixUpdate()
 {
-	m_matrix.reset();
-	m_matrix *= math::mat4().initTranslation(m_pos);
-	m_matrix *= m_rot.normalize().toMatrix();
-	m_matrix *= math::mat4().initScale(m_scale);
+	m_matrix.initTRS(m_pos, m_rot.normalizeFast(), m_scale);
 
 	m_pendingMatrixUpdate = false; //Signals that no update is needed
 }
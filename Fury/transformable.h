@@ -5,7 +5,7 @@
 class Transformable : public Movable
 {
 protected:
-	math::mat4 m_matrix;
+	math::mat3x4 m_matrix;
 public:
 
 
@@ -16,5 +16,5 @@ public:
 	void forceMatrixUpdate();
 
 	/**Returns the internal matrix.*/
-	math::mat4& matrix() {return m_matrix;}
+	math::mat3x4& matrix() {return m_matrix;}
 };
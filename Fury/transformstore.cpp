@@ -0,0 +1,357 @@
+#include "transformstore.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <atomic>
+#include <assert.h>
+
+namespace
+{
+	//Levels with fewer dirty slots stay on the calling thread, where waking the workers would cost more.
+	const size_t kParallelThreshold = 16384;
+
+	//Smallest piece of a level handed to a thread.
+	const size_t kMinChunk = 2048;
+
+	/**Rearranges v so that element n is the old element order[n].*/
+	template<class T>
+	void permute(std::vector<T>& v, const std::vector<unsigned>& order)
+	{
+		std::vector<T> out;
+		out.reserve(order.size());
+		for (size_t n = 0; n < order.size(); ++n)
+			out.push_back(v[order[n]]);
+		v.swap(out);
+	}
+}
+
+const TransformStore::Handle TransformStore::kInvalidHandle;
+const unsigned TransformStore::kNoParent;
+const unsigned TransformStore::kClean;
+
+TransformStore::TransformStore()
+	: mLiveCount(0), mFirstDirty(kClean), mUpdateCount(0), mNeedsReorder(false)
+{
+	mStats.localMatrices = 0;
+	mStats.worldMatrices = 0;
+}
+
+void TransformStore::clear()
+{
+	mParent.clear();
+	mDepth.clear();
+	mPos.clear();
+	mRot.clear();
+	mScale.clear();
+	mLocal.clear();
+	mWorld.clear();
+	mLocalDirty.clear();
+	mChangedAt.clear();
+	mHandle.clear();
+	mLevelEnd.clear();
+	mLevelDirty.clear();
+	mSlot.clear();
+	mFreeHandles.clear();
+
+	mLiveCount = 0;
+	mFirstDirty = kClean;
+	mNeedsReorder = false;
+}
+
+TransformStore::Handle TransformStore::create(Handle parent)
+{
+	const unsigned slot = unsigned(mParent.size());
+	const unsigned parentSlot = parent == kInvalidHandle ? kNoParent : slotOf(parent);
+	const unsigned depth = parentSlot == kNoParent ? 0 : mDepth[parentSlot] + 1;
+
+	//Appending keeps the slots sorted as long as the new one is at the deepest level or one below it.
+	if (depth + 1 == mLevelEnd.size())
+		++mLevelEnd.back();
+	else if (depth == mLevelEnd.size())
+		mLevelEnd.push_back(slot + 1);
+	else
+		mNeedsReorder = true;
+
+	mParent.push_back(parentSlot);
+	mDepth.push_back(depth);
+	mPos.push_back(math::vec3());
+	mRot.push_back(math::Quaternion());
+	mScale.push_back(1.f);
+	mLocal.push_back(math::mat3x4());
+	mWorld.push_back(math::mat3x4());
+	mLocalDirty.push_back(0);
+	mChangedAt.push_back(0);
+	markDirty(slot); //Picks up the parent's world matrix on the next update.
+
+	Handle handle;
+	if (mFreeHandles.empty())
+	{
+		handle = Handle(mSlot.size());
+		mSlot.push_back(slot);
+	}
+	else
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+		mSlot[handle] = slot;
+	}
+	mHandle.push_back(handle);
+
+	++mLiveCount;
+	return handle;
+}
+
+void TransformStore::destroy(Handle handle)
+{
+	//The slot stays in place, still linking its children to its parent, until the next reorder().
+	mHandle[slotOf(handle)] = kInvalidHandle;
+	mFreeHandles.push_back(handle);
+	--mLiveCount;
+	mNeedsReorder = true;
+}
+
+void TransformStore::setParent(Handle handle, Handle parent)
+{
+	const unsigned slot = slotOf(handle);
+	const unsigned parentSlot = parent == kInvalidHandle ? kNoParent : slotOf(parent);
+
+#ifndef NDEBUG
+	for (unsigned s = parentSlot; s != kNoParent; s = mParent[s])
+		assert(s != slot && "A transform can not become its own descendant.");
+#endif
+
+	mParent[slot] = parentSlot;
+	markDirty(slot);
+	mNeedsReorder = true; //The depths of the whole subtree change.
+}
+
+TransformStore::Handle TransformStore::getParent(Handle handle) const
+{
+	unsigned s = mParent[slotOf(handle)];
+	while (s != kNoParent && mHandle[s] == kInvalidHandle)
+		s = mParent[s];
+	return s == kNoParent ? kInvalidHandle : mHandle[s];
+}
+
+void TransformStore::setLocal(Handle handle, const math::vec3& pos, const math::Quaternion& rot, float scale)
+{
+	const unsigned slot = slotOf(handle);
+	mPos[slot] = pos;
+	mRot[slot] = rot;
+	mScale[slot] = scale;
+	markDirty(slot);
+}
+
+void TransformStore::markDirty(unsigned slot)
+{
+	if (mLocalDirty[slot])
+		return;
+	mLocalDirty[slot] = 1;
+	mFirstDirty = std::min(mFirstDirty, slot);
+
+	//By the depth the slot had when last sorted; a reparented slot is counted again by reorder().
+	const unsigned depth = mDepth[slot];
+	if (depth >= mLevelDirty.size())
+		mLevelDirty.resize(depth + 1, 0);
+	++mLevelDirty[depth];
+}
+
+const math::mat3x4& TransformStore::localMatrix(Handle handle) const
+{
+	return mLocal[slotOf(handle)];
+}
+
+const math::mat3x4& TransformStore::worldMatrix(Handle handle) const
+{
+	return mWorld[slotOf(handle)];
+}
+
+bool TransformStore::changedInLastUpdate(Handle handle) const
+{
+	return mChangedAt[slotOf(handle)] == mUpdateCount;
+}
+
+size_t TransformStore::size() const
+{
+	return mLiveCount;
+}
+
+void TransformStore::update(bool allowThreads)
+{
+	mStats.localMatrices = 0;
+	mStats.worldMatrices = 0;
+
+	//Counted even when nothing is dirty, so that changedInLastUpdate() forgets the previous update.
+	const unsigned frame = ++mUpdateCount;
+	if (mNeedsReorder)
+		reorder();
+	if (mFirstDirty == kClean)
+		return;
+
+	const size_t count = mParent.size();
+	if (!allowThreads || count - mFirstDirty < kParallelThreshold)
+		updateRange(mFirstDirty, count, frame, mStats);
+	else
+	{
+		//One level at a time, each with enough dirty slots split over the pool. A level's dirty slots are those
+		//marked in it and the children of those rebuilt in the level above, of which it has as many as the average
+		//slot there. parallelFor returns once the level is done, so the next one reads finished parents.
+		size_t rebuiltAbove = 0;
+		for (size_t level = 0; level < mLevelEnd.size(); ++level)
+		{
+			const size_t levelBegin = level == 0 ? 0 : mLevelEnd[level - 1];
+			const size_t begin = std::max<size_t>(levelBegin, mFirstDirty);
+			const size_t end = mLevelEnd[level];
+			UpdateStats levelStats = { 0, 0 };
+			if (begin >= end)
+			{
+				rebuiltAbove = 0;
+				continue;
+			}
+
+			const size_t aboveSize = level == 0 ? 0 : levelBegin - (level == 1 ? 0 : mLevelEnd[level - 2]);
+			const size_t dirty = (level < mLevelDirty.size() ? mLevelDirty[level] : 0) +
+				(aboveSize ? rebuiltAbove * (end - levelBegin) / aboveSize : 0);
+			if (dirty < kParallelThreshold)
+				updateRange(begin, end, frame, levelStats);
+			else
+			{
+				std::atomic<size_t> localMatrices(0), worldMatrices(0);
+				WorkerPool::instance().parallelFor(end - begin, kMinChunk, [&](size_t chunkBegin, size_t chunkEnd) {
+					UpdateStats stats = { 0, 0 };
+					updateRange(begin + chunkBegin, begin + chunkEnd, frame, stats);
+					localMatrices += stats.localMatrices;
+					worldMatrices += stats.worldMatrices;
+				});
+				levelStats.localMatrices = localMatrices;
+				levelStats.worldMatrices = worldMatrices;
+			}
+
+			mStats.localMatrices += levelStats.localMatrices;
+			mStats.worldMatrices += levelStats.worldMatrices;
+			rebuiltAbove = levelStats.worldMatrices;
+		}
+	}
+
+	mFirstDirty = kClean;
+	std::fill(mLevelDirty.begin(), mLevelDirty.end(), 0);
+}
+
+void TransformStore::updateRange(size_t begin, size_t end, unsigned frame, UpdateStats& stats)
+{
+	//A parent rebuilt in this update has mChangedAt equal to frame, which is how the dirty bit reaches the subtree.
+	for (size_t i = begin; i < end; ++i)
+	{
+		const unsigned parent = mParent[i];
+		if (mLocalDirty[i])
+		{
+			mLocal[i].initTRS(mPos[i], mRot[i].normalizeFast(), mScale[i]);
+			mLocalDirty[i] = 0;
+			++stats.localMatrices;
+		}
+		else if (parent == kNoParent || mChangedAt[parent] != frame)
+			continue;
+
+		if (parent == kNoParent)
+			mWorld[i] = mLocal[i];
+		else
+			mWorld[i] = mLocal[i] * mWorld[parent];
+		mChangedAt[i] = frame;
+		++stats.worldMatrices;
+	}
+}
+
+const TransformStore::UpdateStats& TransformStore::lastUpdateStats() const
+{
+	return mStats;
+}
+
+void TransformStore::reorder()
+{
+	const size_t count = mParent.size();
+
+	//Point every slot past destroyed ancestors, at the nearest live one.
+	std::vector<unsigned> parent(mParent);
+	for (size_t i = 0; i < count; ++i)
+	{
+		while (parent[i] != kNoParent && mHandle[parent[i]] == kInvalidHandle)
+			parent[i] = mParent[parent[i]];
+		if (parent[i] != mParent[i])
+			mLocalDirty[i] = 1; //The world matrix now builds on a different ancestor.
+	}
+
+	std::vector<unsigned> order;
+	order.reserve(mLiveCount);
+	for (size_t i = 0; i < count; ++i)
+		if (mHandle[i] != kInvalidHandle)
+			order.push_back(unsigned(i));
+
+	//Depths from scratch, since orphans and reparented subtrees have moved. Unknown ones are kNoParent.
+	std::vector<unsigned> depth(count, kNoParent);
+	std::vector<unsigned> chain;
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		unsigned s = order[n];
+		while (s != kNoParent && depth[s] == kNoParent)
+		{
+			chain.push_back(s);
+			s = parent[s];
+		}
+		unsigned d = s == kNoParent ? 0 : depth[s] + 1;
+		for (size_t c = chain.size(); c-- > 0; ++d)
+			depth[chain[c]] = d;
+		chain.clear();
+	}
+
+	//Stable, so siblings keep their order.
+	std::stable_sort(order.begin(), order.end(), [&depth](unsigned a, unsigned b) { return depth[a] < depth[b]; });
+
+	std::vector<unsigned> newSlot(count, kNoParent);
+	for (size_t n = 0; n < order.size(); ++n)
+		newSlot[order[n]] = unsigned(n);
+
+	mParent.resize(order.size());
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		const unsigned p = parent[order[n]];
+		mParent[n] = p == kNoParent ? kNoParent : newSlot[p];
+	}
+
+	mDepth.resize(order.size());
+	mLevelEnd.clear();
+	for (size_t n = 0; n < order.size(); ++n)
+	{
+		mDepth[n] = depth[order[n]];
+		if (mDepth[n] == mLevelEnd.size())
+			mLevelEnd.push_back(unsigned(n));
+		++mLevelEnd.back();
+	}
+
+	permute(mPos, order);
+	permute(mRot, order);
+	permute(mScale, order);
+	permute(mLocal, order);
+	permute(mWorld, order);
+	permute(mLocalDirty, order);
+	permute(mChangedAt, order);
+	permute(mHandle, order);
+
+	for (size_t n = 0; n < mHandle.size(); ++n)
+		mSlot[mHandle[n]] = unsigned(n);
+
+	mFirstDirty = kClean;
+	mLevelDirty.assign(mLevelEnd.size(), 0);
+	for (size_t n = 0; n < mLocalDirty.size(); ++n)
+		if (mLocalDirty[n])
+		{
+			mFirstDirty = std::min(mFirstDirty, unsigned(n));
+			++mLevelDirty[mDepth[n]];
+		}
+
+	mNeedsReorder = false;
+}
+
+unsigned TransformStore::slotOf(Handle handle) const
+{
+	assert(handle < mSlot.size() && mSlot[handle] < mHandle.size() && mHandle[mSlot[handle]] == handle);
+	return mSlot[handle];
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "matrixd.h"
+#include <vector>
+
+/*
+The transform hierarchy of a scene, kept in flat arrays instead of in the nodes themselves. Every transform has a
+slot holding its parent's slot, its local position, rotation and scale, and its local and world matrices. Slots
+are sorted by depth in the hierarchy, so a parent always comes before its children, which lets update() compute
+every world matrix in a single pass from front to back, reading the parent's result from earlier in the same array.
+Each depth is also one contiguous range whose transforms only depend on earlier ranges, so large scenes split
+every range over worker threads instead.
+
+Only what changed is recomputed: setting a transform marks its local matrix dirty, and the pass rebuilds the world
+matrices of the dirty transforms and of everything below them. The pass starts at the first dirty slot, and an
+update with nothing dirty returns straight away, so a scene that stands still costs nothing.
+
+Slots move when transforms are destroyed or reparented, so callers refer to transforms through handles, which
+stay the same for the lifetime of the transform.
+*/
+class TransformStore
+{
+public:
+	/**Identifies a transform in the store.*/
+	typedef unsigned Handle;
+
+	/**No transform. Used as the parent of root transforms.*/
+	static const Handle kInvalidHandle = ~0u;
+
+	/**What the last update() recomputed, for checking that unchanged parts of the scene are skipped.*/
+	struct UpdateStats
+	{
+		size_t localMatrices; //Rebuilt from a new position, rotation and scale.
+		size_t worldMatrices; //Rebuilt because the transform or one of its ancestors changed.
+	};
+
+	TransformStore();
+
+	/**Creates an identity transform under the given parent, or as a root if the parent is kInvalidHandle.*/
+	Handle create(Handle parent = kInvalidHandle);
+
+	/**Destroys the transform. Any children left are attached to its parent, and the handle may be reused.*/
+	void destroy(Handle handle);
+
+	/**Moves the transform under a new parent, or makes it a root if the parent is kInvalidHandle.
+	The parent must not be the transform itself or one of its descendants.*/
+	void setParent(Handle handle, Handle parent);
+
+	/**Destroys every transform. The arrays keep their memory.*/
+	void clear();
+
+	/**Returns the parent, or kInvalidHandle for a root.*/
+	Handle getParent(Handle handle) const;
+
+	/**Sets the local position, rotation and scale. The matrices follow on the next update().*/
+	void setLocal(Handle handle, const math::vec3& pos, const math::Quaternion& rot, float scale);
+
+	/**Returns the local matrix as of the last update().*/
+	const math::mat3x4& localMatrix(Handle handle) const;
+
+	/**Returns the world matrix, local * parent world, as of the last update().*/
+	const math::mat3x4& worldMatrix(Handle handle) const;
+
+	/**Returns whether the last update() rebuilt the world matrix, for keeping what depends on it up to date.*/
+	bool changedInLastUpdate(Handle handle) const;
+
+	/**Returns the number of live transforms.*/
+	size_t size() const;
+
+	/**Rebuilds the changed local matrices and the world matrices that depend on them. Levels of the hierarchy
+	with enough work are split over WorkerPool::instance() unless allowThreads is false. The result is the same
+	either way, to the bit.*/
+	void update(bool allowThreads = true);
+
+	/**Returns the counts of the last update().*/
+	const UpdateStats& lastUpdateStats() const;
+
+private:
+	static const unsigned kNoParent = ~0u;
+	static const unsigned kClean = ~0u; //mFirstDirty when nothing changed.
+
+	/**Drops destroyed slots and sorts the rest by depth again.*/
+	void reorder();
+
+	/**Marks the slot's local matrix dirty.*/
+	void markDirty(unsigned slot);
+
+	/**Updates the slots [begin, end), whose parents must already be up to date, adding to the counts.*/
+	void updateRange(size_t begin, size_t end, unsigned frame, UpdateStats& stats);
+
+	unsigned slotOf(Handle handle) const;
+
+	//Per slot, sorted by depth.
+	std::vector<unsigned> mParent; //Slot of the parent, or kNoParent.
+	std::vector<unsigned> mDepth;
+	std::vector<math::vec3> mPos;
+	std::vector<math::Quaternion> mRot;
+	std::vector<float> mScale;
+	std::vector<math::mat3x4> mLocal;
+	std::vector<math::mat3x4> mWorld;
+	std::vector<unsigned char> mLocalDirty;
+	std::vector<unsigned> mChangedAt; //The update that last rebuilt the world matrix.
+	std::vector<Handle> mHandle; //The handle owning the slot, or kInvalidHandle once destroyed.
+
+	std::vector<unsigned> mLevelEnd; //One past the last slot of each depth.
+	std::vector<size_t> mLevelDirty; //Slots of each depth whose local matrix is dirty.
+
+	//Per handle.
+	std::vector<unsigned> mSlot;
+	std::vector<Handle> mFreeHandles;
+
+	size_t mLiveCount;
+	unsigned mFirstDirty;
+	unsigned mUpdateCount;
+	UpdateStats mStats;
+	bool mNeedsReorder;
+};
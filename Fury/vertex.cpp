@@ -1,4 +1,4 @@
-#include "Vertex.h"
+#include "vertex.h"
 
 Vertex3D::Vertex3D()
 {
@@ -37,4 +37,17 @@ Vertex2D::Vertex2D(float x_, float y_, float u_, float v_)
 	y = y_;
 	u = u_;
 	v = v_;
-}
\ No newline at end of file
+}
+
+unsigned vertexStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case VERTEX_QUANTIZED:
+		return sizeof(QuantizedVertex);
+	case VERTEX_QUANTIZED_COMPACT:
+		return sizeof(CompactQuantizedVertex);
+	default:
+		return sizeof(Vertex3D);
+	}
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 typedef int ElementIndexType;
 #define ELEMENT_INDEX_TYPE_ENUM DXGI_FORMAT_R32_UINT
 
@@ -43,4 +44,34 @@ public:
 	@param v_ The v UV coordinate.
 	*/
 	Vertex2D(float x_, float y_, float u_, float v_);
-};
\ No newline at end of file
+};
+
+/**The layouts the vertices of a mesh can be stored and drawn in.*/
+enum VertexFormat
+{
+	VERTEX_FLOAT, //Vertex3D.
+	VERTEX_QUANTIZED, //QuantizedVertex.
+	VERTEX_QUANTIZED_COMPACT, //CompactQuantizedVertex.
+	VERTEX_FORMAT_COUNT
+};
+
+/**Returns the size of a vertex of a format.*/
+unsigned vertexStride(VertexFormat format);
+
+/**A Vertex3D in 16 bytes, as encoded by quantizeVertices. The position is quantized to 16 bits an axis against the
+box bounding the mesh, the fourth unused; the normal is octahedral encoded in two signed normalised 16 bit values;
+the UV is in half floats.*/
+struct QuantizedVertex
+{
+	uint16_t position[4];
+	int16_t normal[2];
+	uint16_t uv[2];
+};
+
+/**As QuantizedVertex in 12 bytes, with 8 bits for each value of the normal.*/
+struct CompactQuantizedVertex
+{
+	uint16_t position[3];
+	int8_t normal[2];
+	uint16_t uv[2];
+};
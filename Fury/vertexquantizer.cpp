@@ -0,0 +1,248 @@
+#include "vertexquantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float kDegreesPerRadian = 57.2957795f;
+
+	/**Converts to a half float, rounding to the nearest and clamping to the largest finite half.*/
+	uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int exponent = int((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFF;
+
+		if (value != value)
+			return 0x7E00;
+		if (exponent >= 31)
+			return uint16_t(sign | 0x7BFF);
+
+		//Below the smallest normal half, the implicit bit moves into the mantissa.
+		int shift = 13;
+		uint32_t half = (uint32_t(std::max(exponent, 0)) << 10);
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return uint16_t(sign);
+			mantissa |= 0x800000;
+			shift = 14 - exponent;
+		}
+		half |= mantissa >> shift;
+		const uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			++half; //Carries into the exponent where it must.
+		return uint16_t(sign | std::min(half, 0x7BFFu));
+	}
+
+	float halfToFloat(uint16_t half)
+	{
+		const int exponent = (half >> 10) & 0x1F;
+		const int mantissa = half & 0x3FF;
+		float value;
+		if (exponent == 0)
+			value = std::ldexp(float(mantissa), -24);
+		else if (exponent == 31)
+			value = mantissa ? NAN : INFINITY;
+		else
+			value = std::ldexp(float(mantissa | 0x400), exponent - 25);
+		return half & 0x8000 ? -value : value;
+	}
+
+	float signNotZero(float value)
+	{
+		return value < 0 ? -1.f : 1.f;
+	}
+
+	/**Maps a unit vector onto the octahedron and unfolds it onto the square [-1, 1]^2.*/
+	void octahedralEncode(const float normal[3], float& x, float& y)
+	{
+		const float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+		x = length > 0 ? normal[0] / length : 0;
+		y = length > 0 ? normal[1] / length : 0;
+		if (normal[2] < 0)
+		{
+			const float foldedX = (1 - std::fabs(y)) * signNotZero(x);
+			y = (1 - std::fabs(x)) * signNotZero(y);
+			x = foldedX;
+		}
+	}
+
+	/**The inverse of octahedralEncode, as in the vertex shader.*/
+	void octahedralDecode(float x, float y, float normal[3])
+	{
+		normal[0] = x;
+		normal[1] = y;
+		normal[2] = 1 - std::fabs(x) - std::fabs(y);
+		const float fold = std::max(-normal[2], 0.f);
+		normal[0] += normal[0] >= 0 ? -fold : fold;
+		normal[1] += normal[1] >= 0 ? -fold : fold;
+		const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int axis = 0; axis < 3; ++axis)
+			normal[axis] /= length;
+	}
+
+	/**Signed normalised values, decoded as Direct3D does: the most negative one is -1 as well.*/
+	float snormToFloat(int value, int max)
+	{
+		return std::max(float(value) / float(max), -1.f);
+	}
+
+	/**Encodes a normal in two signed normalised values of max steps each side of zero, rounding whichever way
+	decodes closest to it rather than to the nearest, which halves the worst error.*/
+	void encodeNormal(const Vertex3D& vertex, int max, int& encodedX, int& encodedY)
+	{
+		const float length = std::sqrt(vertex.normx * vertex.normx + vertex.normy * vertex.normy +
+			vertex.normz * vertex.normz);
+		const float normal[3] = { length > 0 ? vertex.normx / length : 0, length > 0 ? vertex.normy / length : 0,
+			length > 0 ? vertex.normz / length : 1 };
+		float x, y;
+		octahedralEncode(normal, x, y);
+
+		const float scaledX = x * float(max), scaledY = y * float(max);
+		float best = -2;
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			const int candidateX = int(corner & 1 ? std::ceil(scaledX) : std::floor(scaledX));
+			const int candidateY = int(corner & 2 ? std::ceil(scaledY) : std::floor(scaledY));
+			float decoded[3];
+			octahedralDecode(snormToFloat(candidateX, max), snormToFloat(candidateY, max), decoded);
+			const float cosine = decoded[0] * normal[0] + decoded[1] * normal[1] + decoded[2] * normal[2];
+			if (cosine > best)
+			{
+				best = cosine;
+				encodedX = candidateX;
+				encodedY = candidateY;
+			}
+		}
+	}
+
+	uint16_t quantizePosition(float value, float min, float max)
+	{
+		if (!(max > min))
+			return 0;
+		const float scaled = (value - min) / (max - min) * 65535.f + 0.5f;
+		return uint16_t(std::min(std::max(scaled, 0.f), 65535.f));
+	}
+}
+
+bool quantizeVertices(const Vertex3D* vertices, unsigned count, VertexFormat format, const float boundsMin[3],
+	const float boundsMax[3], void* out, QuantizationError* error)
+{
+	if (format != VERTEX_QUANTIZED && format != VERTEX_QUANTIZED_COMPACT)
+		return false;
+
+	const unsigned stride = vertexStride(format);
+	unsigned char* bytes = static_cast<unsigned char*>(out);
+	double positionSum = 0, normalSum = 0, uvSum = 0;
+	if (error)
+		std::memset(error, 0, sizeof(*error));
+
+	for (unsigned v = 0; v < count; ++v)
+	{
+		const Vertex3D& vertex = vertices[v];
+		const float position[3] = { vertex.x, vertex.y, vertex.z };
+		uint16_t quantized[3];
+		for (int axis = 0; axis < 3; ++axis)
+			quantized[axis] = quantizePosition(position[axis], boundsMin[axis], boundsMax[axis]);
+		const uint16_t uv[2] = { floatToHalf(vertex.u), floatToHalf(vertex.v) };
+
+		int normalX, normalY;
+		if (format == VERTEX_QUANTIZED)
+		{
+			encodeNormal(vertex, 32767, normalX, normalY);
+			QuantizedVertex encoded;
+			std::copy(quantized, quantized + 3, encoded.position);
+			encoded.position[3] = 0;
+			encoded.normal[0] = int16_t(normalX);
+			encoded.normal[1] = int16_t(normalY);
+			std::copy(uv, uv + 2, encoded.uv);
+			std::memcpy(bytes + size_t(v) * stride, &encoded, sizeof(encoded));
+		}
+		else
+		{
+			encodeNormal(vertex, 127, normalX, normalY);
+			CompactQuantizedVertex encoded;
+			std::copy(quantized, quantized + 3, encoded.position);
+			encoded.normal[0] = int8_t(normalX);
+			encoded.normal[1] = int8_t(normalY);
+			std::copy(uv, uv + 2, encoded.uv);
+			std::memcpy(bytes + size_t(v) * stride, &encoded, sizeof(encoded));
+		}
+
+		if (!error)
+			continue;
+		const Vertex3D decoded = dequantizeVertex(bytes + size_t(v) * stride, format, boundsMin, boundsMax);
+		const float dx = decoded.x - vertex.x, dy = decoded.y - vertex.y, dz = decoded.z - vertex.z;
+		const float positionError = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		const float length = std::sqrt(vertex.normx * vertex.normx + vertex.normy * vertex.normy +
+			vertex.normz * vertex.normz);
+		float normalError = 0;
+		if (length > 0)
+		{
+			const float cosine = (decoded.normx * vertex.normx + decoded.normy * vertex.normy +
+				decoded.normz * vertex.normz) / length;
+			normalError = std::acos(std::min(std::max(cosine, -1.f), 1.f)) * kDegreesPerRadian;
+		}
+
+		const float uvError = std::max(std::fabs(decoded.u - vertex.u), std::fabs(decoded.v - vertex.v));
+
+		error->maxPosition = std::max(error->maxPosition, positionError);
+		error->maxNormalDegrees = std::max(error->maxNormalDegrees, normalError);
+		error->maxUV = std::max(error->maxUV, uvError);
+		positionSum += positionError;
+		normalSum += normalError;
+		uvSum += uvError;
+	}
+
+	if (error && count)
+	{
+		error->meanPosition = float(positionSum / count);
+		error->meanNormalDegrees = float(normalSum / count);
+		error->meanUV = float(uvSum / count);
+	}
+	return true;
+}
+
+Vertex3D dequantizeVertex(const void* vertex, VertexFormat format, const float boundsMin[3],
+	const float boundsMax[3])
+{
+	const uint16_t* position;
+	const uint16_t* uv;
+	float normalX, normalY;
+	QuantizedVertex quantized;
+	CompactQuantizedVertex compact;
+	if (format == VERTEX_QUANTIZED)
+	{
+		std::memcpy(&quantized, vertex, sizeof(quantized));
+		position = quantized.position;
+		normalX = snormToFloat(quantized.normal[0], 32767);
+		normalY = snormToFloat(quantized.normal[1], 32767);
+		uv = quantized.uv;
+	}
+	else if (format == VERTEX_QUANTIZED_COMPACT)
+	{
+		std::memcpy(&compact, vertex, sizeof(compact));
+		position = compact.position;
+		normalX = snormToFloat(compact.normal[0], 127);
+		normalY = snormToFloat(compact.normal[1], 127);
+		uv = compact.uv;
+	}
+	else
+	{
+		Vertex3D copy;
+		std::memcpy(&copy, vertex, sizeof(copy));
+		return copy;
+	}
+
+	float decoded[3], normal[3];
+	for (int axis = 0; axis < 3; ++axis)
+		decoded[axis] = boundsMin[axis] + float(position[axis]) / 65535.f * (boundsMax[axis] - boundsMin[axis]);
+	octahedralDecode(normalX, normalY, normal);
+	return Vertex3D(decoded[0], decoded[1], decoded[2], normal[0], normal[1], normal[2], halfToFloat(uv[0]),
+		halfToFloat(uv[1]));
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "vertex.h"
+#include <cstddef>
+
+/**How far quantized vertices are from the ones they were made from.*/
+struct QuantizationError
+{
+	float maxPosition, meanPosition; //Distance, in model space.
+	float maxNormalDegrees, meanNormalDegrees; //Angle between the normals.
+	float maxUV, meanUV; //Largest difference of u and v.
+};
+
+/**
+Encodes vertices in a quantized format, as the vertex shader decodes them. Positions are quantized against a box
+holding them all, which the mesh is drawn with; normals need not be of unit length.
+@param out Where the vertices go, vertexStride(format) bytes each.
+@param error If not NULL, is set to how far the decoded vertices are from the originals.
+@return False if the format is VERTEX_FLOAT, which needs no encoding.
+*/
+bool quantizeVertices(const Vertex3D* vertices, unsigned count, VertexFormat format, const float boundsMin[3],
+	const float boundsMax[3], void* out, QuantizationError* error = NULL);
+
+/**Decodes a quantized vertex, as the vertex shader does, with the box it was quantized against.*/
+Vertex3D dequantizeVertex(const void* vertex, VertexFormat format, const float boundsMin[3],
+	const float boundsMax[3]);
@@ -0,0 +1,463 @@
+#include "vmffile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	/**Continues a CRC-32 (the zlib one) over more bytes. Start from 0.*/
+	uint32_t crc32(uint32_t crc, const void* data, size_t size)
+	{
+		static uint32_t table[256];
+		static bool tableMade = false;
+		if (!tableMade)
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t c = i;
+				for (int bit = 0; bit < 8; ++bit)
+					c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			tableMade = true;
+		}
+
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i)
+			crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	/**The checksum of a header, headerSize bytes of it, as if its headerChecksum were zero, and its section table.*/
+	uint32_t headerChecksum(const unsigned char* file, size_t headerSize, const VMF2Section* sections,
+		size_t sectionCount)
+	{
+		const uint32_t zero = 0;
+		const size_t field = offsetof(VMF2Header, headerChecksum);
+		uint32_t crc = crc32(0, file, field);
+		crc = crc32(crc, &zero, sizeof(zero));
+		crc = crc32(crc, file + field + sizeof(zero), headerSize - field - sizeof(zero));
+		return crc32(crc, sections, sectionCount * sizeof(VMF2Section));
+	}
+
+	const size_t kAttributeCount = 3;
+
+	/**The attribute descriptors of the vertices of each VertexFormat.*/
+	const VMFAttribute kLayouts[VERTEX_FORMAT_COUNT][kAttributeCount] = {
+		{
+			{ VMF_SEMANTIC_POSITION, VMF_FORMAT_FLOAT3, uint32_t(offsetof(Vertex3D, x)), 0 },
+			{ VMF_SEMANTIC_NORMAL, VMF_FORMAT_FLOAT3, uint32_t(offsetof(Vertex3D, normx)), 0 },
+			{ VMF_SEMANTIC_TEXCOORD, VMF_FORMAT_FLOAT2, uint32_t(offsetof(Vertex3D, u)), 0 },
+		},
+		{
+			{ VMF_SEMANTIC_POSITION, VMF_FORMAT_UNORM16X4, uint32_t(offsetof(QuantizedVertex, position)), 0 },
+			{ VMF_SEMANTIC_NORMAL, VMF_FORMAT_OCTAHEDRAL_SNORM16X2, uint32_t(offsetof(QuantizedVertex, normal)), 0 },
+			{ VMF_SEMANTIC_TEXCOORD, VMF_FORMAT_HALF2, uint32_t(offsetof(QuantizedVertex, uv)), 0 },
+		},
+		{
+			{ VMF_SEMANTIC_POSITION, VMF_FORMAT_UNORM16X3, uint32_t(offsetof(CompactQuantizedVertex, position)), 0 },
+			{ VMF_SEMANTIC_NORMAL, VMF_FORMAT_OCTAHEDRAL_SNORM8X2, uint32_t(offsetof(CompactQuantizedVertex, normal)),
+				0 },
+			{ VMF_SEMANTIC_TEXCOORD, VMF_FORMAT_HALF2, uint32_t(offsetof(CompactQuantizedVertex, uv)), 0 },
+		},
+	};
+
+	/**Whether the attribute descriptors, in any order, are those of a format.*/
+	bool matchesLayout(const VMFAttribute* attributes, size_t count, VertexFormat format)
+	{
+		const VMFAttribute* layout = kLayouts[format];
+		if (count != kAttributeCount)
+			return false;
+		bool found[kAttributeCount] = {};
+		for (size_t a = 0; a < count; ++a)
+		{
+			size_t l = 0;
+			while (l < kAttributeCount && layout[l].semantic != attributes[a].semantic)
+				++l;
+			if (l == kAttributeCount || found[l] || layout[l].format != attributes[a].format ||
+				layout[l].offset != attributes[a].offset)
+				return false;
+			found[l] = true;
+		}
+		return true;
+	}
+
+	/**Finds the format of vertices of a stride with the attribute descriptors. Returns false if there is none.*/
+	bool findFormat(const VMFAttribute* attributes, size_t count, uint32_t stride, VertexFormat& format)
+	{
+		for (int f = 0; f < VERTEX_FORMAT_COUNT; ++f)
+			if (stride == vertexStride(VertexFormat(f)) && matchesLayout(attributes, count, VertexFormat(f)))
+			{
+				format = VertexFormat(f);
+				return true;
+			}
+		return false;
+	}
+
+	/**Grows a box to hold a vertex.*/
+	void include(float min[3], float max[3], const Vertex3D& vertex)
+	{
+		const float position[3] = { vertex.x, vertex.y, vertex.z };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			min[axis] = std::min(min[axis], position[axis]);
+			max[axis] = std::max(max[axis], position[axis]);
+		}
+	}
+
+	/**Pads a file with zeros up to an offset.*/
+	void padTo(std::ofstream& file, uint64_t offset)
+	{
+		static const char zeros[kVMFAlignment] = {};
+		const uint64_t at = uint64_t(file.tellp());
+		if (offset > at)
+			file.write(zeros, std::streamsize(offset - at));
+	}
+
+	uint64_t alignUp(uint64_t offset)
+	{
+		return (offset + kVMFAlignment - 1) / kVMFAlignment * kVMFAlignment;
+	}
+}
+
+VMFFile::VMFFile() : mVersion(0), mVertexData(NULL), mVertexFormat(VERTEX_FLOAT), mIndices(NULL), mVertexCount(0),
+	mIndexCount(0), mSubMeshes(NULL), mSubMeshCount(0)
+{
+	std::memset(&mBounds, 0, sizeof(mBounds));
+	std::memset(&mWholeMesh, 0, sizeof(mWholeMesh));
+}
+
+VMFFile::Status VMFFile::open(const char* path)
+{
+	close();
+
+	if (!mFile.open(path))
+		return CANNOT_OPEN;
+
+	const Status status = mFile.size() >= sizeof(kVMFMagic) &&
+		std::memcmp(mFile.data(), kVMFMagic, sizeof(kVMFMagic)) == 0 ? openVersion2() : openVersion1();
+	if (status != OK)
+		close();
+	return status;
+}
+
+VMFFile::Status VMFFile::openVersion1()
+{
+	if (mFile.size() < sizeof(VMFHeader))
+		return TOO_SHORT;
+
+	//The mapping starts on a page, so the header, the vertices after it and the indices after them are aligned.
+	const VMFHeader* header = reinterpret_cast<const VMFHeader*>(mFile.data());
+	const uint64_t expected = sizeof(VMFHeader) + uint64_t(header->vertCount) * sizeof(Vertex3D) +
+		uint64_t(header->indexCount) * sizeof(ElementIndexType);
+	if (expected != mFile.size())
+		return SIZE_MISMATCH;
+	if (!(header->objectRadius >= 0))
+		return BAD_BOUNDS;
+
+	mVersion = 1;
+	mVertexCount = header->vertCount;
+	mIndexCount = header->indexCount;
+	mVertexData = mFile.data() + sizeof(VMFHeader);
+	mVertexFormat = VERTEX_FLOAT;
+	mIndices = reinterpret_cast<const ElementIndexType*>(mFile.data() + sizeof(VMFHeader) + vertexBytes());
+
+	const float centre[3] = { header->centrePointX, header->centrePointY, header->centrePointZ };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		mBounds.min[axis] = centre[axis] - header->objectRadius;
+		mBounds.max[axis] = centre[axis] + header->objectRadius;
+		mBounds.centre[axis] = centre[axis];
+	}
+	mBounds.radius = header->objectRadius;
+
+	useWholeMesh();
+	return OK;
+}
+
+VMFFile::Status VMFFile::openVersion2()
+{
+	const unsigned char* data = mFile.data();
+	const uint64_t size = mFile.size();
+	if (size < sizeof(VMF2Header))
+		return TOO_SHORT;
+
+	const VMF2Header* header = reinterpret_cast<const VMF2Header*>(data);
+	if (header->version != kVMFVersion || header->headerSize < sizeof(VMF2Header))
+		return UNSUPPORTED_VERSION;
+	if (header->fileSize != size || header->headerSize > size)
+		return SIZE_MISMATCH;
+	if (header->sectionTableOffset % sizeof(uint64_t) != 0 ||
+		header->sectionTableOffset + uint64_t(header->sectionCount) * sizeof(VMF2Section) > size)
+		return BAD_SECTION;
+
+	const VMF2Section* sections = reinterpret_cast<const VMF2Section*>(data + header->sectionTableOffset);
+	if (headerChecksum(data, header->headerSize, sections, header->sectionCount) != header->headerChecksum)
+		return BAD_CHECKSUM;
+
+	const VMF2Section* vertices = NULL;
+	const VMF2Section* indices = NULL;
+	const VMF2Section* attributes = NULL;
+	const VMF2Section* subMeshes = NULL;
+	for (uint32_t s = 0; s < header->sectionCount; ++s)
+	{
+		const VMF2Section& section = sections[s];
+		if (section.offset % kVMFAlignment != 0 || section.offset > size || section.size > size - section.offset ||
+			section.elementSize == 0 || section.size % section.elementSize != 0)
+			return BAD_SECTION;
+
+		const VMF2Section** known = NULL;
+		switch (section.type)
+		{
+		case VMF_SECTION_VERTICES:
+			known = &vertices;
+			break;
+		case VMF_SECTION_INDICES:
+			known = &indices;
+			break;
+		case VMF_SECTION_ATTRIBUTES:
+			known = &attributes;
+			break;
+		case VMF_SECTION_SUBMESHES:
+			known = &subMeshes;
+			break;
+		}
+		if (known)
+		{
+			if (*known)
+				return BAD_SECTION;
+			*known = &section;
+		}
+	}
+
+	if (!vertices || !indices || !attributes)
+		return MISSING_SECTION;
+	VertexFormat format;
+	if (indices->elementSize != sizeof(ElementIndexType) || attributes->elementSize != sizeof(VMFAttribute) ||
+		(subMeshes && subMeshes->elementSize != sizeof(VMFSubMesh)) ||
+		!findFormat(reinterpret_cast<const VMFAttribute*>(data + attributes->offset),
+			size_t(attributes->size / sizeof(VMFAttribute)), vertices->elementSize, format))
+		return UNSUPPORTED_FORMAT;
+	if (vertices->size / vertices->elementSize > 0xFFFFFFFFu ||
+		indices->size / sizeof(ElementIndexType) > 0xFFFFFFFFu)
+		return UNSUPPORTED_FORMAT;
+
+	if (!(header->sphereRadius >= 0))
+		return BAD_BOUNDS;
+	for (int axis = 0; axis < 3; ++axis)
+		if (!(header->boundsMin[axis] <= header->boundsMax[axis]))
+			return BAD_BOUNDS;
+
+	mVertexCount = unsigned(vertices->size / vertices->elementSize);
+	mIndexCount = unsigned(indices->size / sizeof(ElementIndexType));
+	if (subMeshes)
+	{
+		mSubMeshes = reinterpret_cast<const VMFSubMesh*>(data + subMeshes->offset);
+		mSubMeshCount = unsigned(subMeshes->size / sizeof(VMFSubMesh));
+		for (unsigned m = 0; m < mSubMeshCount; ++m)
+			if (uint64_t(mSubMeshes[m].firstIndex) + mSubMeshes[m].indexCount > mIndexCount)
+				return BAD_SUBMESH;
+	}
+
+	mVersion = kVMFVersion;
+	mVertexData = data + vertices->offset;
+	mVertexFormat = format;
+	mIndices = reinterpret_cast<const ElementIndexType*>(data + indices->offset);
+	std::memcpy(mBounds.min, header->boundsMin, sizeof(mBounds.min));
+	std::memcpy(mBounds.max, header->boundsMax, sizeof(mBounds.max));
+	std::memcpy(mBounds.centre, header->sphereCentre, sizeof(mBounds.centre));
+	mBounds.radius = header->sphereRadius;
+
+	if (!subMeshes)
+		useWholeMesh();
+	return OK;
+}
+
+void VMFFile::useWholeMesh()
+{
+	mWholeMesh.firstIndex = 0;
+	mWholeMesh.indexCount = mIndexCount;
+	mWholeMesh.baseVertex = 0;
+	mWholeMesh.material = 0;
+	std::memcpy(mWholeMesh.boundsMin, mBounds.min, sizeof(mBounds.min));
+	std::memcpy(mWholeMesh.boundsMax, mBounds.max, sizeof(mBounds.max));
+	mSubMeshes = &mWholeMesh;
+	mSubMeshCount = 1;
+}
+
+void VMFFile::close()
+{
+	mFile.close();
+	mVersion = 0;
+	mVertexData = NULL;
+	mVertexFormat = VERTEX_FLOAT;
+	mIndices = NULL;
+	mVertexCount = 0;
+	mIndexCount = 0;
+	mSubMeshes = NULL;
+	mSubMeshCount = 0;
+}
+
+bool VMFFile::verifyChecksums() const
+{
+	if (mVersion != kVMFVersion)
+		return mVersion == 1;
+
+	const VMF2Header* header = reinterpret_cast<const VMF2Header*>(mFile.data());
+	const VMF2Section* sections = reinterpret_cast<const VMF2Section*>(mFile.data() + header->sectionTableOffset);
+	for (uint32_t s = 0; s < header->sectionCount; ++s)
+		if (crc32(0, mFile.data() + sections[s].offset, size_t(sections[s].size)) != sections[s].checksum)
+			return false;
+	return true;
+}
+
+bool VMFFile::write(const char* path, const Vertex3D* vertices, unsigned vertexCount,
+	const ElementIndexType* indices, unsigned indexCount, const VMFSubMesh* subMeshes, unsigned subMeshCount,
+	VertexFormat format, QuantizationError* error)
+{
+	VMFSubMesh wholeMesh = { 0, indexCount, 0, 0, {}, {} };
+	if (subMeshCount == 0)
+	{
+		subMeshes = &wholeMesh;
+		subMeshCount = 1;
+	}
+
+	//The bounds of each part are of the vertices its indices use; those of the mesh, of all its vertices.
+	std::vector<VMFSubMesh> parts(subMeshes, subMeshes + subMeshCount);
+	for (unsigned m = 0; m < subMeshCount; ++m)
+	{
+		VMFSubMesh& part = parts[m];
+		if (uint64_t(part.firstIndex) + part.indexCount > indexCount)
+			return false;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			part.boundsMin[axis] = part.indexCount ? HUGE_VALF : 0;
+			part.boundsMax[axis] = part.indexCount ? -HUGE_VALF : 0;
+		}
+		for (unsigned i = part.firstIndex; i < part.firstIndex + part.indexCount; ++i)
+		{
+			const int64_t vertex = int64_t(indices[i]) + part.baseVertex;
+			if (vertex < 0 || vertex >= vertexCount)
+				return false;
+			include(part.boundsMin, part.boundsMax, vertices[vertex]);
+		}
+	}
+
+	VMF2Header header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, kVMFMagic, sizeof(kVMFMagic));
+	header.version = kVMFVersion;
+	header.headerSize = sizeof(VMF2Header);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = vertexCount ? HUGE_VALF : 0;
+		header.boundsMax[axis] = vertexCount ? -HUGE_VALF : 0;
+	}
+	for (unsigned v = 0; v < vertexCount; ++v)
+		include(header.boundsMin, header.boundsMax, vertices[v]);
+	float radiusSquared = 0;
+	for (int axis = 0; axis < 3; ++axis)
+		header.sphereCentre[axis] = (header.boundsMin[axis] + header.boundsMax[axis]) * 0.5f;
+	for (unsigned v = 0; v < vertexCount; ++v)
+	{
+		const float dx = vertices[v].x - header.sphereCentre[0], dy = vertices[v].y - header.sphereCentre[1],
+			dz = vertices[v].z - header.sphereCentre[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	header.sphereRadius = std::sqrt(radiusSquared);
+
+	//Quantized positions are within half a step of each axis of the originals, so the sphere grows by as much.
+	const void* vertexData = vertices;
+	std::vector<unsigned char> quantized;
+	if (format != VERTEX_FLOAT)
+	{
+		quantized.resize(size_t(vertexCount) * vertexStride(format));
+		quantizeVertices(vertices, vertexCount, format, header.boundsMin, header.boundsMax, quantized.data(), error);
+		vertexData = quantized.data();
+		float stepSquared = 0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float halfStep = (header.boundsMax[axis] - header.boundsMin[axis]) / 65535.f * 0.5f;
+			stepSquared += halfStep * halfStep;
+		}
+		header.sphereRadius += std::sqrt(stepSquared);
+	}
+	const VMFAttribute* attributes = kLayouts[format];
+	const uint32_t stride = vertexStride(format);
+	const struct
+	{
+		uint32_t type, elementSize;
+		const void* data;
+		uint64_t size;
+	} contents[] = {
+		{ VMF_SECTION_ATTRIBUTES, sizeof(VMFAttribute), attributes, kAttributeCount * sizeof(VMFAttribute) },
+		{ VMF_SECTION_SUBMESHES, sizeof(VMFSubMesh), parts.data(), parts.size() * sizeof(VMFSubMesh) },
+		{ VMF_SECTION_VERTICES, stride, vertexData, uint64_t(vertexCount) * stride },
+		{ VMF_SECTION_INDICES, sizeof(ElementIndexType), indices, uint64_t(indexCount) * sizeof(ElementIndexType) },
+	};
+	const uint32_t sectionCount = sizeof(contents) / sizeof(contents[0]);
+
+	//The section table follows the header, and the sections the table, each on the alignment.
+	VMF2Section sections[sectionCount];
+	uint64_t offset = sizeof(VMF2Header) + sizeof(sections);
+	for (uint32_t s = 0; s < sectionCount; ++s)
+	{
+		offset = alignUp(offset);
+		sections[s].type = contents[s].type;
+		sections[s].elementSize = contents[s].elementSize;
+		sections[s].offset = offset;
+		sections[s].size = contents[s].size;
+		sections[s].checksum = crc32(0, contents[s].data, size_t(contents[s].size));
+		sections[s].reserved = 0;
+		offset += contents[s].size;
+	}
+	header.fileSize = offset;
+	header.sectionTableOffset = sizeof(VMF2Header);
+	header.sectionCount = sectionCount;
+	header.headerChecksum = headerChecksum(reinterpret_cast<const unsigned char*>(&header), sizeof(header),
+		sections, sectionCount);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+	for (uint32_t s = 0; s < sectionCount; ++s)
+	{
+		padTo(file, sections[s].offset);
+		file.write(static_cast<const char*>(contents[s].data), std::streamsize(contents[s].size));
+	}
+	return !file.fail();
+}
+
+const char* VMFFile::describe(Status status)
+{
+	switch (status)
+	{
+	case OK:
+		return "no error";
+	case CANNOT_OPEN:
+		return "the file could not be opened, or is empty";
+	case TOO_SHORT:
+		return "the file is shorter than its header";
+	case SIZE_MISMATCH:
+		return "the file is not the size its header gives";
+	case BAD_BOUNDS:
+		return "the bounds are invalid";
+	case UNSUPPORTED_VERSION:
+		return "the file is of an unsupported version of the format";
+	case BAD_CHECKSUM:
+		return "the header or the section table is corrupt";
+	case BAD_SECTION:
+		return "a section is outside the file, misaligned or repeated";
+	case MISSING_SECTION:
+		return "the vertices, indices or vertex attributes are missing";
+	case UNSUPPORTED_FORMAT:
+		return "the vertices or indices are in an unsupported format";
+	case BAD_SUBMESH:
+		return "a sub-mesh goes past the end of the indices";
+	}
+	return "unknown error";
+}
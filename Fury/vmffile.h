@@ -0,0 +1,111 @@
+#pragma once
+#include "mappedfile.h"
+#include "vmfheader.h"
+#include "vertex.h"
+#include "vertexquantizer.h"
+
+/**A .vmf model read in place: the file is mapped and the vertices and indices are used straight from the mapping,
+so loading copies nothing and touches only the header and the tables. Versions 1 and 2 of the format are read; for
+version 1 the box bounds are the cube around the bounding sphere, and there is one sub-mesh, the whole mesh.
+
+The header and the sections are checked against the file's size; the indices are not checked against the vertex
+count, nor the sections against their checksums unless verifyChecksums() is called, as that would read the whole
+file.*/
+class VMFFile
+{
+public:
+	enum Status
+	{
+		OK,
+		CANNOT_OPEN,
+		TOO_SHORT, //Smaller than the header.
+		SIZE_MISMATCH, //Not the size the header gives, or for version 1, the counts in it make.
+		BAD_BOUNDS, //The bounding radius is negative or not a number, or the box is inside out.
+		UNSUPPORTED_VERSION,
+		BAD_CHECKSUM, //The header or the section table is corrupt.
+		BAD_SECTION, //A section is outside the file, misaligned, not a whole number of elements, or there twice.
+		MISSING_SECTION, //There are no vertices, indices or attribute descriptors.
+		UNSUPPORTED_FORMAT, //The vertices are not in a VertexFormat, or the indices not ElementIndexType.
+		BAD_SUBMESH //A sub-mesh's indices go past the end of the indices.
+	};
+
+	/**The shape around the vertices, in model space.*/
+	struct Bounds
+	{
+		float min[3], max[3];
+		float centre[3], radius;
+	};
+
+	VMFFile();
+
+	/**Maps and checks the file, closing the one opened before. Nothing is left open unless it returns OK.*/
+	Status open(const char* path);
+
+	/**Unmaps the file. The pointers returned before are invalid afterwards.*/
+	void close();
+
+	bool isOpen() const { return mVertexData != NULL; }
+
+	/**Returns the version of the format the file is in.*/
+	unsigned version() const { return mVersion; }
+
+	/**Returns the vertices and indices in the mapping, vertexCount() and indexCount() of them. Quantized vertices
+	are decoded against the box of bounds().*/
+	const void* vertexData() const { return mVertexData; }
+	VertexFormat vertexFormat() const { return mVertexFormat; }
+	const ElementIndexType* indices() const { return mIndices; }
+	unsigned vertexCount() const { return mVertexCount; }
+	unsigned indexCount() const { return mIndexCount; }
+
+	/**Returns the vertices if they are in VERTEX_FLOAT, or NULL.*/
+	const Vertex3D* vertices() const
+	{
+		return mVertexFormat == VERTEX_FLOAT ? static_cast<const Vertex3D*>(mVertexData) : NULL;
+	}
+
+	/**Returns the size of the vertices and indices in bytes.*/
+	size_t vertexBytes() const { return size_t(mVertexCount) * vertexStride(mVertexFormat); }
+	size_t indexBytes() const { return size_t(mIndexCount) * sizeof(ElementIndexType); }
+
+	const Bounds& bounds() const { return mBounds; }
+
+	/**Returns the parts of the mesh, subMeshCount() of them, in the mapping or, for version 1, in the VMFFile.*/
+	const VMFSubMesh* subMeshes() const { return mSubMeshes; }
+	unsigned subMeshCount() const { return mSubMeshCount; }
+
+	/**Reads every section of a version 2 file and checks it against its checksum. Version 1 files have none, so
+	they always pass.*/
+	bool verifyChecksums() const;
+
+	/**
+	Writes a version 2 file, with the bounds of the mesh and of each part worked out from the vertices.
+	@param subMeshes The parts of the mesh; if there are none, the whole mesh is written as one.
+	@param format The format to store the vertices in, quantizing them against the mesh's box.
+	@param error If not NULL and the vertices are quantized, is set to how far they are from the originals.
+	@return False if the file could not be written or an index, with its part's base vertex, is not a vertex.
+	*/
+	static bool write(const char* path, const Vertex3D* vertices, unsigned vertexCount,
+		const ElementIndexType* indices, unsigned indexCount, const VMFSubMesh* subMeshes = NULL,
+		unsigned subMeshCount = 0, VertexFormat format = VERTEX_FLOAT, QuantizationError* error = NULL);
+
+	/**Returns a description of a status, for error messages.*/
+	static const char* describe(Status status);
+
+private:
+	Status openVersion1();
+	Status openVersion2();
+
+	/**Makes the whole mesh the one sub-mesh, for files without a table of them.*/
+	void useWholeMesh();
+
+	MappedFile mFile;
+	unsigned mVersion;
+	const void* mVertexData;
+	VertexFormat mVertexFormat;
+	const ElementIndexType* mIndices;
+	unsigned mVertexCount, mIndexCount;
+	Bounds mBounds;
+	const VMFSubMesh* mSubMeshes;
+	unsigned mSubMeshCount;
+	VMFSubMesh mWholeMesh; //The sub-mesh of version 1 files.
+};
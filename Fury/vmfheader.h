@@ -1,6 +1,8 @@
 #pragma once
+#include <cstdint>
 
-/**The VMP model format header struct to be used when loading models.*/
+/**The VMP model format header struct to be used when loading models. This is version 1: the header is followed by
+vertCount vertices and indexCount indices, and nothing else.*/
 struct VMFHeader
 {
 	unsigned vertCount;
@@ -9,4 +11,96 @@ struct VMFHeader
 	float centrePointX;
 	float centrePointY;
 	float centrePointZ;
-};
\ No newline at end of file
+};
+
+/*
+Version 2 of the format, all little-endian:
+
+	VMF2Header                       at offset 0
+	VMF2Section[sectionCount]        at sectionTableOffset
+	sections                         each at a multiple of kVMFAlignment
+
+The header starts with kVMFMagic, which as a version 1 vertex count would need a file of dozens of gigabytes, so the
+two versions cannot be mistaken for each other. headerChecksum covers the header, with the field itself zero, and the
+section table; each section has its own checksum, which loading does not check, so that it touches only what it
+reads. Sections of types a reader does not know are skipped, so later versions can add them.
+*/
+
+const unsigned char kVMFMagic[4] = { 0x89, 'V', 'M', 'F' };
+const uint32_t kVMFVersion = 2;
+
+/**The alignment of the sections in the file; the mapping starts on a page, so it is their alignment in memory too.*/
+const uint32_t kVMFAlignment = 64;
+
+struct VMF2Header
+{
+	unsigned char magic[4];
+	uint32_t version;
+	uint32_t headerSize; //sizeof(VMF2Header); later versions may append fields.
+	uint32_t headerChecksum; //CRC-32 of the header and the section table.
+	uint64_t fileSize;
+	uint32_t sectionTableOffset;
+	uint32_t sectionCount;
+	float boundsMin[3]; //The axis aligned box bounding the vertices, in model space, that quantizes positions.
+	float boundsMax[3];
+	float sphereCentre[3]; //The sphere bounding the vertices, in model space.
+	float sphereRadius;
+};
+
+enum VMFSectionType
+{
+	VMF_SECTION_VERTICES = 1, //elementSize is the vertex stride.
+	VMF_SECTION_INDICES = 2, //elementSize is the size of an index.
+	VMF_SECTION_ATTRIBUTES = 3, //VMFAttribute descriptors of the vertices.
+	VMF_SECTION_SUBMESHES = 4 //VMFSubMesh ranges.
+};
+
+struct VMF2Section
+{
+	uint32_t type; //A VMFSectionType.
+	uint32_t elementSize;
+	uint64_t offset; //From the start of the file, a multiple of kVMFAlignment.
+	uint64_t size; //In bytes, a multiple of elementSize.
+	uint32_t checksum; //CRC-32 of the section's bytes.
+	uint32_t reserved;
+};
+
+enum VMFSemantic
+{
+	VMF_SEMANTIC_POSITION = 1,
+	VMF_SEMANTIC_NORMAL = 2,
+	VMF_SEMANTIC_TEXCOORD = 3
+};
+
+/**How an attribute is stored. The quantized formats are those of QuantizedVertex and CompactQuantizedVertex:
+positions are fractions of the header's box, normals are octahedral encoded, and UVs are half floats.*/
+enum VMFFormat
+{
+	VMF_FORMAT_FLOAT2 = 1,
+	VMF_FORMAT_FLOAT3 = 2,
+	VMF_FORMAT_UNORM16X3 = 3,
+	VMF_FORMAT_UNORM16X4 = 4, //The fourth value is padding.
+	VMF_FORMAT_OCTAHEDRAL_SNORM16X2 = 5,
+	VMF_FORMAT_OCTAHEDRAL_SNORM8X2 = 6,
+	VMF_FORMAT_HALF2 = 7
+};
+
+/**Where one attribute sits in a vertex, and how it is stored.*/
+struct VMFAttribute
+{
+	uint32_t semantic; //A VMFSemantic.
+	uint32_t format; //A VMFFormat.
+	uint32_t offset; //From the start of the vertex.
+	uint32_t reserved;
+};
+
+/**A part of the mesh, drawn from its own range of the indices. Version 1 files have one, the whole mesh.*/
+struct VMFSubMesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t baseVertex; //Added to the part's indices.
+	uint32_t material; //For the game to interpret; 0 if the part has none.
+	float boundsMin[3];
+	float boundsMax[3];
+};
@@ -0,0 +1,127 @@
+#include "workerpool.h"
+#include <algorithm>
+
+namespace
+{
+	//Set while a thread executes a chunk, so that nested parallelFor calls run inline instead of deadlocking.
+	thread_local bool tInsideJob = false;
+}
+
+WorkerPool::WorkerPool(size_t workerCount)
+	: mJob(nullptr), mJobCount(0), mChunkSize(0), mNextChunk(0), mActiveWorkers(0), mGeneration(0), mStopping(false)
+{
+	start(workerCount);
+}
+
+WorkerPool::~WorkerPool()
+{
+	stop();
+}
+
+WorkerPool& WorkerPool::instance()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+size_t WorkerPool::threadCount() const
+{
+	return mWorkers.size() + 1;
+}
+
+void WorkerPool::setWorkerCount(size_t workerCount)
+{
+	std::lock_guard<std::mutex> submit(mSubmitMutex);
+	stop();
+	start(workerCount);
+}
+
+void WorkerPool::start(size_t workerCount)
+{
+	mStopping = false;
+	mWorkers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; ++i)
+		mWorkers.push_back(std::thread(&WorkerPool::workerLoop, this, mGeneration));
+}
+
+void WorkerPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+	for (size_t i = 0; i < mWorkers.size(); ++i)
+		mWorkers[i].join();
+	mWorkers.clear();
+}
+
+void WorkerPool::parallelFor(size_t count, size_t minChunk, const RangeFunction& func)
+{
+	if (count == 0)
+		return;
+
+	minChunk = std::max<size_t>(minChunk, 1);
+	if (mWorkers.empty() || tInsideJob || count < minChunk * 2)
+	{
+		func(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(mSubmitMutex);
+
+	//A few chunks per thread keeps the load balanced when some chunks are slower than others.
+	size_t chunkSize = std::max(minChunk, (count + threadCount() * 4 - 1) / (threadCount() * 4));
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJob = &func;
+		mJobCount = count;
+		mChunkSize = chunkSize;
+		mNextChunk = 0;
+		mActiveWorkers = mWorkers.size();
+		++mGeneration;
+	}
+	mWake.notify_all();
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDone.wait(lock, [this]() { return mActiveWorkers == 0; });
+	mJob = nullptr;
+}
+
+void WorkerPool::runChunks()
+{
+	tInsideJob = true;
+	for (;;)
+	{
+		size_t begin = mNextChunk.fetch_add(mChunkSize);
+		if (begin >= mJobCount)
+			break;
+		(*mJob)(begin, std::min(begin + mChunkSize, mJobCount));
+	}
+	tInsideJob = false;
+}
+
+void WorkerPool::workerLoop(unsigned seenGeneration)
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [&]() { return mStopping || mGeneration != seenGeneration; });
+			if (mStopping)
+				return;
+			seenGeneration = mGeneration;
+		}
+
+		runChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			--mActiveWorkers;
+		}
+		mDone.notify_one();
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**A fixed set of worker threads for splitting data-parallel loops. The calling thread always takes part in the work,
+so a pool with zero workers simply runs everything inline.*/
+class WorkerPool
+{
+public:
+	/**The loop body, called with a half open range [begin, end) of the indices.*/
+	typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+	/**Creates the pool.
+	@param workerCount The number of threads to start in addition to the caller.*/
+	explicit WorkerPool(size_t workerCount);
+
+	/**Stops and joins all workers.*/
+	~WorkerPool();
+
+	/**Returns the shared pool, which has one worker less than the number of hardware threads.*/
+	static WorkerPool& instance();
+
+	/**Returns the number of threads that take part in a parallelFor, including the caller.*/
+	size_t threadCount() const;
+
+	/**Restarts the pool with a new number of workers. Must not be called during a parallelFor.*/
+	void setWorkerCount(size_t workerCount);
+
+	/**Calls func over [0, count) in chunks of at least minChunk indices, spread over the workers and the caller.
+	Returns once every chunk has finished. Ranges smaller than two chunks run inline on the caller.
+	Nested calls from inside func also run inline.*/
+	void parallelFor(size_t count, size_t minChunk, const RangeFunction& func);
+
+private:
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+
+	void start(size_t workerCount);
+	void stop();
+	void workerLoop(unsigned seenGeneration);
+	void runChunks();
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	std::mutex mSubmitMutex;
+
+	//The job being executed. Guarded by mMutex except for the atomics.
+	const RangeFunction* mJob;
+	size_t mJobCount;
+	size_t mChunkSize;
+	std::atomic<size_t> mNextChunk;
+	size_t mActiveWorkers;
+	unsigned mGeneration;
+	bool mStopping;
+};